@@ -22,7 +22,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021  The University of Edinburgh
+ *  (c) 2010-2023  The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -46,6 +46,9 @@ __global__ void advflux_cs_2nd_kernel(kernel_ctxt_t * ktx, advflux_t * flux,
 				      hydro_t * hydro, field_t * field);
 __global__ void advflux_cs_3rd_kernel_v(kernel_ctxt_t * ktx, advflux_t * flux, 
 					hydro_t * hydro, field_t * field);
+__global__ void advflux_cs_stencil_kernel_v(kernel_ctxt_t * ktx,
+					    advflux_t * flux, hydro_t * hydro,
+					    field_t * field, int scheme);
 
 /* Lees-Edwards (via "advection_x()") */
 
@@ -56,12 +59,13 @@ int advection_le_2nd(advflux_t * flux, hydro_t * hydro, field_t * field);
 __host__
 int advection_le_3rd(advflux_t * flux, hydro_t * hydro, field_t * field);
 
-static int advection_le_4th(advflux_t * flux, hydro_t * hydro, int nf,
-			    double * f);
-static int advection_le_5th(advflux_t * flux, hydro_t * hydro, int nf,
-			    double * f);
+__host__
+int advection_le_stencil(advflux_t * flux, hydro_t * hydro, field_t * field,
+			 int scheme);
 
 __global__ void advflux_zero_kernel(kernel_ctxt_t * ktx, advflux_t * flx);
+__global__ void advflux_scale_kernel(kernel_ctxt_t * ktx, advflux_t * flx,
+				     double a);
 
 __global__
 void advection_le_1st_kernel(kernel_ctxt_t * ktx, advflux_t * flux,
@@ -79,19 +83,28 @@ __global__
 void advection_le_3rd_kernel_v(kernel_ctxt_t * ktx, lees_edw_t * le,
 			       advflux_t * flux,
 			       hydro_t * hydro, field_t * field);
+__global__
+void advection_le_stencil_kernel_v(kernel_ctxt_t * ktx, lees_edw_t * le,
+				   advflux_t * flux, hydro_t * hydro,
+				   field_t * field, int scheme);
 
 
 /* SCHEDULED FOR DELETION! */
 static int order_ = 1; /* Default is upwind (bad!) */
+static int scheme_ = ADVFLUX_SCHEME_DEFAULT; /* Limited scheme, if any */
 
 /*****************************************************************************
  *
  *  advection_order_set
  *
+ *  The run time default order of the linear schemes (1-5).
+ *
  *****************************************************************************/
 
 int advection_order_set(const int n) {
 
+  assert(1 <= n && n <= 5);
+
   order_ = n;
   return 0;
 }
@@ -111,6 +124,61 @@ int advection_order(int * order) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  advection_scheme_set
+ *
+ *  The run time limited scheme ADVFLUX_SCHEME_MUSCL or WENO5, which
+ *  takes precedence over the order. ADVFLUX_SCHEME_DEFAULT means
+ *  the linear scheme of order advection_order() is used.
+ *
+ *****************************************************************************/
+
+int advection_scheme_set(const int scheme) {
+
+  assert(scheme == ADVFLUX_SCHEME_DEFAULT || scheme == ADVFLUX_SCHEME_MUSCL ||
+	 scheme == ADVFLUX_SCHEME_WENO5);
+
+  scheme_ = scheme;
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  advection_scheme
+ *
+ *****************************************************************************/
+
+int advection_scheme(int * scheme) {
+
+  assert(scheme);
+
+  *scheme = scheme_;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  advflux_scheme_current
+ *
+ *  The scheme to be used by flux: the scheme of the object, if set,
+ *  otherwise the run time scheme, otherwise the run time order.
+ *
+ *****************************************************************************/
+
+static int advflux_scheme_current(const advflux_t * flux) {
+
+  int scheme = ADVFLUX_SCHEME_ORDER_1 + (order_ - 1);
+
+  assert(flux);
+
+  if (scheme_ != ADVFLUX_SCHEME_DEFAULT) scheme = scheme_;
+  if (flux->scheme != ADVFLUX_SCHEME_DEFAULT) scheme = flux->scheme;
+
+  return scheme;
+}
+
 /*****************************************************************************
  *
  *  advflux_cs_create
@@ -295,6 +363,26 @@ __host__ int advflux_free(advflux_t * obj) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  advflux_scheme_set
+ *
+ *  Select the scheme for this flux object. The default
+ *  ADVFLUX_SCHEME_DEFAULT uses the run time choice advection_scheme(),
+ *  or advection_order().
+ *
+ *****************************************************************************/
+
+__host__ int advflux_scheme_set(advflux_t * flux, int scheme) {
+
+  assert(flux);
+  assert(ADVFLUX_SCHEME_DEFAULT <= scheme && scheme <= ADVFLUX_SCHEME_WENO5);
+
+  flux->scheme = scheme;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  advflux_zero
@@ -369,6 +457,77 @@ __global__ void advflux_zero_kernel(kernel_ctxt_t * ktx, advflux_t * flux) {
   return;
 }
 
+/*****************************************************************************
+ *
+ *  advflux_scale
+ *
+ *  Multiply all face fluxes by a (e.g., a time step other than unity).
+ *
+ *****************************************************************************/
+
+__host__ int advflux_scale(advflux_t * flux, double a) {
+
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+
+  assert(flux);
+
+  cs_nlocal(flux->cs, nlocal);
+
+  limits.imin = 0; limits.imax = nlocal[X];
+  limits.jmin = 0; limits.jmax = nlocal[Y];
+  limits.kmin = 0; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(flux->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(advflux_scale_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, flux->target, a);
+
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  advflux_scale_kernel
+ *
+ *****************************************************************************/
+
+__global__ void advflux_scale_kernel(kernel_ctxt_t * ktx, advflux_t * flux,
+				     double a) {
+  int kindex;
+  __shared__ int kiter;
+
+  assert(ktx);
+  assert(flux);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    for (int ia = 0; ia < flux->nf; ia++) {
+      flux->fw[addr_rank1(flux->nsite, flux->nf, index, ia)] *= a;
+      flux->fe[addr_rank1(flux->nsite, flux->nf, index, ia)] *= a;
+      flux->fy[addr_rank1(flux->nsite, flux->nf, index, ia)] *= a;
+      flux->fz[addr_rank1(flux->nsite, flux->nf, index, ia)] *= a;
+    }
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  advflux_memcpy
@@ -432,13 +591,13 @@ __host__ int advflux_memcpy(advflux_t * adv, tdpMemcpyKind flag) {
 
 int advection_x(advflux_t * obj, hydro_t * hydro, field_t * field) {
 
-  int nf;
+  int scheme = ADVFLUX_SCHEME_DEFAULT;
 
   assert(obj);
   assert(hydro);
   assert(field);
 
-  field_nf(field, &nf);
+  scheme = advflux_scheme_current(obj);
 
   TIMER_start(ADVECTION_X_KERNEL);
 
@@ -452,28 +611,22 @@ int advection_x(advflux_t * obj, hydro_t * hydro, field_t * field) {
 
     /* For given LE , and given order, compute fluxes */
 
-    switch (order_) {
-    case 1:
+    switch (scheme) {
+    case ADVFLUX_SCHEME_ORDER_1:
       advection_le_1st(obj, hydro, field);
       break;
-    case 2:
+    case ADVFLUX_SCHEME_ORDER_2:
       advection_le_2nd(obj, hydro, field);
       break;
-    case 3:
+    case ADVFLUX_SCHEME_ORDER_3:
       advection_le_3rd(obj, hydro, field);
       break;
-    case 4:
-      /* No kernel available yet, hence copies ... */
-      advflux_memcpy(obj, tdpMemcpyDeviceToHost);
-      advection_le_4th(obj, hydro, nf, field->data);
-      advflux_memcpy(obj, tdpMemcpyHostToDevice);
+    case ADVFLUX_SCHEME_ORDER_4:
+    case ADVFLUX_SCHEME_ORDER_5:
+    case ADVFLUX_SCHEME_MUSCL:
+    case ADVFLUX_SCHEME_WENO5:
+      advection_le_stencil(obj, hydro, field, scheme);
       break;
-    case 5:
-      /* Ditto */
-      advflux_memcpy(obj, tdpMemcpyDeviceToHost);
-      advection_le_5th(obj, hydro, nf, field->data);
-      advflux_memcpy(obj, tdpMemcpyHostToDevice);
-      break; 
     default:
       pe_fatal(obj->pe, "Unexpected advection scheme order\n");
     }
@@ -1175,290 +1328,336 @@ __global__ void advection_le_3rd_kernel_v(kernel_ctxt_t * ktx,
   return;
 }
 
-/****************************************************************************
- *
- *  advection_le_4th
+/*****************************************************************************
  *
- *  Advective fluxes, allowing for LE planes.
+ *  advflux_scheme_width
  *
- *  The stencil is four points.
+ *  Half-width of the stencil about a face for the wide schemes, i.e.,
+ *  the number of halo points required.
  *
- ****************************************************************************/
+ *****************************************************************************/
 
-static int advection_le_4th(advflux_t * flux, hydro_t * hydro, int nf,
-			    double * f) {
-  int nlocal[3];
-  int ic, jc, kc;
-  int n;
-  int index0, index1, index2, index3;
-  int icm2, icm1, icp1, icp2;
-  double u0[3], u1[3], u;
-  lees_edw_t * le = NULL;
+__host__ __device__ static int advflux_scheme_width(int scheme) {
 
-  const double a1 = (1.0/16.0); /* Interpolation weight */
-  const double a2 = (9.0/16.0); /* Interpolation weight */
+  int w = 2;
 
-  assert(flux);
-  assert(hydro);
-  assert(f);
+  if (scheme == ADVFLUX_SCHEME_ORDER_5) w = 3;
+  if (scheme == ADVFLUX_SCHEME_WENO5)   w = 3;
 
-  le = flux->le;
+  return w;
+}
 
-  lees_edw_nlocal(le, nlocal);
+/*****************************************************************************
+ *
+ *  advflux_face_value
+ *
+ *  Face value for the wide schemes from g[] at positions L-2, L-1, L,
+ *  R, R+1, R+2 where the face lies between L and R. Only the points
+ *  within advflux_scheme_width() of the face need be set.
+ *
+ *  ORDER_4  four point centred interpolation.
+ *  ORDER_5  fourth-order wavenumber-extended upwind-biased scheme of
+ *           Li, J. Comp. Phys. 133 235-255 (1997).
+ *  MUSCL    linear reconstruction from the upwind cell with the van
+ *           Leer limiter, van Leer, J. Comp. Phys. 32, 101 (1979).
+ *  WENO5    fifth order weighted essentially non-oscillatory scheme
+ *           of Jiang and Shu, J. Comp. Phys. 126, 202 (1996).
+ *
+ *  The limited schemes do not create new extrema at sharp interfaces.
+ *
+ *****************************************************************************/
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    icm2 = lees_edw_ic_to_buff(le, ic, -2);
-    icm1 = lees_edw_ic_to_buff(le, ic, -1);
-    icp1 = lees_edw_ic_to_buff(le, ic, +1);
-    icp2 = lees_edw_ic_to_buff(le, ic, +2);
+__host__ __device__ static double advflux_face_value(int scheme, double u,
+						     const double g[6]) {
+  double fw = 0.0;
+  double v[5];
 
-    for (jc = 0; jc <= nlocal[Y]; jc++) {
-      for (kc = 0; kc <= nlocal[Z]; kc++) {
+  /* v[] is the stencil ordered in the upwind direction: v[2] is the
+   * upwind cell and v[3] the downwind cell. */
 
-	index0 = lees_edw_index(le, ic, jc, kc);
-	hydro_u(hydro, index0, u0);
+  if (u > 0.0) {
+    v[0] = g[0]; v[1] = g[1]; v[2] = g[2]; v[3] = g[3]; v[4] = g[4];
+  }
+  else {
+    v[0] = g[5]; v[1] = g[4]; v[2] = g[3]; v[3] = g[2]; v[4] = g[1];
+  }
 
-	/* west face (icm1 and ic) */
+  switch (scheme) {
+  case ADVFLUX_SCHEME_ORDER_4:
+    {
+      const double a1 = (1.0/16.0);
+      const double a2 = (9.0/16.0);
+      fw = - a1*g[1] + a2*g[2] + a2*g[3] - a1*g[4];
+    }
+    break;
+  case ADVFLUX_SCHEME_ORDER_5:
+    {
+      const double a1 =  0.055453;
+      const double a2 = -0.305147;
+      const double a3 =  0.916054;
+      const double a4 =  0.361520;
+      const double a5 = -0.027880;
+      fw = a1*v[0] + a2*v[1] + a3*v[2] + a4*v[3] + a5*v[4];
+    }
+    break;
+  case ADVFLUX_SCHEME_MUSCL:
+    {
+      double dl = v[2] - v[1];
+      double dr = v[3] - v[2];
+      fw = v[2];
+      if (dl*dr > 0.0) fw += dl*dr/(dl + dr);
+    }
+    break;
+  case ADVFLUX_SCHEME_WENO5:
+    {
+      const double epsilon = 1.0e-06;
+      const double r13 = (13.0/12.0);
+      double q0 = (2.0*v[0] - 7.0*v[1] + 11.0*v[2])/6.0;
+      double q1 = (   -v[1] + 5.0*v[2] +  2.0*v[3])/6.0;
+      double q2 = (2.0*v[2] + 5.0*v[3] -      v[4])/6.0;
+      double d0 = v[0] - 2.0*v[1] + v[2];
+      double d1 = v[1] - 2.0*v[2] + v[3];
+      double d2 = v[2] - 2.0*v[3] + v[4];
+      double e0 = v[0] - 4.0*v[1] + 3.0*v[2];
+      double e1 = v[1] - v[3];
+      double e2 = 3.0*v[2] - 4.0*v[3] + v[4];
+      double b0 = epsilon + r13*d0*d0 + 0.25*e0*e0;
+      double b1 = epsilon + r13*d1*d1 + 0.25*e1*e1;
+      double b2 = epsilon + r13*d2*d2 + 0.25*e2*e2;
+      double w0 = 0.1/(b0*b0);
+      double w1 = 0.6/(b1*b1);
+      double w2 = 0.3/(b2*b2);
+      fw = (w0*q0 + w1*q1 + w2*q2)/(w0 + w1 + w2);
+    }
+    break;
+  default:
+    assert(0);
+  }
 
-	index1 = lees_edw_index(le, icm1, jc, kc);
-	hydro_u(hydro, index1, u1);
-	u = 0.5*(u0[X] + u1[X]);
+  return fw;
+}
 
-	index2 = lees_edw_index(le, icm2, jc, kc);
-	index3 = lees_edw_index(le, icp1, jc, kc);
+/*****************************************************************************
+ *
+ *  advflux_stencil_check
+ *
+ *****************************************************************************/
 
-	for (n = 0; n < nf; n++) {
-	  flux->fw[addr_rank1(flux->nsite, nf, index0,  n)] =
-	    u*(- a1*f[addr_rank1(flux->nsite, nf, index2, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index1, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index0, n)]
-	       - a1*f[addr_rank1(flux->nsite, nf, index3, n)]);
-	}
+static int advflux_stencil_check(advflux_t * flux, int scheme) {
 
-	/* east face */
+  int nhalo = 0;
 
-	index1 = lees_edw_index(le, icp1, jc, kc);
-	hydro_u(hydro, index1, u1);
-	u = 0.5*(u0[X] + u1[X]);
+  assert(flux);
 
-	index2 = lees_edw_index(le, icm1, jc, kc);
-	index3 = lees_edw_index(le, icp2, jc, kc);
+  cs_nhalo(flux->cs, &nhalo);
 
-	for (n = 0; n < nf; n++) {
-	  flux->fe[addr_rank1(flux->nsite, nf, index0, n)] =
-	    u*(- a1*f[addr_rank1(flux->nsite, nf, index2, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index0, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index1, n)]
-	       - a1*f[addr_rank1(flux->nsite, nf, index3, n)]);
-	}
+  if (nhalo < advflux_scheme_width(scheme)) {
+    pe_fatal(flux->pe, "Advection scheme %d requires halo width %d (not %d)\n",
+	     scheme, advflux_scheme_width(scheme), nhalo);
+  }
 
-	/* y-direction */
+  return 0;
+}
 
-	index1 = lees_edw_index(le, ic, jc+1, kc);
-	hydro_u(hydro, index1, u1);
-	u = 0.5*(u0[Y] + u1[Y]);
+/*****************************************************************************
+ *
+ *  advection_le_stencil
+ *
+ *  Kernel driver for the wide (four and five point) schemes and the
+ *  limited schemes in the presence of Lees-Edwards planes.
+ *
+ *****************************************************************************/
 
-	index2 = lees_edw_index(le, ic, jc-1, kc);
-	index3 = lees_edw_index(le, ic, jc+2, kc);
+__host__ int advection_le_stencil(advflux_t * flux, hydro_t * hydro,
+				  field_t * field, int scheme) {
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  lees_edw_t * letarget = NULL;
 
-	for (n = 0; n < nf; n++) {
-	  flux->fy[addr_rank1(flux->nsite, nf, index0, n)] =
-	    u*(- a1*f[addr_rank1(flux->nsite, nf, index2, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index0, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index1, n)]
-	       - a1*f[addr_rank1(flux->nsite, nf, index3, n)]);
-	}
+  assert(flux);
+  assert(flux->le);
+  assert(hydro);
+  assert(field);
 
-	/* z-direction */
+  advflux_stencil_check(flux, scheme);
 
-	index1 = lees_edw_index(le, ic, jc, kc+1);
-	hydro_u(hydro, index1, u1);
-	u = 0.5*(u0[Z] + u1[Z]);
+  cs_nlocal(flux->cs, nlocal);
 
-	index2 = lees_edw_index(le, ic, jc, kc-1);
-	index3 = lees_edw_index(le, ic, jc, kc+2);
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 0; limits.jmax = nlocal[Y];
+  limits.kmin = 0; limits.kmax = nlocal[Z];
 
-	for (n = 0; n < nf; n++) {
-	  flux->fz[addr_rank1(flux->nsite, nf, index0, n)] =
-	    u*(- a1*f[addr_rank1(flux->nsite, nf, index2, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index0, n)]
-	       + a2*f[addr_rank1(flux->nsite, nf, index1, n)]
-	       - a1*f[addr_rank1(flux->nsite, nf, index3, n)]);
-	}
+  kernel_ctxt_create(flux->cs, NSIMDVL, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	/* Next interface. */
-      }
-    }
-  }
+  lees_edw_target(flux->le, &letarget);
+
+  tdpLaunchKernel(advection_le_stencil_kernel_v, nblk, ntpb, 0, 0,
+		  ctxt->target, letarget, flux->target, hydro->target,
+		  field->target, scheme);
+
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  kernel_ctxt_free(ctxt);
 
   return 0;
 }
 
-/****************************************************************************
+/*****************************************************************************
  *
- *  advection_le_5th
+ *  advection_le_stencil_kernel_v
  *
- *  Advective fluxes, allowing for LE planes.
+ *  Advective fluxes, allowing for LE planes, for the wide schemes.
  *
- *  Formally fourth-order accurate wavenumber-extended scheme of
- *  Li, J. Comp. Phys. 133 235-255 (1997).
+ *  For each face, the stencil g[] is gathered from position p = -3..+2
+ *  relative to the downwind cell R (L = R - 1), so the x-direction
+ *  fetches use lees_edw_ic_to_buff() as for the other orders.
  *
- *  The stencil is five points, biased in the upwind direction,
- *  with weights a1--a5.
- *
- ****************************************************************************/
+ *****************************************************************************/
 
-static int advection_le_5th(advflux_t * flux, hydro_t * hydro, int nf,
-			    double * f) {
-  int nlocal[3];
-  int ic, jc, kc;
-  int n;
-  int index0, index1;
-  int icm2, icm1, icp1, icp2, icm3, icp3;
-  double u0[3], u1[3], u;
-  lees_edw_t * le = NULL;
-
-  const double a1 =  0.055453;
-  const double a2 = -0.305147;
-  const double a3 =  0.916054;
-  const double a4 =  0.361520;
-  const double a5 = -0.027880;
+__global__ void advection_le_stencil_kernel_v(kernel_ctxt_t * ktx,
+					      lees_edw_t * le,
+					      advflux_t * flux,
+					      hydro_t * hydro,
+					      field_t * fld, int scheme) {
+  int kindex;
+  __shared__ int kiter;
 
+  assert(ktx);
+  assert(le);
   assert(flux);
   assert(hydro);
-  assert(f);
+  assert(fld);
+
+  kiter = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, NSIMDVL) {
+
+    int ia, iv, n, p;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int maskv[NSIMDVL];
+    int index0[NSIMDVL];
+    int ib[NSIMDVL];
+    int indexp[6][NSIMDVL];
+    double u0[3][NSIMDVL], u[NSIMDVL];
+
+    const int w = advflux_scheme_width(scheme);
+    const int pmin = 3 - w;
+    const int pmax = 2 + w;
+
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_coords_index_v(ktx, ic, jc, kc, index0);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    for (ia = 0; ia < NHDIM; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	int haddr = addr_rank1(hydro->nsite, NHDIM, index0[iv], ia);
+	u0[ia][iv] = hydro->u->data[haddr];
+      }
+    }
+
+    /* West face (between ic-1 and ic): R = ic */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) {
+	ib[iv] = lees_edw_ic_to_buff(le, ic[iv], (p - 3)*maskv[iv]);
+      }
+      lees_edw_index_v(le, ib, jc, kc, indexp[p]);
+    }
 
-  le = flux->le;
-  lees_edw_nlocal(le, nlocal);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    icm3 = lees_edw_ic_to_buff(le, ic, -3);
-    icm2 = lees_edw_ic_to_buff(le, ic, -2);
-    icm1 = lees_edw_ic_to_buff(le, ic, -1);
-    icp1 = lees_edw_ic_to_buff(le, ic, +1);
-    icp2 = lees_edw_ic_to_buff(le, ic, +2);
-    icp3 = lees_edw_ic_to_buff(le, ic, +3);
-
-    for (jc = 0; jc <= nlocal[Y]; jc++) {
-      for (kc = 0; kc <= nlocal[Z]; kc++) {
-
-        index0 = lees_edw_index(le, ic, jc, kc);
-        hydro_u(hydro, index0, u0);
-
-        /* west face (icm1 and ic) */
-
-        index1 = lees_edw_index(le, icm1, jc, kc);
-        hydro_u(hydro, index1, u1);
-        u = 0.5*(u0[X] + u1[X]);
-
-        if (u > 0.0) {
-          for (n = 0; n < nf; n++) {
-            flux->fw[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm3,jc,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm2,jc,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index1, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index0, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp1,jc,kc), n)]);
-          }
-        }
-        else {
-          for (n = 0; n < nf; n++) {
-            flux->fw[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp2,jc,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp1,jc,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index0, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index1, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm2,jc,kc), n)]);
-          }
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[2][iv], X);
+      u[iv] = 0.5*maskv[iv]*(u0[X][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < fld->nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = fld->data[addr_rank1(fld->nsites, fld->nf, indexp[p][iv], n)];
+	}
+	flux->fw[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+
+    /* East face (between ic and ic+1): R = ic + 1 */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) {
+	ib[iv] = lees_edw_ic_to_buff(le, ic[iv], (p - 2)*maskv[iv]);
+      }
+      lees_edw_index_v(le, ib, jc, kc, indexp[p]);
+    }
+
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], X);
+      u[iv] = 0.5*maskv[iv]*(u0[X][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < fld->nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = fld->data[addr_rank1(fld->nsites, fld->nf, indexp[p][iv], n)];
+	}
+	flux->fe[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+
+    /* y-direction (between jc and jc+1) */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) ib[iv] = jc[iv] + (p - 2)*maskv[iv];
+      lees_edw_index_v(le, ic, ib, kc, indexp[p]);
+    }
+
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], Y);
+      u[iv] = 0.5*maskv[iv]*(u0[Y][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < fld->nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = fld->data[addr_rank1(fld->nsites, fld->nf, indexp[p][iv], n)];
 	}
+	flux->fy[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+
+    /* z-direction (between kc and kc+1) */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) ib[iv] = kc[iv] + (p - 2)*maskv[iv];
+      lees_edw_index_v(le, ic, jc, ib, indexp[p]);
+    }
 
-        /* east face */
-
-        index1 = lees_edw_index(le, icp1, jc, kc);
-        hydro_u(hydro, index1, u1);
-        u = 0.5*(u0[X] + u1[X]);
-
-        if (u < 0.0) {
-          for (n = 0; n < nf; n++) {
-            flux->fe[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp3,jc,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp2,jc,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index1, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index0, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm1,jc,kc), n)]);
-          }
-        }
-        else {
-          for (n = 0; n < nf; n++) {
-            flux->fe[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm2,jc,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icm1,jc,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index0, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index1, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,icp2,jc,kc), n)]);
-          }
-        }
-
-        /* y-direction */
-
-        index1 = lees_edw_index(le, ic, jc+1, kc);
-        hydro_u(hydro, index1, u1);
-        u = 0.5*(u0[Y] + u1[Y]);
-
-        if (u < 0.0) {
-          for (n = 0; n < nf; n++) {
-            flux->fy[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc+3,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc+2,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index1, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index0, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc-1,kc), n)]);
-          }
-        }
-        else {
-          for (n = 0; n < nf; n++) {
-            flux->fy[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc-2,kc), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc-1,kc), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index0, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index1, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc+2,kc), n)]);
-          }
-        }
-
-        /* z-direction */
-
-        index1 = lees_edw_index(le, ic, jc, kc+1);
-        hydro_u(hydro, index1, u1);
-        u = 0.5*(u0[Z] + u1[Z]);
-
-        if (u < 0.0) {
-          for (n = 0; n < nf; n++) {
-            flux->fz[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc+3), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc+2), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index1, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index0, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc-1), n)]);
-          }
-        }
-        else {
-          for (n = 0; n < nf; n++) {
-            flux->fz[addr_rank1(flux->nsite, nf, index0, n)] = u*
-	      (a1*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc-2), n)] +
-	       a2*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc-1), n)] +
-               a3*f[addr_rank1(flux->nsite, nf, index0, n)] +
-               a4*f[addr_rank1(flux->nsite, nf, index1, n)] +
-	       a5*f[addr_rank1(flux->nsite, nf, lees_edw_index(le,ic,jc,kc+2), n)]);
-          }
-        }
-
-        /* Next interface. */
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], Z);
+      u[iv] = 0.5*maskv[iv]*(u0[Z][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < fld->nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = fld->data[addr_rank1(fld->nsites, fld->nf, indexp[p][iv], n)];
+	}
+	flux->fz[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
       }
     }
+    /* Next sites */
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -1474,6 +1673,7 @@ static int advection_le_5th(advflux_t * flux, hydro_t * hydro, int nf,
 __host__ int advflux_cs_compute(advflux_t * flux, hydro_t * h, field_t * f) {
 
   int nlocal[3];
+  int scheme = ADVFLUX_SCHEME_DEFAULT;
   dim3 nblk, ntpb;
   kernel_info_t limits;
   kernel_ctxt_t * ctxt = NULL;
@@ -1483,6 +1683,8 @@ __host__ int advflux_cs_compute(advflux_t * flux, hydro_t * h, field_t * f) {
   assert(h);
   assert(f);
 
+  scheme = advflux_scheme_current(flux);
+
   cs_nlocal(flux->cs, nlocal);
 
   /* Limits */
@@ -1494,19 +1696,27 @@ __host__ int advflux_cs_compute(advflux_t * flux, hydro_t * h, field_t * f) {
   kernel_ctxt_create(flux->cs, NSIMDVL, limits, &ctxt);
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  switch (order_) {
-  case 1:
+  switch (scheme) {
+  case ADVFLUX_SCHEME_ORDER_1:
     tdpLaunchKernel(advflux_cs_1st_kernel, nblk, ntpb, 0, 0,
 		    ctxt->target, flux->target, h->target, f->target);
     break;
-  case 2:
+  case ADVFLUX_SCHEME_ORDER_2:
     tdpLaunchKernel(advflux_cs_2nd_kernel, nblk, ntpb, 0, 0,
 		    ctxt->target, flux->target, h->target, f->target);
     break;
-  case 3:
+  case ADVFLUX_SCHEME_ORDER_3:
     tdpLaunchKernel(advflux_cs_3rd_kernel_v, nblk, ntpb, 0, 0,
 		    ctxt->target, flux->target, h->target, f->target);
     break;
+  case ADVFLUX_SCHEME_ORDER_4:
+  case ADVFLUX_SCHEME_ORDER_5:
+  case ADVFLUX_SCHEME_MUSCL:
+  case ADVFLUX_SCHEME_WENO5:
+    advflux_stencil_check(flux, scheme);
+    tdpLaunchKernel(advflux_cs_stencil_kernel_v, nblk, ntpb, 0, 0,
+		    ctxt->target, flux->target, h->target, f->target, scheme);
+    break;
   default:
     pe_fatal(flux->pe, "advflux_cs_compute: Unexpected advection scheme\n");
   }
@@ -1922,3 +2132,127 @@ __global__ void advflux_cs_3rd_kernel_v(kernel_ctxt_t * ktx,
   return;
 }
 
+
+/*****************************************************************************
+ *
+ *  advflux_cs_stencil_kernel_v
+ *
+ *  No Lees-Edwards planes. The wide and limited schemes, where the
+ *  stencil about each face is gathered from position p = -3..+2
+ *  relative to the downwind cell.
+ *
+ *****************************************************************************/
+
+__global__ void advflux_cs_stencil_kernel_v(kernel_ctxt_t * ktx,
+					    advflux_t * flux,
+					    hydro_t * hydro,
+					    field_t * field, int scheme) {
+  int kindex;
+  __shared__ int kiter;
+
+  assert(ktx);
+  assert(flux);
+  assert(hydro);
+  assert(field);
+
+  kiter = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, NSIMDVL) {
+
+    int ia, iv, n, p;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int maskv[NSIMDVL];
+    int index0[NSIMDVL];
+    int ib[NSIMDVL];
+    int indexp[6][NSIMDVL];
+    double u0[3][NSIMDVL], u[NSIMDVL];
+
+    const int nf = field->nf;
+    const int w = advflux_scheme_width(scheme);
+    const int pmin = 3 - w;
+    const int pmax = 2 + w;
+
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_coords_index_v(ktx, ic, jc, kc, index0);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    for (ia = 0; ia < NHDIM; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	int haddr = addr_rank1(hydro->nsite, NHDIM, index0[iv], ia);
+	u0[ia][iv] = hydro->u->data[haddr];
+      }
+    }
+
+    /* x-direction (between ic and ic+1) */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) ib[iv] = ic[iv] + (p - 2)*maskv[iv];
+      kernel_coords_index_v(ktx, ib, jc, kc, indexp[p]);
+    }
+
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], X);
+      u[iv] = 0.5*maskv[iv]*(u0[X][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = field->data[addr_rank1(field->nsites, nf, indexp[p][iv], n)];
+	}
+	flux->fx[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+
+    /* y-direction (between jc and jc+1) */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) ib[iv] = jc[iv] + (p - 2)*maskv[iv];
+      kernel_coords_index_v(ktx, ic, ib, kc, indexp[p]);
+    }
+
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], Y);
+      u[iv] = 0.5*maskv[iv]*(u0[Y][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = field->data[addr_rank1(field->nsites, nf, indexp[p][iv], n)];
+	}
+	flux->fy[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+
+    /* z-direction (between kc and kc+1) */
+
+    for (p = pmin; p <= pmax; p++) {
+      for_simd_v(iv, NSIMDVL) ib[iv] = kc[iv] + (p - 2)*maskv[iv];
+      kernel_coords_index_v(ktx, ic, jc, ib, indexp[p]);
+    }
+
+    for_simd_v(iv, NSIMDVL) {
+      int haddr = addr_rank1(hydro->nsite, NHDIM, indexp[3][iv], Z);
+      u[iv] = 0.5*maskv[iv]*(u0[Z][iv] + hydro->u->data[haddr]);
+    }
+
+    for (n = 0; n < nf; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	double g[6] = {0};
+	for (p = pmin; p <= pmax; p++) {
+	  g[p] = field->data[addr_rank1(field->nsites, nf, indexp[p][iv], n)];
+	}
+	flux->fz[addr_rank1(flux->nsite, flux->nf, index0[iv], n)] =
+	  u[iv]*advflux_face_value(scheme, u[iv], g);
+      }
+    }
+    /* Next sites */
+  }
+
+  return;
+}
@@ -22,6 +22,18 @@
 
 typedef struct advflux_s advflux_t;
 
+/* Schemes: orders 1-5 are the linear (upwind-biased) schemes; MUSCL and
+ * WENO5 are limited to remain bounded at sharp interfaces. */
+
+enum advflux_scheme_enum {ADVFLUX_SCHEME_DEFAULT = 0,
+			  ADVFLUX_SCHEME_ORDER_1,
+			  ADVFLUX_SCHEME_ORDER_2,
+			  ADVFLUX_SCHEME_ORDER_3,
+			  ADVFLUX_SCHEME_ORDER_4,
+			  ADVFLUX_SCHEME_ORDER_5,
+			  ADVFLUX_SCHEME_MUSCL,
+			  ADVFLUX_SCHEME_WENO5};
+
 __host__ int advflux_create(pe_t * pe, cs_t * cs, lees_edw_t * le, int nf,
 			    advflux_t ** pobj);
 __host__ int advflux_cs_create(pe_t * pe, cs_t * cs, int nf, advflux_t **obj);
@@ -29,6 +41,8 @@ __host__ int advflux_le_create(pe_t * pe, cs_t * cs, lees_edw_t * le, int nf,
 			       advflux_t ** pobj);
 __host__ int advflux_free(advflux_t * obj);
 __host__ int advflux_zero(advflux_t * obj);
+__host__ int advflux_scale(advflux_t * obj, double a);
+__host__ int advflux_scheme_set(advflux_t * obj, int scheme);
 __host__ int advflux_memcpy(advflux_t * obj, tdpMemcpyKind flag);
 
 
@@ -39,4 +53,6 @@ __host__ int advection_x(advflux_t * obj, hydro_t * hydro, field_t * field);
 
 __host__ int advection_order_set(const int order);
 __host__ int advection_order(int * order);
+__host__ int advection_scheme_set(const int scheme);
+__host__ int advection_scheme(int * scheme);
 #endif
@@ -10,7 +10,7 @@
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010-2016 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -45,6 +45,26 @@ int advection_init_rt(pe_t * pe, rt_t * rt) {
   }
   else {
 
+    char key2[FILENAME_MAX] = {0};
+
+    /* A limited scheme, if present, takes precedence over the order */
+
+    if (rt_string_parameter(rt, "fd_advection_scheme", key2, FILENAME_MAX)) {
+      if (strcmp(key2, "muscl") == 0) {
+	pe_info(pe, "\nAdvection scheme:       muscl (van Leer limiter)\n");
+	advection_scheme_set(ADVFLUX_SCHEME_MUSCL);
+      }
+      else if (strcmp(key2, "weno5") == 0) {
+	pe_info(pe, "\nAdvection scheme:       weno5\n");
+	advection_scheme_set(ADVFLUX_SCHEME_WENO5);
+      }
+      else {
+	pe_info(pe, "fd_advection_scheme %s not recognised\n", key2);
+	pe_fatal(pe, "Please use muscl or weno5\n");
+      }
+      return 0;
+    }
+
     pe_info(pe, "\nAdvection scheme order: ");
 
     n = rt_int_parameter(rt, "fd_advection_scheme_order", &order);
@@ -55,6 +75,9 @@ int advection_init_rt(pe_t * pe, rt_t * rt) {
     }
     else {
       pe_info(pe, "%d\n", order);
+      if (order < 1 || order > 5) {
+	pe_fatal(pe, "fd_advection_scheme_order must be 1-5\n");
+      }
       advection_order_set(order);
     }
   }
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2019 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -23,6 +23,7 @@ struct advflux_s {
 
   int nf;        /* Number of fields (1 for scalar etc) */
   int nsite;     /* Number of sites allocated */
+  int scheme;    /* advflux_scheme_enum (default: run time choice) */
   double * fe;   /* East face flxues (Lees-Edwards)   */
   double * fw;   /* West face flxues (Less-Edwards)   */
   double * fx;   /* x-face fluxes (between i and i+1) */
@@ -13,7 +13,7 @@
  *   Edinburgh Soft Matter and Statistical Physics Group and
  *   Edinburgh Parallel Computing Centre
  *
- *   (c) 2014-2017 The University of Edinburgh
+ *   (c) 2014-2023 The University of Edinburgh
  *
  *   Contributing authors:
  *   Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -147,34 +147,34 @@ int angle_cosine_compute(colloids_info_t * cinfo, void * self) {
   double v0, v1, v01;        /* potential coefficients */
   double f0[3], f1[3];       /* forces */
 
-  colloid_t * pc = NULL;
-
   assert(obj);
   assert(cinfo);
 
   obj->vlocal = 0.0;
   obj->cosine_min = +DBL_MAX;
   obj->cosine_max = -DBL_MAX;
-  colloids_info_local_head(cinfo, &pc);
 
-  for (; pc; pc = pc->nextlocal) {
-    if (pc->s.nangles == 0) continue;
-    assert(pc->s.nangles == 1);
+  /* Angle list (see interact_find_bonds()) holds (pc, bonded[0],
+   * bonded[1]) for each local colloid with an angle. */
+
+  for (int n = 0; n < cinfo->nanglelist; n++) {
+
+    colloid_t * pc  = cinfo->anglelist[3*n + 0];
+    colloid_t * pc0 = cinfo->anglelist[3*n + 1];
+    colloid_t * pc1 = cinfo->anglelist[3*n + 2];
 
-    assert(pc->bonded[0]);
-    assert(pc->bonded[1]);
-    assert(pc->bonded[0]->s.index == pc->s.bond[0]);
-    assert(pc->bonded[1]->s.index == pc->s.bond[1]);
+    assert(pc0->s.index == pc->s.bond[0]);
+    assert(pc1->s.index == pc->s.bond[1]);
 
     /* Bond 0 is pc -> bonded[0] */
 
-    cs_minimum_distance(obj->cs, pc->s.r, pc->bonded[0]->s.r, r0);
+    cs_minimum_distance(obj->cs, pc->s.r, pc0->s.r, r0);
     r0sq = r0[X]*r0[X] + r0[Y]*r0[Y] + r0[Z]*r0[Z];
     r0md = sqrt(r0sq);
 
     /* Bond 2 is pc -> bonded[1] */
 
-    cs_minimum_distance(obj->cs, pc->s.r, pc->bonded[1]->s.r, r1);
+    cs_minimum_distance(obj->cs, pc->s.r, pc1->s.r, r1);
     r1sq = r1[X]*r1[X] + r1[Y]*r1[Y] + r1[Z]*r1[Z];
     r1md = sqrt(r1sq);
 
@@ -196,17 +196,17 @@ int angle_cosine_compute(colloids_info_t * cinfo, void * self) {
 
     /* Accumulate forces */
 
-    pc->bonded[0]->force[X] += f0[X];
-    pc->bonded[0]->force[Y] += f0[Y];
-    pc->bonded[0]->force[Z] += f0[Z];
+    pc0->force[X] += f0[X];
+    pc0->force[Y] += f0[Y];
+    pc0->force[Z] += f0[Z];
 
     pc->force[X] -= (f0[X] + f1[X]);
     pc->force[Y] -= (f0[Y] + f1[Y]);
     pc->force[Z] -= (f0[Z] + f1[Z]);
 
-    pc->bonded[1]->force[X] += f1[X];
-    pc->bonded[1]->force[Y] += f1[Y];
-    pc->bonded[1]->force[Z] += f1[Z];
+    pc1->force[X] += f1[X];
+    pc1->force[Y] += f1[Y];
+    pc1->force[Z] += f1[Z];
 
     /* Potential energy */
 
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing Authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -29,6 +29,69 @@
 #include "bbl.h"
 #include "colloid.h"
 #include "colloids.h"
+#include "timer.h"
+#include "util_commit.h"
+
+/* The link-based passes run on the target over a flattened copy of
+ * the colloid link lists, in which each colloid owns a contiguous range
+ * of links. Each pass is two kernels:
+ *
+ *   (a) one thread per link: the update of f at the link, and the
+ *       link contributions to the per-colloid sums, which are stored
+ *       in a per-link workspace;
+ *   (b) one thread per colloid: a segmented reduction of the workspace
+ *       over the colloid's range of links.
+ *
+ * Each distribution updated belongs to exactly one link, so there are
+ * no conflicts in (a). The reduction (b) is in host link list order,
+ * so the result does not depend on the number of threads, and is the
+ * same as the original serial sum over links. */
+
+typedef struct bbl_link_s bbl_link_t;
+typedef struct bbl_colloid_s bbl_colloid_t;
+
+struct bbl_link_s {
+  int i;                /* Index of site outside (fluid or colloid) */
+  int j;                /* Index of site inside */
+  int p;                /* Velocity index i -> j */
+  int status;           /* LINK_FLUID or LINK_COLLOID */
+  int nc;               /* Owning colloid (index in per-colloid buffer) */
+  double rb[3];         /* Boundary vector */
+};
+
+/* Per-link workspace: offsets of the contributions in pass 1 and
+ * pass 2 (which share the same storage). */
+
+enum bbl_lsum_enum {BBL_LSUM_F0 = 0,
+		    BBL_LSUM_T0 = 3,
+		    BBL_LSUM_ZETA = 6,
+		    BBL_LSUM_SUMP = 27,
+		    BBL_LSUM_MAX = 28};
+
+enum bbl_lsum2_enum {BBL_LSUM_STRESS = 0,
+		     BBL_LSUM_DELTAPHI = 9};
+
+struct bbl_colloid_s {
+  int type;             /* Colloid type */
+  int link0;            /* First link in the flattened list */
+  int link1;            /* One past the last link */
+  double v[3];          /* Velocity */
+  double w[3];          /* Angular velocity */
+  double m[3];          /* Squirmer orientation */
+  double b1;            /* Squirmer B_1 */
+  double b2;            /* Squirmer B_2 */
+  double deltam;        /* Mass correction (normalised) */
+  double sump;          /* Squirmer mass correction */
+  double dms;           /* Missing link correction (pass 2) */
+  double dgtm1;         /* Order parameter correction at previous step */
+  double deltaphi;      /* Order parameter correction this step */
+  double cbar[3];       /* Normalised sum of link vectors */
+  double rxcbar[3];     /* Normalised sum of r_b x link vectors */
+  double f0[3];         /* Velocity-independent force */
+  double t0[3];         /* Velocity-independent torque */
+  double zeta[21];      /* Drag matrix */
+  double stress[3][3];  /* Contribution to surface stress */
+};
 
 struct bbl_s {
   pe_t * pe;            /* Parallel environment */
@@ -37,10 +100,24 @@ struct bbl_s {
   int ndist;            /* Number of LB distributions active */
   double deltag;        /* Excess or deficit of phi between steps */
   double stress[3][3];  /* Surface stress diagnostic */
+
+  int nlink;            /* Number of links in flattened list */
+  int nlinkmax;         /* Current capacity of link list */
+  int ncolloid;         /* Number of colloids with links */
+  int ncolloidmax;      /* Current capacity of colloid list */
+  bbl_link_t * link;    /* Flattened link list */
+  bbl_colloid_t * cbuf; /* Per-colloid quantities */
+  double * lsum;        /* Per-link workspace [nlink][BBL_LSUM_MAX] */
+  util_commit_t commit; /* LB parameters last sent to target */
+
+  bbl_t * target;       /* Target copy */
 };
 
 static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo);
 static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo);
+static int bbl_links_flatten(bbl_t * bbl, colloids_info_t * cinfo);
+static int bbl_buffers(bbl_t * bbl, int nlink, int ncolloid);
+static int bbl_cbuf_memcpy(bbl_t * bbl, tdpMemcpyKind flag);
 static int bbl_active_conservation(bbl_t * bbl, lb_t * lb,
 				   colloids_info_t * cinfo);
 static int bbl_wall_lubrication_account(bbl_t * bbl, wall_t * wall,
@@ -48,6 +125,10 @@ static int bbl_wall_lubrication_account(bbl_t * bbl, wall_t * wall,
 
 __global__ void bbl_pass0_kernel(kernel_ctxt_t * ktxt, cs_t * cs, lb_t * lb,
 				 colloids_info_t * cinfo);
+__global__ void bbl_pass1_link_kernel(bbl_t * bbl, lb_t * lb, double rho0);
+__global__ void bbl_pass1_sum_kernel(bbl_t * bbl);
+__global__ void bbl_pass2_link_kernel(bbl_t * bbl, lb_t * lb, double rho0);
+__global__ void bbl_pass2_sum_kernel(bbl_t * bbl);
 
 static __constant__ lb_collide_param_t lbp;
 
@@ -61,6 +142,7 @@ static __constant__ lb_collide_param_t lbp;
 
 int bbl_create(pe_t * pe, cs_t * cs, lb_t * lb, bbl_t ** pobj) {
 
+  int ndevice;
   bbl_t * bbl = NULL;
 
   assert(pe);
@@ -76,6 +158,18 @@ int bbl_create(pe_t * pe, cs_t * cs, lb_t * lb, bbl_t ** pobj) {
   bbl->cs = cs;
   lb_ndist(lb, &bbl->ndist);
 
+  /* Target copy */
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice == 0) {
+    bbl->target = bbl;
+  }
+  else {
+    tdpAssert(tdpMalloc((void **) &bbl->target, sizeof(bbl_t)));
+    tdpAssert(tdpMemset(bbl->target, 0, sizeof(bbl_t)));
+  }
+
   *pobj = bbl;
 
   return 0;
@@ -89,8 +183,30 @@ int bbl_create(pe_t * pe, cs_t * cs, lb_t * lb, bbl_t ** pobj) {
 
 int bbl_free(bbl_t * bbl) {
 
+  int ndevice;
+
   assert(bbl);
 
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    void * tmp = NULL;
+    tdpAssert(tdpMemcpy(&tmp, &bbl->target->link, sizeof(bbl_link_t *),
+			tdpMemcpyDeviceToHost));
+    if (tmp) tdpAssert(tdpFree(tmp));
+    tdpAssert(tdpMemcpy(&tmp, &bbl->target->cbuf, sizeof(bbl_colloid_t *),
+			tdpMemcpyDeviceToHost));
+    if (tmp) tdpAssert(tdpFree(tmp));
+    tdpAssert(tdpMemcpy(&tmp, &bbl->target->lsum, sizeof(double *),
+			tdpMemcpyDeviceToHost));
+    if (tmp) tdpAssert(tdpFree(tmp));
+    tdpAssert(tdpFree(bbl->target));
+  }
+
+  util_commit_reset(&bbl->commit);
+  free(bbl->link);
+  free(bbl->cbuf);
+  free(bbl->lsum);
   free(bbl);
 
   return 0;
@@ -161,12 +277,18 @@ int bounce_back_on_links(bbl_t * bbl, lb_t * lb, wall_t * wall,
 
   colloid_sums_halo(cinfo, COLLOID_SUM_STRUCTURE);
 
+  TIMER_start(TIMER_BBL_PASS0);
   bbl_pass0(bbl, lb, cinfo);
+  TIMER_stop(TIMER_BBL_PASS0);
 
-  /* __NVCC__ TODO: remove */
-  lb_memcpy(lb, tdpMemcpyDeviceToHost);
+  TIMER_start(TIMER_BBL_FLATTEN);
+  bbl_links_flatten(bbl, cinfo);
+  TIMER_stop(TIMER_BBL_FLATTEN);
 
+  TIMER_start(TIMER_BBL_PASS1);
   bbl_pass1(bbl, lb, cinfo);
+  TIMER_count(TIMER_BBL_PASS1, bbl->nlink);
+  TIMER_stop(TIMER_BBL_PASS1);
 
   colloid_sums_halo(cinfo, COLLOID_SUM_DYNAMICS);
 
@@ -177,10 +299,10 @@ int bounce_back_on_links(bbl_t * bbl, lb_t * lb, wall_t * wall,
 
   bbl_update_colloids(bbl, wall, cinfo);
 
+  TIMER_start(TIMER_BBL_PASS2);
   bbl_pass2(bbl, lb, cinfo);
-
-  /* __NVCC__ TODO: remove */
-  lb_memcpy(lb, tdpMemcpyHostToDevice);
+  TIMER_count(TIMER_BBL_PASS2, bbl->nlink);
+  TIMER_stop(TIMER_BBL_PASS2);
 
   return 0;
 }
@@ -267,8 +389,11 @@ int bbl_pass0(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
   limits.jmin = 1 - nextra; limits.jmax = nlocal[Y] + nextra;
   limits.kmin = 1 - nextra; limits.kmax = nlocal[Z] + nextra;
 
-  tdpMemcpyToSymbol(tdpSymbol(lbp), lb->param, sizeof(lb_collide_param_t), 0,
-		    tdpMemcpyHostToDevice);
+  if (util_commit_required(&bbl->commit, "bbl.c:lbp", lb->param,
+			   sizeof(lb_collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(lbp), lb->param, sizeof(lb_collide_param_t), 0,
+		      tdpMemcpyHostToDevice);
+  }
 
   kernel_ctxt_create(bbl->cs, 1, limits, &ctxt);
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
@@ -362,33 +487,222 @@ __global__ void bbl_pass0_kernel(kernel_ctxt_t * ktxt, cs_t * cs, lb_t * lb,
   return;
 }
 
+/*****************************************************************************
+ *
+ *  bbl_buffers
+ *
+ *  Ensure capacity of the flattened link list and the per-colloid
+ *  buffer on host and target. Storage only grows.
+ *
+ *  The per-link workspace is only required on the target.
+ *
+ *****************************************************************************/
+
+static int bbl_buffers(bbl_t * bbl, int nlink, int ncolloid) {
+
+  int ndevice;
+
+  assert(bbl);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (nlink > bbl->nlinkmax) {
+    bbl_link_t * link = NULL;
+    link = (bbl_link_t *) realloc(bbl->link, nlink*sizeof(bbl_link_t));
+    if (link == NULL) pe_fatal(bbl->pe, "realloc(bbl_link_t) failed\n");
+    bbl->link = link;
+    bbl->nlinkmax = nlink;
+
+    if (ndevice > 0) {
+      bbl_link_t * tmp = NULL;
+      tdpAssert(tdpMemcpy(&tmp, &bbl->target->link, sizeof(bbl_link_t *),
+			  tdpMemcpyDeviceToHost));
+      if (tmp) tdpAssert(tdpFree(tmp));
+      tdpAssert(tdpMalloc((void **) &tmp, nlink*sizeof(bbl_link_t)));
+      tdpAssert(tdpMemcpy(&bbl->target->link, &tmp, sizeof(bbl_link_t *),
+			  tdpMemcpyHostToDevice));
+    }
+
+    if (ndevice == 0) {
+      size_t nsz = (size_t) nlink*BBL_LSUM_MAX*sizeof(double);
+      double * lsum = (double *) realloc(bbl->lsum, nsz);
+      if (lsum == NULL) pe_fatal(bbl->pe, "realloc(bbl->lsum) failed\n");
+      bbl->lsum = lsum;
+    }
+    else {
+      size_t nsz = (size_t) nlink*BBL_LSUM_MAX*sizeof(double);
+      double * tmp = NULL;
+      tdpAssert(tdpMemcpy(&tmp, &bbl->target->lsum, sizeof(double *),
+			  tdpMemcpyDeviceToHost));
+      if (tmp) tdpAssert(tdpFree(tmp));
+      tdpAssert(tdpMalloc((void **) &tmp, nsz));
+      tdpAssert(tdpMemcpy(&bbl->target->lsum, &tmp, sizeof(double *),
+			  tdpMemcpyHostToDevice));
+    }
+  }
+
+  if (ncolloid > bbl->ncolloidmax) {
+    bbl_colloid_t * cbuf = NULL;
+    cbuf = (bbl_colloid_t *) realloc(bbl->cbuf,
+				     ncolloid*sizeof(bbl_colloid_t));
+    if (cbuf == NULL) pe_fatal(bbl->pe, "realloc(bbl_colloid_t) failed\n");
+    bbl->cbuf = cbuf;
+    bbl->ncolloidmax = ncolloid;
+
+    if (ndevice > 0) {
+      bbl_colloid_t * tmp = NULL;
+      tdpAssert(tdpMemcpy(&tmp, &bbl->target->cbuf, sizeof(bbl_colloid_t *),
+			  tdpMemcpyDeviceToHost));
+      if (tmp) tdpAssert(tdpFree(tmp));
+      tdpAssert(tdpMalloc((void **) &tmp, ncolloid*sizeof(bbl_colloid_t)));
+      tdpAssert(tdpMemcpy(&bbl->target->cbuf, &tmp, sizeof(bbl_colloid_t *),
+			  tdpMemcpyHostToDevice));
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_links_flatten
+ *
+ *  Copy the link lists of all colloids (including halo) into a
+ *  single contiguous list which is then copied to the target.
+ *  Only the links are moved, not the distributions.
+ *
+ *  The order of both colloids and links is that of the host lists,
+ *  and must be maintained by the passes which follow.
+ *
+ *****************************************************************************/
+
+static int bbl_links_flatten(bbl_t * bbl, colloids_info_t * cinfo) {
+
+  int ndevice;
+  int nlink = 0;
+  int ncolloid = 0;
+  colloid_t * pc = NULL;
+  colloid_link_t * p_link = NULL;
+
+  assert(bbl);
+  assert(cinfo);
+
+  colloids_info_all_head(cinfo, &pc);
+
+  for ( ; pc; pc = pc->nextall) {
+    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+    ncolloid += 1;
+    for (p_link = pc->lnk; p_link; p_link = p_link->next) {
+      if (p_link->status == LINK_UNUSED) continue;
+      nlink += 1;
+    }
+  }
+
+  bbl_buffers(bbl, imax(1, nlink), imax(1, ncolloid));
+
+  nlink = 0;
+  ncolloid = 0;
+  colloids_info_all_head(cinfo, &pc);
+
+  for ( ; pc; pc = pc->nextall) {
+    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+    bbl->cbuf[ncolloid].link0 = nlink;
+    for (p_link = pc->lnk; p_link; p_link = p_link->next) {
+      if (p_link->status == LINK_UNUSED) continue;
+      bbl->link[nlink].i = p_link->i;
+      bbl->link[nlink].j = p_link->j;
+      bbl->link[nlink].p = p_link->p;
+      bbl->link[nlink].status = p_link->status;
+      bbl->link[nlink].nc = ncolloid;
+      bbl->link[nlink].rb[X] = p_link->rb[X];
+      bbl->link[nlink].rb[Y] = p_link->rb[Y];
+      bbl->link[nlink].rb[Z] = p_link->rb[Z];
+      nlink += 1;
+    }
+    bbl->cbuf[ncolloid].link1 = nlink;
+    ncolloid += 1;
+  }
+
+  bbl->nlink = nlink;
+  bbl->ncolloid = ncolloid;
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    bbl_link_t * tmp = NULL;
+    tdpAssert(tdpMemcpy(&bbl->target->nlink, &bbl->nlink, sizeof(int),
+			tdpMemcpyHostToDevice));
+    tdpAssert(tdpMemcpy(&bbl->target->ncolloid, &bbl->ncolloid, sizeof(int),
+			tdpMemcpyHostToDevice));
+    tdpAssert(tdpMemcpy(&tmp, &bbl->target->link, sizeof(bbl_link_t *),
+			tdpMemcpyDeviceToHost));
+    if (nlink > 0) {
+      tdpAssert(tdpMemcpy(tmp, bbl->link, nlink*sizeof(bbl_link_t),
+			  tdpMemcpyHostToDevice));
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_cbuf_memcpy
+ *
+ *  Per-colloid buffer host <-> target.
+ *
+ *****************************************************************************/
+
+static int bbl_cbuf_memcpy(bbl_t * bbl, tdpMemcpyKind flag) {
+
+  int ndevice;
+
+  assert(bbl);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0 && bbl->ncolloid > 0) {
+    size_t nsz = bbl->ncolloid*sizeof(bbl_colloid_t);
+    bbl_colloid_t * tmp = NULL;
+
+    tdpAssert(tdpMemcpy(&tmp, &bbl->target->cbuf, sizeof(bbl_colloid_t *),
+			tdpMemcpyDeviceToHost));
+    switch (flag) {
+    case tdpMemcpyHostToDevice:
+      tdpAssert(tdpMemcpy(tmp, bbl->cbuf, nsz, flag));
+      break;
+    case tdpMemcpyDeviceToHost:
+      tdpAssert(tdpMemcpy(bbl->cbuf, tmp, nsz, flag));
+      break;
+    default:
+      pe_fatal(bbl->pe, "Bad flag in bbl_cbuf_memcpy\n");
+    }
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  bbl_pass1
  *
  *  Work out the velocity independent terms before actual BBL takes place.
  *
+ *  The per-colloid normalisation is done on the host; the sums over
+ *  links are done by bbl_pass1_link_kernel() and bbl_pass1_sum_kernel().
+ *
  *****************************************************************************/
 
 static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
   int ia;
-  int i, j, ij, ji;
-
-  double dm;
-  double delta;
+  int n = 0;
   double rsumw;
-  double c[3];
-  double rbxc[3];
   double rho0;
-  double mod, rmod, dm_a, cost, plegendre, sint;
-  double tans[3], vector1[3];
-  double fdist;
-  LB_RCS2_DOUBLE(rcs2);
+  dim3 nblk, ntpb;
 
   physics_t * phys = NULL;
   colloid_t * pc = NULL;
-  colloid_link_t * p_link = NULL;
 
   assert(bbl);
   assert(lb);
@@ -403,6 +717,8 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
   for ( ; pc; pc = pc->nextall) {
 
+    bbl_colloid_t * cb = NULL;
+
     if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
 
     /* Diagnostic record of f0 before additions are made. */
@@ -412,12 +728,6 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
     pc->diagnostic.fbuild[Y] = pc->f0[Y];
     pc->diagnostic.fbuild[Z] = pc->f0[Z];
 
-    p_link = pc->lnk;
-
-    for (i = 0; i < 21; i++) {
-      pc->zeta[i] = 0.0;
-    }
-
     /* We need to normalise link quantities by the sum of weights
      * over the particle. Note that sumw cannot be zero here during
      * correct operation (implies the particle has no links). */
@@ -430,129 +740,271 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
     pc->deltam   *= rsumw;
     pc->s.deltaphi *= rsumw;
 
-    /* Sum over the links */ 
+    cb = bbl->cbuf + n;
+    cb->type   = pc->s.type;
+    cb->b1     = pc->s.b1;
+    cb->b2     = pc->s.b2;
+    cb->deltam = pc->deltam;
+    cb->sump   = pc->sump;
+    for (ia = 0; ia < 3; ia++) {
+      cb->m[ia]      = pc->s.m[ia];
+      cb->cbar[ia]   = pc->cbar[ia];
+      cb->rxcbar[ia] = pc->rxcbar[ia];
+      cb->f0[ia]     = pc->f0[ia];
+      cb->t0[ia]     = pc->t0[ia];
+    }
+    n += 1;
+  }
+
+  assert(n == bbl->ncolloid);
+  if (n == 0) return 0;
 
-    for (; p_link; p_link = p_link->next) {
+  if (util_commit_required(&bbl->commit, "bbl.c:lbp", lb->param,
+			   sizeof(lb_collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(lbp), lb->param, sizeof(lb_collide_param_t), 0,
+		      tdpMemcpyHostToDevice);
+  }
 
-      if (p_link->status == LINK_UNUSED) continue;
+  bbl_cbuf_memcpy(bbl, tdpMemcpyHostToDevice);
 
-      i = p_link->i;              /* index site i (outside) */
-      j = p_link->j;              /* index site j (inside) */
-      ij = p_link->p;             /* link velocity index i->j */
-      ji = lb->model.nvel - ij;   /* link velocity index j->i */
+  if (bbl->nlink > 0) {
+    kernel_launch_param(bbl->nlink, &nblk, &ntpb);
+    tdpLaunchKernel(bbl_pass1_link_kernel, nblk, ntpb, 0, 0,
+		    bbl->target, lb->target, rho0);
+    tdpAssert(tdpPeekAtLastError());
+  }
 
-      assert(ij > 0 && ij < lb->model.nvel);
+  kernel_launch_param(n, &nblk, &ntpb);
+  tdpLaunchKernel(bbl_pass1_sum_kernel, nblk, ntpb, 0, 0, bbl->target);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-      /* For stationary link, the momentum transfer from the
-       * fluid to the colloid is "dm" */
+  bbl_cbuf_memcpy(bbl, tdpMemcpyDeviceToHost);
 
-      if (p_link->status == LINK_FLUID) {
-	/* Bounce back of fluid on outside plus correction
-	 * arising from changes in shape at previous step.
-	 * Note minus sign. */
+  /* Results */
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm =  2.0*fdist - lb->model.wv[ij]*pc->deltam;
-	delta = 2.0*rcs2*lb->model.wv[ij]*rho0;
-
-	/* Squirmer section */
-	if (pc->s.type == COLLOID_TYPE_ACTIVE) {
-
-	  /* We expect s.m to be a unit vector, but for floating
-	   * point purposes, we must make sure here. */
-
-	  mod = modulus(p_link->rb)*modulus(pc->s.m);
-	  rmod = 0.0;
-	  if (mod != 0.0) rmod = 1.0/mod;
-	  cost = rmod*dot_product(p_link->rb, pc->s.m);
-	  if (cost*cost > 1.0) cost = 1.0;
-	  assert(cost*cost <= 1.0);
-	  sint = sqrt(1.0 - cost*cost);
-
-	  cross_product(p_link->rb, pc->s.m, vector1);
-	  cross_product(vector1, p_link->rb, tans);
-
-	  mod = modulus(tans);
-	  rmod = 0.0;
-	  if (mod != 0.0) rmod = 1.0/mod;
-	  plegendre = -sint*(pc->s.b2*cost + pc->s.b1);
-
-	  dm_a = 0.0;
-	  for (ia = 0; ia < 3; ia++) {
-	    dm_a += -delta*plegendre*rmod*tans[ia]*lb->model.cv[ij][ia];
-	  }
+  n = 0;
+  colloids_info_all_head(cinfo, &pc);
 
-	  lb_f(lb, i, ij, 0, &fdist);
-	  fdist += dm_a;
-	  lb_f_set(lb, i, ij, 0, fdist);
+  for ( ; pc; pc = pc->nextall) {
+
+    bbl_colloid_t * cb = NULL;
+
+    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+
+    cb = bbl->cbuf + n;
+    pc->sump = cb->sump;
+    for (ia = 0; ia < 3; ia++) {
+      pc->f0[ia] = cb->f0[ia];
+      pc->t0[ia] = cb->t0[ia];
+    }
+    for (ia = 0; ia < 21; ia++) {
+      pc->zeta[ia] = cb->zeta[ia];
+    }
+    n += 1;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_pass1_link_kernel
+ *
+ *  One link per iteration: the link contributions to the
+ *  velocity-independent force and torque, and the drag matrix,
+ *  for its colloid. The squirmer correction to f is applied here.
+ *
+ *****************************************************************************/
+
+__global__ void bbl_pass1_link_kernel(bbl_t * bbl, lb_t * lb, double rho0) {
+
+  int nl;
+  LB_RCS2_DOUBLE(rcs2);
+
+  assert(bbl);
+  assert(lb);
+
+  for_simt_parallel(nl, bbl->nlink, 1) {
+
+    const bbl_link_t * lnk = bbl->link + nl;
+    const bbl_colloid_t * cb = bbl->cbuf + lnk->nc;
+
+    int i  = lnk->i;              /* index site i (outside) */
+    int j  = lnk->j;              /* index site j (inside) */
+    int ij = lnk->p;              /* link velocity index i->j */
+    int ji = lbp.nvel - ij;       /* link velocity index j->i */
+
+    int ia;
+    double dm;
+    double delta;
+    double fdist;
+    double c[3];
+    double rbxc[3];
+    double s[BBL_LSUM_MAX] = {0};
+
+    assert(ij > 0 && ij < lbp.nvel);
+
+    /* For stationary link, the momentum transfer from the
+     * fluid to the colloid is "dm" */
 
-	  dm += dm_a;
+    if (lnk->status == LINK_FLUID) {
+      /* Bounce back of fluid on outside plus correction
+       * arising from changes in shape at previous step.
+       * Note minus sign. */
 
-	  /* needed for mass conservation   */
-	  pc->sump += dm_a;
+      lb_f(lb, i, ij, 0, &fdist);
+      dm =  2.0*fdist - lbp.wv[ij]*cb->deltam;
+      delta = 2.0*rcs2*lbp.wv[ij]*rho0;
+
+      /* Squirmer section */
+      if (cb->type == COLLOID_TYPE_ACTIVE) {
+
+	double mod, rmod, dm_a, cost, plegendre, sint;
+	double tans[3], vector1[3];
+
+	/* We expect s.m to be a unit vector, but for floating
+	 * point purposes, we must make sure here. */
+
+	mod = modulus(lnk->rb)*modulus(cb->m);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	cost = rmod*dot_product(lnk->rb, cb->m);
+	if (cost*cost > 1.0) cost = 1.0;
+	assert(cost*cost <= 1.0);
+	sint = sqrt(1.0 - cost*cost);
+
+	cross_product(lnk->rb, cb->m, vector1);
+	cross_product(vector1, lnk->rb, tans);
+
+	mod = modulus(tans);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	plegendre = -sint*(cb->b2*cost + cb->b1);
+
+	dm_a = 0.0;
+	for (ia = 0; ia < 3; ia++) {
+	  dm_a += -delta*plegendre*rmod*tans[ia]*lbp.cv[ij][ia];
 	}
-      }
-      else {
-	/* Virtual momentum transfer for solid->solid links,
-	 * but no contribution to drag maxtrix */
 
 	lb_f(lb, i, ij, 0, &fdist);
-	dm = fdist;
-	lb_f(lb, j, ji, 0, &fdist);
-	dm += fdist;
-	delta = 0.0;
-      }
+	fdist += dm_a;
+	lb_f_set(lb, i, ij, 0, fdist);
 
-      for (ia = 0; ia < 3; ia++) {
-	c[ia] = 1.0*lb->model.cv[ij][ia];
+	dm += dm_a;
+
+	/* needed for mass conservation   */
+	s[BBL_LSUM_SUMP] = dm_a;
       }
+    }
+    else {
+      /* Virtual momentum transfer for solid->solid links,
+       * but no contribution to drag maxtrix */
+
+      lb_f(lb, i, ij, 0, &fdist);
+      dm = fdist;
+      lb_f(lb, j, ji, 0, &fdist);
+      dm += fdist;
+      delta = 0.0;
+    }
 
-      cross_product(p_link->rb, c, rbxc);
+    for (ia = 0; ia < 3; ia++) {
+      c[ia] = 1.0*lbp.cv[ij][ia];
+    }
 
-      /* Now add contribution to the sums required for 
-       * self-consistent evaluation of new velocities. */
+    cross_product(lnk->rb, c, rbxc);
 
-      for (ia = 0; ia < 3; ia++) {
-	pc->f0[ia] += dm*c[ia];
-	pc->t0[ia] += dm*rbxc[ia];
-	/* Corrections when links are missing (close to contact) */
-	c[ia] -= pc->cbar[ia];
-	rbxc[ia] -= pc->rxcbar[ia];
-      }
+    /* Contributions to the sums required for self-consistent
+     * evaluation of new velocities. */
+
+    for (ia = 0; ia < 3; ia++) {
+      s[BBL_LSUM_F0 + ia] = dm*c[ia];
+      s[BBL_LSUM_T0 + ia] = dm*rbxc[ia];
+      /* Corrections when links are missing (close to contact) */
+      c[ia] -= cb->cbar[ia];
+      rbxc[ia] -= cb->rxcbar[ia];
+    }
 
-      /* Drag matrix elements */
+    /* Drag matrix elements */
 
-      pc->zeta[ 0] += delta*c[X]*c[X];
-      pc->zeta[ 1] += delta*c[X]*c[Y];
-      pc->zeta[ 2] += delta*c[X]*c[Z];
-      pc->zeta[ 3] += delta*c[X]*rbxc[X];
-      pc->zeta[ 4] += delta*c[X]*rbxc[Y];
-      pc->zeta[ 5] += delta*c[X]*rbxc[Z];
+    s[BBL_LSUM_ZETA +  0] = delta*c[X]*c[X];
+    s[BBL_LSUM_ZETA +  1] = delta*c[X]*c[Y];
+    s[BBL_LSUM_ZETA +  2] = delta*c[X]*c[Z];
+    s[BBL_LSUM_ZETA +  3] = delta*c[X]*rbxc[X];
+    s[BBL_LSUM_ZETA +  4] = delta*c[X]*rbxc[Y];
+    s[BBL_LSUM_ZETA +  5] = delta*c[X]*rbxc[Z];
 
-      pc->zeta[ 6] += delta*c[Y]*c[Y];
-      pc->zeta[ 7] += delta*c[Y]*c[Z];
-      pc->zeta[ 8] += delta*c[Y]*rbxc[X];
-      pc->zeta[ 9] += delta*c[Y]*rbxc[Y];
-      pc->zeta[10] += delta*c[Y]*rbxc[Z];
+    s[BBL_LSUM_ZETA +  6] = delta*c[Y]*c[Y];
+    s[BBL_LSUM_ZETA +  7] = delta*c[Y]*c[Z];
+    s[BBL_LSUM_ZETA +  8] = delta*c[Y]*rbxc[X];
+    s[BBL_LSUM_ZETA +  9] = delta*c[Y]*rbxc[Y];
+    s[BBL_LSUM_ZETA + 10] = delta*c[Y]*rbxc[Z];
 
-      pc->zeta[11] += delta*c[Z]*c[Z];
-      pc->zeta[12] += delta*c[Z]*rbxc[X];
-      pc->zeta[13] += delta*c[Z]*rbxc[Y];
-      pc->zeta[14] += delta*c[Z]*rbxc[Z];
+    s[BBL_LSUM_ZETA + 11] = delta*c[Z]*c[Z];
+    s[BBL_LSUM_ZETA + 12] = delta*c[Z]*rbxc[X];
+    s[BBL_LSUM_ZETA + 13] = delta*c[Z]*rbxc[Y];
+    s[BBL_LSUM_ZETA + 14] = delta*c[Z]*rbxc[Z];
 
-      pc->zeta[15] += delta*rbxc[X]*rbxc[X];
-      pc->zeta[16] += delta*rbxc[X]*rbxc[Y];
-      pc->zeta[17] += delta*rbxc[X]*rbxc[Z];
+    s[BBL_LSUM_ZETA + 15] = delta*rbxc[X]*rbxc[X];
+    s[BBL_LSUM_ZETA + 16] = delta*rbxc[X]*rbxc[Y];
+    s[BBL_LSUM_ZETA + 17] = delta*rbxc[X]*rbxc[Z];
 
-      pc->zeta[18] += delta*rbxc[Y]*rbxc[Y];
-      pc->zeta[19] += delta*rbxc[Y]*rbxc[Z];
+    s[BBL_LSUM_ZETA + 18] = delta*rbxc[Y]*rbxc[Y];
+    s[BBL_LSUM_ZETA + 19] = delta*rbxc[Y]*rbxc[Z];
 
-      pc->zeta[20] += delta*rbxc[Z]*rbxc[Z];
+    s[BBL_LSUM_ZETA + 20] = delta*rbxc[Z]*rbxc[Z];
 
+    for (ia = 0; ia < BBL_LSUM_MAX; ia++) {
+      bbl->lsum[addr_rank1(bbl->nlink, BBL_LSUM_MAX, nl, ia)] = s[ia];
     }
   }
 
-  return 0;
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  bbl_pass1_sum_kernel
+ *
+ *  One colloid per iteration: sum the link contributions, in order,
+ *  into the velocity-independent force and torque, and drag matrix.
+ *
+ *****************************************************************************/
+
+__global__ void bbl_pass1_sum_kernel(bbl_t * bbl) {
+
+  int n;
+
+  assert(bbl);
+
+  for_simt_parallel(n, bbl->ncolloid, 1) {
+
+    int ia, nl;
+    bbl_colloid_t * cb = bbl->cbuf + n;
+
+    for (ia = 0; ia < 21; ia++) {
+      cb->zeta[ia] = 0.0;
+    }
+
+    for (nl = cb->link0; nl < cb->link1; nl++) {
+      const double * lsum = bbl->lsum;
+      int nlink = bbl->nlink;
+
+      for (ia = 0; ia < 3; ia++) {
+	cb->f0[ia] += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl, BBL_LSUM_F0+ia)];
+	cb->t0[ia] += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl, BBL_LSUM_T0+ia)];
+      }
+      for (ia = 0; ia < 21; ia++) {
+	cb->zeta[ia] += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl,
+					BBL_LSUM_ZETA + ia)];
+      }
+      if (cb->type == COLLOID_TYPE_ACTIVE) {
+	cb->sump += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl, BBL_LSUM_SUMP)];
+      }
+    }
+  }
+
+  return;
 }
 
 /*****************************************************************************
@@ -566,29 +1018,23 @@ static int bbl_pass1(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
  *  done between the colloid velcoity update and the actual bbl).
  *  There's a separate routine to access it below.
  *
+ *  The bounce-back proper is bbl_pass2_link_kernel(), and the sums
+ *  are bbl_pass2_sum_kernel(); the per-colloid set up and the resets
+ *  are on the host.
+ *
  *****************************************************************************/
 
 static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
-  int i, j, ij, ji;
-  int ia;
-  int ndist;
-
-  double dm;
-  double vdotc;
+  int ia, ib;
+  int n = 0;
   double dms;
-  double df, dg;
-  double fdist;
-  double wxrb[3];
-
-  double dgtm1;
   double rho0;
+  dim3 nblk, ntpb;
   LB_RCS2_DOUBLE(rcs2);
 
   physics_t * phys = NULL;
   colloid_t * pc = NULL;
-  colloid_link_t * p_link;
-
 
   assert(bbl);
   assert(lb);
@@ -597,16 +1043,14 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
   physics_ref(&phys);
   physics_rho0(phys, &rho0);
 
-  ndist=lb->ndist;
-
   /* Account the current phi deficit */
   bbl->deltag = 0.0;
 
   /* Zero the surface stress */
 
-  for (i = 0; i < 3; i++) {
-    for (j = 0; j < 3; j++) {
-      bbl->stress[i][j] = 0.0;
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      bbl->stress[ia][ib] = 0.0;
     }
   }
 
@@ -616,12 +1060,9 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
 
   for ( ; pc; pc = pc->nextall) {
 
-    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+    bbl_colloid_t * cb = NULL;
 
-    /* Set correction for phi arising from previous step */
-
-    dgtm1 = pc->s.deltaphi;
-    pc->s.deltaphi = 0.0;
+    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
 
     /* Correction to the bounce-back for this particle if it is
      * without full complement of links */
@@ -633,106 +1074,234 @@ static int bbl_pass2(bbl_t * bbl, lb_t * lb, colloids_info_t * cinfo) {
       dms += pc->s.w[ia]*pc->rxcbar[ia];
     }
 
-    dms = 2.0*rcs2*rho0*dms;
+    cb = bbl->cbuf + n;
+    cb->deltam = pc->deltam;
+    cb->sump   = pc->sump;
+    cb->dms    = 2.0*rcs2*rho0*dms;
 
-    /* Run through the links */
+    /* Set correction for phi arising from previous step */
+    cb->dgtm1  = pc->s.deltaphi;
 
-    p_link = pc->lnk;
+    for (ia = 0; ia < 3; ia++) {
+      cb->v[ia] = pc->s.v[ia];
+      cb->w[ia] = pc->s.w[ia];
+    }
+    n += 1;
+  }
 
-    for ( ; p_link; p_link = p_link->next) {
+  assert(n == bbl->ncolloid);
+  if (n == 0) return 0;
 
-      i = p_link->i;              /* index site i (outside) */
-      j = p_link->j;              /* index site j (inside) */
-      ij = p_link->p;             /* link velocity index i->j */
-      ji = lb->model.nvel - ij;   /* link velocity index j->i */
+  bbl_cbuf_memcpy(bbl, tdpMemcpyHostToDevice);
 
-      if (p_link->status == LINK_FLUID) {
+  if (bbl->nlink > 0) {
+    kernel_launch_param(bbl->nlink, &nblk, &ntpb);
+    tdpLaunchKernel(bbl_pass2_link_kernel, nblk, ntpb, 0, 0,
+		    bbl->target, lb->target, rho0);
+    tdpAssert(tdpPeekAtLastError());
+  }
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm =  2.0*fdist - lb->model.wv[ij]*pc->deltam;
+  kernel_launch_param(n, &nblk, &ntpb);
+  tdpLaunchKernel(bbl_pass2_sum_kernel, nblk, ntpb, 0, 0, bbl->target);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-	/* Compute the self-consistent boundary velocity,
-	 * and add the correction term for changes in shape. */
+  bbl_cbuf_memcpy(bbl, tdpMemcpyDeviceToHost);
 
-	cross_product(pc->s.w, p_link->rb, wxrb);
+  /* Results and reset factors required for change of shape, etc */
 
-	vdotc = 0.0;
-	for (ia = 0; ia < 3; ia++) {
-	  vdotc += (pc->s.v[ia] + wxrb[ia])*lb->model.cv[ij][ia];
-	}
-	vdotc = 2.0*rcs2*lb->model.wv[ij]*vdotc;
-	df = rho0*vdotc + lb->model.wv[ij]*pc->deltam;
+  n = 0;
+  colloids_info_all_head(cinfo, &pc);
 
-	/* Contribution to mass conservation from squirmer */
+  for ( ; pc; pc = pc->nextall) {
 
-	df += lb->model.wv[ij]*pc->sump; 
+    bbl_colloid_t * cb = NULL;
 
-	/* Correction owing to missing links "squeeze term" */
+    if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
 
-	df -= lb->model.wv[ij]*dms;
+    cb = bbl->cbuf + n;
+    pc->s.deltaphi = cb->deltaphi;
 
-	/* The outside site actually undergoes BBL. */
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	bbl->stress[ia][ib] += cb->stress[ia][ib];
+      }
+    }
 
-	lb_f(lb, i, ij, LB_RHO, &fdist);
-	fdist = fdist - df;
-	lb_f_set(lb, j, ji, LB_RHO, fdist);
+    pc->deltam = 0.0;
+    pc->sump = 0.0;
 
-	/* This is slightly clunky. If the order parameter is
-	 * via LB, bounce back with correction. */
+    for (ia = 0; ia < 3; ia++) {
+      pc->f0[ia] = 0.0;
+      pc->t0[ia] = 0.0;
+      pc->fc0[ia] = 0.0;
+      pc->tc0[ia] = 0.0;
+    }
 
-	if (ndist > 1) {
-	  lb_0th_moment(lb, i, LB_PHI, &dg);
-	  dg *= vdotc;
-	  pc->s.deltaphi += dg;
-	  dg -= lb->model.wv[ij]*dgtm1;
+    bbl->deltag += pc->s.deltaphi;
+    n += 1;
+  }
 
-	  lb_f(lb, i, ij, LB_PHI, &fdist);
-	  fdist = fdist - dg;
-	  lb_f_set(lb, j, ji, LB_PHI, fdist);
-	}
+  return 0;
+}
 
-	/* The stress is r_b f_b */
-	for (ia = 0; ia < 3; ia++) {
-	  bbl->stress[ia][X] += p_link->rb[X]*(dm - df)*lb->model.cv[ij][ia];
-	  bbl->stress[ia][Y] += p_link->rb[Y]*(dm - df)*lb->model.cv[ij][ia];
-	  bbl->stress[ia][Z] += p_link->rb[Z]*(dm - df)*lb->model.cv[ij][ia];
-	}
+/*****************************************************************************
+ *
+ *  bbl_pass2_link_kernel
+ *
+ *  One link per iteration. The distributions updated are those
+ *  at the inside site j, which belong to exactly one link. The
+ *  contributions to the stress and the order parameter correction
+ *  are recorded for bbl_pass2_sum_kernel().
+ *
+ *****************************************************************************/
+
+__global__ void bbl_pass2_link_kernel(bbl_t * bbl, lb_t * lb, double rho0) {
+
+  int nl;
+  LB_RCS2_DOUBLE(rcs2);
+
+  assert(bbl);
+  assert(lb);
+
+  for_simt_parallel(nl, bbl->nlink, 1) {
+
+    const bbl_link_t * lnk = bbl->link + nl;
+    const bbl_colloid_t * cb = bbl->cbuf + lnk->nc;
+
+    int i  = lnk->i;              /* index site i (outside) */
+    int j  = lnk->j;              /* index site j (inside) */
+    int ij = lnk->p;              /* link velocity index i->j */
+    int ji = lbp.nvel - ij;       /* link velocity index j->i */
+
+    int ia;
+    double dm;
+    double fdist;
+    double s[BBL_LSUM_MAX] = {0};
+
+    if (lnk->status == LINK_FLUID) {
+
+      double df, dg;
+      double vdotc;
+      double wxrb[3];
+
+      lb_f(lb, i, ij, 0, &fdist);
+      dm =  2.0*fdist - lbp.wv[ij]*cb->deltam;
+
+      /* Compute the self-consistent boundary velocity,
+       * and add the correction term for changes in shape. */
+
+      cross_product(cb->w, lnk->rb, wxrb);
+
+      vdotc = 0.0;
+      for (ia = 0; ia < 3; ia++) {
+	vdotc += (cb->v[ia] + wxrb[ia])*lbp.cv[ij][ia];
       }
-      else if (p_link->status == LINK_COLLOID) {
+      vdotc = 2.0*rcs2*lbp.wv[ij]*vdotc;
+      df = rho0*vdotc + lbp.wv[ij]*cb->deltam;
 
-	/* The stress should include the solid->solid term */
+      /* Contribution to mass conservation from squirmer */
 
-	lb_f(lb, i, ij, 0, &fdist);
-	dm = fdist;
-	lb_f(lb, j, ji, 0, &fdist);
-	dm += fdist;
+      df += lbp.wv[ij]*cb->sump;
 
-	for (ia = 0; ia < 3; ia++) {
-	  bbl->stress[ia][X] += p_link->rb[X]*dm*lb->model.cv[ij][ia];
-	  bbl->stress[ia][Y] += p_link->rb[Y]*dm*lb->model.cv[ij][ia];
-	  bbl->stress[ia][Z] += p_link->rb[Z]*dm*lb->model.cv[ij][ia];
-	}
+      /* Correction owing to missing links "squeeze term" */
+
+      df -= lbp.wv[ij]*cb->dms;
+
+      /* The outside site actually undergoes BBL. */
+
+      lb_f(lb, i, ij, LB_RHO, &fdist);
+      fdist = fdist - df;
+      lb_f_set(lb, j, ji, LB_RHO, fdist);
+
+      /* This is slightly clunky. If the order parameter is
+       * via LB, bounce back with correction. */
+
+      if (lb->ndist > 1) {
+	lb_0th_moment(lb, i, LB_PHI, &dg);
+	dg *= vdotc;
+	s[BBL_LSUM_DELTAPHI] = dg;
+	dg -= lbp.wv[ij]*cb->dgtm1;
+
+	lb_f(lb, i, ij, LB_PHI, &fdist);
+	fdist = fdist - dg;
+	lb_f_set(lb, j, ji, LB_PHI, fdist);
+      }
+
+      /* The stress is r_b f_b */
+      for (ia = 0; ia < 3; ia++) {
+	s[BBL_LSUM_STRESS + 3*ia + X] = lnk->rb[X]*(dm - df)*lbp.cv[ij][ia];
+	s[BBL_LSUM_STRESS + 3*ia + Y] = lnk->rb[Y]*(dm - df)*lbp.cv[ij][ia];
+	s[BBL_LSUM_STRESS + 3*ia + Z] = lnk->rb[Z]*(dm - df)*lbp.cv[ij][ia];
       }
-      /* Next link */
     }
+    else if (lnk->status == LINK_COLLOID) {
 
-    /* Reset factors required for change of shape, etc */
+      /* The stress should include the solid->solid term */
 
-    pc->deltam = 0.0;
-    pc->sump = 0.0;
+      lb_f(lb, i, ij, 0, &fdist);
+      dm = fdist;
+      lb_f(lb, j, ji, 0, &fdist);
+      dm += fdist;
 
-    for (ia = 0; ia < 3; ia++) {
-      pc->f0[ia] = 0.0;
-      pc->t0[ia] = 0.0;
-      pc->fc0[ia] = 0.0;
-      pc->tc0[ia] = 0.0;
+      for (ia = 0; ia < 3; ia++) {
+	s[BBL_LSUM_STRESS + 3*ia + X] = lnk->rb[X]*dm*lbp.cv[ij][ia];
+	s[BBL_LSUM_STRESS + 3*ia + Y] = lnk->rb[Y]*dm*lbp.cv[ij][ia];
+	s[BBL_LSUM_STRESS + 3*ia + Z] = lnk->rb[Z]*dm*lbp.cv[ij][ia];
+      }
     }
 
-    bbl->deltag += pc->s.deltaphi;
+    for (ia = 0; ia < BBL_LSUM_DELTAPHI + 1; ia++) {
+      bbl->lsum[addr_rank1(bbl->nlink, BBL_LSUM_MAX, nl, ia)] = s[ia];
+    }
   }
 
+  return;
+}
 
-  return 0;
+/*****************************************************************************
+ *
+ *  bbl_pass2_sum_kernel
+ *
+ *  One colloid per iteration: sum the link contributions, in order,
+ *  to the surface stress and order parameter correction.
+ *
+ *****************************************************************************/
+
+__global__ void bbl_pass2_sum_kernel(bbl_t * bbl) {
+
+  int n;
+
+  assert(bbl);
+
+  for_simt_parallel(n, bbl->ncolloid, 1) {
+
+    int ia, ib, nl;
+    bbl_colloid_t * cb = bbl->cbuf + n;
+
+    cb->deltaphi = 0.0;
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	cb->stress[ia][ib] = 0.0;
+      }
+    }
+
+    for (nl = cb->link0; nl < cb->link1; nl++) {
+      const double * lsum = bbl->lsum;
+      int nlink = bbl->nlink;
+
+      cb->deltaphi += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl,
+				      BBL_LSUM_DELTAPHI)];
+      for (ia = 0; ia < 3; ia++) {
+	for (ib = 0; ib < 3; ib++) {
+	  cb->stress[ia][ib] += lsum[addr_rank1(nlink, BBL_LSUM_MAX, nl,
+						BBL_LSUM_STRESS + 3*ia + ib)];
+	}
+      }
+    }
+  }
+
+  return;
 }
 
 /*****************************************************************************
@@ -46,7 +46,9 @@ static fe_vt_t fe_hvt = {
   (fe_htensor_v_ft) fe_lc_mol_field_v,
   (fe_stress_v_ft)  fe_lc_stress_v,
   (fe_stress_v_ft)  fe_lc_str_symm_v,
-  (fe_stress_v_ft)  fe_lc_str_anti_v
+  (fe_stress_v_ft)  fe_lc_str_anti_v,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 static __constant__ fe_vt_t fe_dvt = {
@@ -63,7 +65,9 @@ static __constant__ fe_vt_t fe_dvt = {
   (fe_htensor_v_ft) fe_lc_mol_field_v,
   (fe_stress_v_ft)  fe_lc_stress_v,
   (fe_stress_v_ft)  fe_lc_str_symm_v,
-  (fe_stress_v_ft)  fe_lc_str_anti_v
+  (fe_stress_v_ft)  fe_lc_str_anti_v,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 
@@ -174,6 +178,7 @@ __host__ int fe_lc_free(fe_lc_t * fe) {
   if (fe->dp) field_grad_free(fe->dp);
   if (fe->p) field_free(fe->p);
 
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
 
@@ -221,8 +226,11 @@ __host__ int fe_lc_param_commit(fe_lc_t * fe) {
 
   fe->param->coswt = cos(2.0*pi*e0_freq*t);
 
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param, sizeof(fe_lc_param_t),
-		    0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&fe->commit, "blue_phase.c:const_param",
+			   fe->param, sizeof(fe_lc_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_lc_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
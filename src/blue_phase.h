@@ -29,6 +29,7 @@
 #include "io_harness.h"
 
 #include "lc_anchoring.h"
+#include "util_commit.h"
 
 typedef struct fe_lc_s fe_lc_t;
 typedef struct fe_lc_param_s fe_lc_param_t;
@@ -44,6 +45,7 @@ struct fe_lc_s {
   field_grad_t * dq;          /* Gradients thereof */
   field_t * p;                /* Active term P_a = Q_ak d_m Q_mk */
   field_grad_t * dp;          /* Active term gradient d_a P_b */
+  util_commit_t commit;       /* Parameters last sent to target */
   fe_lc_t * target;           /* Device structure */
 };
 
@@ -27,11 +27,18 @@
  *  variates at each lattice site to generate consistent noise. The
  *  variance is 2 kT Gamma from fluctuation dissipation.
  *
+ *  The time step dt is unity by default; a smaller (or larger) value
+ *  may be set to allow sub-cycling relative to the LB step.
+ *
+ *  By default the molecular field is computed and stored for all sites
+ *  before the update. The "fused" update evaluates H at each site in
+ *  the update kernel itself, avoiding the extra pass over memory.
+ *
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2009-2022 The University of Edinburgh
+ *  (c) 2009-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -55,9 +62,10 @@
 #include "advection_s.h"
 #include "colloids.h"
 #include "timer.h"
+#include "util_commit.h"
 
-__host__ int beris_edw_update_driver(beris_edw_t * be, field_t * fq,
-				     field_grad_t * fq_grad,
+__host__ int beris_edw_update_driver(beris_edw_t * be, fe_t * fe,
+				     field_t * fq, field_grad_t * fq_grad,
 				     hydro_t * hydro,
 				     map_t * map, noise_t * noise); 
 __host__ int beris_edw_fix_swd(beris_edw_t * be, colloids_info_t * cinfo,
@@ -70,10 +78,10 @@ __host__ int beris_edw_h_driver(beris_edw_t * be, fe_t * fe);
 __global__
 void beris_edw_h_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe);
 __global__
-void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
+void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe,
 			field_t * fq, field_grad_t * fqgrad,
 			hydro_t * hydro, advflux_t * flux,
-			map_t * map, noise_t * noise);
+			map_t * map, noise_t * noise, double dt);
 __global__
 void beris_edw_fix_swd_kernel(kernel_ctxt_t * ktx, colloids_info_t * cinfo,
 			      hydro_t * hydro, map_t * map, int noffsetx,
@@ -86,7 +94,10 @@ struct beris_edw_s {
   advflux_t * flux;                /* Advective fluxes */
   int nall;                        /* Allocated sites */
   double * h;                      /* Molecular Field */
+  double dt;                       /* Time step (LB units) */
+  int fused;                       /* Molecular field in update kernel */
 
+  util_commit_t commit;            /* Parameters last sent to target */
   beris_edw_t * target;            /* Target memory */
 };
 
@@ -130,6 +141,7 @@ __host__ int beris_edw_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
   obj->cs = cs;
   obj->le = le;
   obj->flux = flx;
+  obj->dt = 1.0;
 
   beris_edw_tmatrix(obj->param->tmatrix);
 
@@ -194,6 +206,7 @@ __host__ int beris_edw_free(beris_edw_t * be) {
 
   advflux_free(be->flux);
   free(be->h);
+  util_commit_reset(&be->commit);
   free(be->param);
   free(be);
 
@@ -218,8 +231,15 @@ __host__ int beris_edw_param_commit(beris_edw_t * be) {
   physics_kt(phys, &kt);
   be->param->var = sqrt(2.0*kt*be->param->gamma);
 
-  tdpMemcpyToSymbol(tdpSymbol(static_param), be->param,
-		    sizeof(beris_edw_param_t), 0, tdpMemcpyHostToDevice);
+  /* Increment dt*var*chi must have variance 2 kT Gamma dt */
+  if (be->dt != 1.0) be->param->var = sqrt(2.0*kt*be->param->gamma/be->dt);
+
+  if (util_commit_required(&be->commit,
+			   "blue_phase_beris_edwards.c:static_param",
+			   be->param, sizeof(beris_edw_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(static_param), be->param,
+		      sizeof(beris_edw_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
@@ -228,6 +248,9 @@ __host__ int beris_edw_param_commit(beris_edw_t * be) {
  *
  *  beris_edw_param_set
  *
+ *  The noise basis tmatrix is a constant and is not taken from vals
+ *  (callers usually leave it zero, which would switch off the noise).
+ *
  *****************************************************************************/
 
 __host__ int beris_edw_param_set(beris_edw_t * be, beris_edw_param_t * vals) {
@@ -236,6 +259,41 @@ __host__ int beris_edw_param_set(beris_edw_t * be, beris_edw_param_t * vals) {
   assert(vals);
 
   *be->param = *vals;
+  beris_edw_tmatrix(be->param->tmatrix);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  beris_edw_dt_set
+ *
+ *****************************************************************************/
+
+__host__ int beris_edw_dt_set(beris_edw_t * be, double dt) {
+
+  assert(be);
+  assert(dt > 0.0);
+
+  be->dt = dt;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  beris_edw_fused_set
+ *
+ *  If fused is non-zero, the molecular field is computed in the
+ *  update kernel rather than being stored.
+ *
+ *****************************************************************************/
+
+__host__ int beris_edw_fused_set(beris_edw_t * be, int fused) {
+
+  assert(be);
+
+  be->fused = fused;
 
   return 0;
 }
@@ -278,8 +336,8 @@ __host__ int beris_edw_update(beris_edw_t * be,
     advection_bcs_no_normal_flux(nf, be->flux, map);
   }
 
-  beris_edw_h_driver(be, fe);
-  beris_edw_update_driver(be, fq, fq_grad, hydro, map, noise);
+  if (be->fused == 0) beris_edw_h_driver(be, fe);
+  beris_edw_update_driver(be, fe, fq, fq_grad, hydro, map, noise);
 
   return 0;
 }
@@ -325,7 +383,7 @@ __host__ int beris_edw_update_host(beris_edw_t * be, fe_t * fe, field_t * fq,
   double tmatrix[3][3][NQAB] = {0};
   double var = 0.0;
 
-  const double dt = 1.0;
+  const double dt = be->dt;
   const double r3 = 1.0/3.0;
   KRONECKER_DELTA_CHAR(d_);
 
@@ -481,9 +539,13 @@ __host__ int beris_edw_update_host(beris_edw_t * be, fe_t * fe, field_t * fq,
  *  hydro is allowed to be NULL, in which case we only have relaxational
  *  dynamics.
  *
+ *  For the fused update, the free energy is passed to the kernel to
+ *  compute the molecular field; otherwise the stored be->h is used.
+ *
  *****************************************************************************/
 
 __host__ int beris_edw_update_driver(beris_edw_t * be,
+				     fe_t * fe,
 				     field_t * fq,
 				     field_grad_t * fq_grad,
 				     hydro_t * hydro,
@@ -495,10 +557,12 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
   kernel_info_t limits;
   kernel_ctxt_t * ctxt = NULL;
 
+  fe_t * fetarget = NULL;
   hydro_t * hydrotarget = NULL;
   noise_t * noisetarget = NULL;
 
   assert(be);
+  assert(fe);
   assert(fq);
   assert(map);
 
@@ -513,6 +577,7 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
 
   beris_edw_param_commit(be);
   if (hydro) hydrotarget = hydro->target;
+  if (be->fused) fe->func->target(fe, &fetarget);
 
   ison = 0;
   if (noise) noise_present(noise, NOISE_QAB, &ison);
@@ -521,8 +586,9 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
   TIMER_start(BP_BE_UPDATE_KERNEL);
 
   tdpLaunchKernel(beris_edw_kernel_v, nblk, ntpb, 0, 0,
-		  ctxt->target, be->target, fq->target, fq_grad->target,
-		  hydrotarget, be->flux->target, map->target, noisetarget);
+		  ctxt->target, be->target, fetarget, fq->target,
+		  fq_grad->target, hydrotarget, be->flux->target, map->target,
+		  noisetarget, be->dt);
 
   tdpAssert(tdpPeekAtLastError());
   tdpAssert(tdpDeviceSynchronize());
@@ -538,18 +604,19 @@ __host__ int beris_edw_update_driver(beris_edw_t * be,
  *
  *  beris_edw_kernel
  *
+ *  If fe is not NULL, the molecular field is computed here.
+ *
  *****************************************************************************/
 
 __global__
-void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
+void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be, fe_t * fe,
 			field_t * fq, field_grad_t * fqgrad,
 			hydro_t * hydro, advflux_t * flux,
-			map_t * map, noise_t * noise) {
+			map_t * map, noise_t * noise, double dt) {
 
   int kindex;
   __shared__ int kiterations;
 
-  const double dt = 1.0;
   const double r3 = (1.0/3.0);
   KRONECKER_DELTA_CHAR(d_);
 
@@ -582,6 +649,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
     double trace_qw[NSIMDVL];
     double chi[NQAB], chi_qab[3][3][NSIMDVL];
     double tr[NSIMDVL];
+    double h[3][3][NSIMDVL];
 
     index = kernel_baseindex(ktx, kindex);
     kernel_coords_v(ktx, kindex, ic, jc, kc);
@@ -754,6 +822,21 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       }
     }
 
+    /* Molecular field */
+
+    if (fe) {
+      fe->func->htensor_v(fe, index, h);
+    }
+    else {
+      for_simd_v(iv, NSIMDVL) {
+	h[X][X][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, XX)];
+	h[X][Y][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, XY)];
+	h[X][Z][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, XZ)];
+	h[Y][Y][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, YY)];
+	h[Y][Z][iv] = be->h[addr_rank1(be->nall, NQAB, index+iv, YZ)];
+      }
+    }
+
     /* Here's the full hydrodynamic update. */
     /* The divergence of advective fluxes involves (jc-1) and (kc-1)
      * which are masked out if not a valid kernel site */
@@ -770,7 +853,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][X][iv] += dt*
 	(s[X][X][iv]
 	 + chi_qab[X][X][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XX)]
+	 + be->param->gamma*h[X][X][iv]
 	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
 	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
 	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XX)]
@@ -785,7 +868,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][Y][iv] += dt*
 	(s[X][Y][iv]
 	 + chi_qab[X][Y][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XY)]
+	 + be->param->gamma*h[X][Y][iv]
 	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
 	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
 	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XY)]
@@ -800,7 +883,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[X][Z][iv] += dt*
 	(s[X][Z][iv]
 	 + chi_qab[X][Z][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, XZ)]
+	 + be->param->gamma*h[X][Z][iv]
 	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
 	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
 	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,XZ)]
@@ -815,7 +898,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[Y][Y][iv] += dt*
 	(s[Y][Y][iv]
 	 + chi_qab[Y][Y][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, YY)]
+	 + be->param->gamma*h[Y][Y][iv]
 	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
 	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
 	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YY)]
@@ -830,7 +913,7 @@ void beris_edw_kernel_v(kernel_ctxt_t * ktx, beris_edw_t * be,
       q[Y][Z][iv] += dt*
 	(s[Y][Z][iv]
 	 + chi_qab[Y][Z][iv]
-	 + be->param->gamma*be->h[addr_rank1(be->nall, NQAB, index+iv, YZ)]
+	 + be->param->gamma*h[Y][Z][iv]
 	 - flux->fe[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
 	 + flux->fw[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
 	 - flux->fy[addr_rank1(flux->nsite,NQAB,index + iv,YZ)]
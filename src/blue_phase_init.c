@@ -7,10 +7,16 @@
  *  See, for example, Henrich et al, ...
  *  and references therein.
  *
+ *  All the initialisations are kernels which set Q_ab at the local
+ *  sites on the target. The host copy of the field is updated on
+ *  completion. Random initialisations use the per-site noise
+ *  generator, which is seeded from the global lattice position,
+ *  so that results are independent of decomposition.
+ *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Oliver Henrich (oliver.henrich@strath.ac.uk)
@@ -25,6 +31,7 @@
 #include "pe.h"
 #include "util.h"
 #include "coords.h"
+#include "kernel.h"
 #include "field_grad.h"
 #include "blue_phase.h"
 #include "blue_phase_init.h"
@@ -40,10 +47,98 @@ typedef struct rotation_s {
   double m2[3][3];
 } rotation_t;
 
-static int rotation_create(rotation_t * rot, int, int, int, const double a[3]);
-static int rotate_inplace(const rotation_t * rot, double r[3]);
+/* Parameters passed (by value) to the initialisation kernels */
+
+typedef struct bp_init_s bp_init_t;
+
+struct bp_init_s {
+  fe_lc_param_t param;          /* Free energy parameters (copy) */
+  int nlocal[3];                /* Local system size */
+  int ntotal[3];                /* Global system size */
+  int noffset[3];               /* Local offset */
+  double ltot[3];               /* Global system length */
+  int axis;                     /* Helical axis, strip, or finger axis */
+  double q[3][3];               /* Uniform (background) Q_ab */
+  double qkink1[3][3];          /* Kinks (active nematics) */
+  double qkink2[3][3];
+  rotation_t rot;               /* Euler rotation (O8M, O2) */
+  int nchi;                     /* chi edge: number */
+  double x0;                    /* chi edge: position */
+  double z0;                    /* chi edge: position */
+  int rmin[3];                  /* Random rectangle (local coordinates) */
+  int rmax[3];
+  double var;                   /* Variance of random fluctuation (cf1) */
+  double tmatrix[3][3][NQAB];   /* Basis for random fluctuation (cf1) */
+};
+
+/* BPIII: double twist cylinders, and their spatial bins */
+
+typedef struct bp_dtc_s bp_dtc_t;
+
+struct bp_dtc_s {
+  int ndtc;                     /* Number of cylinders */
+  int radius;                   /* Radius */
+  int env;                      /* Environment (0 isotropic, 1 cholesteric) */
+  int nbin[3];                  /* Number of bins */
+  double wbin[3];               /* Width of bins */
+  double * centre;              /* Centres [3*ndtc] */
+  double * mx;                  /* Rotation matrices [9*ndtc] */
+  double * my;                  /* Rotation matrices [9*ndtc] */
+  int * binstart;               /* Start of each bin in the list [nbins+1] */
+  int * binlist;                /* Cylinders by bin (ascending) [ndtc] */
+};
 
-void blue_phase_M_rot(double M[3][3], int dim, double alpha);
+static int rotation_create(rotation_t * rot, int, int, int, const double a[3]);
+static __host__ __device__ int rotate_inplace(const rotation_t * rot,
+					      double r[3]);
+static int bp_init_create(cs_t * cs, fe_lc_param_t * param, bp_init_t * init,
+			  kernel_ctxt_t ** ctxt);
+static int bp_init_finish(kernel_ctxt_t * ctxt, field_t * fq);
+static int bp_dtc_create(const bp_init_t * init, const double specs[3],
+			 bp_dtc_t * dtc);
+static int bp_dtc_free(bp_dtc_t * dtc);
+
+__global__ void bp_o8m_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init);
+__global__ void bp_o2_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			     bp_init_t init);
+__global__ void bp_h2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init);
+__global__ void bp_h3d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init, double sign);
+__global__ void bp_o5_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			     bp_init_t init);
+__global__ void bp_dtc_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init);
+__global__ void bp_bpiii_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				noise_t * rng, bp_init_t init, bp_dtc_t dtc);
+__global__ void bp_twist_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				bp_init_t init);
+__global__ void bp_uniform_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				  bp_init_t init);
+__global__ void bp_kink_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			       bp_init_t init);
+__global__ void bp_kink_q2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   bp_init_t init);
+__global__ void bp_chi_edge_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   bp_init_t init);
+__global__ void bp_random_q_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   noise_t * rng, bp_init_t init);
+__global__ void bp_random_q_2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				      noise_t * rng, bp_init_t init);
+__global__ void bp_random_q_rectangle_kernel(kernel_ctxt_t * ktx,
+					     field_t * fq, noise_t * rng,
+					     bp_init_t init);
+__global__ void bp_cf1_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      noise_t * rng, bp_init_t init);
+
+static __host__ __device__ void bp_cf1_director(const bp_init_t * init,
+						int ic, int jc, int kc,
+						double n[3]);
+static __host__ __device__ int bp_dtc_q(const bp_init_t * init,
+					const bp_dtc_t * dtc, int in,
+					int ir, int jr, int kr,
+					double q[3][3]);
 
 /*****************************************************************************
  *
@@ -59,23 +154,14 @@ void blue_phase_M_rot(double M[3][3], int dim, double alpha);
 int blue_phase_O8M_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			const double euler_angles[3]) {
 
-  int ntotal[3], nlocal[3], noffset[3];
-
-  double root2;
-  double q0;
-  double amplitude0;
-  rotation_t rot = {0};
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  cs_ntotal(cs, ntotal);
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-
-  root2 = sqrt(2.0);
-  q0    = param->q0;
-  amplitude0 = param->amplitude0;
+  bp_init_create(cs, param, &init, &ctxt);
 
   /* Set up rotation matrices with negative angles. Clockwise rotation */
   /* of arguments leads to counterclockwise rotation of the Q-tensor.  */
@@ -89,56 +175,85 @@ int blue_phase_O8M_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
     angles[1] = -1.0*pi*euler_angles[1]/180.0;
     angles[2] = -1.0*pi*euler_angles[2]/180.0;
 
-    rotation_create(&rot, Z, X, Z, angles);
+    rotation_create(&init.rot, Z, X, Z, angles);
   }
 
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    double x = noffset[X] + ic;
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      double y = noffset[Y] + jc;
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
-	double z = noffset[Z] + kc;
-	double r[3] = {0};
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	/* Rotate around the centre */
-	r[X] = x - 0.5*ntotal[X];
-	r[Y] = y - 0.5*ntotal[Y];
-	r[Z] = z - 0.5*ntotal[Z];
+  tdpLaunchKernel(bp_o8m_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-	rotate_inplace(&rot, r);
+  bp_init_finish(ctxt, fq);
 
-	r[X] += 0.5*ntotal[X];
-	r[Y] += 0.5*ntotal[Y];
-	r[Z] += 0.5*ntotal[Z];
+  return 0;
+}
 
-	{
-	  int index   = cs_index(cs, ic, jc, kc);
-	  double cosx = cos(root2*q0*r[X]);
-	  double cosy = cos(root2*q0*r[Y]);
-	  double cosz = cos(root2*q0*r[Z]);
-	  double sinx = sin(root2*q0*r[X]);
-	  double siny = sin(root2*q0*r[Y]);
-	  double sinz = sin(root2*q0*r[Z]);
-	  double q[3][3] = {0};
-
-	  q[X][X] = amplitude0*( -2.0*cosy*sinz +       sinx*cosz + cosx*siny);
-	  q[X][Y] = amplitude0*(root2*cosy*cosz + root2*sinx*sinz - sinx*cosy);
-	  q[X][Z] = amplitude0*(root2*cosx*cosy + root2*sinz*siny - cosx*sinz);
-	  q[Y][X] = q[X][Y];
-	  q[Y][Y] = amplitude0*( -2.0*sinx*cosz +       siny*cosx + cosy*sinz);
-	  q[Y][Z] = amplitude0*(root2*cosz*cosx + root2*siny*sinx - siny*cosz);
-	  q[Z][X] = q[X][Z];
-	  q[Z][Y] = q[Y][Z];
-	  q[Z][Z] = - q[X][X] - q[Y][Y];
+/*****************************************************************************
+ *
+ *  bp_o8m_kernel
+ *
+ *****************************************************************************/
 
-	  field_tensor_set(fq, index, q);
-	}
-	/* Next site */
-      }
+__global__ void bp_o8m_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double root2 = sqrt(2.0);
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double z = init.noffset[Z] + kc;
+    double r[3] = {0};
+
+    /* Rotate around the centre */
+    r[X] = x - 0.5*init.ntotal[X];
+    r[Y] = y - 0.5*init.ntotal[Y];
+    r[Z] = z - 0.5*init.ntotal[Z];
+
+    rotate_inplace(&init.rot, r);
+
+    r[X] += 0.5*init.ntotal[X];
+    r[Y] += 0.5*init.ntotal[Y];
+    r[Z] += 0.5*init.ntotal[Z];
+
+    {
+      double cosx = cos(root2*q0*r[X]);
+      double cosy = cos(root2*q0*r[Y]);
+      double cosz = cos(root2*q0*r[Z]);
+      double sinx = sin(root2*q0*r[X]);
+      double siny = sin(root2*q0*r[Y]);
+      double sinz = sin(root2*q0*r[Z]);
+      double q[3][3] = {0};
+
+      q[X][X] = amplitude0*( -2.0*cosy*sinz +       sinx*cosz + cosx*siny);
+      q[X][Y] = amplitude0*(root2*cosy*cosz + root2*sinx*sinz - sinx*cosy);
+      q[X][Z] = amplitude0*(root2*cosx*cosy + root2*sinz*siny - cosx*sinz);
+      q[Y][X] = q[X][Y];
+      q[Y][Y] = amplitude0*( -2.0*sinx*cosz +       siny*cosx + cosy*sinz);
+      q[Y][Z] = amplitude0*(root2*cosz*cosx + root2*siny*sinx - siny*cosz);
+      q[Z][X] = q[X][Z];
+      q[Z][Y] = q[Y][Z];
+      q[Z][Z] = - q[X][X] - q[Y][Y];
+
+      field_tensor_set(fq, index, q);
     }
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -155,21 +270,14 @@ int blue_phase_O8M_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 int blue_phase_O2_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 		       const double euler_angles[3]) {
 
-  int ntotal[3], nlocal[3], noffset[3];
-
-  double q0;
-  double amplitude0;
-  rotation_t rot = {0};
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  cs_ntotal(cs, ntotal);
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
+  bp_init_create(cs, param, &init, &ctxt);
 
   /* Set up rotation matrices with negative angles. Clockwise rotation */
   /* of arguments leads to counterclockwise rotation of the Q-tensor.  */
@@ -183,55 +291,83 @@ int blue_phase_O2_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
     angles[1] = -1.0*pi*euler_angles[1]/180.0;
     angles[2] = -1.0*pi*euler_angles[2]/180.0;
 
-    rotation_create(&rot, Z, X, Z, angles);
+    rotation_create(&init.rot, Z, X, Z, angles);
   }
 
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    double x = noffset[X] + ic;
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      double y = noffset[Y] + jc;
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
-	double z = noffset[Z] + kc;
-	double r[3] = {0};
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	r[X] = x - 0.5*ntotal[X];
-	r[Y] = y - 0.5*ntotal[Y];
-	r[Z] = z - 0.5*ntotal[Z];
+  tdpLaunchKernel(bp_o2_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-	rotate_inplace(&rot, r);
+  bp_init_finish(ctxt, fq);
 
-	r[X] += 0.5*ntotal[X];
-	r[Y] += 0.5*ntotal[Y];
-	r[Z] += 0.5*ntotal[Z];
+  return 0;
+}
 
-	{
-	  int index = cs_index(cs, ic, jc, kc);
-	  double cosx = cos(2.0*q0*r[X]);
-	  double cosy = cos(2.0*q0*r[Y]);
-	  double cosz = cos(2.0*q0*r[Z]);
-	  double sinx = sin(2.0*q0*r[X]);
-	  double siny = sin(2.0*q0*r[Y]);
-	  double sinz = sin(2.0*q0*r[Z]);
-	  double q[3][3] = {0};
-
-	  q[X][X] = amplitude0*(cosz - cosy);
-	  q[X][Y] = amplitude0*sinz;
-	  q[X][Z] = amplitude0*siny;
-	  q[Y][X] = q[X][Y];
-	  q[Y][Y] = amplitude0*(cosx - cosz);
-	  q[Y][Z] = amplitude0*sinx;
-	  q[Z][X] = q[X][Z];
-	  q[Z][Y] = q[Y][Z];
-	  q[Z][Z] = - q[X][X] - q[Y][Y];
+/*****************************************************************************
+ *
+ *  bp_o2_kernel
+ *
+ *****************************************************************************/
 
-	  field_tensor_set(fq, index, q);
-	}
-	/* Next site */
-      }
+__global__ void bp_o2_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			     bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double z = init.noffset[Z] + kc;
+    double r[3] = {0};
+
+    r[X] = x - 0.5*init.ntotal[X];
+    r[Y] = y - 0.5*init.ntotal[Y];
+    r[Z] = z - 0.5*init.ntotal[Z];
+
+    rotate_inplace(&init.rot, r);
+
+    r[X] += 0.5*init.ntotal[X];
+    r[Y] += 0.5*init.ntotal[Y];
+    r[Z] += 0.5*init.ntotal[Z];
+
+    {
+      double cosx = cos(2.0*q0*r[X]);
+      double cosy = cos(2.0*q0*r[Y]);
+      double cosz = cos(2.0*q0*r[Z]);
+      double sinx = sin(2.0*q0*r[X]);
+      double siny = sin(2.0*q0*r[Y]);
+      double sinz = sin(2.0*q0*r[Z]);
+      double q[3][3] = {0};
+
+      q[X][X] = amplitude0*(cosz - cosy);
+      q[X][Y] = amplitude0*sinz;
+      q[X][Z] = amplitude0*siny;
+      q[Y][X] = q[X][Y];
+      q[Y][Y] = amplitude0*(cosx - cosz);
+      q[Y][Z] = amplitude0*sinx;
+      q[Z][X] = q[X][Z];
+      q[Z][Y] = q[Y][Z];
+      q[Z][Z] = - q[X][X] - q[Y][Y];
+
+      field_tensor_set(fq, index, q);
     }
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -244,51 +380,68 @@ int blue_phase_O2_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 
 int blue_phase_H2D_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double q[3][3];
-  double x, y;
-  double r3;
-  double q0;
-  double amplitude0;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  r3 = sqrt(3.0);
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
+  bp_init_create(cs, param, &init, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  tdpLaunchKernel(bp_h2d_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  bp_init_finish(ctxt, fq);
 
-	index = cs_index(cs, ic, jc, kc);
+  return 0;
+}
 
-	q[X][X] = amplitude0*(-1.5*   cos(q0*x)*cos(q0*r3*y));
-	q[X][Y] = amplitude0*(-0.5*r3*sin(q0*x)*sin(q0*r3*y));
-	q[X][Z] = amplitude0*(     r3*cos(q0*x)*sin(q0*r3*y));
-	q[Y][X] = q[X][Y];
-	q[Y][Y] = amplitude0*(-cos(2.0*q0*x) - 0.5*cos(q0*x)*cos(q0*r3*y));
-	q[Y][Z] = amplitude0*(-sin(2.0*q0*x) -     sin(q0*x)*cos(q0*r3*y));
-	q[Z][X] = q[X][Z];
-	q[Z][Y] = q[Y][Z];
-	q[Z][Z] = - q[X][X] - q[Y][Y];
+/*****************************************************************************
+ *
+ *  bp_h2d_kernel
+ *
+ *****************************************************************************/
 
-	field_tensor_set(fq, index, q);
-      }
-    }
+__global__ void bp_h2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double r3 = sqrt(3.0);
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double q[3][3];
+
+    q[X][X] = amplitude0*(-1.5*   cos(q0*x)*cos(q0*r3*y));
+    q[X][Y] = amplitude0*(-0.5*r3*sin(q0*x)*sin(q0*r3*y));
+    q[X][Z] = amplitude0*(     r3*cos(q0*x)*sin(q0*r3*y));
+    q[Y][X] = q[X][Y];
+    q[Y][Y] = amplitude0*(-cos(2.0*q0*x) - 0.5*cos(q0*x)*cos(q0*r3*y));
+    q[Y][Z] = amplitude0*(-sin(2.0*q0*x) -     sin(q0*x)*cos(q0*r3*y));
+    q[Z][X] = q[X][Z];
+    q[Z][Y] = q[Y][Z];
+    q[Z][Z] = - q[X][X] - q[Y][Y];
+
+    field_tensor_set(fq, index, q);
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -301,55 +454,20 @@ int blue_phase_H2D_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
 int blue_phase_H3DA_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double q[3][3];
-  double x, y, z;
-  double r3;
-  double q0;
-  double amplitude0;
-  double ltot[3];
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  r3 = sqrt(3.0);
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
-
-  cs_ltot(cs, ltot);
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	z = noffset[Z] + kc;
-
-	index = cs_index(cs, ic, jc, kc);
-
-	q[X][X] = amplitude0*(-1.5*cos(q0*x)*cos(q0*r3*y)
-			       + 0.25*cos(q0*ltot[X]/ltot[Z]*z)); 
-	q[X][Y] = amplitude0*(-0.5*r3*sin(q0*x)*sin(q0*r3*y)
-			       + 0.25*sin(q0*ltot[X]/ltot[Z]*z));
-	q[X][Z] = amplitude0*(r3*cos(q0*x)*sin(q0*r3*y));
-	q[Y][X] = q[X][Y];
-	q[Y][Y] = amplitude0*(-cos(2.0*q0*x)-0.5*cos(q0*x)*cos(q0*r3*y)
-			       -0.25*cos(q0*ltot[X]/ltot[Z]*z));
-	q[Y][Z] = amplitude0*(-sin(2.0*q0*x)-sin(q0*x)*cos(q0*r3*y));
-	q[Z][X] = q[X][Z];
-	q[Z][Y] = q[Y][Z];
-	q[Z][Z] = - q[X][X] - q[Y][Y];
-
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+  bp_init_create(cs, param, &init, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(bp_h3d_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init, -1.0);
+
+  bp_init_finish(ctxt, fq);
 
   return 0;
 }
@@ -364,59 +482,77 @@ int blue_phase_H3DA_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
 int blue_phase_H3DB_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double q[3][3];
-  double x, y, z;
-  double r3;
-  double q0;
-  double amplitude0;
-  double ltot[3];
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  r3 = sqrt(3.0);
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
-
-  cs_ltot(cs, ltot);
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	z = noffset[Z] + kc;
-
-	index = cs_index(cs, ic, jc, kc);
-
-	q[X][X] = amplitude0*(1.5*cos(q0*x)*cos(q0*r3*y)
-			       + 0.25*cos(q0*ltot[X]/ltot[Z]*z)); 
-	q[X][Y] = amplitude0*(0.5*r3*sin(q0*x)*sin(q0*r3*y)
-			       + 0.25*sin(q0*ltot[X]/ltot[Z]*z));
-	q[X][Z] = amplitude0*(-r3*cos(q0*x)*sin(q0*r3*y));
-	q[Y][X] = q[X][Y];
-	q[Y][Y] = amplitude0*(cos(2.0*q0*x) + 0.5*cos(q0*x)*cos(q0*r3*y)
-			       - 0.25*cos(q0*ltot[X]/ltot[Z]*z));
-	q[Y][Z] = amplitude0*(sin(2.0*q0*x) + sin(q0*x)*cos(q0*r3*y));
-	q[Z][X] = q[X][Z];
-	q[Z][Y] = q[Y][Z];
-	q[Z][Z] = - q[X][X] - q[Y][Y];
-
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+  bp_init_create(cs, param, &init, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(bp_h3d_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init, +1.0);
+
+  bp_init_finish(ctxt, fq);
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  bp_h3d_kernel
+ *
+ *  3D hexagonal A (sign = -1) or B (sign = +1). The sign applies to
+ *  the 2D hexagonal part only.
+ *
+ *****************************************************************************/
+
+__global__ void bp_h3d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init, double sign) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double r3 = sqrt(3.0);
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double z = init.noffset[Z] + kc;
+    double q[3][3];
+
+    q[X][X] = amplitude0*(sign*1.5*cos(q0*x)*cos(q0*r3*y)
+			  + 0.25*cos(q0*init.ltot[X]/init.ltot[Z]*z));
+    q[X][Y] = amplitude0*(sign*0.5*r3*sin(q0*x)*sin(q0*r3*y)
+			  + 0.25*sin(q0*init.ltot[X]/init.ltot[Z]*z));
+    q[X][Z] = amplitude0*(-sign*r3*cos(q0*x)*sin(q0*r3*y));
+    q[Y][X] = q[X][Y];
+    q[Y][Y] = amplitude0*(sign*(cos(2.0*q0*x) + 0.5*cos(q0*x)*cos(q0*r3*y))
+			  - 0.25*cos(q0*init.ltot[X]/init.ltot[Z]*z));
+    q[Y][Z] = amplitude0*(sign*(sin(2.0*q0*x) + sin(q0*x)*cos(q0*r3*y)));
+    q[Z][X] = q[X][Z];
+    q[Z][Y] = q[Y][Z];
+    q[Z][Z] = - q[X][X] - q[Y][Y];
+
+    field_tensor_set(fq, index, q);
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  blue_phase_O5_init
@@ -427,64 +563,82 @@ int blue_phase_H3DB_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
 int blue_phase_O5_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
+
+  assert(fq);
+
+  bp_init_create(cs, param, &init, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(bp_o5_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
+
+  bp_init_finish(ctxt, fq);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_o5_kernel
+ *
+ *****************************************************************************/
 
-  double q[3][3];
-  double x, y, z;
-  double q0;
-  double amplitude0;
+__global__ void bp_o5_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			     bp_init_t init) {
+  int kiter;
+  int kindex;
 
+  assert(ktx);
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	z = noffset[Z] + kc;
-
-	index = cs_index(cs, ic, jc, kc);
-
-	q[X][X] = amplitude0*
-            (2.0*cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*z)-
-                 cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*z)-
-                 cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*y)); 
-	q[X][Y] = amplitude0*
-            (sqrt(2.0)*cos(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*z)-
-             sqrt(2.0)*cos(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*z)-
-             sin(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*y));
-	q[X][Z] = amplitude0*
-            (sqrt(2.0)*cos(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*y)-
-             sqrt(2.0)*cos(sqrt(2.0)*q0*z)*sin(sqrt(2.0)*q0*y)-
-             sin(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*z));
-	q[Y][X] = q[X][Y];
-	q[Y][Y] = amplitude0*
-            (2.0*cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*z)-
-                 cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*x)-
-                 cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*z));
-	q[Y][Z] = amplitude0*
-            (sqrt(2.0)*cos(sqrt(2.0)*q0*z)*sin(sqrt(2.0)*q0*x)-
-             sqrt(2.0)*cos(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*x)-
-             sin(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*z));
-	q[Z][X] = q[X][Z];
-	q[Z][Y] = q[Y][Z];
-	q[Z][Z] = - q[X][X] - q[Y][Y];
-
-	field_tensor_set(fq, index, q);
-      }
-    }
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double z = init.noffset[Z] + kc;
+    double q[3][3];
+
+    q[X][X] = amplitude0*
+      (2.0*cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*z)-
+           cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*z)-
+           cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*y));
+    q[X][Y] = amplitude0*
+      (sqrt(2.0)*cos(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*z)-
+       sqrt(2.0)*cos(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*z)-
+       sin(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*y));
+    q[X][Z] = amplitude0*
+      (sqrt(2.0)*cos(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*y)-
+       sqrt(2.0)*cos(sqrt(2.0)*q0*z)*sin(sqrt(2.0)*q0*y)-
+       sin(sqrt(2.0)*q0*x)*sin(sqrt(2.0)*q0*z));
+    q[Y][X] = q[X][Y];
+    q[Y][Y] = amplitude0*
+      (2.0*cos(sqrt(2.0)*q0*x)*cos(sqrt(2.0)*q0*z)-
+           cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*x)-
+           cos(sqrt(2.0)*q0*y)*cos(sqrt(2.0)*q0*z));
+    q[Y][Z] = amplitude0*
+      (sqrt(2.0)*cos(sqrt(2.0)*q0*z)*sin(sqrt(2.0)*q0*x)-
+       sqrt(2.0)*cos(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*x)-
+       sin(sqrt(2.0)*q0*y)*sin(sqrt(2.0)*q0*z));
+    q[Z][X] = q[X][Z];
+    q[Z][Y] = q[Y][Z];
+    q[Z][Z] = - q[X][X] - q[Y][Y];
+
+    field_tensor_set(fq, index, q);
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -497,49 +651,67 @@ int blue_phase_O5_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
 int blue_phase_DTC_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double q[3][3];
-  double x, y;
-  double q0;
-  double amplitude0;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  q0 = param->q0;
-  amplitude0 = param->amplitude0;
+  tdpLaunchKernel(bp_dtc_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  bp_init_finish(ctxt, fq);
 
-	index = cs_index(cs, ic, jc, kc);
+  return 0;
+}
 
-	q[X][X] = -amplitude0*cos(2*q0*y);
-	q[X][Y] = 0.0;
-	q[X][Z] = amplitude0*sin(2.0*q0*y);
-	q[Y][X] = q[X][Y];
-	q[Y][Y] = -amplitude0*cos(2.0*q0*x);
-	q[Y][Z] = -amplitude0*sin(2.0*q0*x);
-	q[Z][X] = q[X][Z];
-	q[Z][Y] = q[Y][Z];
-	q[Z][Z] = - q[X][X] - q[Y][Y];
+/*****************************************************************************
+ *
+ *  bp_dtc_kernel
+ *
+ *****************************************************************************/
 
-	field_tensor_set(fq, index, q);
-      }
-    }
+__global__ void bp_dtc_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double q0 = init.param.q0;
+    double amplitude0 = init.param.amplitude0;
+    double x = init.noffset[X] + ic;
+    double y = init.noffset[Y] + jc;
+    double q[3][3];
+
+    q[X][X] = -amplitude0*cos(2*q0*y);
+    q[X][Y] = 0.0;
+    q[X][Z] = amplitude0*sin(2.0*q0*y);
+    q[Y][X] = q[X][Y];
+    q[Y][Y] = -amplitude0*cos(2.0*q0*x);
+    q[Y][Z] = -amplitude0*sin(2.0*q0*x);
+    q[Z][X] = q[X][Z];
+    q[Z][Y] = q[Y][Z];
+    q[Z][Z] = - q[X][X] - q[Y][Y];
+
+    field_tensor_set(fq, index, q);
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -549,206 +721,428 @@ int blue_phase_DTC_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
  *  This initialisation is with Blue Phase III, randomly positioned
  *  and oriented DTC-cylinders in isotropic (0) or cholesteric (1) environment.
  *
- *  NOTE: The rotations are not rigorously implemented; no cross-boundary 
- *        communication is performed. 
+ *  Each cylinder maps the local sites within its radius to rotated
+ *  positions; where cylinders overlap, the last cylinder wins. This
+ *  is computed as a gather at each site, which only examines the
+ *  cylinders in neighbouring spatial bins (see bp_bpiii_kernel).
+ *
+ *  NOTE: The rotations are not rigorously implemented; no cross-boundary
+ *        communication is performed.
  *        Hence, the decomposition must consist of sufficiently large volumes.
- *        
+ *
  *****************************************************************************/
 
 int blue_phase_BPIII_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			  const double specs[3]) {
 
-  int ic, jc, kc;
-  int ir, jr, kr; 	/* indices for rotated output */
-  int ia, ib, ik, il, in;
-  int nlocal[3];
-  int ntotal[3];
-  int noffset[3];
-  int index;
-  double q[3][3], q0[3][3];
-  double x, y, z;
-  double *a, *b;	/* rotation angles */
-  double *C;     	/* global coordinates of DTC-centres */
-  int N=2, R=3, ENV=1; 	/* default no. & radius & environment */ 
-  double rc[3];	  	/* distance DTC-centre - site */ 
-  double rc_r[3]; 	/* rotated vector */ 
-  double Mx[3][3], My[3][3]; /* rotation matrices */
-  double phase1, phase2;
-  double n[3]={0.0,0.0,0.0};
-  double q0_pitch;      /* Just q0 scalar */
-  double amplitude0;
-  PI_DOUBLE(pi);
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  bp_dtc_t dtc = {0};
+  kernel_ctxt_t * ctxt = NULL;
+  noise_t * rng = NULL;
+  noise_t * rng_target = NULL;
 
   assert(cs);
   assert(fq);
   assert(specs);
 
-  N = (int) specs[0];
-  R = (int) specs[1];
-  ENV = (int) specs[2];
+  bp_init_create(cs, param, &init, &ctxt);
+  bp_dtc_create(&init, specs, &dtc);
 
-  a = (double*)calloc(N, sizeof(double));
-  b = (double*)calloc(N, sizeof(double));
-  C = (double*)calloc(3*N, sizeof(double));
+  noise_create(fq->pe, cs, &rng);
+  noise_init(rng, DEFAULT_SEED);
+  noise_target(rng, &rng_target);
+
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  cs_nlocal(cs, nlocal);
-  cs_ntotal(cs, ntotal);
-  cs_nlocal_offset(cs, noffset);
+  tdpLaunchKernel(bp_bpiii_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, rng_target, init, dtc);
 
-  q0_pitch = param->q0;
-  amplitude0 = param->amplitude0;
+  bp_init_finish(ctxt, fq);
 
-    /* Initialise random rotation angles and centres in serial */
-    /* to get the same random numbers on all processes */
-    for(in = 0; in < N; in++){
+  noise_free(rng);
+  bp_dtc_free(&dtc);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_dtc_create
+ *
+ *  Random rotation angles and centres are drawn in serial to get the
+ *  same values on all processes. The centres are then placed in bins
+ *  of width at least radius + 1 (the furthest a site can be moved by
+ *  a cylinder), and the lists are copied to the target.
+ *
+ *****************************************************************************/
+
+static int bp_dtc_create(const bp_init_t * init, const double specs[3],
+			 bp_dtc_t * dtc) {
+
+  int ndtc;
+  int nbins;
+  int * binstart = NULL;
+  int * binlist = NULL;
+  int * ibin = NULL;
+  double * centre = NULL;
+  double * mx = NULL;
+  double * my = NULL;
+  PI_DOUBLE(pi);
+
+  assert(init);
+  assert(specs);
+  assert(dtc);
+
+  dtc->ndtc   = (int) specs[0];
+  dtc->radius = (int) specs[1];
+  dtc->env    = (int) specs[2];
+
+  ndtc = dtc->ndtc;
+
+  for (int ia = 0; ia < 3; ia++) {
+    dtc->nbin[ia] = imax(1, init->ntotal[ia]/(dtc->radius + 1));
+    dtc->wbin[ia] = 1.0*init->ntotal[ia]/dtc->nbin[ia];
+  }
+  nbins = dtc->nbin[X]*dtc->nbin[Y]*dtc->nbin[Z];
+
+  centre   = (double *) calloc(3*imax(1, ndtc), sizeof(double));
+  mx       = (double *) calloc(9*imax(1, ndtc), sizeof(double));
+  my       = (double *) calloc(9*imax(1, ndtc), sizeof(double));
+  ibin     = (int *) calloc(imax(1, ndtc), sizeof(int));
+  binlist  = (int *) calloc(imax(1, ndtc), sizeof(int));
+  binstart = (int *) calloc(nbins + 1, sizeof(int));
+  assert(centre && mx && my && ibin && binlist && binstart);
+
+  for (int in = 0; in < ndtc; in++) {
+    int ib[3] = {0};
+    double a = 2.0*pi * ran_serial_uniform();
+    double b = 2.0*pi * ran_serial_uniform();
+
+    centre[3*in + X] = init->ntotal[X] * ran_serial_uniform();
+    centre[3*in + Y] = init->ntotal[Y] * ran_serial_uniform();
+    centre[3*in + Z] = init->ntotal[Z] * ran_serial_uniform();
+
+    blue_phase_M_rot((double (*)[3]) (mx + 9*in), 0, a);
+    blue_phase_M_rot((double (*)[3]) (my + 9*in), 1, b);
+
+    for (int ia = 0; ia < 3; ia++) {
+      ib[ia] = (int) (centre[3*in + ia]/dtc->wbin[ia]);
+      ib[ia] = imin(ib[ia], dtc->nbin[ia] - 1);
+    }
+    ibin[in] = ib[X]*dtc->nbin[Y]*dtc->nbin[Z] + ib[Y]*dtc->nbin[Z] + ib[Z];
+    binstart[ibin[in] + 1] += 1;
+  }
+
+  /* Counting sort preserves ascending order of cylinders within bins */
+
+  for (int n = 0; n < nbins; n++) {
+    binstart[n + 1] += binstart[n];
+  }
+
+  {
+    int * ifill = (int *) calloc(nbins, sizeof(int));
+    assert(ifill);
+    for (int in = 0; in < ndtc; in++) {
+      binlist[binstart[ibin[in]] + ifill[ibin[in]]++] = in;
+    }
+    free(ifill);
+  }
 
-      a[in] = 2.0*pi * ran_serial_uniform();
-      b[in] = 2.0*pi * ran_serial_uniform();
-      C[3*in]   = ntotal[X] * ran_serial_uniform(); 
-      C[3*in+1] = ntotal[Y] * ran_serial_uniform(); 
-      C[3*in+2] = ntotal[Z] * ran_serial_uniform(); 
+  /* Target copies */
 
+  {
+    int ndevice = 0;
+    tdpGetDeviceCount(&ndevice);
+
+    if (ndevice == 0) {
+      dtc->centre   = centre;
+      dtc->mx       = mx;
+      dtc->my       = my;
+      dtc->binstart = binstart;
+      dtc->binlist  = binlist;
+      centre = NULL; mx = NULL; my = NULL; binstart = NULL; binlist = NULL;
     }
+    else {
+      size_t nd = imax(1, ndtc);
+      tdpAssert(tdpMalloc((void **) &dtc->centre, 3*nd*sizeof(double)));
+      tdpAssert(tdpMalloc((void **) &dtc->mx, 9*nd*sizeof(double)));
+      tdpAssert(tdpMalloc((void **) &dtc->my, 9*nd*sizeof(double)));
+      tdpAssert(tdpMalloc((void **) &dtc->binlist, nd*sizeof(int)));
+      tdpAssert(tdpMalloc((void **) &dtc->binstart, (nbins+1)*sizeof(int)));
+      tdpAssert(tdpMemcpy(dtc->centre, centre, 3*nd*sizeof(double),
+			  tdpMemcpyHostToDevice));
+      tdpAssert(tdpMemcpy(dtc->mx, mx, 9*nd*sizeof(double),
+			  tdpMemcpyHostToDevice));
+      tdpAssert(tdpMemcpy(dtc->my, my, 9*nd*sizeof(double),
+			  tdpMemcpyHostToDevice));
+      tdpAssert(tdpMemcpy(dtc->binlist, binlist, nd*sizeof(int),
+			  tdpMemcpyHostToDevice));
+      tdpAssert(tdpMemcpy(dtc->binstart, binstart, (nbins+1)*sizeof(int),
+			  tdpMemcpyHostToDevice));
+    }
+  }
 
-  /* Setting environment configuration */
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      y = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  free(binstart);
+  free(binlist);
+  free(ibin);
+  free(my);
+  free(mx);
+  free(centre);
 
-	if (ENV == 0){
+  return 0;
+}
 
-	  phase1 = pi*(0.5 - ran_parallel_uniform());
-	  phase2 = pi*(0.5 - ran_parallel_uniform());
+/*****************************************************************************
+ *
+ *  bp_dtc_free
+ *
+ *****************************************************************************/
 
-	  n[X] = cos(phase1)*sin(phase2);
-	  n[Y] = sin(phase1)*sin(phase2);
-	  n[Z] = cos(phase2);
+static int bp_dtc_free(bp_dtc_t * dtc) {
 
-	  fe_lc_q_uniaxial(param, n, q);
+  int ndevice = 0;
 
-	 /* The amplitude of the orderparameter is hardwired */
-	 /* for the random and isotropic background configuration */     
-	  for (ia = 0; ia < 3; ia++) {
-	    for (ib = 0; ib < 3; ib++) {
-	      q[ia][ib] *= 1.0e-6;
-	    }
-	  }
+  assert(dtc);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice == 0) {
+    free(dtc->binstart);
+    free(dtc->binlist);
+    free(dtc->my);
+    free(dtc->mx);
+    free(dtc->centre);
+  }
+  else {
+    tdpAssert(tdpFree(dtc->binstart));
+    tdpAssert(tdpFree(dtc->binlist));
+    tdpAssert(tdpFree(dtc->my));
+    tdpAssert(tdpFree(dtc->mx));
+    tdpAssert(tdpFree(dtc->centre));
+  }
+
+  *dtc = (bp_dtc_t) {0};
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_bpiii_kernel
+ *
+ *  The environment is set at each site, and then replaced by the
+ *  contribution of the highest-numbered cylinder which maps a site
+ *  onto this one (if any).
+ *
+ *****************************************************************************/
+
+__global__ void bp_bpiii_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				noise_t * rng, bp_init_t init, bp_dtc_t dtc) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+  assert(rng);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    int ndtc = -1;
+    int bmin[3], bmax[3];
+    double r[3];
+    double q[3][3] = {0};
+    double n[3] = {0};
+    PI_DOUBLE(pi);
+
+    /* Environment */
+
+    if (dtc.env == 0) {
+      double ran1 = 0.0;
+      double ran2 = 0.0;
+      double phase1, phase2;
+
+      noise_uniform_double_reap(rng, index, &ran1);
+      noise_uniform_double_reap(rng, index, &ran2);
 
+      phase1 = pi*(0.5 - ran1);
+      phase2 = pi*(0.5 - ran2);
+
+      n[X] = cos(phase1)*sin(phase2);
+      n[Y] = sin(phase1)*sin(phase2);
+      n[Z] = cos(phase2);
+
+      fe_lc_q_uniaxial(&init.param, n, q);
+
+      /* The amplitude of the orderparameter is hardwired */
+      /* for the random and isotropic background configuration */
+      for (int ia = 0; ia < 3; ia++) {
+	for (int ib = 0; ib < 3; ib++) {
+	  q[ia][ib] *= 1.0e-6;
 	}
-	if (ENV == 1){
+      }
+    }
 
-	  /* cholesteric helix along y-direction */
-	  n[X] = cos(q0_pitch*y);
-	  n[Y] = 0.0;
-	  n[Z] = -sin(q0_pitch*y);
+    if (dtc.env == 1) {
+      /* cholesteric helix along y-direction */
+      double y = init.noffset[Y] + jc;
+      n[X] = cos(init.param.q0*y);
+      n[Y] = 0.0;
+      n[Z] = -sin(init.param.q0*y);
+
+      fe_lc_q_uniaxial(&init.param, n, q);
+
+      for (int ia = 0; ia < 3; ia++) {
+	for (int ib = 0; ib < 3; ib++) {
+	  q[ia][ib] *= init.param.amplitude0;
+	}
+      }
+    }
 
-	  fe_lc_q_uniaxial(param, n, q);
+    /* Cylinders in neighbouring bins (no periodic images) */
 
-	  for (ia = 0; ia < 3; ia++) {
-	    for (ib = 0; ib < 3; ib++) {
-	      q[ia][ib] *= amplitude0;
+    r[X] = init.noffset[X] + ic;
+    r[Y] = init.noffset[Y] + jc;
+    r[Z] = init.noffset[Z] + kc;
+
+    for (int ia = 0; ia < 3; ia++) {
+      bmin[ia] = (int) floor((r[ia] - dtc.radius - 1.0)/dtc.wbin[ia]);
+      bmax[ia] = (int) floor((r[ia] + dtc.radius + 1.0)/dtc.wbin[ia]);
+      bmin[ia] = imax(bmin[ia], 0);
+      bmax[ia] = imin(bmax[ia], dtc.nbin[ia] - 1);
+    }
+
+    for (int ib = bmin[X]; ib <= bmax[X]; ib++) {
+      for (int jb = bmin[Y]; jb <= bmax[Y]; jb++) {
+	for (int kb = bmin[Z]; kb <= bmax[Z]; kb++) {
+	  int nb = ib*dtc.nbin[Y]*dtc.nbin[Z] + jb*dtc.nbin[Z] + kb;
+	  for (int p = dtc.binstart[nb]; p < dtc.binstart[nb + 1]; p++) {
+	    int in = dtc.binlist[p];
+	    if (in > ndtc) {
+	      double qdtc[3][3];
+	      if (bp_dtc_q(&init, &dtc, in, ic, jc, kc, qdtc)) {
+		ndtc = in;
+		for (int ia = 0; ia < 3; ia++) {
+		  for (int ja = 0; ja < 3; ja++) {
+		    q[ia][ja] = qdtc[ia][ja];
+		  }
+		}
+	      }
 	    }
 	  }
-	  
 	}
+      }
+    }
+
+    field_tensor_set(fq, index, q);
+  }
 
-	index = cs_index(cs, ic, jc, kc);
-	field_tensor_set(fq, index, q);
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  bp_dtc_q
+ *
+ *  For cylinder in, does any local site (ic, jc, kc) in the cylinder
+ *  map to local site (ir, jr, kr)? If so, return 1 and the Q_ab from
+ *  the last such site (in the order ic, jc, kc). Otherwise return 0.
+ *
+ *  The candidate sites are those near the inverse rotation of the
+ *  centre of the target site; the forward map is then computed for
+ *  each candidate exactly as the original site-by-site sweep.
+ *
+ *****************************************************************************/
+
+static __host__ __device__ int bp_dtc_q(const bp_init_t * init,
+					const bp_dtc_t * dtc, int in,
+					int ir, int jr, int kr,
+					double q[3][3]) {
+  int found = 0;
+  int nc[3];
+  double rt[3];
+  const double * c = dtc->centre + 3*in;
+  const double (* mx)[3] = (const double (*)[3]) (dtc->mx + 9*in);
+  const double (* my)[3] = (const double (*)[3]) (dtc->my + 9*in);
+
+  /* Inverse image of target centre: rc = Mx^T My^T (rt - c) */
+
+  rt[X] = init->noffset[X] + ir + 0.5 - c[X];
+  rt[Y] = init->noffset[Y] + jr + 0.5 - c[Y];
+  rt[Z] = init->noffset[Z] + kr + 0.5 - c[Z];
+
+  for (int ia = 0; ia < 3; ia++) {
+    double rc = 0.0;
+    for (int ik = 0; ik < 3; ik++) {
+      for (int il = 0; il < 3; il++) {
+	rc += mx[il][ia]*my[ik][il]*rt[ik];
       }
     }
+    nc[ia] = (int) floor(c[ia] + rc + 0.5) - init->noffset[ia];
   }
 
-  /* Replace configuration inside DTC-domains */
-  /* by sweeping through all local sites */
-  for(in = 0; in<N; in++){
-
-    blue_phase_M_rot(Mx,0,a[in]);
-    blue_phase_M_rot(My,1,b[in]);
-
-    for (ic = 1; ic <= nlocal[X]; ic++) {
-      x = noffset[X] + ic;
-      for (jc = 1; jc <= nlocal[Y]; jc++) {
-	y = noffset[Y] + jc;
-	for (kc = 1; kc <= nlocal[Z]; kc++) {
-	  z = noffset[Z] + kc;
-
-	  rc[X] = x - C[3*in];
-	  rc[Y] = y - C[3*in+1];
-	  rc[Z] = z - C[3*in+2];
-
-	  /* If current site is in ROI perform double */
-	  /* rotation around local x- and y-axis */
-	  if(rc[0]*rc[0] + rc[1]*rc[1] + rc[2]*rc[2] < R*R){
-
-	    for(ia=0; ia<3; ia++){
-	      rc_r[ia] = 0.0;
-	      for(ik=0; ik<3; ik++){
-		for(il=0; il<3; il++){
-		  rc_r[ia] += My[ia][ik] * Mx[ik][il] * rc[il];
-		}
-	      }
+  for (int ic = nc[X] - 2; ic <= nc[X] + 2; ic++) {
+    if (ic < 1 || ic > init->nlocal[X]) continue;
+    for (int jc = nc[Y] - 2; jc <= nc[Y] + 2; jc++) {
+      if (jc < 1 || jc > init->nlocal[Y]) continue;
+      for (int kc = nc[Z] - 2; kc <= nc[Z] + 2; kc++) {
+	double rc[3];
+	double rc_r[3];
+	if (kc < 1 || kc > init->nlocal[Z]) continue;
+
+	rc[X] = (double) (init->noffset[X] + ic) - c[X];
+	rc[Y] = (double) (init->noffset[Y] + jc) - c[Y];
+	rc[Z] = (double) (init->noffset[Z] + kc) - c[Z];
+
+	if (rc[0]*rc[0] + rc[1]*rc[1] + rc[2]*rc[2]
+	    >= dtc->radius*dtc->radius) continue;
+
+	for (int ia = 0; ia < 3; ia++) {
+	  rc_r[ia] = 0.0;
+	  for (int ik = 0; ik < 3; ik++) {
+	    for (int il = 0; il < 3; il++) {
+	      rc_r[ia] += my[ia][ik] * mx[ik][il] * rc[il];
 	    }
+	  }
+	}
 
-	    /* DTC symmetric wrt local z-axis */
-	    q0[X][X] = -amplitude0*cos(2*q0_pitch*rc[Y]);
-	    q0[X][Y] = 0.0;
-	    q0[X][Z] = amplitude0*sin(2.0*q0_pitch*rc[Y]);
-	    q0[Y][X] = q[X][Y];
-	    q0[Y][Y] = -amplitude0*cos(2.0*q0_pitch*rc[X]);
-	    q0[Y][Z] = -amplitude0*sin(2.0*q0_pitch*rc[X]);
-	    q0[Z][X] = q[X][Z];
-	    q0[Z][Y] = q[Y][Z];
-	    q0[Z][Z] = - q[X][X] - q[Y][Y];
-
-	    /* Transform order parameter tensor */ 
-            /* Determine local output index */
-            ir = (int)(C[3*in] + rc_r[X] - noffset[X]);
-            jr = (int)(C[3*in+1] + rc_r[Y] - noffset[Y]);
-            kr = (int)(C[3*in+2] + rc_r[Z] - noffset[Z]);
-
-	    /* Replace if index is in local domain */
-	    if((1 <= ir && ir <= nlocal[X]) &&  
-	       (1 <= jr && jr <= nlocal[Y]) &&  
-               (1 <= kr && kr <= nlocal[Z]))
-	    {
-   /*******************************************************************
-   * NOTE: The individual componentes of the tensor order parameter are
-   *       not transformed, i.e. rotated, as this leads to considerable 
-   *       instabilities in the calculation of the gradients.
-   *       BPIII emerges more reliably from an unrotated OP.
-   *******************************************************************/
-
-	      q[X][X] = q0[X][X];
-	      q[X][Y] = q0[X][Y];
-	      q[X][Z] = q0[X][Z];
-	      q[Y][X] = q[X][Y];
-	      q[Y][Y] = q0[Y][Y];
-	      q[Y][Z] = q0[Y][Z];
-	      q[Z][X] = q[X][Z];
-	      q[Z][Y] = q[Y][Z];
-	      q[Z][Z] = - q[X][X] - q[Y][Y];
-
-	      index = cs_index(cs, ir, jr, kr);
-	      field_tensor_set(fq, index, q);
-	    }
+	if ((int)(c[X] + rc_r[X] - init->noffset[X]) != ir) continue;
+	if ((int)(c[Y] + rc_r[Y] - init->noffset[Y]) != jr) continue;
+	if ((int)(c[Z] + rc_r[Z] - init->noffset[Z]) != kr) continue;
 
-	  }
+	/* DTC symmetric wrt local z-axis. The individual components
+	 * are not rotated, as this leads to considerable instabilities
+	 * in the calculation of the gradients. BPIII emerges more
+	 * reliably from an unrotated OP. */
+	{
+	  double q0 = init->param.q0;
+	  double amplitude0 = init->param.amplitude0;
 
+	  q[X][X] = -amplitude0*cos(2*q0*rc[Y]);
+	  q[X][Y] = 0.0;
+	  q[X][Z] = amplitude0*sin(2.0*q0*rc[Y]);
+	  q[Y][X] = q[X][Y];
+	  q[Y][Y] = -amplitude0*cos(2.0*q0*rc[X]);
+	  q[Y][Z] = -amplitude0*sin(2.0*q0*rc[X]);
+	  q[Z][X] = q[X][Z];
+	  q[Z][Y] = q[Y][Z];
+	  q[Z][Z] = - q[X][X] - q[Y][Y];
 	}
+	found = 1;
       }
     }
-
   }
 
-  free(a);
-  free(b);
-  free(C);
-
-  return 0;
+  return found;
 }
 
-
 /*****************************************************************************
  *
  *  blue_phase_twist_init
@@ -763,63 +1157,78 @@ int blue_phase_BPIII_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 int blue_phase_twist_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			  int helical_axis) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double n[3];
-  double q[3][3];
-  double x, y, z;
-  double q0;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(param);
   assert(fq);
   assert(helical_axis == X || helical_axis == Y || helical_axis == Z);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
+  init.axis = helical_axis;
 
-  q0 = param->q0;
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  n[X] = 0.0;
-  n[Y] = 0.0;
-  n[Z] = 0.0;
- 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
+  tdpLaunchKernel(bp_twist_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-    if (helical_axis == X) {
-      x = noffset[X] + ic;
-      n[Y] = cos(q0*x);
-      n[Z] = sin(q0*x);
-    }
+  bp_init_finish(ctxt, fq);
 
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
+  return 0;
+}
 
-      if (helical_axis == Y) {
-	y = noffset[Y] + jc;
-	n[X] = cos(q0*y);
-	n[Z] = -sin(q0*y);
-      }
+/*****************************************************************************
+ *
+ *  bp_twist_kernel
+ *
+ *****************************************************************************/
 
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	
-	index = cs_index(cs, ic, jc, kc);
+__global__ void bp_twist_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				bp_init_t init) {
+  int kiter;
+  int kindex;
 
-	if (helical_axis == Z) {
-	  z = noffset[Z] + kc;
-	  n[X] = cos(q0*z);
-	  n[Y] = sin(q0*z);
-	}
+  assert(ktx);
+  assert(fq);
 
-	fe_lc_q_uniaxial(param, n, q);
-	field_tensor_set(fq, index, q);
-      }
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double q0 = init.param.q0;
+    double n[3] = {0};
+    double q[3][3];
+
+    if (init.axis == X) {
+      double x = init.noffset[X] + ic;
+      n[Y] = cos(q0*x);
+      n[Z] = sin(q0*x);
+    }
+
+    if (init.axis == Y) {
+      double y = init.noffset[Y] + jc;
+      n[X] = cos(q0*y);
+      n[Z] = -sin(q0*y);
     }
+
+    if (init.axis == Z) {
+      double z = init.noffset[Z] + kc;
+      n[X] = cos(q0*z);
+      n[Y] = sin(q0*z);
+    }
+
+    fe_lc_q_uniaxial(&init.param, n, q);
+    field_tensor_set(fq, index, q);
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -836,41 +1245,63 @@ int blue_phase_twist_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 int blue_phase_nematic_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			    const double n[3]) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int ia, index;
-
   double nhat[3];
-  double q[3][3];
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
   assert(n);
   assert(modulus(n) > 0.0);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
 
-  for (ia = 0; ia < 3; ia++) {
+  for (int ia = 0; ia < 3; ia++) {
     nhat[ia] = n[ia] / modulus(n);
   }
 
-  fe_lc_q_uniaxial(param, nhat, q);
+  fe_lc_q_uniaxial(param, nhat, init.q);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	index = cs_index(cs, ic, jc, kc);
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+  tdpLaunchKernel(bp_uniform_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
+
+  bp_init_finish(ctxt, fq);
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  bp_uniform_kernel
+ *
+ *****************************************************************************/
+
+__global__ void bp_uniform_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				  bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    field_tensor_set(fq, index, init.q);
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  blue_phase_active_nematic_init
@@ -885,19 +1316,12 @@ int blue_phase_nematic_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
 				   field_t * fq, const double n[3]) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int ntotal[3];
-  int noffset[3];
-  int ia, index;
-
   double nhat[3];
-  double q[3][3];
-
-  double nkink1[3], nkink2[3];
-  double qkink1[3][3], qkink2[3][3];
-
+  double nkink1[3] = {0}, nkink2[3] = {0};
   double ang;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   PI_DOUBLE(pi);
 
   ang = pi/180.0*10.0;
@@ -905,18 +1329,19 @@ int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
   assert(cs);
   assert(modulus(n) > 0.0);
 
-  cs_nlocal(cs, nlocal);
-  cs_ntotal(cs, ntotal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
 
-  for (ia = 0; ia < 3; ia++) {
+  for (int ia = 0; ia < 3; ia++) {
     nhat[ia] = n[ia] / modulus(n);
   }
 
-  /* 2 kinks depending on the primary alignment */
+  /* 2 kinks depending on the primary alignment; if neither, no kinks */
+
+  init.axis = -1;
 
-  /* Kink for primary alignment along x */	 
+  /* Kink for primary alignment along x */
   if (nhat[0] == 1.0) {
+    init.axis = X;
     nkink1[0] = nhat[0]*sin(ang);
     nkink1[1] = nhat[1];
     nkink1[2] = nhat[0]*cos(ang);
@@ -925,9 +1350,10 @@ int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
     nkink2[1] =  nhat[1];
     nkink2[2] =  nhat[0]*cos(ang);
   }
-  /* Kink for primary alignment along y */	 
+  /* Kink for primary alignment along y */
 
   if (nhat[1] == 1.0) {
+    init.axis = Y;
     nkink1[0] = nhat[0];
     nkink1[1] = nhat[1]*sin(ang);
     nkink1[2] = nhat[1]*cos(ang);
@@ -937,54 +1363,73 @@ int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
     nkink2[2] =  nhat[1]*cos(ang);
   }
 
-  fe_lc_q_uniaxial(param, nhat, q);
-  fe_lc_q_uniaxial(param, nkink1, qkink1);
-  fe_lc_q_uniaxial(param, nkink2, qkink2);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    int ix = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      int iy = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	int iz = noffset[Z] + kc;
-
-	index = cs_index(cs, ic, jc, kc);
-	field_tensor_set(fq, index, q);
-
-        /* If alignment along x region around 
-	   z = ntotal[Z]/2 is being replaced */
- 
-	if(nhat[0] == 1.0) {
-	  if (iz == ntotal[Z]/2 || iz == (ntotal[Z]-1)/2) {
-	    if (ix <= ntotal[X]/2) {
-	      field_tensor_set(fq, index, qkink1);
-	    }
-	    else {
-	      field_tensor_set(fq, index, qkink2);
-	    }
-	  }
-	}
+  fe_lc_q_uniaxial(param, nhat, init.q);
+  fe_lc_q_uniaxial(param, nkink1, init.qkink1);
+  fe_lc_q_uniaxial(param, nkink2, init.qkink2);
+
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(bp_kink_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
+
+  bp_init_finish(ctxt, fq);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_kink_kernel
+ *
+ *  Kinks in the plane(s) around z = ntotal[Z]/2 for alignment along
+ *  init.axis = X or Y.
+ *
+ *****************************************************************************/
+
+__global__ void bp_kink_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			       bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
 
-        /* If alignment along y region around 
-	   z=ntotal[Z]/2 is being replaced */
+  for_simt_parallel(kindex, kiter, 1) {
 
-	if(nhat[1] == 1.0){
-	  if (iz == ntotal[Z]/2 || iz == (ntotal[Z]-1)/2) {
-	    if (iy <= ntotal[Y]/2) {
-	      field_tensor_set(fq, index, qkink1);
-	    }
-	    else {
-	      field_tensor_set(fq, index, qkink2);
-	    }
-	  }
-	}
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
 
+    int ix = init.noffset[X] + ic;
+    int iy = init.noffset[Y] + jc;
+    int iz = init.noffset[Z] + kc;
+    int iskink = (iz == init.ntotal[Z]/2 || iz == (init.ntotal[Z]-1)/2);
+
+    if (iskink && init.axis == X) {
+      if (ix <= init.ntotal[X]/2) {
+	field_tensor_set(fq, index, init.qkink1);
+      }
+      else {
+	field_tensor_set(fq, index, init.qkink2);
+      }
+    }
+    else if (iskink && init.axis == Y) {
+      if (iy <= init.ntotal[Y]/2) {
+	field_tensor_set(fq, index, init.qkink1);
       }
+      else {
+	field_tensor_set(fq, index, init.qkink2);
+      }
+    }
+    else {
+      field_tensor_set(fq, index, init.q);
     }
   }
 
-
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -995,7 +1440,7 @@ int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
  *
  *  For istrip == X, the director looks like
  *
- *       - - - - - -     ^ 
+ *       - - - - - -     ^
  *       / / / \ \ \     |
  *       - - - - - -     | Y   ---> X
  *
@@ -1006,19 +1451,12 @@ int blue_phase_active_nematic_init(cs_t * cs, fe_lc_param_t * param,
 int lc_active_nematic_init_q2d(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			       int istrip) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int ntotal[3];
-  int noffset[3];
-  int index;
-
-  double nhat[3];
-  double q[3][3];
-
-  double nkink1[3], nkink2[3];
-  double qkink1[3][3], qkink2[3][3];
-
+  double nhat[3] = {0};
+  double nkink1[3] = {0}, nkink2[3] = {0};
   double ang;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   PI_DOUBLE(pi);
 
   assert(cs);
@@ -1028,9 +1466,8 @@ int lc_active_nematic_init_q2d(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 
   ang = pi/180.0*10.0;
 
-  cs_nlocal(cs, nlocal);
-  cs_ntotal(cs, ntotal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
+  init.axis = istrip;
 
   if (istrip == X) {
     nhat[X] = 1.0;
@@ -1056,53 +1493,75 @@ int lc_active_nematic_init_q2d(cs_t * cs, fe_lc_param_t * param, field_t * fq,
     nkink2[Z] =  0.0;
   }
 
-  fe_lc_q_uniaxial(param, nhat, q);
-  fe_lc_q_uniaxial(param, nkink1, qkink1);
-  fe_lc_q_uniaxial(param, nkink2, qkink2);
+  fe_lc_q_uniaxial(param, nhat, init.q);
+  fe_lc_q_uniaxial(param, nkink1, init.qkink1);
+  fe_lc_q_uniaxial(param, nkink2, init.qkink2);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    int ix = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      int iy = noffset[Y] + jc;
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	index = cs_index(cs, ic, jc, kc);
+  tdpLaunchKernel(bp_kink_q2d_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-	/* Background */
-	field_tensor_set(fq, index, q);
+  bp_init_finish(ctxt, fq);
 
-        /* Central strip parallel to X */
- 
-	if (istrip == X) {
-	  if (iy == ntotal[Y]/2 || iy == (ntotal[Y]-1)/2) {
-	    if (ix <= ntotal[X]/2) {
-	      field_tensor_set(fq, index, qkink1);
-	    }
-	    else {
-	      field_tensor_set(fq, index, qkink2);
-	    }
-	  }
-	}
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_kink_q2d_kernel
+ *
+ *  Central strip parallel to init.axis.
+ *
+ *****************************************************************************/
 
-        /* Central strip parallel to Y */
+__global__ void bp_kink_q2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   bp_init_t init) {
+  int kiter;
+  int kindex;
 
-	if (istrip == Y) {
-	  if (ix == ntotal[X]/2 || ix == (ntotal[X]-1)/2) {
-	    if (iy <= ntotal[Y]/2) {
-	      field_tensor_set(fq, index, qkink1);
-	    }
-	    else {
-	      field_tensor_set(fq, index, qkink2);
-	    }
-	  }
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    int ix = init.noffset[X] + ic;
+    int iy = init.noffset[Y] + jc;
+
+    /* Background */
+    field_tensor_set(fq, index, init.q);
+
+    if (init.axis == X) {
+      if (iy == init.ntotal[Y]/2 || iy == (init.ntotal[Y]-1)/2) {
+	if (ix <= init.ntotal[X]/2) {
+	  field_tensor_set(fq, index, init.qkink1);
+	}
+	else {
+	  field_tensor_set(fq, index, init.qkink2);
 	}
+      }
+    }
 
-	/* Next site */
+    if (init.axis == Y) {
+      if (ix == init.ntotal[X]/2 || ix == (init.ntotal[X]-1)/2) {
+	if (iy <= init.ntotal[Y]/2) {
+	  field_tensor_set(fq, index, init.qkink1);
+	}
+	else {
+	  field_tensor_set(fq, index, init.qkink2);
+	}
       }
     }
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -1116,45 +1575,70 @@ int lc_active_nematic_init_q2d(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 int blue_phase_chi_edge(cs_t * cs, fe_lc_param_t * param, field_t * fq, int N,
 			double z0, double x0) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int index;
-
-  double q[3][3];
-  double x, z;
-  double n[3];
-  double theta;
-  double q0;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
+  init.nchi = N;
+  init.z0 = z0;
+  init.x0 = x0;
 
-  q0 = param->q0;
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    x = noffset[X] + ic;
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	z = noffset[Z] + kc;
-	
-	index = cs_index(cs, ic, jc, kc);
+  tdpLaunchKernel(bp_chi_edge_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, init);
 
-	theta = 1.0*N/2.0*atan2((1.0*z-z0),(1.0*x-x0)) + q0*(z-z0);	
-	n[X] = cos(theta);
-	n[Y] = sin(theta);
-	n[Z] = 0.0;
+  bp_init_finish(ctxt, fq);
 
-	fe_lc_q_uniaxial(param, n, q);
-	field_tensor_set(fq, index, q);
-      }
-    }
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_chi_edge_kernel
+ *
+ *****************************************************************************/
+
+__global__ void bp_chi_edge_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double x = init.noffset[X] + ic;
+    double z = init.noffset[Z] + kc;
+    double z0 = init.z0;
+    double x0 = init.x0;
+    double theta;
+    double n[3];
+    double q[3][3];
+
+    theta = 1.0*init.nchi/2.0*atan2((1.0*z-z0),(1.0*x-x0))
+      + init.param.q0*(z-z0);
+    n[X] = cos(theta);
+    n[Y] = sin(theta);
+    n[Z] = 0.0;
+
+    fe_lc_q_uniaxial(&init.param, n, q);
+    field_tensor_set(fq, index, q);
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -1169,52 +1653,79 @@ int blue_phase_chi_edge(cs_t * cs, fe_lc_param_t * param, field_t * fq, int N,
 
 int blue_phase_random_q_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int ic, jc, kc, index;
-  int nlocal[3];
-  int seed = DEFAULT_SEED;
-
-  double n[3];            /* random director */
-  double q[3][3];         /* resulting unixial q */
-  double phase1, phase2;
-
-  double ran1, ran2;
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   noise_t * rng = NULL;
-  PI_DOUBLE(pi);
+  noise_t * rng_target = NULL;
 
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
+  bp_init_create(cs, param, &init, &ctxt);
 
   noise_create(fq->pe, cs, &rng);
-  noise_init(rng, seed);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-	    
-	index = cs_index(cs, ic, jc, kc);
-
-	noise_uniform_double_reap(rng, index, &ran1);
-	noise_uniform_double_reap(rng, index, &ran2);
+  noise_init(rng, DEFAULT_SEED);
+  noise_target(rng, &rng_target);
 
-	phase1 = 2.0*pi*(0.5 - ran1);
-	phase2 = acos(2.0*ran2 - 1.0);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	n[X] = cos(phase1)*sin(phase2);
-	n[Y] = sin(phase1)*sin(phase2);
-	n[Z] = cos(phase2);
+  tdpLaunchKernel(bp_random_q_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, rng_target, init);
 
-	fe_lc_q_uniaxial(param, n, q);
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+  bp_init_finish(ctxt, fq);
 
   noise_free(rng);
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  bp_random_q_kernel
+ *
+ *****************************************************************************/
+
+__global__ void bp_random_q_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				   noise_t * rng, bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+  assert(rng);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double n[3];            /* random director */
+    double q[3][3];         /* resulting unixial q */
+    double phase1, phase2;
+    double ran1, ran2;
+    PI_DOUBLE(pi);
+
+    noise_uniform_double_reap(rng, index, &ran1);
+    noise_uniform_double_reap(rng, index, &ran2);
+
+    phase1 = 2.0*pi*(0.5 - ran1);
+    phase2 = acos(2.0*ran2 - 1.0);
+
+    n[X] = cos(phase1)*sin(phase2);
+    n[Y] = sin(phase1)*sin(phase2);
+    n[Z] = cos(phase2);
+
+    fe_lc_q_uniaxial(&init.param, n, q);
+    field_tensor_set(fq, index, q);
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  blue_phase_random_q_2d
@@ -1226,46 +1737,75 @@ int blue_phase_random_q_init(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
 int blue_phase_random_q_2d(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
 
-  int seed = DEFAULT_SEED;
-  int nlocal[3] = {0};
-
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   noise_t * rng = NULL;
-  PI_DOUBLE(pi);
+  noise_t * rng_target = NULL;
 
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
+  bp_init_create(cs, param, &init, &ctxt);
 
   noise_create(fq->pe, cs, &rng);
-  noise_init(rng, seed);
+  noise_init(rng, DEFAULT_SEED);
+  noise_target(rng, &rng_target);
 
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	int index = cs_index(cs, ic, jc, kc);
-	double ran1 = 0.0;
-	double phase1 = 0.0;
-	double n[3] = {0};
-	double q[3][3] = {0};
+  tdpLaunchKernel(bp_random_q_2d_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, rng_target, init);
 
-	noise_uniform_double_reap(rng, index, &ran1);
+  bp_init_finish(ctxt, fq);
 
-	phase1 = 2.0*pi*(0.5 - ran1);
+  noise_free(rng);
 
-	n[X] = cos(phase1);
-	n[Y] = sin(phase1);
-	n[Z] = 0.0;
+  return 0;
+}
 
-	fe_lc_q_uniaxial(param, n, q);
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+/*****************************************************************************
+ *
+ *  bp_random_q_2d_kernel
+ *
+ *****************************************************************************/
 
-  noise_free(rng);
+__global__ void bp_random_q_2d_kernel(kernel_ctxt_t * ktx, field_t * fq,
+				      noise_t * rng, bp_init_t init) {
+  int kiter;
+  int kindex;
 
-  return 0;
+  assert(ktx);
+  assert(fq);
+  assert(rng);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double ran1 = 0.0;
+    double phase1 = 0.0;
+    double n[3] = {0};
+    double q[3][3] = {0};
+    PI_DOUBLE(pi);
+
+    noise_uniform_double_reap(rng, index, &ran1);
+
+    phase1 = 2.0*pi*(0.5 - ran1);
+
+    n[X] = cos(phase1);
+    n[Y] = sin(phase1);
+    n[Z] = 0.0;
+
+    fe_lc_q_uniaxial(&init.param, n, q);
+    field_tensor_set(fq, index, q);
+  }
+
+  return;
 }
 
 /*****************************************************************************
@@ -1277,83 +1817,111 @@ int blue_phase_random_q_2d(cs_t * cs, fe_lc_param_t * param, field_t * fq) {
  *  set previously (e.g., to cholesteric), but only in a small region.
  *
  *  We should then have amplitude of order a0 << amplitude0; we use
- *  a0 = 1.0e-06. 
- * 
+ *  a0 = 1.0e-06.
+ *
  *****************************************************************************/
 
 int blue_phase_random_q_rectangle(cs_t * cs, fe_lc_param_t * param,
 				  field_t * fq, int rmin[3],
 				  int rmax[3]) {
 
-  int ic, jc, kc, index;
-  int ia, ib;
-  int nlocal[3];
-  int noffset[3];
-  int seed = DEFAULT_SEED;
-
-  double n[3];
-  double q[3][3];
-  double phase1, phase2;
-  double a0 = 0.01;             /* Initial amplitude of order in 'box' */
-
-  double ran1, ran2;
-
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   noise_t * rng = NULL;
-  PI_DOUBLE(pi);
-  KRONECKER_DELTA_CHAR(d);
+  noise_t * rng_target = NULL;
 
   assert(cs);
   assert(fq);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
+  bp_init_create(cs, param, &init, &ctxt);
 
   noise_create(fq->pe, cs, &rng);
-  noise_init(rng, seed);
+  noise_init(rng, DEFAULT_SEED);
+  noise_target(rng, &rng_target);
 
   /* Adjust min, max to allow for parallel offset of box */
 
-  rmin[X] -= noffset[X]; rmax[X] -= noffset[X];
-  rmin[Y] -= noffset[Y]; rmax[Y] -= noffset[Y];
-  rmin[Z] -= noffset[Z]; rmax[Z] -= noffset[Z];
+  for (int ia = 0; ia < 3; ia++) {
+    init.rmin[ia] = rmin[ia] - init.noffset[ia];
+    init.rmax[ia] = rmax[ia] - init.noffset[ia];
+  }
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  /* The rectangle is superposed on the existing (host) state */
 
-	if (ic < rmin[X] || ic > rmax[X] || jc < rmin[Y] || jc > rmax[Y] ||
-	    kc < rmin[Z] || kc > rmax[Z]) continue;
+  field_memcpy(fq, tdpMemcpyHostToDevice);
 
-	index = cs_index(cs, ic, jc, kc);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	noise_uniform_double_reap(rng, index, &ran1);
-	noise_uniform_double_reap(rng, index, &ran2);
+  tdpLaunchKernel(bp_random_q_rectangle_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, rng_target, init);
 
-	phase1 = 2.0*pi*(0.5 - ran1);
-	phase2 = acos(2.0*ran2 - 1.0);
-	    
-	n[X] = cos(phase1)*sin(phase2);
-	n[Y] = sin(phase1)*sin(phase2);
-	n[Z] = cos(phase2);
+  bp_init_finish(ctxt, fq);
 
-	/* Uniaxial approximation using a0 */
-	for (ia = 0; ia < 3; ia++) {
-	  for (ib = 0; ib < 3; ib++) {
-	    q[ia][ib] = 0.5*a0*(3.0*n[ia]*n[ib] - d[ia][ib]);
-	  }
-	}
-	field_tensor_set(fq, index, q);
+  noise_free(rng);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  bp_random_q_rectangle_kernel
+ *
+ *****************************************************************************/
 
+__global__ void bp_random_q_rectangle_kernel(kernel_ctxt_t * ktx,
+					     field_t * fq, noise_t * rng,
+					     bp_init_t init) {
+  int kiter;
+  int kindex;
+
+  assert(ktx);
+  assert(fq);
+  assert(rng);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+
+    double n[3];
+    double q[3][3];
+    double phase1, phase2;
+    double a0 = 0.01;             /* Initial amplitude of order in 'box' */
+    double ran1, ran2;
+    PI_DOUBLE(pi);
+    KRONECKER_DELTA_CHAR(d);
+
+    if (ic < init.rmin[X] || ic > init.rmax[X] ||
+	jc < init.rmin[Y] || jc > init.rmax[Y] ||
+	kc < init.rmin[Z] || kc > init.rmax[Z]) continue;
+
+    noise_uniform_double_reap(rng, index, &ran1);
+    noise_uniform_double_reap(rng, index, &ran2);
+
+    phase1 = 2.0*pi*(0.5 - ran1);
+    phase2 = acos(2.0*ran2 - 1.0);
+
+    n[X] = cos(phase1)*sin(phase2);
+    n[Y] = sin(phase1)*sin(phase2);
+    n[Z] = cos(phase2);
+
+    /* Uniaxial approximation using a0 */
+    for (int ia = 0; ia < 3; ia++) {
+      for (int ib = 0; ib < 3; ib++) {
+	q[ia][ib] = 0.5*a0*(3.0*n[ia]*n[ib] - d[ia][ib]);
       }
     }
+    field_tensor_set(fq, index, q);
   }
 
-  noise_free(rng);
-
-  return 0;
+  return;
 }
 
-
 /****************************************************************************
  *
  *  M_rot
@@ -1439,7 +2007,8 @@ static int rotation_create(rotation_t * rot, int d0, int d1, int d2,
  *
  *****************************************************************************/
 
-static int rotate_inplace(const rotation_t * rot, double r[3]) {
+static __host__ __device__ int rotate_inplace(const rotation_t * rot,
+					      double r[3]) {
 
   double r0[3] = {r[X], r[Y], r[Z]};
 
@@ -1460,107 +2029,92 @@ static int rotate_inplace(const rotation_t * rot, double r[3]) {
   return 0;
 }
 
-
 /*****************************************************************************
  *
- *  blue_phase_cf1_init
- *
- *  Initialise a cholesteric finger of the first kind.
- *  Uses the current free energy parameters
- *     q0 (P=2pi/q0)
+ *  bp_init_create
  *
- *  See also P. Ribiere, S. Pirkl, P. Oswald, Phys. Rev. A 44, 8198--8209 (1991). 
+ *  Common parameters, and a kernel context for all local sites.
  *
  *****************************************************************************/
 
-int blue_phase_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
-			int axis) {
+static int bp_init_create(cs_t * cs, fe_lc_param_t * param, bp_init_t * init,
+			  kernel_ctxt_t ** ctxt) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int ntotal[3];
-  int index;
+  kernel_info_t limits;
 
-  double n[3];
-  double q[3][3];
-  double q0;
-  double alpha, alpha0, beta;
-  PI_DOUBLE(pi);
+  assert(cs);
+  assert(param);
+  assert(init);
+  assert(ctxt);
 
-  assert(fq);
-  assert(axis == X || axis == Y || axis == Z);
+  init->param = *param;
+  cs_nlocal(cs, init->nlocal);
+  cs_ntotal(cs, init->ntotal);
+  cs_nlocal_offset(cs, init->noffset);
+  cs_ltot(cs, init->ltot);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-  cs_ntotal(cs, ntotal);
+  limits.imin = 1; limits.imax = init->nlocal[X];
+  limits.jmin = 1; limits.jmax = init->nlocal[Y];
+  limits.kmin = 1; limits.kmax = init->nlocal[Z];
 
-  q0 = param->q0;
-  alpha0 = 0.5*pi; 
+  kernel_ctxt_create(cs, 1, limits, ctxt);
 
-  n[X] = 0.0;
-  n[Y] = 0.0;
-  n[Z] = 0.0;
- 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  return 0;
+}
 
-	index = cs_index(cs, ic, jc, kc);
+/*****************************************************************************
+ *
+ *  bp_init_finish
+ *
+ *  Complete the kernel and update the host copy of the field.
+ *
+ *****************************************************************************/
 
-	if (axis == X) {
+static int bp_init_finish(kernel_ctxt_t * ctxt, field_t * fq) {
 
-	    alpha = alpha0*sin(pi*(noffset[Z]+kc)/ntotal[Z]);
-	    beta  = -2.0*(pi*(noffset[Z]+kc)/ntotal[Z]-0.5*pi);
+  assert(ctxt);
+  assert(fq);
 
-	    n[X]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Y]+jc)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[Y]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Y]+jc)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[Z]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     cos(alpha)*cos(alpha);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-	}
+  kernel_ctxt_free(ctxt);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
 
-	if (axis == Y) {
+  return 0;
+}
 
-	    alpha = alpha0*sin(pi*(noffset[X]+ic)/ntotal[X]);
-	    beta  = -2.0*(pi*(noffset[X]+ic)/ntotal[X]-0.5*pi);
+/*****************************************************************************
+ *
+ *  blue_phase_cf1_init
+ *
+ *  Initialise a cholesteric finger of the first kind.
+ *  Uses the current free energy parameters
+ *     q0 (P=2pi/q0)
+ *
+ *  See also P. Ribiere, S. Pirkl, P. Oswald, Phys. Rev. A 44, 8198--8209 (1991).
+ *
+ *****************************************************************************/
 
-	    n[Y]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Z]+kc)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[Z]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Z]+kc)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[X]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     cos(alpha)*cos(alpha);
+int blue_phase_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
+			int axis) {
 
-	}
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
 
-	if (axis == Z) {
+  assert(fq);
+  assert(axis == X || axis == Y || axis == Z);
 
-	    alpha = alpha0*sin(pi*(noffset[Y]+jc)/ntotal[Y]);
-	    beta  = -2.0*(pi*(noffset[Y]+jc)/ntotal[Y]-0.5*pi);
+  bp_init_create(cs, param, &init, &ctxt);
+  init.axis = axis;
 
-	    n[Z]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[X]+ic)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[X]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[X]+ic)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[Y]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     cos(alpha)*cos(alpha);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	}
+  tdpLaunchKernel(bp_cf1_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, NULL, init);
 
-	fe_lc_q_uniaxial(param, n, q);
-	field_tensor_set(fq, index, q);
-      }
-    }
-  }
+  bp_init_finish(ctxt, fq);
 
   return 0;
 }
@@ -1576,134 +2130,166 @@ int blue_phase_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
  *  Uses the current free energy parameters
  *     q0 (pitch = 2pi/q0)
  *
- *  See also P. Ribiere, S. Pirkl, P. Oswald, Phys. Rev. A 44, 8198--8209 (1991). 
+ *  See also P. Ribiere, S. Pirkl, P. Oswald, Phys. Rev. A 44, 8198--8209 (1991).
  *
  *****************************************************************************/
 
 int blue_phase_random_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq,
 			       int axis) {
 
-  int ic, jc, kc;
-  int nlocal[3];
-  int noffset[3];
-  int ntotal[3];
-  int index;
-
-  double n[3];
-  double q[3][3];
-  double q0;
-  double alpha, alpha0, beta;
-
-  int ia, ib, id;
-  double tmatrix[3][3][NQAB];
-  double chi[NQAB], chi_qab[3][3];
-  double var = 1e-1; /* variance of random fluctuation */
-  int seed = DEFAULT_SEED;
-
+  dim3 nblk, ntpb;
+  bp_init_t init = {0};
+  kernel_ctxt_t * ctxt = NULL;
   noise_t * rng = NULL;
-  PI_DOUBLE(pi);
+  noise_t * rng_target = NULL;
 
   assert(cs);
   assert(fq);
   assert(axis == X || axis == Y || axis == Z);
 
-  cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
-  cs_ntotal(cs, ntotal);
+  bp_init_create(cs, param, &init, &ctxt);
+  init.axis = axis;
+  init.var = 1e-1; /* variance of random fluctuation */
+  beris_edw_tmatrix(init.tmatrix);
 
-  q0 = param->q0;
-  alpha0 = 0.5*pi; 
+  noise_create(fq->pe, cs, &rng);
+  noise_init(rng, DEFAULT_SEED);
+  noise_target(rng, &rng_target);
 
-  n[X] = 0.0;
-  n[Y] = 0.0;
-  n[Z] = 0.0;
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-  noise_create(fq->pe, cs, &rng);
-  noise_init(rng, seed);
- 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  tdpLaunchKernel(bp_cf1_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, fq->target, rng_target, init);
 
-	index = cs_index(cs, ic, jc, kc);
+  bp_init_finish(ctxt, fq);
 
-	if (axis == X) {
+  noise_free(rng);
+
+  return 0;
+}
 
-	    alpha = alpha0*sin(pi*(noffset[Z]+kc)/ntotal[Z]);
-	    beta  = -2.0*(pi*(noffset[Z]+kc)/ntotal[Z]-0.5*pi);
+/*****************************************************************************
+ *
+ *  bp_cf1_kernel
+ *
+ *  Cholesteric finger; if rng is not NULL, with a random fluctuation.
+ *
+ *****************************************************************************/
 
-	    n[X]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Y]+jc)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[Y]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Y]+jc)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[Z]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
-		     cos(alpha)*cos(alpha);
+__global__ void bp_cf1_kernel(kernel_ctxt_t * ktx, field_t * fq,
+			      noise_t * rng, bp_init_t init) {
+  int kiter;
+  int kindex;
 
-	}
+  assert(ktx);
+  assert(fq);
 
-	if (axis == Y) {
+  kiter = kernel_iterations(ktx);
 
-	    alpha = alpha0*sin(pi*(noffset[X]+ic)/ntotal[X]);
-	    beta  = -2.0*(pi*(noffset[X]+ic)/ntotal[X]-0.5*pi);
+  for_simt_parallel(kindex, kiter, 1) {
 
-	    n[Y]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Z]+kc)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[Z]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Z]+kc)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[X]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
-		     cos(alpha)*cos(alpha);
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = kernel_coords_index(ktx, ic, jc, kc);
 
-	}
+    double n[3] = {0};
+    double q[3][3];
 
-	if (axis == Z) {
+    bp_cf1_director(&init, ic, jc, kc, n);
+    fe_lc_q_uniaxial(&init.param, n, q);
 
-	    alpha = alpha0*sin(pi*(noffset[Y]+jc)/ntotal[Y]);
-	    beta  = -2.0*(pi*(noffset[Y]+jc)/ntotal[Y]-0.5*pi);
+    if (rng) {
+      double chi[NQAB];
 
-	    n[Z]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[X]+ic)) -
-		     cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     sin(alpha)*sin(beta)*cos(alpha);
-	    n[X]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[X]+ic)) -
-		     cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     sin(alpha)*cos(beta)*cos(alpha);
-	    n[Y]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
-		     cos(alpha)*cos(alpha);
+      /* Random fluctuation with specified variance */
+      noise_reap_n(rng, index, NQAB, chi);
 
+      for (int id = 0; id < NQAB; id++) {
+	chi[id] = init.var*chi[id];
+      }
+
+      /* Random fluctuation added to tensor order parameter */
+      for (int ia = 0; ia < 3; ia++) {
+	for (int ib = 0; ib < 3; ib++) {
+	  double chi_qab = 0.0;
+	  for (int id = 0; id < NQAB; id++) {
+	    chi_qab += chi[id]*init.tmatrix[ia][ib][id];
+	  }
+	  q[ia][ib] += chi_qab;
 	}
+      }
+    }
+
+    field_tensor_set(fq, index, q);
+  }
 
-	fe_lc_q_uniaxial(param, n, q);
+  return;
+}
 
-	/* Random fluctuation with specified variance */
-        noise_reap_n(rng, index, NQAB, chi);
+/*****************************************************************************
+ *
+ *  bp_cf1_director
+ *
+ *  Director for the cholesteric finger with axis init->axis.
+ *
+ *****************************************************************************/
 
-	for (id = 0; id < NQAB; id++) {
-	  chi[id] = var*chi[id];
-	}
+static __host__ __device__ void bp_cf1_director(const bp_init_t * init,
+						int ic, int jc, int kc,
+						double n[3]) {
+  const int * noffset = init->noffset;
+  const int * ntotal = init->ntotal;
+  double q0 = init->param.q0;
+  double alpha, alpha0, beta;
+  PI_DOUBLE(pi);
 
-	beris_edw_tmatrix(tmatrix);
+  alpha0 = 0.5*pi;
 
-	/* Random fluctuation added to tensor order parameter */
-	for (ia = 0; ia < 3; ia++) {
-	  for (ib = 0; ib < 3; ib++) {
-	    chi_qab[ia][ib] = 0.0;
-	    for (id = 0; id < NQAB; id++) {
-	      chi_qab[ia][ib] += chi[id]*tmatrix[ia][ib][id];
-	    }
-	    q[ia][ib] += chi_qab[ia][ib];
-	  }
-	}
+  if (init->axis == X) {
 
-	field_tensor_set(fq, index, q);
+    alpha = alpha0*sin(pi*(noffset[Z]+kc)/ntotal[Z]);
+    beta  = -2.0*(pi*(noffset[Z]+kc)/ntotal[Z]-0.5*pi);
 
-      }
-    }
+    n[X]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Y]+jc)) -
+             cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
+             sin(alpha)*sin(beta)*cos(alpha);
+    n[Y]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Y]+jc)) -
+             cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
+             sin(alpha)*cos(beta)*cos(alpha);
+    n[Z]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Y]+jc)) +
+             cos(alpha)*cos(alpha);
   }
 
-  noise_free(rng);
+  if (init->axis == Y) {
 
-  return 0;
+    alpha = alpha0*sin(pi*(noffset[X]+ic)/ntotal[X]);
+    beta  = -2.0*(pi*(noffset[X]+ic)/ntotal[X]-0.5*pi);
+
+    n[Y]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[Z]+kc)) -
+             cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
+             sin(alpha)*sin(beta)*cos(alpha);
+    n[Z]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[Z]+kc)) -
+             cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
+             sin(alpha)*cos(beta)*cos(alpha);
+    n[X]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[Z]+kc)) +
+             cos(alpha)*cos(alpha);
+  }
+
+  if (init->axis == Z) {
+
+    alpha = alpha0*sin(pi*(noffset[Y]+jc)/ntotal[Y]);
+    beta  = -2.0*(pi*(noffset[Y]+jc)/ntotal[Y]-0.5*pi);
+
+    n[Z]  =  cos(beta)* sin(alpha)*sin(q0*(noffset[X]+ic)) -
+             cos(alpha)*sin(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
+             sin(alpha)*sin(beta)*cos(alpha);
+    n[X]  = -sin(beta)*sin(alpha)*sin(q0*(noffset[X]+ic)) -
+             cos(alpha)*cos(beta)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
+             sin(alpha)*cos(beta)*cos(alpha);
+    n[Y]  =  sin(alpha)*sin(alpha)*cos(q0*(noffset[X]+ic)) +
+             cos(alpha)*cos(alpha);
+  }
+
+  return;
 }
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Oliver Henrich (o.henrich@ucl.ac.uk) wrote most of these.
@@ -44,5 +44,6 @@ int blue_phase_random_q_rectangle(cs_t * cs, fe_lc_param_t * param,
 				  field_t * q, int rmin[3], int rmax[3]);
 int blue_phase_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq, int axis);
 int blue_phase_random_cf1_init(cs_t * cs, fe_lc_param_t * param, field_t * fq, int axis);
+void blue_phase_M_rot(double M[3][3], int dim, double alpha);
 
 #endif
@@ -396,6 +396,14 @@ __host__ int blue_phase_init_rt(pe_t * pe, rt_t *rt,
     pe_info(pe, "Rotational diffusion const = %14.7e\n", gamma);
   }
 
+  {
+    /* Optional fused update (molecular field not stored) */
+    int fused = 0;
+    rt_int_parameter(rt, "lc_beris_edwards_fused", &fused);
+    beris_edw_fused_set(be, fused);
+    if (fused) pe_info(pe, "Fused update (H on the fly) =  on\n");
+  }
+
   return 0;
 }
 
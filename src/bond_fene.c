@@ -16,7 +16,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2014-2020 The University of Edinburgh
+ *  (c) 2014-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -150,12 +150,9 @@ int bond_fene_compute(colloids_info_t * cinfo, void * self) {
   double r2min, r2max;
   double r2, rr02, f;
 
-  colloid_t * pc = NULL;
-
   assert(cinfo);
   assert(obj);
 
-  colloids_info_local_head(cinfo, &pc);
   rr02 = 1.0/(obj->r0*obj->r0);
 
   r2min = obj->r0*obj->r0;
@@ -164,35 +161,33 @@ int bond_fene_compute(colloids_info_t * cinfo, void * self) {
   obj->vlocal = 0;
   obj->bondlocal = 0.0;
 
-  for (; pc; pc = pc->nextlocal) {
-   
-    if (pc->s.nbonds == 0) continue;
+  /* Bond list (see interact_find_bonds()) has each bond once. */
+
+  for (n = 0; n < cinfo->nbondlist; n++) {
 
-    for (n = 0; n < pc->s.nbonds; n++) {
-      assert(pc->bonded[n]);
-      if (pc->s.index > pc->bonded[n]->s.index) continue;
+    colloid_t * pc1 = cinfo->bondlist[2*n + 0];
+    colloid_t * pc2 = cinfo->bondlist[2*n + 1];
 
-      /* Compute force arising on each particle from single bond */
+    /* Compute force arising on each particle from single bond */
 
-      cs_minimum_distance(obj->cs, pc->s.r, pc->bonded[n]->s.r, r12);
-      r2 = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
+    cs_minimum_distance(obj->cs, pc1->s.r, pc2->s.r, r12);
+    r2 = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
 
-      if (r2 < r2min) r2min = r2;
-      if (r2 > r2max) r2max = r2;
-      if (r2 > obj->r0*obj->r0) pe_fatal(obj->pe, "Broken fene bond\n");
+    if (r2 < r2min) r2min = r2;
+    if (r2 > r2max) r2max = r2;
+    if (r2 > obj->r0*obj->r0) pe_fatal(obj->pe, "Broken fene bond\n");
 
-      obj->vlocal += -0.5*obj->k*obj->r0*obj->r0*log(1.0 - r2*rr02);
-      obj->bondlocal += 1.0;
-      f = -obj->k/(1.0 - r2*rr02);
+    obj->vlocal += -0.5*obj->k*obj->r0*obj->r0*log(1.0 - r2*rr02);
+    obj->bondlocal += 1.0;
+    f = -obj->k/(1.0 - r2*rr02);
 
-      pc->force[X] -= f*r12[X];
-      pc->force[Y] -= f*r12[Y];
-      pc->force[Z] -= f*r12[Z];
+    pc1->force[X] -= f*r12[X];
+    pc1->force[Y] -= f*r12[Y];
+    pc1->force[Z] -= f*r12[Z];
 
-      pc->bonded[n]->force[X] += f*r12[X];
-      pc->bonded[n]->force[Y] += f*r12[Y];
-      pc->bonded[n]->force[Z] += f*r12[Z];
-    }
+    pc2->force[X] += f*r12[X];
+    pc2->force[Y] += f*r12[Y];
+    pc2->force[Z] += f*r12[Z];
   }
 
   obj->rminlocal = sqrt(r2min);
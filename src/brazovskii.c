@@ -40,6 +40,7 @@
 #include "pe.h"
 #include "util.h"
 #include "brazovskii.h"
+#include "util_commit.h"
 
 struct fe_brazovskii_s {
   fe_t super;
@@ -48,6 +49,7 @@ struct fe_brazovskii_s {
   fe_brazovskii_param_t * param;    /* Parameters */
   field_t * phi;                    /* Reference to order parameter field */
   field_grad_t * dphi;              /* Reference to gradient field */
+  util_commit_t commit;             /* Parameters last sent to target */
   fe_brazovskii_t * target;         /* Device copy */
 };
 
@@ -68,7 +70,9 @@ static fe_vt_t fe_braz_hvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_brazovskii_str_v,
   (fe_stress_v_ft)  fe_brazovskii_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 static  __constant__ fe_vt_t fe_braz_dvt = {
@@ -85,7 +89,9 @@ static  __constant__ fe_vt_t fe_braz_dvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_brazovskii_str_v,
   (fe_stress_v_ft)  fe_brazovskii_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 
@@ -168,6 +174,7 @@ __host__ int fe_brazovskii_free(fe_brazovskii_t * fe) {
   tdpGetDeviceCount(&ndevice);
   if (ndevice > 0) tdpFree(fe->target);
 
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
 
@@ -204,8 +211,11 @@ __host__ int fe_brazovskii_param_set(fe_brazovskii_t * fe,
   assert(fe);
 
   *fe->param = values;
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
-		    sizeof(fe_brazovskii_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&fe->commit, "brazovskii.c:const_param",
+			   fe->param, sizeof(fe_brazovskii_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_brazovskii_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
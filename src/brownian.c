@@ -2,510 +2,494 @@
  *
  *  brownian.c
  *
+ *  Brownian dynamics for colloids in an implicit solvent, i.e., with
+ *  no lattice Boltzmann fluid. This may be used, e.g., to equilibrate
+ *  a colloid configuration cheaply before hydrodynamics is switched on.
+ *
+ *  Two integrators are available:
+ *
+ *  BROWNIAN_NO_INERTIA: no velocity; only position is updated.
+ *  Rotational and translational parts; see, for example,
+ *  Merlet et al. J. Chem Phys., 121 6078 (2004).
+ *
+ *  r(t + dt) = r(t) +  rgamma_t dt Force + r_random
+ *  s(t + dt) = s(t) + (rgamma_r dt Torque + t_random) x s(t)
+ *
+ *  The translational and rotational friction coefficients are
+ *  gamma_t  = 6 pi eta a
+ *  gamma_r  = 8 pi eta a^3
+ *
+ *  The variances of the random translational and rotational
+ *  contributions are related to the diffusion constants (kT/gamma)
+ *  <r_i . r_j> = 2 dt (kT / gamma_t) delta_ij
+ *  <t_i . t_j> = 2 dt (kT / gamma_r) delta_ij
+ *
+ *  BROWNIAN_ERMAK_BUCKHOLZ: the method of Ermak and Buckholz
+ *  J. Comp. Phys 35, 169 (1980) for the translational part (see
+ *  also Allen and Tildesley Appendix G.3). This is valid when the
+ *  time step is of the same order as the decay time of the velocity
+ *  autocorrelation function. The updates for position and velocity
+ *  must be correlated. The rotational part is as above.
+ *
+ *  Gaussian random variates (six per particle per step for no inertia,
+ *  nine for Ermak and Buckholz) are taken from the particle's own
+ *  random number state (colloid_state_t rng), which is carried with
+ *  the particle. Variates are generated in pairs, so Ermak and Buckholz
+ *  draws ten per step and discards one.
+ *  All copies of a particle (including halo copies) then take the
+ *  same step without further communication, and the update may be
+ *  made independently (in parallel) for each particle.
+ *
+ *  Forces and torques are computed via interact_forces(), and
+ *  are those in fex[] and tex[].
+ *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2007 The University of Edinburgh
+ *  (c) 2007-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
 #include <assert.h>
 #include <math.h>
+#include <stdlib.h>
 
-#include "pe.h"
-#include "ran.h"
-#include "coords.h"
-#include "colloids.h"
 #include "colloids_halo.h"
+#include "colloid_sums.h"
 #include "physics.h"
 #include "util.h"
+#include "brownian.h"
+
+typedef struct brownian_param_s brownian_param_t;
+
+struct brownian_param_s {
+  double dt;                     /* Time step */
+  double eta;                    /* Solvent viscosity */
+  double kt;                     /* Temperature */
+  double rho0;                   /* Particle density */
+};
+
+static int brownian_colloid_list(colloids_info_t * cinfo, int * nlist,
+				 colloid_t *** list);
+static void brownian_random(colloid_t * pc, double ran[6]);
+static void brownian_no_inertia(const brownian_param_t * param,
+				colloid_t * pc);
+static void brownian_ermak_buckholz(const brownian_param_t * param,
+				    colloid_t * pc);
+static void brownian_rotation(const brownian_param_t * param,
+			      colloid_t * pc, const double ran[3]);
 
-#ifdef THIS_FILE_IS_OUT_OF_DATE
+/*****************************************************************************
+ *
+ *  brownian_options_default
+ *
+ *****************************************************************************/
 
-void brownian_step_ermak_buckholz(void);
-void brownian_step_no_inertia(void);
-void brownian_step_no_inertia_test(void);
-void brownian_set_random(void);
+brownian_options_t brownian_options_default(void) {
 
-static double dt_ = 1.0;  /* Time step; fixed here to be 1 LB step */
-#define NTIME 16
+  brownian_options_t opts = {.method = BROWNIAN_NO_INERTIA, .dt = 1.0};
+
+  return opts;
+}
 
 /*****************************************************************************
  *
- *  do_brownian_dynamics
- *
- *  Perform a number of Brownian Dynamics steps.
+ *  brownian_options_valid
  *
  *****************************************************************************/
 
-void do_brownian_dynamics() {
-
-  int     ia;
-  int     ic, jc, kc;
-  colloid_t * p_colloid;
-  int i, n, nt, nmax = 100000;
-  double u[3][NTIME];
-  double r[3][NTIME];
-  double s[3][NTIME];
-  double correlator_uu[NTIME];
-  double correlator_ur[NTIME];
-  double correlator_rr[NTIME];
-  double correlator_ss[NTIME];
-  double mass, scaleu, scalex, beta;
-  double dr[3];
-
-  /* Brownian dynamics requires an update. */
-  assert(0);
-
-  brownian_step_no_inertia_test();
-  if (1) return;
-
-  mass  = (4.0/3.0)*pi_*pow(2.3, 3);
-  beta  = 6.0*pi_*get_eta_shear()*2.3/mass;
-  scaleu = sqrt(mass/(3.0*get_kT()));
-  scalex = beta*scaleu;
-
-  dt_ = 0.1/beta;
-  dt_ = 1.0;
-
-  info("beta = %f\n", beta);
-  info("scale u is %f\n", scaleu);
-  info("scale x is %f\n", scalex);
-
-  for (nt = 0; nt < NTIME; nt++) {
-    for (i = 0; i < 3; i++) {
-      u[i][nt] = 0.0;
-      r[i][nt] = 0.0;
-      s[i][nt] = 0.0;
-    }
-    correlator_uu[nt] = 0.0;
-    correlator_ur[nt] = 0.0;
-    correlator_rr[nt] = 0.0;
-    correlator_ss[nt] = 0.0;
-  }
+int brownian_options_valid(const brownian_options_t * opts) {
 
-  for (n = 1; n <= nmax; n++) {
+  int valid = 1;
 
-  /* Set random numbers for each particle */
-    brownian_set_random();
-    colloids_halo_state();
-    brownian_step_no_inertia();  /* Or Ermak & Buckholz routine */
+  assert(opts);
 
-    /* diagnostics */
-
-    for (nt = NTIME-1; nt >= 1; nt--) {
-      for (i = 0; i < 3; i++) {
-	u[i][nt] = u[i][nt-1];
-	r[i][nt] = r[i][nt-1];
-	s[i][nt] = s[i][nt-1];
-      }
-    }
+  if (opts->method != BROWNIAN_NO_INERTIA &&
+      opts->method != BROWNIAN_ERMAK_BUCKHOLZ) valid = 0;
+  if (opts->dt <= 0.0) valid = 0;
 
-    for (ic = 1; ic <= Ncell(X); ic++) {
-      for (jc = 1; jc <= Ncell(Y); jc++) {
-	for (kc = 1; kc <= Ncell(Z); kc++) {
+  return valid;
+}
 
-	  p_colloid = colloids_cell_list(ic, jc, kc);
+/*****************************************************************************
+ *
+ *  brownian_create
+ *
+ *****************************************************************************/
 
-	  while (p_colloid) {
-	    for (ia = 0; ia < 3; ia++) {
-	      r[ia][0] = p_colloid->s.r[ia];
-	      u[ia][0] = p_colloid->s.v[ia];
-	      s[ia][0] = p_colloid->s.s[ia];
-	    }
+int brownian_create(pe_t * pe, cs_t * cs, const brownian_options_t * opts,
+		    brownian_t ** bd) {
 
-	    p_colloid = p_colloid->next;
-	  }
-	}
-      }
-    }
+  brownian_t * obj = NULL;
 
-    if ( n > NTIME) {
-      for (nt = 0; nt < NTIME; nt++) {
-	for (i = 0; i < 3; i++) {
-	  correlator_uu[nt] += scaleu*scaleu*u[i][nt]*u[i][0];
-	  /* -ve sign here because r[0] is current step and nt previous */
-	  dr[i] = -(r[i][nt] - r[i][0]);
-	  if (dr[i] > L(i)/2.0) dr[i] -= L(i);
-	  if (dr[i] <-L(i)/2.0) dr[i] += L(i);
-	  correlator_ur[nt] += scaleu*u[i][nt]*scalex*dr[i];
-	  correlator_rr[nt] += dr[i]*dr[i];
-	  correlator_ss[nt] += (s[i][nt] - s[i][0])*(s[i][nt] - s[i][0]);
-	}
-      }
-    }
+  assert(pe);
+  assert(cs);
+  assert(opts);
+  assert(bd);
 
-    colloids_cell_update();
+  if (brownian_options_valid(opts) == 0) {
+    pe_fatal(pe, "brownian_create: invalid options\n");
   }
 
-  info("\nResults Ermak and Buckholz \n");
-  for (n = 0; n < NTIME; n++) {
-    double tau = n*beta*dt_;
-    info("%6.3f %6.3f %6.3f ", tau, exp(-tau), correlator_uu[n]/nmax);
-    info("%6.3f %6.3f ", 1.0 -  exp(-tau), sqrt(3.0)*correlator_ur[n]/nmax);
-    info("%6.3f %6.3f\n", 2.0*(tau - 1.0 + exp(-tau)),
-	 scalex*scalex*correlator_rr[n]/nmax);
-  }
+  obj = (brownian_t *) calloc(1, sizeof(brownian_t));
+  assert(obj);
+  if (obj == NULL) pe_fatal(pe, "calloc(brownian_t) failed\n");
 
-  /* No inertia test */
-  for (n = 0; n < NTIME; n++) {
-    double tau = n*dt_;
-    double difft = get_kT() / (6.0*pi_*get_eta_shear()*2.3);
-    double diffr = get_kT() / (8.0*pi_*get_eta_shear()*2.3*2.3*2.3);
-    info("%8.3f %8.3f %8.3f ",  tau, 2.0*tau, correlator_rr[n]/(3.0*difft*nmax));
-    info("%8.3f %8.3f\n", 4.0*tau, correlator_ss[n]/(diffr*nmax));
-  }
+  obj->pe = pe;
+  obj->cs = cs;
+  obj->opts = *opts;
+  obj->nstep = 0;
 
-  return;
+  *bd = obj;
+
+  return 0;
 }
 
 /*****************************************************************************
  *
- *  brownian_step_no_inertia
- *
- *  Brownian dynamics with no velocity; only position is updated.
- *
- *  Rotational and translation parts; see, for example, Meriget etal
- *  J. Chem Phys., 121 6078 (2004).
- *  
- *  r(t + dt) = r(t) +  rgamma_t dt Force + r_random
- *  s(t + dt) = s(t) + (rgamma_r dt Torque + t_random) x s(t)
- *
- *  The translational and rotational friction coefficients are
- *  gamma_t  = 6 pi eta a
- *  gamma_r  = 8.0 pi eta a^3
- *
- *  The variances of the random translational and rotational
- *  contributions are related to the diffusion constants (kT/gamma)
- *  <r_i . r_j> = 2 dt (kT / gamma_t) delta_ij
- *  <t_i . t_j> = 2 dt (kT / gamma_r) delta_ij
- * 
- *  This requires six random variates per time step.
+ *  brownian_free
  *
  *****************************************************************************/
 
-void brownian_step_no_inertia() {
+int brownian_free(brownian_t * bd) {
 
-  int       ic, jc, kc;
-  colloid_t * p_colloid;
-  double    ran[3];
-  double    eta, kT;
-  double    sigma, rgamma;
+  assert(bd);
 
-  kT = get_kT();
-  eta = get_eta_shear();
+  free(bd);
 
-  /* Update each particle */
+  return 0;
+}
 
-  for (ic = 0; ic <= Ncell(X) + 1; ic++) {
-    for (jc = 0; jc <= Ncell(Y) + 1; jc++) {
-      for (kc = 0; kc <= Ncell(Z) + 1; kc++) {
+/*****************************************************************************
+ *
+ *  brownian_info
+ *
+ *****************************************************************************/
+
+int brownian_info(const brownian_t * bd) {
 
-	p_colloid = colloids_cell_list(ic, jc, kc);
+  assert(bd);
 
-	while (p_colloid) {
+  pe_info(bd->pe, "Brownian dynamics method:     %s\n",
+	  (bd->opts.method == BROWNIAN_NO_INERTIA) ?
+	  "no inertia" : "Ermak and Buckholz");
+  pe_info(bd->pe, "Brownian dynamics time step:  %14.7e\n", bd->opts.dt);
 
-	  /* Translational motion */
+  return 0;
+}
 
-	  rgamma = 1.0 / (6.0*pi_*eta*p_colloid->s.ah);
-	  sigma = sqrt(2.0*dt_*kT*rgamma);
+/*****************************************************************************
+ *
+ *  brownian_run
+ *
+ *  Take nstep steps of Brownian dynamics. The colloids are assumed
+ *  to be in a consistent state with respect to the cell list and
+ *  halo on entry, and are left in the same condition on exit.
+ *
+ *  The map is required only for gravity (and may be NULL otherwise).
+ *
+ *****************************************************************************/
 
-	  ran[X] = sigma*p_colloid->random[0];
-	  ran[Y] = sigma*p_colloid->random[1];
-	  ran[Z] = sigma*p_colloid->random[2];
+int brownian_run(brownian_t * bd, colloids_info_t * cinfo,
+		 interact_t * interact, map_t * map, int nstep) {
 
-	  p_colloid->s.r[X] += dt_*rgamma*p_colloid->force[X] + ran[X];
-	  p_colloid->s.r[Y] += dt_*rgamma*p_colloid->force[Y] + ran[Y];
-	  p_colloid->s.r[Z] += dt_*rgamma*p_colloid->force[Z] + ran[Z];
+  int n;
+  int ncolloid = 0;
 
-	  /* Rotational motion */
+  assert(bd);
+  assert(cinfo);
+  assert(interact);
 
-	  rgamma = 1.0 / (8.0*pi_*eta*pow(p_colloid->s.ah, 3));
-	  sigma = sqrt(2.0*dt_*kT*rgamma);
+  colloids_info_ntotal(cinfo, &ncolloid);
+  if (ncolloid == 0) return 0;
 
-	  ran[X] = dt_*rgamma*p_colloid->torque[X]
-	    + sigma*p_colloid->random[3+X];
-	  ran[Y] = dt_*rgamma*p_colloid->torque[Y]
-	    + sigma*p_colloid->random[3+Y];
-	  ran[Z] = dt_*rgamma*p_colloid->torque[Z]
-	    + sigma*p_colloid->random[3+Z];
+  for (n = 0; n < nstep; n++) {
 
-	  rotate_vector(p_colloid->s.s, ran);
+    colloids_info_update_lists(cinfo);
+    interact_forces(interact, cinfo, map, NULL, NULL);
 
-	  /* Next colloid */
+    /* All copies require the total force and torque */
+    colloid_sums_halo(cinfo, COLLOID_SUM_FORCE_EXT_ONLY);
 
-	  p_colloid = p_colloid->next;
-	}
+    brownian_step(bd, cinfo);
 
-	/* Next cell */
-      }
-    }
+    colloids_info_position_update(cinfo);
+    colloids_info_update_cell_list(cinfo);
+    colloids_halo_state(cinfo);
   }
 
-  return;
+  colloids_info_update_lists(cinfo);
+
+  return 0;
 }
 
 /*****************************************************************************
  *
- *  brownian_step_ermak_buckholz
- *
- *  This is the method of Ermak and Buckholz J. Comp. Phys 35, 169 (1980).
- *  It is valid when the time step is of the same order as the decay time
- *  for the velocity autocorrelation function.
- *
- *  See also Allen and Tildesley.
+ *  brownian_step
  *
- *  Only the translational part is present at the moment. This requires
- *  6 random numbers per particle per timestep. The updates for the
- *  position and momentum must be correlated (see e.g., Allen & Tildesley
- *  Appendix G.3)   
+ *  Set the displacement s.dr (and update the orientation) of all
+ *  particles, including those in the halo region, given the current
+ *  forces fex and torques tex. The actual position update is left to
+ *  colloids_info_position_update().
  *
  *****************************************************************************/
 
-void brownian_step_ermak_buckholz() {
-
-  int     ic, jc, kc;
-  colloid_t * pc;
-
-  double ranx, rany, ranz;
-  double cx, cy, cz;
-
-  double c0, c1, c2;
-  double xi, xidt;
-  double sigma_r, sigma_v;
-  double c12, c21;
-  double rmass, kT;
+int brownian_step(brownian_t * bd, colloids_info_t * cinfo) {
 
-  kT = get_kT();
+  int nlist = 0;
+  colloid_t ** list = NULL;
+  brownian_param_t param = {0};
+  physics_t * phys = NULL;
 
-  /* Update each particle */
+  assert(bd);
+  assert(cinfo);
 
-  for (ic = 0; ic <= Ncell(X) + 1; ic++) {
-    for (jc = 0; jc <= Ncell(Y) + 1; jc++) {
-      for (kc = 0; kc <= Ncell(Z) + 1; kc++) {
+  physics_ref(&phys);
+  physics_eta_shear(phys, &param.eta);
+  physics_kt(phys, &param.kt);
+  colloids_info_rho0(cinfo, &param.rho0);
+  param.dt = bd->opts.dt;
 
-	pc = colloids_cell_list(ic, jc, kc);
+  brownian_colloid_list(cinfo, &nlist, &list);
 
-	while (pc) {
+  /* Colloids are host linked-list objects with no target copy, so the
+   * lattice kernel machinery does not apply; the (independent) updates
+   * are shared between host threads directly. */
 
-	  rmass = 1.0/((4.0/3.0)*pi_*pow(pc->s.ah, 3.0));
-
-	  /* Friction coefficient is xi, and related quantities */
-
-	  xi = 6.0*pi_*get_eta_shear()*pc->s.ah*rmass;
-	  xidt = xi*dt_;
-
-	  c0 = exp(-xidt);
-	  c1 = (1.0 - c0) / xi;
-	  c2 = (dt_ - c1) / xi;
-
-	  /* Velocity update */
+  #pragma omp parallel for
+  for (int n = 0; n < nlist; n++) {
+    if (bd->opts.method == BROWNIAN_NO_INERTIA) {
+      brownian_no_inertia(&param, list[n]);
+    }
+    else {
+      brownian_ermak_buckholz(&param, list[n]);
+    }
+  }
 
-	  sigma_v = sqrt(rmass*kT*(1.0 - c0*c0));
+  free(list);
+  bd->nstep += 1;
 
-	  ranx = pc->random[0];
-	  rany = pc->random[1];
-	  ranz = pc->random[2];
+  return 0;
+}
 
-	  cx = c0*pc->s.v[X] + rmass*c1*pc->force[X] + sigma_v*ranx;
-	  cy = c0*pc->s.v[Y] + rmass*c1*pc->force[Y] + sigma_v*rany;
-	  cz = c0*pc->s.v[Z] + rmass*c1*pc->force[Z] + sigma_v*ranz;
+/*****************************************************************************
+ *
+ *  brownian_colloid_list
+ *
+ *  Return a newly allocated list of all colloids in all cells
+ *  (including halo cells). The caller must release the list.
+ *
+ *****************************************************************************/
 
-	  pc->s.v[X] = cx;
-	  pc->s.v[Y] = cy;
-	  pc->s.v[Z] = cz;
+static int brownian_colloid_list(colloids_info_t * cinfo, int * nlist,
+				 colloid_t *** list) {
 
-	  /* Generate correlated random pairs */
+  int ic, jc, kc;
+  int ncell[3];
+  int n = 0;
+  colloid_t * pc = NULL;
+  colloid_t ** plist = NULL;
 
-	  sigma_r = sqrt(rmass*kT*(2.0*xidt - 3.0 + 4.0*c0 - c0*c0)/(xi*xi));
-	  c12 = rmass*kT*(1.0 - c0)*(1.0 - c0) / (sigma_v*sigma_r*xi);
-	  c21 = sqrt(1.0 - c12*c12);
+  assert(cinfo);
+  assert(nlist);
+  assert(list);
 
-	  ranx = (c12*ranx + c21*pc->random[3]);
-	  rany = (c12*rany + c21*pc->random[4]);
-	  ranz = (c12*ranz + c21*pc->random[5]);
+  colloids_info_ncell(cinfo, ncell);
 
-	  /* Position update */
+  for (ic = 0; ic <= ncell[X] + 1; ic++) {
+    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
+      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for ( ; pc; pc = pc->next) n += 1;
+      }
+    }
+  }
 
-	  cx = c1*pc->s.v[X] + rmass*c2*pc->force[X] + sigma_r*ranx;
-	  cy = c1*pc->s.v[Y] + rmass*c2*pc->force[Y] + sigma_r*rany;
-	  cz = c1*pc->s.v[Z] + rmass*c2*pc->force[Z] + sigma_r*ranz;
+  if (n > 0) {
+    plist = (colloid_t **) malloc(n*sizeof(colloid_t *));
+    assert(plist);
+    if (plist == NULL) pe_fatal(cinfo->pe, "malloc(colloid list) failed\n");
+  }
 
-	  pc->s.r[X] += cx;
-	  pc->s.r[Y] += cy;
-	  pc->s.r[Z] += cz;
+  n = 0;
 
-	  pc = pc->next;
+  for (ic = 0; ic <= ncell[X] + 1; ic++) {
+    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
+      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for ( ; pc; pc = pc->next) {
+	  if (pc->s.rng <= 0) {
+	    pe_fatal(cinfo->pe, "Brownian dynamics: colloid %d has rng <= 0\n",
+		     pc->s.index);
+	  }
+	  plist[n++] = pc;
 	}
       }
     }
   }
 
-  return;
+  *nlist = n;
+  *list = plist;
+
+  return 0;
 }
 
 /*****************************************************************************
  *
- *  brownian_set_random
+ *  brownian_random
  *
- *  Set the table of random numbers for each particle.
+ *  Six Gaussian random variates from the particle's own state.
  *
  *****************************************************************************/
 
-void brownian_set_random() {
+static void brownian_random(colloid_t * pc, double ran[6]) {
 
-  int     ic, jc, kc;
-  colloid_t * p_colloid;
+  assert(pc);
+  assert(pc->s.rng > 0);
 
-  /* Set random numbers for each particle */
+  util_ranlcg_reap_gaussian(&pc->s.rng, ran);
+  util_ranlcg_reap_gaussian(&pc->s.rng, ran + 2);
+  util_ranlcg_reap_gaussian(&pc->s.rng, ran + 4);
 
-  for (ic = 1; ic <= Ncell(X); ic++) {
-    for (jc = 1; jc <= Ncell(Y); jc++) {
-      for (kc = 1; kc <= Ncell(Z); kc++) {
+  return;
+}
 
-	p_colloid = colloids_cell_list(ic, jc, kc);
+/*****************************************************************************
+ *
+ *  brownian_no_inertia
+ *
+ *****************************************************************************/
 
-	while (p_colloid) {
+static void brownian_no_inertia(const brownian_param_t * param,
+				colloid_t * pc) {
+  int ia;
+  double ran[6];
+  double sigma, rgamma;
+  PI_DOUBLE(pi);
 
-	  p_colloid->random[0] = ran_parallel_gaussian();
-	  p_colloid->random[1] = ran_parallel_gaussian();
-	  p_colloid->random[2] = ran_parallel_gaussian();
-	  p_colloid->random[3] = ran_parallel_gaussian();
-	  p_colloid->random[4] = ran_parallel_gaussian();
-	  p_colloid->random[5] = ran_parallel_gaussian();
+  assert(param);
+  assert(pc);
 
-	  p_colloid = p_colloid->next;
-	}
-      }
-    }
+  brownian_random(pc, ran);
+
+  /* Translational motion */
+
+  rgamma = 1.0/(6.0*pi*param->eta*pc->s.ah);
+  sigma = sqrt(2.0*param->dt*param->kt*rgamma);
+
+  for (ia = 0; ia < 3; ia++) {
+    double dr = param->dt*rgamma*pc->fex[ia] + sigma*ran[ia];
+    if (pc->s.isfixedrxyz[ia] == 0) pc->s.dr[ia] = dr;
+    if (pc->s.isfixedvxyz[ia] == 0) pc->s.v[ia] = dr/param->dt;
   }
 
+  brownian_rotation(param, pc, ran + 3);
+
   return;
 }
 
 /*****************************************************************************
  *
- *  brownian_step_no_interia_test
- *
- *  We test the single-particle position and orientational
- *  correlators:
- *
- *  < [r(t) - r(0)][r(t) - r(0)] > = 2D_t t I     t >> m / gamma_t
- *  < |s(t) - s(0)|^2 >            = 4D_r t       2D_r t << 1
- *
- *  where I is the identity matrix.
- *
- *  See, for example, Jan Dhont 'An Introduction to dynamics of colloids'
- *  Chapter 2.
- *
- *  The correlators should be good to about 1% after 100,000 iterations.
+ *  brownian_ermak_buckholz
  *
  *****************************************************************************/
 
-void brownian_step_no_inertia_test() {
+static void brownian_ermak_buckholz(const brownian_param_t * param,
+				    colloid_t * pc) {
+  int ia;
+  double ran[6];
+  double c0, c1, c2;
+  double xi, xidt;
+  double sigma_r, sigma_v;
+  double c12, c21;
+  double rmass;
+  PI_DOUBLE(pi);
 
-  const int nmax  = 10000;
+  assert(param);
+  assert(pc);
 
-  int     ia;
-  int     ic, jc, kc;
-  colloid_t * p_colloid;
-  int     i, n, nt;
-  int     ncell[3];
-  double  diffr, difft;
-  double  r[3][NTIME];
-  double  s[3][NTIME];
-  double  correlator_rr[3][NTIME];
-  double  correlator_ss[NTIME];
-  double  dr[3];
+  brownian_random(pc, ran);
 
+  rmass = 1.0/((4.0/3.0)*pi*param->rho0*pow(pc->s.ah, 3));
 
-  difft = get_kT() / (6.0*pi_*get_eta_shear()*2.3);
-  diffr = get_kT() / (8.0*pi_*get_eta_shear()*2.3*2.3*2.3);
+  /* Friction coefficient is xi, and related quantities */
 
-  /* Initialise */
+  xi = 6.0*pi*param->eta*pc->s.ah*rmass;
+  xidt = xi*param->dt;
 
-  for (i = 0; i < 3; i++) ncell[i] = Ncell(i);
+  c0 = exp(-xidt);
+  c1 = (1.0 - c0)/xi;
+  c2 = (param->dt - c1)/xi;
 
-  for (nt = 0; nt < NTIME; nt++) {
-    for (i = 0; i < 3; i++) {
-      correlator_rr[i][nt] = 0.0;
-    }
-    correlator_ss[nt] = 0.0;
+  sigma_v = sqrt(rmass*param->kt*(1.0 - c0*c0));
+  sigma_r = sqrt(rmass*param->kt*(2.0*xidt - 3.0 + 4.0*c0 - c0*c0)/(xi*xi));
+
+  /* Correlation of the random parts (zero if kT = 0) */
+
+  c12 = 0.0;
+  if (param->kt > 0.0) {
+    c12 = rmass*param->kt*(1.0 - c0)*(1.0 - c0)/(sigma_v*sigma_r*xi);
   }
+  c21 = sqrt(1.0 - c12*c12);
 
-  /* Start the main iteration loop */
+  for (ia = 0; ia < 3; ia++) {
 
-  for (n = 1; n <= nmax; n++) {
+    double v, dr;
 
-    brownian_set_random();
+    /* Position and velocity both from the velocity at the start of
+     * the step; the random parts are correlated. */
 
-    colloids_halo_state();
-    brownian_step_no_inertia();
-    colloids_cell_update();
+    dr = c1*pc->s.v[ia] + rmass*c2*pc->fex[ia]
+      + sigma_r*(c12*ran[ia] + c21*ran[3+ia]);
+    v = c0*pc->s.v[ia] + rmass*c1*pc->fex[ia] + sigma_v*ran[ia];
 
-    /* Rotate the tables of position and orientation backwards
-     * and store the current values */
+    if (pc->s.isfixedvxyz[ia] == 0) pc->s.v[ia] = v;
+    if (pc->s.isfixedrxyz[ia] == 0) pc->s.dr[ia] = dr;
+  }
 
-    for (nt = NTIME-1; nt >= 1; nt--) {
-      for (i = 0; i < 3; i++) {
-	r[i][nt] = r[i][nt-1];
-	s[i][nt] = s[i][nt-1];
-      }
-    }
+  /* Rotation (no inertia) requires three further variates; the fourth
+   * of the pair drawn here is unused. */
 
-    for (ic = 1; ic <= ncell[X]; ic++) {
-      for (jc = 1; jc <= ncell[Y]; jc++) {
-	for (kc = 1; kc <= ncell[Z]; kc++) {
+  util_ranlcg_reap_gaussian(&pc->s.rng, ran);
+  util_ranlcg_reap_gaussian(&pc->s.rng, ran + 2);
 
-	  p_colloid = colloids_cell_list(ic, jc, kc);
+  brownian_rotation(param, pc, ran);
 
-	  while (p_colloid) {
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  brownian_rotation
+ *
+ *  Overdamped rotational update of s.m and s.s given three Gaussian
+ *  random variates ran[3].
+ *
+ *****************************************************************************/
 
-	    for (ia = 0; ia < 3; ia++) {
-	      r[ia][0] = p_colloid->s.r[ia];
-	      s[ia][0] = p_colloid->s.s[ia];
-	    }
+static void brownian_rotation(const brownian_param_t * param,
+			      colloid_t * pc, const double ran[3]) {
+  int ia;
+  double dphi[3];
+  double sigma, rgamma;
+  PI_DOUBLE(pi);
 
-	    p_colloid = p_colloid->next;
-	  }
-	}
-      }
-    }
+  assert(param);
+  assert(pc);
 
-    /* Work out the contribution to the correlators */
-
-    if ( n > NTIME) {
-      for (nt = 0; nt < NTIME; nt++) {
-	for (i = 0; i < 3; i++) {
-	  /* correct for periodic boundaries */
-	  dr[i] = (r[i][nt] - r[i][0]);
-	  if (dr[i] > L(i)/2.0) dr[i] -= L(i);
-	  if (dr[i] <-L(i)/2.0) dr[i] += L(i);
-	  correlator_rr[i][nt] += dr[i]*dr[i];
-	  correlator_ss[nt] += (s[i][nt] - s[i][0])*(s[i][nt] - s[i][0]);
-	}
-      }
-    }
+  rgamma = 1.0/(8.0*pi*param->eta*pow(pc->s.ah, 3));
+  sigma = sqrt(2.0*param->dt*param->kt*rgamma);
 
+  for (ia = 0; ia < 3; ia++) {
+    dphi[ia] = param->dt*rgamma*pc->tex[ia] + sigma*ran[ia];
+    if (pc->s.isfixedw == 0) pc->s.w[ia] = dphi[ia]/param->dt;
   }
 
-  /* Results */
-
-  info("\n\n");
-  info("           Translational                       Orientational\n");
-  info("    Time   theory     <rx>     <ry>     <rz>   ");
-  info("theory     <ss>\n");
-  
-  for (n = 0; n < NTIME; n++) {
-    double tau = n*dt_;
-    info("%8.3f %8.3f ",  tau, 2.0*tau);
-    info("%8.3f ", correlator_rr[X][n]/(difft*nmax));
-    info("%8.3f ", correlator_rr[Y][n]/(difft*nmax));
-    info("%8.3f ", correlator_rr[Z][n]/(difft*nmax));
-    info("%8.3f %8.3f\n", 4.0*tau, correlator_ss[n]/(diffr*nmax));
+  if (pc->s.isfixeds == 0) {
+    rotate_vector(pc->s.m, dphi);
+    rotate_vector(pc->s.s, dphi);
   }
 
   return;
 }
-#endif
@@ -2,22 +2,55 @@
  *
  *  brownian.h
  *
- *  Brownian dynamics is disabled at the moment.
- *
- *  $Id: brownian.h,v 1.3 2010-10-15 12:40:02 kevin Exp $
+ *  Brownian (overdamped) and Langevin dynamics for colloids in an
+ *  implicit solvent.
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
-#ifndef BROWNIAN_H
-#define BROWNIAN_H
+#ifndef LUDWIG_BROWNIAN_H
+#define LUDWIG_BROWNIAN_H
+
+#include "pe.h"
+#include "coords.h"
+#include "map.h"
+#include "colloids.h"
+#include "interaction.h"
+
+typedef enum brownian_method_enum {
+  BROWNIAN_NO_INERTIA = 0,       /* Position only (overdamped) */
+  BROWNIAN_ERMAK_BUCKHOLZ        /* Position and velocity (Langevin) */
+} brownian_method_t;
+
+typedef struct brownian_options_s brownian_options_t;
+typedef struct brownian_s brownian_t;
+
+struct brownian_options_s {
+  brownian_method_t method;      /* Integrator */
+  double dt;                     /* Time step (lattice units) */
+};
+
+struct brownian_s {
+  pe_t * pe;                     /* Parallel environment */
+  cs_t * cs;                     /* Coordinate system */
+  brownian_options_t opts;       /* Options */
+  int nstep;                     /* Number of steps taken */
+};
+
+brownian_options_t brownian_options_default(void);
+int brownian_options_valid(const brownian_options_t * opts);
 
-void brownian_step_no_inertia(void);
-void brownian_set_random(void);
+int brownian_create(pe_t * pe, cs_t * cs, const brownian_options_t * opts,
+		    brownian_t ** bd);
+int brownian_free(brownian_t * bd);
+int brownian_info(const brownian_t * bd);
+int brownian_step(brownian_t * bd, colloids_info_t * cinfo);
+int brownian_run(brownian_t * bd, colloids_info_t * cinfo,
+		 interact_t * interact, map_t * map, int nstep);
 
 #endif
@@ -23,6 +23,7 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "kernel.h"
 #include "physics.h"
 #include "colloid_sums.h"
 #include "psi_colloid.h"
@@ -30,6 +31,7 @@
 #include "wall.h"
 #include "build.h"
 #include "blue_phase.h"
+#include "timer.h"
 
 
 int build_replace_fluid_local(colloids_info_t * info, colloid_t * pc,
@@ -38,9 +40,23 @@ int build_replace_fluid_local(colloids_info_t * info, colloid_t * pc,
 int build_replace_q_local(fe_t * fe, colloids_info_t * info, colloid_t * pc, int index,
 			  field_t * q);
 
-static int build_remove_fluid(lb_t * lb, int index, colloid_t * pc);
-static int build_replace_fluid(lb_t * lb, colloids_info_t * info, int index,
-			       colloid_t * pc, map_t * map);
+static int build_colloid_list(colloids_info_t * cinfo, int * ncolloid,
+			      colloid_t *** clist);
+static __host__ __device__
+int build_remove_fluid(cs_t * cs, lb_t * lb, int index,
+		       const colloid_t * pc, double rho0,
+		       double * dm, double g[3], double t[3]);
+static __host__ __device__
+int build_replace_fluid(cs_t * cs, lb_t * lb, colloids_info_t * cinfo,
+			map_t * map, int index, const colloid_t * pc,
+			double rho0, double * dm, double g[3], double t[3]);
+static __host__ __device__
+int build_replace_fluid_equilibrium(lb_t * lb, const colloid_t * pc,
+				    int index, const double rb[3],
+				    double gnew[3], double tnew[3]);
+static __device__
+void build_deficit_add(colloid_t * pc, double dm, const double g[3],
+		       const double t[3]);
 static int build_remove_order_parameter(lb_t * lb, field_t * f, int index,
 					colloid_t * pc);
 static int build_replace_order_parameter(fe_t * fe, lb_t * lb, colloids_info_t * cinfo,
@@ -57,6 +73,15 @@ static int build_colloid_wall_links(cs_t * cs, colloids_info_t * cinfo,
 				    colloid_t * pc, map_t * map,
 				    const lb_model_t * model);
 
+__global__ void build_map_reset_kernel(kernel_ctxt_t * ktx, map_t * map);
+__global__ void build_map_paint_kernel(cs_t * cs, colloids_info_t * cinfo,
+				       map_t * map, int ncolloid,
+				       colloid_t ** clist);
+__global__ void build_remove_replace_kernel(kernel_ctxt_t * ktx, cs_t * cs,
+					    colloids_info_t * cinfo,
+					    lb_t * lb, map_t * map,
+					    double rho0, int * nsites);
+
 int build_conservation_phi(colloids_info_t * cinfo, field_t * phi,
 			   const lb_model_t * model);
 int build_conservation_psi(colloids_info_t * cinfo, psi_t * psi,
@@ -70,162 +95,313 @@ int build_conservation_psi(colloids_info_t * cinfo, psi_t * psi,
  *  of all nodes in the presence on colloids. This must be complete
  *  before attempting to build the colloid links.
  *
+ *  The map is reset and then repainted on the target; each colloid
+ *  paints the sites within its own bounding box. The updated status
+ *  and colloid maps are returned to the host for the link rebuild.
+ *
  ****************************************************************************/
 
 int build_update_map(cs_t * cs, colloids_info_t * cinfo, map_t * map) {
 
   int nlocal[3];
-  int noffset[3];
-  int ncell[3];
-  int ic, jc, kc;
-
-  int i, j, k;
-  int i_min, i_max, j_min, j_max, k_min, k_max;
-  int index;
   int nhalo;
-  int status;
-
-  colloid_t * p_colloid = NULL;
-
-  double  r0[3];
-  double  rsite0[3];
-  double  rsep[3];
-
-  double   radius, rsq;
-  double   cosine, mod;
-
-  /* To set the wetting data in the map, we assume C, H zero at moment */
   int ndata;
-  double wet[2];
+  int ndevice;
+  int ncolloid = 0;
+  dim3 nblk, ntpb;
+  cs_t * cstarget = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  colloid_t ** clist = NULL;
 
   assert(cs);
   assert(cinfo);
   assert(map);
 
+  /* To set the wetting data in the map, we assume C, H zero at moment */
   map_ndata(map, &ndata);
   assert(ndata <= 2);
 
   cs_nlocal(cs, nlocal);
-  cs_nlocal_offset(cs, noffset);
   cs_nhalo(cs, &nhalo);
+  cs_target(cs, &cstarget);
+  tdpGetDeviceCount(&ndevice);
 
-  colloids_info_ncell(cinfo, ncell);
+  /* First, set any existing colloid sites to fluid (including halo) */
 
-  /* First, set any existing colloid sites to fluid */
+  limits.imin = 1 - nhalo; limits.imax = nlocal[X] + nhalo;
+  limits.jmin = 1 - nhalo; limits.jmax = nlocal[Y] + nhalo;
+  limits.kmin = 1 - nhalo; limits.kmax = nlocal[Z] + nhalo;
 
-  for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
-    for (jc = 1 - nhalo; jc <= nlocal[Y] + nhalo; jc++) {
-      for (kc = 1 - nhalo; kc <= nlocal[Z] + nhalo; kc++) {
+  kernel_ctxt_create(cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	/* This avoids setting BOUNDARY to FLUID */
-	index = cs_index(cs, ic, jc, kc);
-	map_status(map, index, &status);
-	if (status == MAP_COLLOID) {
-	  /* Set wetting properties to zero. */
-	  map_status_set(map, index, MAP_FLUID);
-	  wet[0] = 0.0;
-	  wet[1] = 0.0;
-	  map_data_set(map, index, wet);
-	}
+  tdpLaunchKernel(build_map_reset_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, map->target);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  kernel_ctxt_free(ctxt);
+
+  colloids_info_map_update(cinfo);
+
+  /* All colloids in cell list order (including the halo cells) */
+
+  build_colloid_list(cinfo, &ncolloid, &clist);
+
+  if (ncolloid > 0) {
+
+    colloid_t ** cltarget = clist;
+
+    if (ndevice > 0) {
+      size_t nsz = ncolloid*sizeof(colloid_t *);
+      tdpAssert(tdpMalloc((void **) &cltarget, nsz));
+      tdpAssert(tdpMemcpy(cltarget, clist, nsz, tdpMemcpyHostToDevice));
+    }
+
+    kernel_launch_param(ncolloid, &nblk, &ntpb);
+
+    tdpLaunchKernel(build_map_paint_kernel, nblk, ntpb, 0, 0,
+		    cstarget, cinfo->target, map->target, ncolloid, cltarget);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+
+    if (ndevice > 0) tdpAssert(tdpFree(cltarget));
+  }
+
+  free(clist);
+
+  /* Host copies are required for the link reconstruction */
 
+  if (ndevice > 0) {
+    map_memcpy(map, tdpMemcpyDeviceToHost);
+    colloids_memcpy(cinfo, tdpMemcpyDeviceToHost);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_colloid_list
+ *
+ *  Return a newly allocated list of fully-resolved colloids (all
+ *  cells, including halo cells) in cell list order. The caller
+ *  must release the list.
+ *
+ *****************************************************************************/
+
+static int build_colloid_list(colloids_info_t * cinfo, int * ncolloid,
+			      colloid_t *** clist) {
+
+  int ic, jc, kc;
+  int ncell[3];
+  int n = 0;
+  colloid_t * pc = NULL;
+  colloid_t ** list = NULL;
+
+  assert(cinfo);
+  assert(ncolloid);
+  assert(clist);
+
+  colloids_info_ncell(cinfo, ncell);
+
+  for (ic = 0; ic <= ncell[X] + 1; ic++) {
+    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
+      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for ( ; pc; pc = pc->next) {
+	  if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+	  n += 1;
+	}
       }
     }
   }
 
-  colloids_info_map_update(cinfo);
+  if (n > 0) {
+    list = (colloid_t **) malloc(n*sizeof(colloid_t *));
+    assert(list);
+    if (list == NULL) pe_fatal(cinfo->pe, "malloc(colloid list) failed\n");
+  }
 
-  /* Loop through all cells (including the halo cells) */
+  n = 0;
 
   for (ic = 0; ic <= ncell[X] + 1; ic++) {
     for (jc = 0; jc <= ncell[Y] + 1; jc++) {
       for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for ( ; pc; pc = pc->next) {
+	  if (pc->s.type == COLLOID_TYPE_SUBGRID) continue;
+	  list[n++] = pc;
+	}
+      }
+    }
+  }
+
+  *ncolloid = n;
+  *clist = list;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_map_reset_kernel
+ *
+ *  Colloid sites become fluid (not boundary sites) with zero
+ *  wetting properties.
+ *
+ *****************************************************************************/
+
+__global__ void build_map_reset_kernel(kernel_ctxt_t * ktx, map_t * map) {
+
+  int kindex;
+  int kiter;
+
+  assert(ktx);
+  assert(map);
+
+  kiter = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic, jc, kc, index;
+    int status;
+
+    ic = kernel_coords_ic(ktx, kindex);
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+    index = kernel_coords_index(ktx, ic, jc, kc);
+
+    map_status(map, index, &status);
+
+    if (status == MAP_COLLOID) {
+      double wet[2] = {0.0, 0.0};
+      map_status_set(map, index, MAP_FLUID);
+      map_data_set(map, index, wet);
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  build_map_paint_kernel
+ *
+ *  One colloid per iteration: check each site in a cubic box around
+ *  the centre of the colloid (restricted to the local domain plus
+ *  halo) and set the status, wetting data, and colloid map for
+ *  sites which are inside.
+ *
+ *  Distinct colloids do not share sites unless they overlap, in
+ *  which case ownership of the shared sites is not defined (the
+ *  host version was "last in cell list order").
+ *
+ *****************************************************************************/
 
-	/* Set the cell index */
+__global__ void build_map_paint_kernel(cs_t * cs, colloids_info_t * cinfo,
+				       map_t * map, int ncolloid,
+				       colloid_t ** clist) {
+  int n;
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  assert(cs);
+  assert(cinfo);
+  assert(map);
+  assert(clist);
 
-	/* For each colloid in this cell, check solid/fluid status */
+  for_simt_parallel(n, ncolloid, 1) {
 
-	for ( ; p_colloid; p_colloid = p_colloid->next) {
+    int i, j, k, index;
+    int nhalo;
+    int nlocal[3];
+    int noffset[3];
+    int i_min, i_max, j_min, j_max, k_min, k_max;
 
-          if (p_colloid->s.type == COLLOID_TYPE_SUBGRID) continue;
+    double radius, rsq;
+    double r0[3];
+    double rsite0[3];
+    double rsep[3];
 
-	  /* Set actual position and radius */
+    colloid_t * pc = clist[n];
 
-	  radius = p_colloid->s.a0;
-	  rsq    = radius*radius;
+    cs_nlocal(cs, nlocal);
+    cs_nlocal_offset(cs, noffset);
+    cs_nhalo(cs, &nhalo);
 
-	  /* Need to translate the colloid position to "local"
-	   * coordinates, so that the correct range of lattice
-	   * nodes is found */
+    /* Set actual position and radius */
 
-	  r0[X] = p_colloid->s.r[X] - 1.0*noffset[X];
-	  r0[Y] = p_colloid->s.r[Y] - 1.0*noffset[Y];
-	  r0[Z] = p_colloid->s.r[Z] - 1.0*noffset[Z];
+    radius = pc->s.a0;
+    rsq    = radius*radius;
 
-	  /* Compute appropriate range of sites that require checks, i.e.,
-	   * a cubic box around the centre of the colloid. However, this
-	   * should not extend beyond the boundary of the current domain
-	   * (but include halos). */
+    /* Need to translate the colloid position to "local"
+     * coordinates, so that the correct range of lattice
+     * nodes is found */
 
-	  i_min = imax(1 - nhalo,         (int) floor(r0[X] - radius));
-	  i_max = imin(nlocal[X] + nhalo, (int) ceil (r0[X] + radius));
-	  j_min = imax(1 - nhalo,         (int) floor(r0[Y] - radius));
-	  j_max = imin(nlocal[Y] + nhalo, (int) ceil (r0[Y] + radius));
-	  k_min = imax(1 - nhalo,         (int) floor(r0[Z] - radius));
-	  k_max = imin(nlocal[Z] + nhalo, (int) ceil (r0[Z] + radius));
+    r0[X] = pc->s.r[X] - 1.0*noffset[X];
+    r0[Y] = pc->s.r[Y] - 1.0*noffset[Y];
+    r0[Z] = pc->s.r[Z] - 1.0*noffset[Z];
 
-	  /* Check each site to see whether it is inside or not */
+    /* Compute appropriate range of sites that require checks, i.e.,
+     * a cubic box around the centre of the colloid. However, this
+     * should not extend beyond the boundary of the current domain
+     * (but include halos). */
 
-	  for (i = i_min; i <= i_max; i++)
-	    for (j = j_min; j <= j_max; j++)
-	      for (k = k_min; k <= k_max; k++) {
+    i_min = imax(1 - nhalo,         (int) floor(r0[X] - radius));
+    i_max = imin(nlocal[X] + nhalo, (int) ceil (r0[X] + radius));
+    j_min = imax(1 - nhalo,         (int) floor(r0[Y] - radius));
+    j_max = imin(nlocal[Y] + nhalo, (int) ceil (r0[Y] + radius));
+    k_min = imax(1 - nhalo,         (int) floor(r0[Z] - radius));
+    k_max = imin(nlocal[Z] + nhalo, (int) ceil (r0[Z] + radius));
 
-		/* rsite0 is the coordinate position of the site */
+    /* Check each site to see whether it is inside or not */
 
-		rsite0[X] = 1.0*i;
-		rsite0[Y] = 1.0*j;
-		rsite0[Z] = 1.0*k;
-		cs_minimum_distance(cs, rsite0, r0, rsep);
+    for (i = i_min; i <= i_max; i++) {
+      for (j = j_min; j <= j_max; j++) {
+	for (k = k_min; k <= k_max; k++) {
 
-		/* Are we inside? */
+	  /* rsite0 is the coordinate position of the site */
 
-		if (dot_product(rsep, rsep) < rsq) {
+	  rsite0[X] = 1.0*i;
+	  rsite0[Y] = 1.0*j;
+	  rsite0[Z] = 1.0*k;
+	  cs_minimum_distance(cs, rsite0, r0, rsep);
 
-		  /* Set index */
-		  index = cs_index(cs, i, j, k);
+	  /* Are we inside? */
 
-		  colloids_info_map_set(cinfo, index, p_colloid);
-		  map_status_set(map, index, MAP_COLLOID);
+	  if (dot_product(rsep, rsep) < rsq) {
 
-		  /* Janus particles have h = h_0 cos (theta)
-		   * with s[3] pointing to the 'north pole' */
+	    double cosine = 1.0;
+	    double wet[2];
 
-		  cosine = 1.0;
-		  if (p_colloid->s.type == COLLOID_TYPE_JANUS) {
-		    mod = modulus(rsep);
-		    if (mod > 0.0) {
-		      cosine = dot_product(p_colloid->s.s, rsep)/mod;
-		    }
-		  }
+	    index = cs_index(cs, i, j, k);
 
-		  wet[0] = p_colloid->s.c;
-		  wet[1] = cosine*p_colloid->s.h;
+	    cinfo->map_new[index] = pc;
+	    map_status_set(map, index, MAP_COLLOID);
 
-		  map_data_set(map, index, wet);
-		}
-		/* Next site */
+	    /* Janus particles have h = h_0 cos (theta)
+	     * with s[3] pointing to the 'north pole' */
+
+	    if (pc->s.type == COLLOID_TYPE_JANUS) {
+	      double mod = modulus(rsep);
+	      if (mod > 0.0) {
+		cosine = dot_product(pc->s.s, rsep)/mod;
 	      }
+	    }
 
-	  /* Next colloid */
-	}
+	    wet[0] = pc->s.c;
+	    wet[1] = cosine*pc->s.h;
 
-	/* Next cell */
+	    map_data_set(map, index, wet);
+	  }
+	  /* Next site */
+	}
       }
     }
+    /* Next colloid */
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -243,6 +419,7 @@ int build_update_links(cs_t * cs, colloids_info_t * cinfo, wall_t * wall,
   int ic, jc, kc;
   int ncell[3];
   int nhalo;
+  int nbuilt = 0;
   colloid_t * pc;
 
   assert(cs);
@@ -271,8 +448,11 @@ int build_update_links(cs_t * cs, colloids_info_t * cinfo, wall_t * wall,
 
 	  if (pc->s.rebuild) {
 	    /* The shape has changed, so need to reconstruct */
+	    int nlink = 0;
 	    build_reconstruct_links(cs, cinfo, pc, map, model);
 	    if (wall) build_colloid_wall_links(cs, cinfo, pc, map, model);
+	    build_count_links_local(pc, &nlink);
+	    nbuilt += nlink;
 	  }
 	  else {
 	    /* Shape unchanged, so just reset existing links */
@@ -291,6 +471,8 @@ int build_update_links(cs_t * cs, colloids_info_t * cinfo, wall_t * wall,
     }
   }
 
+  TIMER_count(TIMER_REBUILD_LINKS, nbuilt);
+
   return 0;
 }
 
@@ -568,6 +750,10 @@ int build_reset_links(cs_t * cs, colloid_t * p_colloid, map_t * map,
  *  Correction terms are added for the appropriate colloids to be
  *  implemented at the next step.
  *
+ *  The fluid (and rebuild flags) are dealt with on the target by
+ *  build_remove_replace_kernel(). Order parameters and charge,
+ *  which may require the free energy, remain with the host.
+ *
  *  The 'abstract' free energy fe may be NULL for single fluid.
  *
  *****************************************************************************/
@@ -577,61 +763,230 @@ int build_remove_replace(fe_t * fe, colloids_info_t * cinfo, lb_t * lb,
 			 field_t * p, field_t * q, psi_t * psi, map_t * map) {
 
   int ic, jc, kc, index;
-  int is_halo;
   int nlocal[3];
   int nhalo;
+  int ndist;
+  int ndevice;
+  double rho0;
+  dim3 nblk, ntpb;
+  cs_t * cstarget = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  physics_t * phys = NULL;
   colloid_t * pcold;
   colloid_t * pcnew;
 
   assert(lb);
   assert(cinfo);
+  assert(map);
 
   cs_nlocal(lb->cs, nlocal);
   cs_nhalo(lb->cs, &nhalo);
+  cs_target(lb->cs, &cstarget);
+  lb_ndist(lb, &ndist);
+  tdpGetDeviceCount(&ndevice);
 
-  for (ic = 1 - nhalo; ic <= nlocal[X] + nhalo; ic++) {
-    for (jc = 1 - nhalo; jc <= nlocal[Y] + nhalo; jc++) {
-      for (kc = 1 - nhalo; kc <= nlocal[Z] + nhalo; kc++) {
+  physics_ref(&phys);
+  physics_rho0(phys, &rho0);
+
+  limits.imin = 1 - nhalo; limits.imax = nlocal[X] + nhalo;
+  limits.jmin = 1 - nhalo; limits.jmax = nlocal[Y] + nhalo;
+  limits.kmin = 1 - nhalo; limits.kmax = nlocal[Z] + nhalo;
+
+  kernel_ctxt_create(lb->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  {
+    /* Count of local sites removed or replaced (for the timer report) */
+    int nsites = 0;
+    int * nsites_d = &nsites;
+
+    if (ndevice > 0) {
+      tdpAssert(tdpMalloc((void **) &nsites_d, sizeof(int)));
+      tdpAssert(tdpMemcpy(nsites_d, &nsites, sizeof(int),
+			  tdpMemcpyHostToDevice));
+    }
+
+    tdpLaunchKernel(build_remove_replace_kernel, nblk, ntpb, 0, 0,
+		    ctxt->target, cstarget, cinfo->target, lb->target,
+		    map->target, rho0, nsites_d);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+
+    if (ndevice > 0) {
+      tdpAssert(tdpMemcpy(&nsites, nsites_d, sizeof(int),
+			  tdpMemcpyDeviceToHost));
+      tdpAssert(tdpFree(nsites_d));
+    }
+
+    TIMER_count(TIMER_REBUILD_REMOVE_REPLACE, nsites);
+  }
+
+  kernel_ctxt_free(ctxt);
+
+  if (phi == NULL && p == NULL && q == NULL && psi == NULL) return 0;
+
+  /* Binary LB order parameter is held with the distributions */
+
+  if (ndevice > 0 && phi && ndist == 2) lb_memcpy(lb, tdpMemcpyDeviceToHost);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
 
 	index = cs_index(lb->cs, ic, jc, kc);
 
 	colloids_info_map_old(cinfo, index, &pcold);
 	colloids_info_map(cinfo, index, &pcnew);
 
-	is_halo = (ic < 1 || jc < 1 || kc < 1 ||
-		   ic > nlocal[X] || jc > nlocal[Y] || kc > nlocal[Z]);
-
 	if (pcold == NULL && pcnew != NULL) {
-
-	  pcnew->s.rebuild = 1;
-
-	  if (!is_halo) {
-	    build_remove_fluid(lb, index, pcnew);
-	    if (phi) build_remove_order_parameter(lb, phi, index, pcnew);
-	    if (psi)  psi_colloid_remove_charge(psi, pcnew, index);
-	  }
+	  if (phi) build_remove_order_parameter(lb, phi, index, pcnew);
+	  if (psi)  psi_colloid_remove_charge(psi, pcnew, index);
 	}
 
 	if (pcold != NULL && pcnew == NULL) {
-
-	  pcold->s.rebuild = 1;
-
-	  if (!is_halo) {
-	    build_replace_fluid(lb, cinfo, index, pcold, map);
-	    if (phi) build_replace_order_parameter(fe, lb, cinfo, phi, index, pcold, map);
-	    if (p) build_replace_order_parameter(fe, lb, cinfo, p, index, pcold, map);
-	    if (q) build_replace_order_parameter(fe, lb, cinfo, q, index, pcold, map);
-	    if (psi) psi_colloid_replace_charge(psi, cinfo, pcold, index);
-	  }
+	  if (phi) build_replace_order_parameter(fe, lb, cinfo, phi, index, pcold, map);
+	  if (p) build_replace_order_parameter(fe, lb, cinfo, p, index, pcold, map);
+	  if (q) build_replace_order_parameter(fe, lb, cinfo, q, index, pcold, map);
+	  if (psi) psi_colloid_replace_charge(psi, cinfo, pcold, index);
 	}
 
+	/* A newly covered site requires the colloid charge density
+	 * to be set afresh (see psi_colloid_rho_set()) */
+
+	if (psi && pcnew != NULL && pcnew != pcold) pcnew->rhoq_valid = 0;
       }
     }
   }
 
+  if (ndevice > 0 && phi && ndist == 2) lb_memcpy(lb, tdpMemcpyHostToDevice);
+
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  build_remove_replace_kernel
+ *
+ *  Newly covered sites have fluid removed; newly uncovered (non-halo)
+ *  sites have fluid replaced. The corrections to the colloid mass,
+ *  force and torque are accumulated atomically, as a colloid may
+ *  have many sites changing at the same time.
+ *
+ *  A replacement reads only sites which were fluid before the update,
+ *  and writes only the site which was not, so there is no conflict
+ *  between iterations.
+ *
+ *  The number of sites treated is counted per thread, and added to
+ *  nsites once per block.
+ *
+ *****************************************************************************/
+
+__global__ void build_remove_replace_kernel(kernel_ctxt_t * ktx, cs_t * cs,
+					    colloids_info_t * cinfo,
+					    lb_t * lb, map_t * map,
+					    double rho0, int * nsites) {
+  int kindex;
+  int tid;
+  __shared__ int kiter;
+  __shared__ int bsites[TARGET_MAX_THREADS_PER_BLOCK];
+  int nlocal[3];
+
+  assert(ktx);
+  assert(cs);
+  assert(cinfo);
+  assert(lb);
+  assert(map);
+  assert(nsites);
+
+  kiter = kernel_iterations(ktx);
+  cs_nlocal(cs, nlocal);
+
+  tid = threadIdx.x;
+  bsites[tid] = 0;
+
+  for_simt_parallel(kindex, kiter, 1) {
+
+    int ic, jc, kc, index;
+    int is_halo;
+    double dm;
+    double g[3];
+    double t[3];
+    colloid_t * pcold = NULL;
+    colloid_t * pcnew = NULL;
+
+    ic = kernel_coords_ic(ktx, kindex);
+    jc = kernel_coords_jc(ktx, kindex);
+    kc = kernel_coords_kc(ktx, kindex);
+    index = kernel_coords_index(ktx, ic, jc, kc);
+
+    pcold = cinfo->map_old[index];
+    pcnew = cinfo->map_new[index];
+
+    is_halo = (ic < 1 || jc < 1 || kc < 1 ||
+	       ic > nlocal[X] || jc > nlocal[Y] || kc > nlocal[Z]);
+
+    if (pcold == NULL && pcnew != NULL) {
+
+      pcnew->s.rebuild = 1;
+
+      if (!is_halo) {
+	build_remove_fluid(cs, lb, index, pcnew, rho0, &dm, g, t);
+	build_deficit_add(pcnew, dm, g, t);
+	bsites[tid] += 1;
+      }
+    }
+
+    if (pcold != NULL && pcnew == NULL) {
+
+      pcold->s.rebuild = 1;
+
+      if (!is_halo) {
+	build_replace_fluid(cs, lb, cinfo, map, index, pcold, rho0, &dm, g, t);
+	build_deficit_add(pcold, dm, g, t);
+	bsites[tid] += 1;
+      }
+    }
+  }
+
+  __syncthreads();
+
+  if (tid == 0) {
+    int nblock = 0;
+    for (int it = 0; it < blockDim.x; it++) {
+      nblock += bsites[it];
+    }
+    tdpAtomicAddInt(nsites, nblock);
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  build_deficit_add
+ *
+ *  Add corrections to mass, force and torque for colloid pc.
+ *
+ *****************************************************************************/
+
+static __device__
+void build_deficit_add(colloid_t * pc, double dm, const double g[3],
+		       const double t[3]) {
+
+  assert(pc);
+
+  tdpAtomicAddDouble(&pc->deltam, dm);
+  tdpAtomicAddDouble(&pc->f0[X], g[X]);
+  tdpAtomicAddDouble(&pc->f0[Y], g[Y]);
+  tdpAtomicAddDouble(&pc->f0[Z], g[Z]);
+  tdpAtomicAddDouble(&pc->t0[X], t[X]);
+  tdpAtomicAddDouble(&pc->t0[Y], t[Y]);
+  tdpAtomicAddDouble(&pc->t0[Z], t[Z]);
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  build_bbl_rebuild_flag
@@ -684,7 +1039,13 @@ int build_bbl_rebuild_flag(cs_t * cs, colloids_info_t * cinfo) {
 int build_remove_replace_policy_local(cs_t * cs, colloids_info_t * cinfo,
 				      lb_t * lb) {
   int ic, jc, kc, index;
+  int ia;
   int nlocal[3];
+  double rho0;
+  double dm;
+  double g[3];
+  double t[3];
+  physics_t * phys = NULL;
   colloid_t * pcold;
   colloid_t * pcnew;
 
@@ -693,6 +1054,8 @@ int build_remove_replace_policy_local(cs_t * cs, colloids_info_t * cinfo,
   assert(cinfo);
 
   cs_nlocal(cs, nlocal);
+  physics_ref(&phys);
+  physics_rho0(phys, &rho0);
 
   for (ic = 1; ic <= nlocal[X]; ic++) {
     for (jc = 1; jc <= nlocal[Y]; jc++) {
@@ -704,7 +1067,12 @@ int build_remove_replace_policy_local(cs_t * cs, colloids_info_t * cinfo,
 	colloids_info_map(cinfo, index, &pcnew);
 
 	if (pcold == NULL && pcnew != NULL) {
-	  build_remove_fluid(lb, index, pcnew);
+	  build_remove_fluid(cs, lb, index, pcnew, rho0, &dm, g, t);
+	  pcnew->deltam += dm;
+	  for (ia = 0; ia < 3; ia++) {
+	    pcnew->f0[ia] += g[ia];
+	    pcnew->t0[ia] += t[ia];
+	  }
 	}
 
 	if (pcold != NULL && pcnew == NULL) {
@@ -724,35 +1092,35 @@ int build_remove_replace_policy_local(cs_t * cs, colloids_info_t * cinfo,
  *
  *  Remove denisty, momentum at site inode.
  *
- *  Corrections to the mass, force, and torque updates to the relevant
- *  colloid are required.
+ *  Corrections to the mass (dm), force (g), and torque (t) updates
+ *  to the relevant colloid are returned; it is the caller's
+ *  responsibility to add them.
  *
  *  We don't care about the 'swallowed' distribution information
  *  associated with the old fluid.
  *
  *****************************************************************************/
 
-static int build_remove_fluid(lb_t * lb, int index, colloid_t * p_colloid) {
+static __host__ __device__
+int build_remove_fluid(cs_t * cs, lb_t * lb, int index,
+		       const colloid_t * p_colloid, double rho0,
+		       double * dm, double g[3], double t[3]) {
 
   int    ia;
   int    ib[3];
   int    noffset[3];
 
   double rho;             /* density of removed fluid */
-  double g[3];            /* momentum of removed fluid */
   double r0[3];           /* Local coords of colloid centre */
   double rb[3];           /* Boundary vector at lattice site index */
   double rtmp[3];
-  double rho0;
-  physics_t  * phys = NULL;
 
+  assert(cs);
   assert(lb);
+  assert(p_colloid);
 
-  cs_nlocal_offset(lb->cs, noffset);
-  cs_index_to_ijk(lb->cs, index, ib);
-
-  physics_ref(&phys);
-  physics_rho0(phys, &rho0);
+  cs_nlocal_offset(cs, noffset);
+  cs_index_to_ijk(cs, index, ib);
 
   /* Get the properties of the old fluid at inode */
 
@@ -762,20 +1130,15 @@ static int build_remove_fluid(lb_t * lb, int index, colloid_t * p_colloid) {
   /* Set the corrections for colloid motion. This requires
    * the local boundary vector rb for the torque */
 
-  p_colloid->deltam -= (rho - rho0);
+  *dm = -(rho - rho0);
 
   for (ia = 0; ia < 3; ia++) {
-    p_colloid->f0[ia] += g[ia];
     r0[ia] = p_colloid->s.r[ia] - 1.0*noffset[ia];
     rtmp[ia] = 1.0*ib[ia];
   }
 
-  cs_minimum_distance(lb->cs, r0, rtmp, rb);
-  cross_product(rb, g, rtmp);
-
-  for (ia = 0; ia < 3; ia++) {
-    p_colloid->t0[ia] += rtmp[ia];
-  }
+  cs_minimum_distance(cs, r0, rtmp, rb);
+  cross_product(rb, g, t);
 
   return 0;
 }
@@ -825,12 +1188,15 @@ static int build_remove_order_parameter(lb_t * lb, field_t * f, int index,
  *  build_replace_fluid
  *
  *  Replace the distributions when a fluid site (index) is exposed.
- *  This gives rise to corrections on the particle force and torque.
+ *  This gives rise to corrections on the particle mass (dm), force (g)
+ *  and torque (t) which are returned to the caller.
  *
  *****************************************************************************/
 
-static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
-			       colloid_t * p_colloid, map_t * map) {
+static __host__ __device__
+int build_replace_fluid(cs_t * cs, lb_t * lb, colloids_info_t * cinfo,
+			map_t * map, int index, const colloid_t * p_colloid,
+			double rho0, double * dm, double g[3], double t[3]) {
 
   int indexn, p, pdash;
   int ia;
@@ -841,25 +1207,19 @@ static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
 
   double newrho;
   double weight;
-  double g[3];                /* Change in momentum */
   double r0[3];               /* Centre of colloid in local coordinates */
   double rb[3];               /* Boundary vector at site index */
   double rtmp[3];
   double newf[NVEL];          /* Replacement distributions */
-  double rho0;
-
-  physics_t * phys = NULL;
-  colloid_t * pc = NULL;
 
+  assert(cs);
   assert(lb);
+  assert(cinfo);
   assert(p_colloid);
   assert(map);
 
-  cs_nlocal_offset(lb->cs, noffset);
-  cs_index_to_ijk(lb->cs, index, ib);
-
-  physics_ref(&phys);
-  physics_rho0(phys, &rho0);
+  cs_nlocal_offset(cs, noffset);
+  cs_index_to_ijk(cs, index, ib);
 
   newrho = 0.0;
   weight = 0.0;
@@ -872,42 +1232,51 @@ static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
   /* Check the surrounding sites that were linked to inode,
    * and accumulate a (weighted) average distribution. */
 
-  for (p = 0; p < lb->model.nvel; p++) {
+  for (p = 0; p < lb->param->nvel; p++) {
     newf[p] = 0.0;
   }
 
-  for (p = 1; p < lb->model.nvel; p++) {
+  for (p = 1; p < lb->param->nvel; p++) {
 
-    indexn = cs_index(lb->cs, ib[X] + lb->model.cv[p][X],
-		              ib[Y] + lb->model.cv[p][Y],
-		              ib[Z] + lb->model.cv[p][Z]);
+    indexn = cs_index(cs, ib[X] + lb->param->cv[p][X],
+		          ib[Y] + lb->param->cv[p][Y],
+		          ib[Z] + lb->param->cv[p][Z]);
 
     /* Site must have been fluid before position update */
 
-    colloids_info_map_old(cinfo, indexn, &pc);
-    if (pc) continue;
+    if (cinfo->map_old[indexn]) continue;
     map_status(map, indexn, &status);
     if (status == MAP_BOUNDARY) continue;
 
-    for (pdash = 0; pdash < lb->model.nvel; pdash++) {
+    for (pdash = 0; pdash < lb->param->nvel; pdash++) {
       lb_f(lb, indexn, pdash, 0, rtmp);
-      newf[pdash] += lb->model.wv[p]*rtmp[0];
+      newf[pdash] += lb->param->wv[p]*rtmp[0];
     }
-    weight += lb->model.wv[p];
+    weight += lb->param->wv[p];
     nweight += 1;
   }
 
+  /* Boundary vector */
+
+  for (ia = 0; ia < 3; ia++) {
+    r0[ia] = p_colloid->s.r[ia] - 1.0*noffset[ia];
+    rtmp[ia] = 1.0*ib[ia];
+  }
+
+  cs_minimum_distance(cs, r0, rtmp, rb);
+
   /* Set new fluid distributions */
 
   if (nweight == 0) {
     /* Cannot interpolate: fall back to local replacement */
-    build_replace_fluid_local(cinfo, p_colloid, index, lb);
+    *dm = 0.0;
+    build_replace_fluid_equilibrium(lb, p_colloid, index, rb, g, t);
   }
   else {
 
     weight = 1.0/weight;
 
-    for (p = 0; p < lb->model.nvel; p++) {
+    for (p = 0; p < lb->param->nvel; p++) {
       newf[p] *= weight;
       lb_f_set(lb, index, p, 0, newf[p]);
 
@@ -918,7 +1287,7 @@ static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
 	 ... correction to colloid momentum */
 
       for (ia = 0; ia < 3; ia++) {
-	g[ia] -= newf[p]*lb->model.cv[p][ia];
+	g[ia] -= newf[p]*lb->param->cv[p][ia];
       }
     }
 
@@ -926,20 +1295,8 @@ static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
      * correction to the torque, we need the appropriate
      * boundary vector rb */
 
-    p_colloid->deltam += (newrho - rho0);
-
-    for (ia = 0; ia < 3; ia++) {
-      p_colloid->f0[ia] += g[ia];
-      r0[ia] = p_colloid->s.r[ia] - 1.0*noffset[ia];
-      rtmp[ia] = 1.0*ib[ia];
-    }
-
-    cs_minimum_distance(lb->cs, r0, rtmp, rb);
-    cross_product(rb, g, rtmp);
-
-    for (ia = 0; ia < 3; ia++) {
-      p_colloid->t0[ia] += rtmp[ia];
-    }
+    *dm = (newrho - rho0);
+    cross_product(rb, g, t);
   }
 
   return 0;
@@ -961,10 +1318,8 @@ static int build_replace_fluid(lb_t * lb, colloids_info_t * cinfo, int index,
 int build_replace_fluid_local(colloids_info_t * cinfo, colloid_t * pc,
 			      int index, lb_t * lb) {
 
-  int ia, ib, p;
-  double rho0;
-  double f, sdotq, udotc;
-  double rb[3], ub[3];
+  int ia;
+  double rb[3];
   double gnew[3] = {0.0, 0.0, 0.0};
   double tnew[3] = {0.0, 0.0, 0.0};
 
@@ -972,42 +1327,79 @@ int build_replace_fluid_local(colloids_info_t * cinfo, colloid_t * pc,
   assert(pc);
   assert(lb);
 
+  colloid_rb(cinfo, pc, index, rb);
+  build_replace_fluid_equilibrium(lb, pc, index, rb, gnew, tnew);
+
+  for (ia = 0; ia < 3; ia++) {
+    pc->f0[ia] += gnew[ia];
+    pc->t0[ia] += tnew[ia];
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  build_replace_fluid_equilibrium
+ *
+ *  Set the distributions at site index to the equilibrium with the
+ *  local solid body velocity at boundary vector rb. The corrections
+ *  to the colloid momentum (gnew) and torque (tnew) are returned.
+ *
+ *****************************************************************************/
+
+static __host__ __device__
+int build_replace_fluid_equilibrium(lb_t * lb, const colloid_t * pc,
+				    int index, const double rb[3],
+				    double gnew[3], double tnew[3]) {
+  int ia, ib, p;
+  double rho0;
+  double f, sdotq, udotc;
+  double ub[3];
+  LB_CS2_DOUBLE(cs2);
+  LB_RCS2_DOUBLE(rcs2);
+
+  assert(lb);
+  assert(pc);
+
   /* Compute new distribution */
 
   rho0 = lb->param->rho0; /* fluid density */
-  colloid_rb_ub(cinfo, pc, index, rb, ub);
 
-  for (p = 0; p < lb->model.nvel; p++) {
-    double cs2 = lb->model.cs2;
-    double rcs2 = 1.0/cs2;
-    udotc = lb->model.cv[p][X]*ub[X]
-          + lb->model.cv[p][Y]*ub[Y]
-          + lb->model.cv[p][Z]*ub[Z];
+  /* u_b = v + omega x r_b */
+
+  ub[X] = pc->s.v[X] + pc->s.w[Y]*rb[Z] - pc->s.w[Z]*rb[Y];
+  ub[Y] = pc->s.v[Y] + pc->s.w[Z]*rb[X] - pc->s.w[X]*rb[Z];
+  ub[Z] = pc->s.v[Z] + pc->s.w[X]*rb[Y] - pc->s.w[Y]*rb[X];
+
+  gnew[X] = 0.0;
+  gnew[Y] = 0.0;
+  gnew[Z] = 0.0;
+
+  for (p = 0; p < lb->param->nvel; p++) {
+    udotc = lb->param->cv[p][X]*ub[X]
+          + lb->param->cv[p][Y]*ub[Y]
+          + lb->param->cv[p][Z]*ub[Z];
     sdotq = 0.0;
     for (ia = 0; ia < 3; ia++) {
       for (ib = 0; ib < 3; ib++) {
 	double dab = (ia == ib);
-	double q = lb->model.cv[p][ia]*lb->model.cv[p][ib] - cs2*dab;
+	double q = lb->param->cv[p][ia]*lb->param->cv[p][ib] - cs2*dab;
 	sdotq += q*ub[ia]*ub[ib];
       }
     }
 
-    f = lb->model.wv[p]*(rho0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq);
+    f = lb->param->wv[p]*(rho0 + rcs2*udotc + 0.5*rcs2*rcs2*sdotq);
     lb_f_set(lb, index, p, LB_RHO, f);
 
     /* Subtract momentum from colloid (contribution to) */
-    gnew[X] -= f*lb->model.cv[p][X];
-    gnew[Y] -= f*lb->model.cv[p][Y];
-    gnew[Z] -= f*lb->model.cv[p][Z];
+    gnew[X] -= f*lb->param->cv[p][X];
+    gnew[Y] -= f*lb->param->cv[p][Y];
+    gnew[Z] -= f*lb->param->cv[p][Z];
   }
 
   cross_product(rb, gnew, tnew);
 
-  for (ia = 0; ia < 3; ia++) {
-    pc->f0[ia] += gnew[ia];
-    pc->t0[ia] += tnew[ia];
-  }
-
   return 0;
 }
 
@@ -18,7 +18,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2021 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributions:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -38,6 +38,8 @@ __host__ int ch_flux_mu1(ch_t * ch, fe_t * fe);
 
 __global__ void ch_flux_mu1_kernel(kernel_ctxt_t * ktx, ch_t * ch, fe_t * fe,
 				   ch_info_t info);
+__global__ void ch_flux_mu1_kernel_v(kernel_ctxt_t * ktx, ch_t * ch,
+				     fe_t * fe, ch_info_t info, int xs, int ys);
 __global__ void ch_update_kernel_2d(kernel_ctxt_t * ktx, ch_t * ch,
 				    field_t * field, ch_info_t info, int xs, int ys);
 __global__ void ch_update_kernel_3d(kernel_ctxt_t * ktx, ch_t * ch,
@@ -222,11 +224,25 @@ __host__ int ch_flux_mu1(ch_t * ch, fe_t * fe) {
   limits.jmin = 0; limits.jmax = nlocal[Y];
   limits.kmin = 0; limits.kmax = nlocal[Z];
 
-  kernel_ctxt_create(ch->cs, 1, limits, &ctxt);
-  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+  if (fe->func->mu_v) {
+    /* Vectorised chemical potential is available */
+    int xs, ys, zs;
+    cs_strides(ch->cs, &xs, &ys, &zs);
+    assert(zs == 1);
 
-  tdpLaunchKernel(ch_flux_mu1_kernel, nblk, ntpb, 0, 0,
-		  ctxt->target, ch->target, fetarget, *ch->info);
+    kernel_ctxt_create(ch->cs, NSIMDVL, limits, &ctxt);
+    kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+    tdpLaunchKernel(ch_flux_mu1_kernel_v, nblk, ntpb, 0, 0,
+		    ctxt->target, ch->target, fetarget, *ch->info, xs, ys);
+  }
+  else {
+    kernel_ctxt_create(ch->cs, 1, limits, &ctxt);
+    kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+    tdpLaunchKernel(ch_flux_mu1_kernel, nblk, ntpb, 0, 0,
+		    ctxt->target, ch->target, fetarget, *ch->info);
+  }
 
   tdpAssert(tdpPeekAtLastError());
   tdpAssert(tdpDeviceSynchronize());
@@ -315,6 +331,83 @@ __global__ void ch_flux_mu1_kernel(kernel_ctxt_t * ktx, ch_t * ch, fe_t * fe,
   return;
 }
 
+/*****************************************************************************
+ *
+ *  ch_flux_mu1_kernel_v
+ *
+ *  Vectorised version of the above, which requires the free energy
+ *  to provide mu_v. xs and ys are the strides (zs is 1).
+ *
+ *****************************************************************************/
+
+__global__ void ch_flux_mu1_kernel_v(kernel_ctxt_t * ktx, ch_t * ch,
+				     fe_t * fe, ch_info_t info, int xs, int ys) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(ch);
+  assert(fe);
+  assert(fe->func->mu_v);
+
+  kiterations = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
+
+    int iv;
+    int index0;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int maskv[NSIMDVL];
+    double mu0[NQAB][NSIMDVL], mu1[NQAB][NSIMDVL];
+
+    assert(info.nfield == ch->flux->nf);
+
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    index0 = kernel_baseindex(ktx, kindex);
+
+    fe->func->mu_v(fe, index0, mu0);
+
+    /* between ic and ic+1 */
+
+    fe->func->mu_v(fe, index0 + xs, mu1);
+    for (int n = 0; n < info.nfield; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	int addr = addr_rank1(ch->flux->nsite, info.nfield, index0 + iv, n);
+	double flux = info.mobility[n]*(mu1[n][iv] - mu0[n][iv]);
+	ch->flux->fx[addr] -= maskv[iv]*flux;
+      }
+    }
+
+    /* y direction */
+
+    fe->func->mu_v(fe, index0 + ys, mu1);
+    for (int n = 0; n < info.nfield; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	int addr = addr_rank1(ch->flux->nsite, info.nfield, index0 + iv, n);
+	double flux = info.mobility[n]*(mu1[n][iv] - mu0[n][iv]);
+	ch->flux->fy[addr] -= maskv[iv]*flux;
+      }
+    }
+
+    /* z direction */
+
+    fe->func->mu_v(fe, index0 + 1, mu1);
+    for (int n = 0; n < info.nfield; n++) {
+      for_simd_v(iv, NSIMDVL) {
+	int addr = addr_rank1(ch->flux->nsite, info.nfield, index0 + iv, n);
+	double flux = info.mobility[n]*(mu1[n][iv] - mu0[n][iv]);
+	ch->flux->fz[addr] -= maskv[iv]*flux;
+      }
+    }
+
+    /* Next site */
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  ch_update_forward_step
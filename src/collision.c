@@ -24,6 +24,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "pe.h"
@@ -86,6 +87,7 @@ struct collide_param_s {
   double eta_shear;
   double eta_bulk;
   int    have_visc_model;
+  visc_local_t visc;          /* Site-local viscosity model (if any) */
 };
 
 static __constant__ lb_collide_param_t _lbp;
@@ -151,6 +153,9 @@ int lb_collide(lb_t * lb, hydro_t * hydro, map_t * map, noise_t * noise,
   assert(lb);
   assert(map);
 
+  /* Parameters are recomputed every step, but are only copied to
+   * the target if they have changed (see util_commit.c). */
+
   lb_ndist(lb, &ndist);
   lb_collision_relaxation_times_set(lb);
   lb_collision_noise_var_set(lb, noise);
@@ -390,6 +395,14 @@ void lb_collision_mrt1_site(lb_t * lb, hydro_t * hydro, map_t * map,
       eta_bulk[iv] = _cp.eta_bulk;
     }
   }
+  else if (_cp.visc.model != VISC_LOCAL_NONE) {
+    /* Viscosity model evaluated here from the composition */
+    /* Bulk viscosity will be (eta_bulk/eta_shear)_newtonian*eta_local */
+    visc_local_eta_v(&_cp.visc, index0, eta);
+    for_simd_v(iv, NSIMDVL) {
+      eta_bulk[iv] = (_cp.eta_bulk/_cp.eta_shear)*eta[iv];
+    }
+  }
   else {
     /* Use viscosity model values hydro->eta */
     /* Bulk viscosity will be (eta_bulk/eta_shear)_newtonian*eta_local */
@@ -1942,6 +1955,10 @@ static __host__ int lb_collision_parameters_commit(lb_t * lb, visc_t * visc) {
 
   assert(lb);
 
+  /* Zero the whole structure (inc. padding) as the commit compares
+   * the bytes with the last values committed. */
+  memset(&p, 0, sizeof(collide_param_t));
+
   physics_ref(&phys);
   physics_fbody(phys, force_constant);
 
@@ -1952,7 +1969,11 @@ static __host__ int lb_collision_parameters_commit(lb_t * lb, visc_t * visc) {
   physics_eta_bulk(phys, &p.eta_bulk);
 
   p.have_visc_model = 0;
-  if (visc) p.have_visc_model = 1;
+  p.visc.model = VISC_LOCAL_NONE;
+  if (visc) {
+    p.have_visc_model = 1;
+    if (visc->func->local) visc->func->local(visc, &p.visc);
+  }
 
   /* Pulse force (time dependent) */
   physics_fpulse(phys, fpulse_amplitude);
@@ -1972,10 +1993,17 @@ static __host__ int lb_collision_parameters_commit(lb_t * lb, visc_t * visc) {
   physics_mobility(phys, &p.mobility);
   p.rtau2 = 2.0 / (1.0 + 2.0*p.mobility);
 
-  tdpMemcpyToSymbol(tdpSymbol(_lbp), lb->param, sizeof(lb_collide_param_t),
-		    0, tdpMemcpyHostToDevice);
-  tdpMemcpyToSymbol(tdpSymbol(_cp), &p, sizeof(collide_param_t), 0,
-		    tdpMemcpyHostToDevice);
+  if (util_commit_required(lb->commit + LB_COMMIT_COLLIDE_LBP,
+			   "collision.c:_lbp", lb->param,
+			   sizeof(lb_collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(_lbp), lb->param,
+		      sizeof(lb_collide_param_t), 0, tdpMemcpyHostToDevice);
+  }
+  if (util_commit_required(lb->commit + LB_COMMIT_COLLIDE_CP,
+			   "collision.c:_cp", &p, sizeof(collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(_cp), &p, sizeof(collide_param_t), 0,
+		      tdpMemcpyHostToDevice);
+  }
   return 0;
 }
 
@@ -18,7 +18,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -33,6 +33,7 @@
 #include "coords.h"
 #include "colloids.h"
 #include "colloid_sums.h"
+#include "timer.h"
 
 /*****************************************************************************
  *
@@ -161,10 +162,21 @@ int colloid_sums_halo(colloids_info_t * cinfo, colloid_sum_enum_t mtype) {
   sum->mtype = mtype;
   sum->msize = msize_[mtype];
 
+  /* There is one timer per message type following TIMER_COLLOID_SUMS */
+
+  assert(TIMER_COLLOID_SUMS + COLLOID_SUM_DIAGNOSTIC
+	 == TIMER_COLLOID_SUMS_DIAGNOSTIC);
+
+  TIMER_start(TIMER_COLLOID_SUMS);
+  if (mtype != COLLOID_SUM_NULL) TIMER_start(TIMER_COLLOID_SUMS + mtype);
+
   colloid_sums_1d(sum, X, mtype);
   colloid_sums_1d(sum, Y, mtype);
   colloid_sums_1d(sum, Z, mtype);
 
+  if (mtype != COLLOID_SUM_NULL) TIMER_stop(TIMER_COLLOID_SUMS + mtype);
+  TIMER_stop(TIMER_COLLOID_SUMS);
+
   free(sum);
 
   return 0;
@@ -344,6 +356,10 @@ static int colloid_sums_isend(colloid_sum_t * sum, int dim,
   req[0] = MPI_REQUEST_NULL;
   req[1] = MPI_REQUEST_NULL;
 
+  if (sum->mtype != COLLOID_SUM_NULL) {
+    TIMER_count(TIMER_COLLOID_SUMS + sum->mtype, (nf + nb)*sizeof(double));
+  }
+
   if (sum->cs->param->mpi_cartsz[dim] == 1) {
     memcpy(sum->recv, sum->send, (nf + nb)*sizeof(double));
   }
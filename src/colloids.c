@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -108,8 +108,29 @@ __host__ void colloids_info_free(colloids_info_t * info) {
   free(info->clist);
   if (info->map_old) free(info->map_old);
   if (info->map_new) free(info->map_new);
+  free(info->bondlist);
+  free(info->anglelist);
 
-  if (info->target != info) tdpAssert(tdpFree(info->target));
+  if (info->subgrid_r0target != info->subgrid_r0) {
+    tdpAssert(tdpFree(info->subgrid_celltarget));
+    tdpAssert(tdpFree(info->subgrid_r0target));
+    tdpAssert(tdpFree(info->subgrid_ftarget));
+  }
+  free(info->subgrid_f);
+  free(info->subgrid_r0);
+  free(info->subgrid_cell);
+  free(info->subgrid_pc);
+
+  if (info->target != info) {
+    colloid_t ** tmp = NULL;
+    tdpAssert(tdpMemcpy(&tmp, &info->target->map_old, sizeof(colloid_t **),
+			tdpMemcpyDeviceToHost));
+    if (tmp) tdpAssert(tdpFree(tmp));
+    tdpAssert(tdpMemcpy(&tmp, &info->target->map_new, sizeof(colloid_t **),
+			tdpMemcpyDeviceToHost));
+    if (tmp) tdpAssert(tdpFree(tmp));
+    tdpAssert(tdpFree(info->target));
+  }
 
   free(info);
 
@@ -176,11 +197,20 @@ __host__ int colloids_memcpy(colloids_info_t * info, int flag) {
     assert((info->target == info));
   }
   else {
-    colloid_t * tmp;
+    colloid_t ** tmp;
+    size_t nsz = info->nsites*sizeof(colloid_t *);
     tdpAssert(tdpMemcpy(&tmp, &info->target->map_new, sizeof(colloid_t **),
 			tdpMemcpyDeviceToHost));
-    tdpAssert(tdpMemcpy(tmp, info->map_new, info->nsites*sizeof(colloid_t *),
-			tdpMemcpyHostToDevice));
+    switch (flag) {
+    case tdpMemcpyHostToDevice:
+      tdpAssert(tdpMemcpy(tmp, info->map_new, nsz, tdpMemcpyHostToDevice));
+      break;
+    case tdpMemcpyDeviceToHost:
+      tdpAssert(tdpMemcpy(info->map_new, tmp, nsz, tdpMemcpyDeviceToHost));
+      break;
+    default:
+      pe_fatal(info->pe, "Bad flag in colloids_memcpy()\n");
+    }
   }
 
   return 0;
@@ -277,6 +307,10 @@ __host__ int colloids_info_map_init(colloids_info_t * info) {
     tdpAssert(tdpMemset(tmp, 0, nsites*sizeof(colloid_t *)));
     tdpAssert(tdpMemcpy(&info->target->map_new, &tmp, sizeof(colloid_t **),
 			tdpMemcpyHostToDevice));
+    tdpAssert(tdpMalloc((void **) &tmp, nsites*sizeof(colloid_t *)));
+    tdpAssert(tdpMemset(tmp, 0, nsites*sizeof(colloid_t *)));
+    tdpAssert(tdpMemcpy(&info->target->map_old, &tmp, sizeof(colloid_t **),
+			tdpMemcpyHostToDevice));
   }
 
   return 0;
@@ -428,6 +462,7 @@ __host__ int colloids_info_map_set(colloids_info_t * cinfo, int index, colloid_t
 __host__ int colloids_info_map_update(colloids_info_t * cinfo) {
 
   int n;
+  int ndevice;
   colloid_t ** maptmp;
 
   assert(cinfo);
@@ -440,6 +475,25 @@ __host__ int colloids_info_map_update(colloids_info_t * cinfo) {
   cinfo->map_old = cinfo->map_new;
   cinfo->map_new = maptmp;
 
+  /* Same on target; the map is rebuilt there */
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    colloid_t ** mapold = NULL;
+    colloid_t ** mapnew = NULL;
+    size_t nsz = cinfo->nsites*sizeof(colloid_t *);
+    tdpAssert(tdpMemcpy(&mapold, &cinfo->target->map_old,
+			sizeof(colloid_t **), tdpMemcpyDeviceToHost));
+    tdpAssert(tdpMemcpy(&mapnew, &cinfo->target->map_new,
+			sizeof(colloid_t **), tdpMemcpyDeviceToHost));
+    tdpAssert(tdpMemset(mapold, 0, nsz));
+    tdpAssert(tdpMemcpy(&cinfo->target->map_old, &mapnew,
+			sizeof(colloid_t **), tdpMemcpyHostToDevice));
+    tdpAssert(tdpMemcpy(&cinfo->target->map_new, &mapold,
+			sizeof(colloid_t **), tdpMemcpyHostToDevice));
+  }
+
   return 0;
 }
 
@@ -1202,6 +1256,86 @@ __host__ int colloids_info_list_local_build(colloids_info_t * cinfo) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_info_bond_lists_build
+ *
+ *  Gather the local bonded interactions into contiguous lists which
+ *  may be traversed directly by the bonded force computations:
+ *
+ *    bondlist:  pairs (pc, pc->bonded[n]) with pc->s.index smaller;
+ *    anglelist: triples (pc, pc->bonded[0], pc->bonded[1]).
+ *
+ *  The bonded[] pointers must be current (see interact_find_bonds()),
+ *  and the local list must have been built. The lists are valid until
+ *  the next change in the cell list.
+ *
+ *****************************************************************************/
+
+__host__ int colloids_info_bond_lists_build(colloids_info_t * cinfo) {
+
+  int nbond = 0;
+  int nangle = 0;
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+
+  /* Count, and make sure there is enough space */
+
+  for (pc = cinfo->headlocal; pc; pc = pc->nextlocal) {
+    nbond += pc->s.nbonds;
+    nangle += pc->s.nangles;
+  }
+
+  if (nbond > cinfo->nbondlistmax) {
+    colloid_t ** tmp = NULL;
+    tmp = (colloid_t **) realloc(cinfo->bondlist, 2*nbond*sizeof(colloid_t *));
+    assert(tmp);
+    if (tmp == NULL) pe_fatal(cinfo->pe, "realloc(bondlist) failed\n");
+    cinfo->bondlist = tmp;
+    cinfo->nbondlistmax = nbond;
+  }
+
+  if (nangle > cinfo->nanglelistmax) {
+    colloid_t ** tmp = NULL;
+    tmp = (colloid_t **) realloc(cinfo->anglelist,
+				 3*nangle*sizeof(colloid_t *));
+    assert(tmp);
+    if (tmp == NULL) pe_fatal(cinfo->pe, "realloc(anglelist) failed\n");
+    cinfo->anglelist = tmp;
+    cinfo->nanglelistmax = nangle;
+  }
+
+  /* Fill; the order follows the local list. */
+
+  nbond = 0;
+  nangle = 0;
+
+  for (pc = cinfo->headlocal; pc; pc = pc->nextlocal) {
+    for (int n = 0; n < pc->s.nbonds; n++) {
+      assert(pc->bonded[n]);
+      if (pc->s.index > pc->bonded[n]->s.index) continue;
+      cinfo->bondlist[2*nbond + 0] = pc;
+      cinfo->bondlist[2*nbond + 1] = pc->bonded[n];
+      nbond += 1;
+    }
+    if (pc->s.nangles > 0) {
+      assert(pc->s.nangles == 1);
+      assert(pc->bonded[0]);
+      assert(pc->bonded[1]);
+      cinfo->anglelist[3*nangle + 0] = pc;
+      cinfo->anglelist[3*nangle + 1] = pc->bonded[0];
+      cinfo->anglelist[3*nangle + 2] = pc->bonded[1];
+      nangle += 1;
+    }
+  }
+
+  cinfo->nbondlist = nbond;
+  cinfo->nanglelist = nangle;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_info_climits
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -68,6 +68,8 @@ struct colloid {
   double tc0[3];        /* total torque on squirmer for mass conservation */
   double sump;          /* flux through squirmer surface */ 
   double dq[2];         /* charge remove/replace mismatch for 2 charges */
+  double rhoq[2];       /* charge densities last set at covered sites */
+  int rhoq_valid;       /* rhoq[] is current at all covered sites */
 
   double fsub[3];       /* Subgrid particle force from fluid */
   double fex[3];        /* External forces (non-fluid) on particle */
@@ -114,6 +116,22 @@ struct colloids_info_s {
   colloid_t * headall;        /* All colloid list (incl. halo) head */
   colloid_t * headlocal;      /* Local list (excl. halo) head */
 
+  int nbondlist;              /* Number of pairs in bond list */
+  int nanglelist;             /* Number of triples in angle list */
+  int nbondlistmax;           /* Allocated capacity (pairs) */
+  int nanglelistmax;          /* Allocated capacity (triples) */
+  colloid_t ** bondlist;      /* Local bonds as pairs (pc, bonded) */
+  colloid_t ** anglelist;     /* Local angles (pc, bonded[0], bonded[1]) */
+
+  int nsubgridmax;            /* Allocated capacity of subgrid lists */
+  colloid_t ** subgrid_pc;    /* Subgrid particles in list order */
+  int * subgrid_cell;         /* Offset of each occupied cell in list */
+  double * subgrid_r0;        /* Local positions of subgrid particles */
+  double * subgrid_f;         /* Force or velocity of subgrid particles */
+  int * subgrid_celltarget;   /* Target copy of subgrid_cell */
+  double * subgrid_r0target;  /* Target copy of subgrid_r0 */
+  double * subgrid_ftarget;   /* Target copy of subgrid_f */
+
   pe_t * pe;                  /* Parallel environment */
   cs_t * cs;                  /* Coordinate system */
   colloids_info_t * target;   /* Copy of this structure on target */ 
@@ -163,6 +181,7 @@ __host__ int colloids_info_map_set(colloids_info_t * cinfo, int index,
 __host__ int colloids_info_update_lists(colloids_info_t * cinfo);
 __host__ int colloids_info_list_all_build(colloids_info_t * cinfo);
 __host__ int colloids_info_list_local_build(colloids_info_t * cinfo);
+__host__ int colloids_info_bond_lists_build(colloids_info_t * cinfo);
 __host__ int colloids_info_climits(colloids_info_t * cinfo, int ia, int ic, int * lim);
 __host__ int colloids_info_a0max(colloids_info_t * cinfo, double * a0max);
 __host__ int colloids_info_ahmax(colloids_info_t * cinfo, double * ahmax);
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -15,6 +15,7 @@
  *****************************************************************************/
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <float.h>
@@ -24,15 +25,30 @@
 #include "colloids.h"
 #include "colloids_halo.h"
 #include "util.h"
+#include "timer.h"
+
+/* The message for each colloid is the state without the padding
+ * (which is around one third of the size of colloid_state_t).
+ * The message is the integer part followed by the double part, and
+ * is rounded up to a multiple of sizeof(double). */
+
+#define HALO_MSG_NINT_BYTES (offsetof(colloid_state_t, intpad))
+#define HALO_MSG_NDBL_BYTES (offsetof(colloid_state_t, dpad) \
+			     - offsetof(colloid_state_t, a0))
+#define HALO_MSG_SIZE (sizeof(double)*((HALO_MSG_NINT_BYTES \
+					+ HALO_MSG_NDBL_BYTES		\
+					+ sizeof(double) - 1)/sizeof(double)))
 
 struct colloid_halo_s {
   pe_t * pe;               /* Parallel environment */
   cs_t * cs;               /* Coordinate system */
   colloids_info_t * cinfo;
-  colloid_state_t * send;
-  colloid_state_t * recv;
+  char * send;             /* Send buffer (HALO_MSG_SIZE per colloid) */
+  char * recv;             /* Receive buffer */
   int nsend[2];
   int nrecv[2];
+  int nsendmax;            /* Current capacity of send buffer (colloids) */
+  int nrecvmax;            /* Current capacity of recv buffer (colloids) */
 };
 
 static const int tagf_ = 1061;
@@ -46,6 +62,9 @@ static int colloids_halo_isend(colloid_halo_t * halo, int dim, MPI_Request req[2
 static int colloids_halo_load_list(colloid_halo_t * halo,
 				   int ic, int jc, int kc,
 				   const double rperiod[3], int noff);
+static int colloids_halo_buffers(colloid_halo_t * halo);
+static void colloids_halo_msg_pack(const colloid_state_t * s, char * buf);
+static void colloids_halo_msg_unpack(const char * buf, colloid_state_t * s);
 
 /*****************************************************************************
  *
@@ -86,6 +105,8 @@ void colloids_halo_free(colloid_halo_t * halo) {
 
   assert(halo);
 
+  free(halo->recv);
+  free(halo->send);
   free(halo);
 
   return;
@@ -118,11 +139,15 @@ int colloids_halo_state(colloids_info_t * cinfo) {
   halo->cs = cinfo->cs;
   halo->cinfo = cinfo;
 
+  TIMER_start(TIMER_PARTICLE_HALO_STATE);
+
   colloids_halo_dim(halo, X);
   colloids_halo_dim(halo, Y);
   colloids_halo_dim(halo, Z);
 
-  free(halo);
+  TIMER_stop(TIMER_PARTICLE_HALO_STATE);
+
+  colloids_halo_free(halo);
 
   return 0;
 }
@@ -152,18 +177,10 @@ int colloids_halo_dim(colloid_halo_t * halo, int dim) {
   colloids_halo_send_count(halo, dim, NULL);
   colloids_halo_number(halo, dim);
 
-  /* Allocate the send and recv buffer, and post recvs */
-
-  n = halo->nsend[FORWARD] + halo->nsend[BACKWARD];
-  halo->send = (colloid_state_t *) malloc(imax(1,n)*sizeof(colloid_state_t));
-  assert(halo->send);
+  /* Make sure the send and recv buffers are large enough; post recvs */
 
+  colloids_halo_buffers(halo);
   n = halo->nrecv[FORWARD] + halo->nrecv[BACKWARD];
-  halo->recv = (colloid_state_t *) malloc(imax(1,n)*sizeof(colloid_state_t));
-  assert(halo->recv);
-
-  if (halo->send == NULL) pe_fatal(halo->pe, "halo malloc(send_) failed\n");
-  if (halo->recv == NULL) pe_fatal(halo->pe, "halo malloc(recv_) failed\n");
 
   colloids_halo_irecv(halo, dim, request_recv);
 
@@ -176,10 +193,8 @@ int colloids_halo_dim(colloid_halo_t * halo, int dim) {
 
   MPI_Waitall(2, request_recv, status);
   colloids_halo_unload(halo, n);
-  free(halo->recv);
 
   MPI_Waitall(2, request_send, status);
-  free(halo->send);
 
   return 0;
 }
@@ -351,13 +366,14 @@ static int colloids_halo_load_list(colloid_halo_t * halo,
   colloids_info_cell_list_head(halo->cinfo, ic, jc, kc, &pc);
 
   while (pc) {
-    halo->send[noff + n] = pc->s;
-    halo->send[noff + n].r[X] = pc->s.r[X] + rperiod[X];
-    halo->send[noff + n].r[Y] = pc->s.r[Y] + rperiod[Y];
-    halo->send[noff + n].r[Z] = pc->s.r[Z] + rperiod[Z];
+    colloid_state_t s = pc->s;
+    s.r[X] = pc->s.r[X] + rperiod[X];
+    s.r[Y] = pc->s.r[Y] + rperiod[Y];
+    s.r[Z] = pc->s.r[Z] + rperiod[Z];
     /* Because delta phi is accumulated across copies at each time step,
      * we must zero the outgoing copy here to avoid overcounting */
-    halo->send[noff + n].deltaphi = 0.0;
+    s.deltaphi = 0.0;
+    colloids_halo_msg_pack(&s, halo->send + (noff + n)*HALO_MSG_SIZE);
     n++;
     pc = pc->next;
   }
@@ -388,9 +404,13 @@ static int colloids_halo_unload(colloid_halo_t * halo, int nrecv) {
 
   for (n = 0; n < nrecv; n++) {
 
+    colloid_state_t s = {0};
+
+    colloids_halo_msg_unpack(halo->recv + n*HALO_MSG_SIZE, &s);
+
     exists = 0;
-    index = halo->recv[n].index;
-    colloids_info_cell_coords(halo->cinfo, halo->recv[n].r, cell);
+    index = s.index;
+    colloids_info_cell_coords(halo->cinfo, s.r, cell);
     colloids_info_cell_list_head(halo->cinfo, cell[X], cell[Y], cell[Z], &pc);
 
     while (pc) {
@@ -399,7 +419,7 @@ static int colloids_halo_unload(colloid_halo_t * halo, int nrecv) {
 	/* kludge: don't update deltaphi */
 	double phi;
 	phi = pc->s.deltaphi;
-	pc->s = halo->recv[n];
+	colloids_halo_msg_unpack(halo->recv + n*HALO_MSG_SIZE, &pc->s);
 	pc->s.deltaphi = phi;
 	exists = 1;
       }
@@ -408,9 +428,9 @@ static int colloids_halo_unload(colloid_halo_t * halo, int nrecv) {
     }
 
     if (exists == 0) {
-      colloids_info_add(halo->cinfo, index, halo->recv[n].r, &pc);
+      colloids_info_add(halo->cinfo, index, s.r, &pc);
       assert(pc);
-      pc->s = halo->recv[n];
+      pc->s = s;
       pc->s.rebuild = 1;
     }
   }
@@ -442,12 +462,12 @@ static int colloids_halo_irecv(colloid_halo_t * halo, int dim,
     pforw = halo->cs->mpi_cart_neighbours[CS_FORW][dim];
     pback = halo->cs->mpi_cart_neighbours[CS_BACK][dim];
 
-    n = halo->nrecv[CS_FORW]*sizeof(colloid_state_t);
+    n = halo->nrecv[CS_FORW]*HALO_MSG_SIZE;
     MPI_Irecv(halo->recv, n, MPI_BYTE, pforw, tagb_, comm, req);
 
-    n = halo->nrecv[CS_BACK]*sizeof(colloid_state_t);
-    MPI_Irecv(halo->recv + halo->nrecv[CS_FORW], n, MPI_BYTE, pback, tagf_,
-	      comm, req + 1);
+    n = halo->nrecv[CS_BACK]*HALO_MSG_SIZE;
+    MPI_Irecv(halo->recv + halo->nrecv[CS_FORW]*HALO_MSG_SIZE, n, MPI_BYTE,
+	      pback, tagf_, comm, req + 1);
   }
 
   return 0;
@@ -475,7 +495,8 @@ static int colloids_halo_isend(colloid_halo_t * halo, int dim,
 
     if (halo->cs->param->periodic[dim]) {
       n = halo->nsend[CS_FORW] + halo->nsend[CS_BACK];
-      memcpy(halo->recv, halo->send, n*sizeof(colloid_state_t));
+      memcpy(halo->recv, halo->send, n*HALO_MSG_SIZE);
+      TIMER_count(TIMER_PARTICLE_HALO_STATE, n*HALO_MSG_SIZE);
     }
 
     req[0] = MPI_REQUEST_NULL;
@@ -487,12 +508,15 @@ static int colloids_halo_isend(colloid_halo_t * halo, int dim,
     pforw = halo->cs->mpi_cart_neighbours[CS_FORW][dim];
     pback = halo->cs->mpi_cart_neighbours[CS_BACK][dim];
 
-    n = halo->nsend[CS_FORW]*sizeof(colloid_state_t);
-    MPI_Issend(halo->send + halo->nsend[CS_BACK], n, MPI_BYTE, pforw, tagf_,
-	       comm, req);
+    n = halo->nsend[CS_FORW]*HALO_MSG_SIZE;
+    MPI_Issend(halo->send + halo->nsend[CS_BACK]*HALO_MSG_SIZE, n, MPI_BYTE,
+	       pforw, tagf_, comm, req);
 
-    n = halo->nsend[CS_BACK]*sizeof(colloid_state_t);
+    n = halo->nsend[CS_BACK]*HALO_MSG_SIZE;
     MPI_Issend(halo->send, n, MPI_BYTE, pback, tagb_, comm, req + 1);
+
+    n = halo->nsend[CS_FORW] + halo->nsend[CS_BACK];
+    TIMER_count(TIMER_PARTICLE_HALO_STATE, n*HALO_MSG_SIZE);
   }
 
   return 0;
@@ -546,3 +570,80 @@ static int colloids_halo_number(colloid_halo_t * halo, int dim) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  colloids_halo_buffers
+ *
+ *  Ensure the send and receive buffers have capacity for the current
+ *  counts. The buffers are retained for the lifetime of the halo
+ *  object, so are only reallocated if they need to grow.
+ *
+ *****************************************************************************/
+
+static int colloids_halo_buffers(colloid_halo_t * halo) {
+
+  int nsend;
+  int nrecv;
+
+  assert(halo);
+
+  nsend = imax(1, halo->nsend[FORWARD] + halo->nsend[BACKWARD]);
+  nrecv = imax(1, halo->nrecv[FORWARD] + halo->nrecv[BACKWARD]);
+
+  if (nsend > halo->nsendmax) {
+    free(halo->send);
+    halo->send = (char *) malloc(nsend*HALO_MSG_SIZE);
+    assert(halo->send);
+    if (halo->send == NULL) pe_fatal(halo->pe, "halo malloc(send_) failed\n");
+    halo->nsendmax = nsend;
+  }
+
+  if (nrecv > halo->nrecvmax) {
+    free(halo->recv);
+    halo->recv = (char *) malloc(nrecv*HALO_MSG_SIZE);
+    assert(halo->recv);
+    if (halo->recv == NULL) pe_fatal(halo->pe, "halo malloc(recv_) failed\n");
+    halo->nrecvmax = nrecv;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_halo_msg_pack
+ *
+ *  State to message (padding is omitted).
+ *
+ *****************************************************************************/
+
+static void colloids_halo_msg_pack(const colloid_state_t * s, char * buf) {
+
+  assert(s);
+  assert(buf);
+
+  memcpy(buf, s, HALO_MSG_NINT_BYTES);
+  memcpy(buf + HALO_MSG_NINT_BYTES, &s->a0, HALO_MSG_NDBL_BYTES);
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_halo_msg_unpack
+ *
+ *  Message to state. The padding in s is left unchanged.
+ *
+ *****************************************************************************/
+
+static void colloids_halo_msg_unpack(const char * buf, colloid_state_t * s) {
+
+  assert(buf);
+  assert(s);
+
+  memcpy(s, buf, HALO_MSG_NINT_BYTES);
+  memcpy(&s->a0, buf + HALO_MSG_NINT_BYTES, HALO_MSG_NDBL_BYTES);
+
+  return;
+}
@@ -7,6 +7,9 @@
  *  If there are any collisions in the result, a fatal error
  *  is issued.
  *
+ *  For larger numbers, or higher volume fractions, random sequential
+ *  addition with push-off is available via colloids_init_rsa().
+ *
  *  Anything more complex should be organised separately and
  *  initialised from file.
  *
@@ -15,17 +18,20 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
  *****************************************************************************/
 
-#include <math.h>
 #include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
 
 #include "ran.h"
+#include "util.h"
 #include "colloids.h"
 #include "colloids_halo.h"
 #include "colloids_init.h"
@@ -37,6 +43,38 @@ static int colloids_init_check_wall(pe_t * pe, cs_t * cs,
 				    colloids_info_t * cinfo, wall_t * wall,
 				    double dh);
 
+/* Random sequential addition: a global cell list of positions only */
+
+#define RSA_NTRIAL_MAX       100   /* Consecutive rejections taken as jammed */
+#define RSA_PUSH_OFF_MARGIN 0.01   /* Fractional extra push-off separation */
+
+typedef struct rsa_cell_s rsa_cell_t;
+
+struct rsa_cell_s {
+  int nc[3];            /* Number of cells in each direction */
+  int periodic[3];      /* Periodic flags */
+  double lmin[3];       /* System lower bound */
+  double ltot[3];       /* System size */
+  double lcell[3];      /* Cell widths */
+  int * head;           /* Head of list for each cell (-1 for empty) */
+  int * next;           /* Next particle in list (-1 for end) */
+};
+
+static int colloids_init_rsa_cell_create(pe_t * pe, cs_t * cs, int np,
+					 double hmax, rsa_cell_t * cell);
+static int colloids_init_rsa_cell_free(rsa_cell_t * cell);
+static int colloids_init_rsa_cell_clear(rsa_cell_t * cell);
+static int colloids_init_rsa_cell_add(rsa_cell_t * cell, int n,
+				      const double r[3]);
+static int colloids_init_rsa_bounds(const rsa_cell_t * cell, double amax,
+				    double lo[3], double lw[3]);
+static int colloids_init_rsa_place(cs_t * cs, rsa_cell_t * cell, int np,
+				   double amax, double hmax, int seed,
+				   double * r, int * nplaced);
+static int colloids_init_rsa_relax(pe_t * pe, cs_t * cs, rsa_cell_t * cell,
+				   int np, double amax, double hmax,
+				   int nrelax, double * r, int * niter);
+
 /*****************************************************************************
  *
  *  colloids_init_random
@@ -70,6 +108,515 @@ int colloids_init_random(pe_t * pe, cs_t * cs, colloids_info_t * cinfo, int np,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_init_rsa
+ *
+ *  Random sequential addition (RSA) of np particles, followed, if
+ *  required, by a soft push-off stage to remove any overlaps.
+ *
+ *  The placement is computed identically on every rank using a
+ *  light-weight global cell list of positions only, and a single
+ *  random number stream with the given seed. Each rank then retains
+ *  those particles in its own subdomain. The result is therefore
+ *  independent of the decomposition.
+ *
+ *  RSA alone will jam at a volume fraction around 0.38. Particles
+ *  which cannot be added without overlap are inserted at random and
+ *  then separated by at most nrelax push-off iterations. Volume
+ *  fractions well above 0.5 are then available.
+ *
+ *  The wall argument may be NULL if there are no walls.
+ *
+ *****************************************************************************/
+
+int colloids_init_rsa(pe_t * pe, cs_t * cs, colloids_info_t * cinfo, int np,
+		      const colloid_state_t * s0, wall_t * wall, double dh,
+		      int seed, int nrelax) {
+
+  int n;
+  int nplaced = 0;
+  int niter = 0;
+  double amax;
+  double hmax;
+  double * r = NULL;
+  colloid_t * pc = NULL;
+  rsa_cell_t cell = {0};
+
+  assert(pe);
+  assert(cs);
+  assert(cinfo);
+  assert(s0);
+  assert(np >= 0);
+  assert(seed > 0);
+  assert(nrelax >= 0);
+
+  amax = s0->ah + dh;
+  hmax = 2.0*s0->ah + dh;
+
+  r = (double *) calloc(imax(1, 3*np), sizeof(double));
+  assert(r);
+  if (r == NULL) pe_fatal(pe, "calloc(rsa positions) failed\n");
+
+  colloids_init_rsa_cell_create(pe, cs, np, hmax, &cell);
+
+  colloids_init_rsa_place(cs, &cell, np, amax, hmax, seed, r, &nplaced);
+  colloids_init_rsa_relax(pe, cs, &cell, np, amax, hmax, nrelax, r, &niter);
+
+  pe_info(pe, "Random sequential addition placed %d of %d\n", nplaced, np);
+  pe_info(pe, "Push-off iterations required:     %d\n", niter);
+
+  if (niter > nrelax) {
+    pe_info(pe, "Push-off failed to remove all overlaps in %d iterations\n",
+	    nrelax);
+    pe_info(pe, "Increase colloid_random_nrelax or reduce the number\n");
+    pe_fatal(pe, "Stop.\n");
+  }
+
+  /* Retain local particles (state as for colloids_init_random_set()) */
+
+  for (n = 1; n <= np; n++) {
+    double * r0 = r + 3*(n - 1);
+    colloids_info_add_local(cinfo, n, r0, &pc);
+    if (pc) {
+      pc->s = *s0;
+      pc->s.index = n;
+      pc->s.rng = n;
+      pc->s.rebuild = 1;
+      pc->s.r[X] = r0[X];
+      pc->s.r[Y] = r0[Y];
+      pc->s.r[Z] = r0[Z];
+    }
+  }
+
+  colloids_init_rsa_cell_free(&cell);
+  free(r);
+
+  /* Final (parallel) checks as usual */
+
+  colloids_halo_state(cinfo);
+  colloids_init_check_state(cinfo, hmax);
+  colloids_info_list_local_build(cinfo);
+
+  if (wall) colloids_init_check_wall(pe, cs, cinfo, wall, dh);
+  colloids_info_ntotal_set(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_create
+ *
+ *  Cells have width at least hmax in each direction so that only
+ *  adjacent cells need be searched.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_cell_create(pe_t * pe, cs_t * cs, int np,
+					 double hmax, rsa_cell_t * cell) {
+  int ia;
+  double ltot[3];
+
+  assert(pe);
+  assert(cs);
+  assert(cell);
+  assert(hmax > 0.0);
+
+  cs_lmin(cs, cell->lmin);
+  cs_ltot(cs, ltot);
+  cs_periodic(cs, cell->periodic);
+
+  for (ia = 0; ia < 3; ia++) {
+    cell->ltot[ia] = ltot[ia];
+    cell->nc[ia] = imax(1, (int) floor(ltot[ia]/hmax));
+    cell->lcell[ia] = ltot[ia]/cell->nc[ia];
+  }
+
+  cell->head = (int *) malloc(sizeof(int)*cell->nc[X]*cell->nc[Y]*cell->nc[Z]);
+  cell->next = (int *) malloc(sizeof(int)*imax(1, np));
+  assert(cell->head);
+  assert(cell->next);
+  if (cell->head == NULL) pe_fatal(pe, "malloc(rsa cell head) failed\n");
+  if (cell->next == NULL) pe_fatal(pe, "malloc(rsa cell next) failed\n");
+
+  colloids_init_rsa_cell_clear(cell);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_free
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_cell_free(rsa_cell_t * cell) {
+
+  assert(cell);
+
+  free(cell->next);
+  free(cell->head);
+  cell->next = NULL;
+  cell->head = NULL;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_clear
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_cell_clear(rsa_cell_t * cell) {
+
+  int n;
+  int ncell;
+
+  assert(cell);
+
+  ncell = cell->nc[X]*cell->nc[Y]*cell->nc[Z];
+  for (n = 0; n < ncell; n++) cell->head[n] = -1;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_coords
+ *
+ *  Cell coordinates for position r.
+ *
+ *****************************************************************************/
+
+static void colloids_init_rsa_cell_coords(const rsa_cell_t * cell,
+					  const double r[3], int c[3]) {
+  int ia;
+
+  for (ia = 0; ia < 3; ia++) {
+    c[ia] = (int) floor((r[ia] - cell->lmin[ia])/cell->lcell[ia]);
+    c[ia] = imax(0, imin(c[ia], cell->nc[ia] - 1));
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_add
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_cell_add(rsa_cell_t * cell, int n,
+				      const double r[3]) {
+  int c[3];
+  int ic;
+
+  assert(cell);
+
+  colloids_init_rsa_cell_coords(cell, r, c);
+  ic = cell->nc[Y]*cell->nc[Z]*c[X] + cell->nc[Z]*c[Y] + c[Z];
+
+  cell->next[n] = cell->head[ic];
+  cell->head[ic] = n;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_cell_range
+ *
+ *  The distinct cells in direction ia adjacent to (and including)
+ *  cell c. Returns the number of cells, at most 3.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_cell_range(const rsa_cell_t * cell, int ia,
+					int c, int list[3]) {
+  int nc = cell->nc[ia];
+  int nlist = 0;
+
+  if (nc < 3) {
+    /* All cells are adjacent; avoid counting any cell twice */
+    for (int ic = 0; ic < nc; ic++) list[nlist++] = ic;
+  }
+  else {
+    for (int dc = -1; dc <= +1; dc++) {
+      int ic = c + dc;
+      if (cell->periodic[ia]) {
+	list[nlist++] = (ic + nc) % nc;
+      }
+      else if (0 <= ic && ic < nc) {
+	list[nlist++] = ic;
+      }
+    }
+  }
+
+  return nlist;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_accumulate
+ *
+ *  For particle position r0 (with index n0, or -1 if not yet in the
+ *  list) examine all neighbours and return the number of overlaps
+ *  with separation < hmax.
+ *
+ *  If dr is not NULL, accumulate push-off displacements which would
+ *  move n0 a half of the way to separation htarget from each overlapping
+ *  neighbour m. If m is not itself active (and so will not compute
+ *  its own contribution), the equal and opposite displacement is
+ *  accumulated for m. The number of overlaps for each particle is
+ *  accumulated in nolap.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_accumulate(const rsa_cell_t * cell,
+					const double * r, int n0,
+					const double r0[3], double hmax,
+					double htarget, const int * active,
+					int * nolap, double * dr) {
+  int c[3];
+  int li[3], lj[3], lk[3];
+  int ni, nj, nk;
+  int noverlap = 0;
+
+  colloids_init_rsa_cell_coords(cell, r0, c);
+
+  ni = colloids_init_rsa_cell_range(cell, X, c[X], li);
+  nj = colloids_init_rsa_cell_range(cell, Y, c[Y], lj);
+  nk = colloids_init_rsa_cell_range(cell, Z, c[Z], lk);
+
+  for (int i = 0; i < ni; i++) {
+    for (int j = 0; j < nj; j++) {
+      for (int k = 0; k < nk; k++) {
+	int ic = cell->nc[Y]*cell->nc[Z]*li[i] + cell->nc[Z]*lj[j] + lk[k];
+	for (int m = cell->head[ic]; m >= 0; m = cell->next[m]) {
+	  double r12[3];
+	  double h;
+	  if (m == n0) continue;
+	  /* Minimum image (cf. cs_minimum_distance()) */
+	  for (int ia = 0; ia < 3; ia++) {
+	    r12[ia] = r[3*m + ia] - r0[ia];
+	    if (cell->periodic[ia] == 0) continue;
+	    if (r12[ia] >  0.5*cell->ltot[ia]) r12[ia] -= cell->ltot[ia];
+	    if (r12[ia] < -0.5*cell->ltot[ia]) r12[ia] += cell->ltot[ia];
+	  }
+	  h = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
+	  if (h >= hmax*hmax) continue;
+	  noverlap += 1;
+	  if (dr) {
+	    double rhat[3] = {1.0*(m < n0) - 1.0*(m > n0), 0.0, 0.0};
+	    h = sqrt(h);
+	    if (h > DBL_EPSILON) {
+	      rhat[X] = r12[X]/h;
+	      rhat[Y] = r12[Y]/h;
+	      rhat[Z] = r12[Z]/h;
+	    }
+	    for (int ia = 0; ia < 3; ia++) {
+	      dr[3*n0 + ia] -= 0.5*(htarget - h)*rhat[ia];
+	    }
+	    nolap[n0] += 1;
+	    if (active[m]) continue;
+	    for (int ia = 0; ia < 3; ia++) {
+	      dr[3*m + ia] += 0.5*(htarget - h)*rhat[ia];
+	    }
+	    nolap[m] += 1;
+	  }
+	}
+      }
+    }
+  }
+
+  return noverlap;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_place
+ *
+ *  Add particles one at a time at random positions, rejecting any
+ *  trial position which overlaps with an existing particle. If
+ *  RSA_NTRIAL_MAX consecutive trials are rejected, the system is
+ *  regarded as jammed, and any remaining particles are inserted at
+ *  random regardless of overlap (and must be pushed off later).
+ *
+ *  Returns the number placed by RSA in nplaced.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_place(cs_t * cs, rsa_cell_t * cell, int np,
+				   double amax, double hmax, int seed,
+				   double * r, int * nplaced) {
+  int n;
+  int jammed = 0;
+  int state = seed;
+  double lo[3];
+  double lw[3];
+
+  assert(cs);
+  assert(cell);
+  assert(r);
+  assert(nplaced);
+
+  colloids_init_rsa_bounds(cell, amax, lo, lw);
+  *nplaced = 0;
+
+  for (n = 0; n < np; n++) {
+    double * r0 = r + 3*n;
+    int ntrial = 0;
+    int noverlap = 0;
+
+    do {
+      double ran[3];
+      util_ranlcg_reap_uniform(&state, ran + X);
+      util_ranlcg_reap_uniform(&state, ran + Y);
+      util_ranlcg_reap_uniform(&state, ran + Z);
+      r0[X] = lo[X] + ran[X]*lw[X];
+      r0[Y] = lo[Y] + ran[Y]*lw[Y];
+      r0[Z] = lo[Z] + ran[Z]*lw[Z];
+      if (jammed) break;
+      noverlap = colloids_init_rsa_accumulate(cell, r, -1, r0, hmax, hmax,
+					      NULL, NULL, NULL);
+      ntrial += 1;
+    } while (noverlap > 0 && ntrial < RSA_NTRIAL_MAX);
+
+    if (noverlap > 0) jammed = 1;
+    if (jammed == 0) *nplaced += 1;
+
+    colloids_init_rsa_cell_add(cell, n, r0);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_relax
+ *
+ *  Push-off: at each iteration every overlapping particle is moved
+ *  (Jacobi-style) half of the way to a separation slightly larger
+ *  than hmax from each of its overlapping neighbours. Stop when there
+ *  are no overlaps.
+ *
+ *  Any new overlap must involve a particle which has just moved, so
+ *  only particles involved in an overlap at the previous iteration
+ *  are active (all are active at the first iteration).
+ *
+ *  The number of iterations taken is returned in niter; if overlaps
+ *  remain after nrelax iterations, niter = nrelax + 1.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_relax(pe_t * pe, cs_t * cs, rsa_cell_t * cell,
+				   int np, double amax, double hmax,
+				   int nrelax, double * r, int * niter) {
+  int iter;
+  double htarget = (1.0 + RSA_PUSH_OFF_MARGIN)*hmax;
+  double lo[3];
+  double lw[3];
+  double * dr = NULL;
+  int * active = NULL;
+  int * nolap = NULL;
+
+  assert(pe);
+  assert(cs);
+  assert(cell);
+  assert(r);
+  assert(niter);
+
+  colloids_init_rsa_bounds(cell, amax, lo, lw);
+
+  dr = (double *) calloc(imax(1, 3*np), sizeof(double));
+  active = (int *) calloc(imax(1, np), sizeof(int));
+  nolap = (int *) calloc(imax(1, np), sizeof(int));
+  assert(dr);
+  assert(active);
+  assert(nolap);
+  if (dr == NULL) pe_fatal(pe, "calloc(rsa displacements) failed\n");
+  if (active == NULL) pe_fatal(pe, "calloc(rsa active) failed\n");
+  if (nolap == NULL) pe_fatal(pe, "calloc(rsa overlaps) failed\n");
+
+  for (int n = 0; n < np; n++) active[n] = 1;
+
+  for (iter = 0; iter <= nrelax; iter++) {
+
+    int noverlap = 0;
+
+    /* Rebuild the list; compute displacements */
+
+    colloids_init_rsa_cell_clear(cell);
+    for (int n = 0; n < np; n++) colloids_init_rsa_cell_add(cell, n, r + 3*n);
+
+    for (int n = 0; n < 3*np; n++) dr[n] = 0.0;
+    for (int n = 0; n < np; n++) nolap[n] = 0;
+
+    for (int n = 0; n < np; n++) {
+      if (active[n] == 0) continue;
+      noverlap += colloids_init_rsa_accumulate(cell, r, n, r + 3*n, hmax,
+					       htarget, active, nolap, dr);
+    }
+
+    if (noverlap == 0) break;
+    if (iter == nrelax) continue;
+
+    /* Move; periodic positions are wrapped, while positions outside
+     * non-periodic boundaries are reflected back inside. */
+
+    for (int n = 0; n < np; n++) {
+      for (int ia = 0; ia < 3; ia++) {
+	double x = r[3*n + ia] + dr[3*n + ia];
+	if (cell->periodic[ia]) {
+	  if (x <  cell->lmin[ia]) x += cell->ltot[ia];
+	  if (x >= cell->lmin[ia] + cell->ltot[ia]) x -= cell->ltot[ia];
+	}
+	else {
+	  if (x < lo[ia]) x = lo[ia] + (lo[ia] - x);
+	  if (x > lo[ia] + lw[ia]) x = lo[ia] + lw[ia] - (x - lo[ia] - lw[ia]);
+	  x = dmax(lo[ia], dmin(x, lo[ia] + lw[ia]));
+	}
+	r[3*n + ia] = x;
+      }
+      active[n] = (nolap[n] > 0);
+    }
+  }
+
+  *niter = iter;
+
+  free(nolap);
+  free(active);
+  free(dr);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  colloids_init_rsa_bounds
+ *
+ *  Lower bound and width of the region available to centres. If
+ *  boundaries are not periodic, some of the volume is excluded.
+ *
+ *****************************************************************************/
+
+static int colloids_init_rsa_bounds(const rsa_cell_t * cell, double amax,
+				    double lo[3], double lw[3]) {
+  int ia;
+
+  assert(cell);
+
+  for (ia = 0; ia < 3; ia++) {
+    double lex = amax*(1.0 - cell->periodic[ia]);
+    lo[ia] = cell->lmin[ia] + lex;
+    lw[ia] = cell->ltot[ia] - 2.0*lex;
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_init_random_set
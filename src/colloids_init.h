@@ -6,7 +6,7 @@
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010-2019 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -21,5 +21,8 @@
 int colloids_init_random(pe_t * pe, cs_t * cs, colloids_info_t * cinfo, int n,
 			 const colloid_state_t * state0, wall_t * wall,
 			 double dh);
+int colloids_init_rsa(pe_t * pe, cs_t * cs, colloids_info_t * cinfo, int np,
+		      const colloid_state_t * s0, wall_t * wall, double dh,
+		      int seed, int nrelax);
 
 #endif
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2014-2022 The University of Edinburgh
+ *  (c) 2014-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -41,6 +41,7 @@
 
 #include "bbl.h"
 #include "build.h"
+#include "brownian.h"
 
 int lubrication_init(pe_t * pe, cs_t * cs, rt_t * rt, interact_t * inter);
 int pair_ss_cut_init(pe_t * pe, cs_t * cs, rt_t * rt, interact_t * inter);
@@ -56,6 +57,9 @@ int wall_ss_cut_init(pe_t * pe, cs_t * cs, rt_t * rt, wall_t * wall,
 int colloids_rt_dynamics(cs_t * cs, colloids_info_t * cinfo, wall_t * wall,
 			 map_t * map, const lb_model_t * model);
 int colloids_rt_gravity(pe_t * pe, rt_t * rt, colloids_info_t * cinfo);
+int colloids_rt_brownian(pe_t * pe, rt_t * rt, cs_t * cs,
+			 colloids_info_t * cinfo, interact_t * interact,
+			 map_t * map);
 int colloids_rt_init_few(pe_t * pe, rt_t * rt, colloids_info_t * cinfo, int nc);
 int colloids_rt_init_from_file(pe_t * pe, rt_t * rt, colloids_info_t * cinfo,
 			       colloid_io_t * cio);
@@ -165,8 +169,9 @@ int colloids_init_rt(pe_t * pe, rt_t * rt, cs_t * cs, colloids_info_t ** pinfo,
   colloids_info_map_init(*pinfo);
   colloids_halo_state(*pinfo);
 
-  colloids_rt_dynamics(cs, *pinfo, wall, map, model);
   colloids_rt_gravity(pe, rt, *pinfo);
+  colloids_rt_brownian(pe, rt, cs, *pinfo, *interact, map);
+  colloids_rt_dynamics(cs, *pinfo, wall, map, model);
 
   /* Set the update frequency and report (non-default values) */
 
@@ -335,7 +340,10 @@ int colloids_rt_init_random(pe_t * pe, cs_t * cs, rt_t * rt, wall_t * wall,
 			    colloids_info_t * cinfo) {
 
   int nc;
+  int seed = 13;
+  int nrelax = 1000;
   double dh = 0.0;
+  char method[BUFSIZ] = "simple";
   colloid_state_t * state0 = NULL;
 
   assert(pe);
@@ -349,8 +357,23 @@ int colloids_rt_init_random(pe_t * pe, cs_t * cs, rt_t * rt, wall_t * wall,
 
   rt_int_parameter(rt, "colloid_random_no", &nc);
   rt_double_parameter(rt, "colloid_random_dh", &dh);
+  rt_string_parameter(rt, "colloid_random_method", method, BUFSIZ);
 
-  colloids_init_random(pe, cs, cinfo, nc, state0, wall, dh);
+  if (strcmp(method, "simple") == 0) {
+    colloids_init_random(pe, cs, cinfo, nc, state0, wall, dh);
+  }
+  else if (strcmp(method, "rsa") == 0) {
+    rt_int_parameter(rt, "colloid_random_seed", &seed);
+    rt_int_parameter(rt, "colloid_random_nrelax", &nrelax);
+    if (seed <= 0) pe_fatal(pe, "colloid_random_seed must be > 0\n");
+    if (nrelax < 0) pe_fatal(pe, "colloid_random_nrelax must be >= 0\n");
+    pe_info(pe, "Random sequential addition seed %d nrelax %d\n",
+	    seed, nrelax);
+    colloids_init_rsa(pe, cs, cinfo, nc, state0, wall, dh, seed, nrelax);
+  }
+  else {
+    pe_fatal(pe, "colloid_random_method not recognised: %s\n", method);
+  }
 
   pe_info(pe, "Requested   %d colloid%s at random\n", nc, (nc > 1) ? "s" : "");
   pe_info(pe, "Colloid  radius a0 = %le\n", state0->a0);
@@ -578,6 +601,66 @@ int colloids_rt_gravity(pe_t * pe, rt_t * rt, colloids_info_t * cinfo) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  colloids_rt_brownian
+ *
+ *  Optional Brownian dynamics (no fluid) to relax the initial colloid
+ *  configuration before the map is built, e.g.,
+ *
+ *    colloid_brownian_nstep    100
+ *    colloid_brownian_method   no_inertia  [or ermak_buckholz]
+ *    colloid_brownian_dt       1.0
+ *
+ *  Each colloid requires a non-zero random number state (rng).
+ *
+ *****************************************************************************/
+
+int colloids_rt_brownian(pe_t * pe, rt_t * rt, cs_t * cs,
+			 colloids_info_t * cinfo, interact_t * interact,
+			 map_t * map) {
+  int nc = 0;
+  int nstep = 0;
+  char method[BUFSIZ] = "no_inertia";
+  brownian_options_t opts = brownian_options_default();
+  brownian_t * bd = NULL;
+
+  assert(pe);
+  assert(rt);
+  assert(cinfo);
+  assert(interact);
+
+  colloids_info_ntotal(cinfo, &nc);
+  if (nc == 0) return 0;
+
+  rt_int_parameter(rt, "colloid_brownian_nstep", &nstep);
+  if (nstep <= 0) return 0;
+
+  rt_string_parameter(rt, "colloid_brownian_method", method, BUFSIZ);
+  rt_double_parameter(rt, "colloid_brownian_dt", &opts.dt);
+
+  if (strcmp(method, "no_inertia") == 0) {
+    opts.method = BROWNIAN_NO_INERTIA;
+  }
+  else if (strcmp(method, "ermak_buckholz") == 0) {
+    opts.method = BROWNIAN_ERMAK_BUCKHOLZ;
+  }
+  else {
+    pe_fatal(pe, "colloid_brownian_method %s not recognised\n", method);
+  }
+
+  brownian_create(pe, cs, &opts, &bd);
+
+  pe_info(pe, "\n");
+  pe_info(pe, "Brownian dynamics steps:      %d\n", nstep);
+  brownian_info(bd);
+
+  brownian_run(bd, cinfo, interact, map, nstep);
+  brownian_free(bd);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  colloids_rt_cell_list_checks
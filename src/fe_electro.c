@@ -84,7 +84,9 @@ static  __constant__ fe_vt_t fe_electro_dvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  NULL,
   (fe_stress_v_ft)  NULL,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 /*****************************************************************************
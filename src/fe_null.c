@@ -36,7 +36,9 @@ static fe_vt_t fe_null_hvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_null_str_v,
   (fe_stress_v_ft)  fe_null_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 static  __constant__ fe_vt_t fe_null_dvt = {
@@ -53,7 +55,9 @@ static  __constant__ fe_vt_t fe_null_dvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_null_str_v,
   (fe_stress_v_ft)  fe_null_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 /****************************************************************************
@@ -17,7 +17,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  and Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2021 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Shan Chen (shan.chen@epfl.ch)
@@ -54,7 +54,9 @@ static fe_vt_t fe_ternary_hvt = {
     (fe_htensor_v_ft) NULL,             /* Not reelvant */
     (fe_stress_v_ft)  fe_ternary_str_v, /* Total stress (vectorised version) */
     (fe_stress_v_ft)  fe_ternary_str_v, /* Symmetric part (vectorised) */
-    (fe_stress_v_ft)  NULL              /* Antisymmetric part (not used) */
+    (fe_stress_v_ft)  NULL,             /* Antisymmetric part (not used) */
+    (fe_fed_v_ft)     fe_ternary_fed_v, /* Vectorised free energy density */
+    (fe_mu_v_ft)      fe_ternary_mu_v   /* Vectorised chemical potential */
 };
 
 static __constant__ fe_vt_t fe_ternary_dvt = {
@@ -71,7 +73,9 @@ static __constant__ fe_vt_t fe_ternary_dvt = {
     (fe_htensor_v_ft) NULL,             /* Not reelvant */
     (fe_stress_v_ft)  fe_ternary_str_v, /* Total stress (vectorised version) */
     (fe_stress_v_ft)  fe_ternary_str_v, /* Symmetric part (vectorised) */
-    (fe_stress_v_ft)  NULL              /* Antisymmetric part (not used) */
+    (fe_stress_v_ft)  NULL,             /* Antisymmetric part (not used) */
+    (fe_fed_v_ft)     fe_ternary_fed_v, /* Vectorised free energy density */
+    (fe_mu_v_ft)      fe_ternary_mu_v   /* Vectorised chemical potential */
 };
 
 static __constant__ fe_ternary_param_t const_param;
@@ -166,6 +170,7 @@ __host__ int fe_ternary_free(fe_ternary_t * fe) {
   tdpGetDeviceCount(&ndevice);
   if (ndevice > 0) tdpAssert(tdpFree(fe->target));
     
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
     
@@ -263,8 +268,11 @@ __host__ int fe_ternary_param_set(fe_ternary_t * fe, fe_ternary_param_t vals) {
 
   *fe->param = vals;
 
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
-		    sizeof(fe_ternary_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&fe->commit, "fe_ternary.c:const_param",
+			   fe->param, sizeof(fe_ternary_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_ternary_param_t), 0, tdpMemcpyHostToDevice);
+  }
   return 0;
 }
 
@@ -694,28 +702,252 @@ __host__ __device__ int fe_ternary_str(fe_ternary_t * fe, int index,
     return 0;
 }
 
+/*****************************************************************************
+ *
+ *  fe_ternary_fed_v
+ *
+ *  Free energy density (vectorised version). See fe_ternary_fed().
+ *
+ *****************************************************************************/
+
+__host__ __device__ void fe_ternary_fed_v(fe_ternary_t * fe, int index,
+					  double fed[NSIMDVL]) {
+  int ia;
+  int iv;
+  double phi[NSIMDVL];
+  double psi[NSIMDVL];
+  double grad[2][3][NSIMDVL];
+  double kappa1, kappa2, kappa3, alpha2;
+
+  assert(fe);
+
+  kappa1 = fe->param->kappa1;
+  kappa2 = fe->param->kappa2;
+  kappa3 = fe->param->kappa3;
+  alpha2 = fe->param->alpha*fe->param->alpha;
+
+  for_simd_v(iv, NSIMDVL) {
+    int n = index + iv;
+    phi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PHI)];
+    psi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PSI)];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      int n = index + iv;
+      grad[FE_PHI][ia][iv] =
+	fe->dphi->grad[addr_rank2(fe->dphi->nsite, 2, 3, n, FE_PHI, ia)];
+      grad[FE_PSI][ia][iv] =
+	fe->dphi->grad[addr_rank2(fe->dphi->nsite, 2, 3, n, FE_PSI, ia)];
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+
+    double rho = 1.0;
+    double drho = 0.0;
+    double d3, dsum;
+    double s1, s2, fe1, fe2;
+
+    dsum = 0.0;
+    for (ia = 0; ia < 3; ia++) {
+      d3 = drho + grad[FE_PHI][ia][iv] - grad[FE_PSI][ia][iv];
+      dsum += d3*d3;
+    }
+
+    s1  = rho + phi[iv] - psi[iv];
+    s2  = 2.0 + psi[iv] - rho - phi[iv];
+    fe1 = 0.03125*kappa1*s1*s1*s2*s2 + 0.125*alpha2*kappa1*dsum;
+
+    dsum = 0.0;
+    for (ia = 0; ia < 3; ia++) {
+      d3 = drho - grad[FE_PHI][ia][iv] - grad[FE_PSI][ia][iv];
+      dsum += d3*d3;
+    }
+
+    s1  = rho - phi[iv] - psi[iv];
+    s2  = 2.0 + psi[iv] - rho + phi[iv];
+    fe2 = 0.03125*kappa2*s1*s1*s2*s2 + 0.125*alpha2*kappa2*dsum;
+
+    s1 = 0.5*kappa3*psi[iv]*psi[iv]*(1.0 - psi[iv])*(1.0 - psi[iv]);
+    s2 = 0.5*alpha2*kappa3*(grad[FE_PSI][X][iv]*grad[FE_PSI][X][iv]
+			    + grad[FE_PSI][Y][iv]*grad[FE_PSI][Y][iv]
+			    + grad[FE_PSI][Z][iv]*grad[FE_PSI][Z][iv]);
+
+    fed[iv] = fe1 + fe2 + s1 + s2;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_ternary_mu_v
+ *
+ *  Chemical potentials (vectorised version). See fe_ternary_mu().
+ *  mu[FE_RHO] is also computed, so mu must have three rows.
+ *
+ *****************************************************************************/
+
+__host__ __device__ void fe_ternary_mu_v(fe_ternary_t * fe, int index,
+					 double mu[][NSIMDVL]) {
+  int iv;
+  double kappa1, kappa2, kappa3, alpha2;
+  double krhorho, kphipsi, kpsipsi;
+
+  assert(fe);
+  assert(mu);
+
+  kappa1 = fe->param->kappa1;
+  kappa2 = fe->param->kappa2;
+  kappa3 = fe->param->kappa3;
+  alpha2 = fe->param->alpha*fe->param->alpha;
+
+  krhorho = 0.25*alpha2*(kappa1 + kappa2);
+  kphipsi = 0.25*alpha2*(kappa2 - kappa1);
+  kpsipsi = 0.25*alpha2*(kappa1 + kappa2 + 4.0*kappa3);
+
+  for_simd_v(iv, NSIMDVL) {
+
+    int n = index + iv;
+    double rho = 1.0;
+    double delsq_rho = 0.0;
+    double phi = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PHI)];
+    double psi = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PSI)];
+    double dphi = fe->dphi->delsq[addr_rank1(fe->dphi->nsite, 2, n, FE_PHI)];
+    double dpsi = fe->dphi->delsq[addr_rank1(fe->dphi->nsite, 2, n, FE_PSI)];
+
+    /* The bulk terms are the same for each of mu_phi, mu_psi, mu_rho */
+    double s1 = (rho + phi - psi)*(rho + phi - psi - 2.0)*(rho + phi - psi - 1.0);
+    double s2 = (rho - phi - psi)*(rho - phi - psi - 2.0)*(rho - phi - psi - 1.0);
+
+    mu[FE_PHI][iv] = 0.125*kappa1*s1 - 0.125*kappa2*s2
+                   + kphipsi*(delsq_rho - dpsi) - krhorho*dphi;
+
+    mu[FE_PSI][iv] = -0.125*kappa1*s1 - 0.125*kappa2*s2
+                   + kappa3*psi*(psi - 1.0)*(2.0*psi - 1.0)
+                   + krhorho*delsq_rho - kphipsi*dphi
+                   - kpsipsi*dpsi;
+
+    mu[FE_RHO][iv] = 0.125*kappa1*s1 - 0.125*kappa2*s2
+                   + krhorho*(dpsi - dphi) + kphipsi*delsq_rho;
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  fe_ternary_str_v
  *
- *  Stress (vectorised version) Currently a patch-up.
+ *  Stress (vectorised version). See fe_ternary_str(). Terms in the
+ *  gradient of rho, which is uniform, are omitted.
  *
  *****************************************************************************/
 
 __host__ __device__ int fe_ternary_str_v(fe_ternary_t * fe, int index,
 					 double s[3][3][NSIMDVL]) {
-
   int ia, ib;
   int iv;
-  double s1[3][3];
-    
+  double phi[NSIMDVL];
+  double psi[NSIMDVL];
+  double delsq[2][NSIMDVL];
+  double dphi[3][NSIMDVL];
+  double dpsi[3][NSIMDVL];
+  double kappa1, kappa2, kappa3, alpha2;
+  double krhorho, kphiphi, kpsipsi;
+  double krhophi, kphipsi;
+  KRONECKER_DELTA_CHAR(d);
+
   assert(fe);
-    
-  for (iv = 0; iv < NSIMDVL; iv++) {
-    fe_ternary_str(fe, index + iv, s1);
+
+  kappa1 = fe->param->kappa1;
+  kappa2 = fe->param->kappa2;
+  kappa3 = fe->param->kappa3;
+  alpha2 = fe->param->alpha*fe->param->alpha;
+
+  krhorho = 0.25*alpha2*(kappa1 + kappa2);
+  kphiphi = krhorho;
+  kpsipsi = 0.25*alpha2*(kappa1 + kappa2 + 4.0*kappa3);
+  krhophi = 0.25*alpha2*(kappa1 - kappa2);
+  kphipsi = - krhophi;
+
+  for_simd_v(iv, NSIMDVL) {
+    int n = index + iv;
+    phi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PHI)];
+    psi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, n, FE_PSI)];
+    delsq[FE_PHI][iv] =
+      fe->dphi->delsq[addr_rank1(fe->dphi->nsite, 2, n, FE_PHI)];
+    delsq[FE_PSI][iv] =
+      fe->dphi->delsq[addr_rank1(fe->dphi->nsite, 2, n, FE_PSI)];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      int n = index + iv;
+      dphi[ia][iv] =
+	fe->dphi->grad[addr_rank2(fe->dphi->nsite, 2, 3, n, FE_PHI, ia)];
+      dpsi[ia][iv] =
+	fe->dphi->grad[addr_rank2(fe->dphi->nsite, 2, 3, n, FE_PSI, ia)];
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+
+    double rho = 1.0;
+    double rho2 = rho*rho;
+    double phi2 = phi[iv]*phi[iv];
+    double psi2 = psi[iv]*psi[iv];
+    double p0, p1, p2, p3, p4;
+    double dphi2, dpsi2, dphidpsi;
+
+    /* Bulk isotropic term p0 (with 4 pieces) */
+
+    p1 = (kappa1 + kappa2)*
+      (0.09375*(rho2*rho2 + phi2*phi2)
+       + 0.5625*(rho2*phi2 + rho2*psi2 + phi2*psi2)
+       - 0.3750*rho*psi[iv]*(rho2 + psi2)
+       + 0.75*(rho2*psi[iv]  - rho*phi2 - rho*psi2 + phi2*psi[iv])
+       - 0.25*rho2*rho + 0.125*rho2 + 0.125*phi2 - 0.25*rho*psi[iv]
+       - 1.125*rho*phi2*psi[iv]);
+
+    p2 = (kappa1 - kappa2)*
+      (0.375*(rho2*rho*phi[iv] + rho*phi2*phi[iv]
+	      - phi2*phi[iv]*psi[iv] - phi[iv]*psi2*psi[iv])
+       -0.25*phi2*phi[iv] - 0.75*(rho2*phi[iv] + phi[iv]*psi2)
+       + 0.25*(rho*phi[iv] - phi[iv]*psi[iv])
+       + 1.125*rho*phi[iv]*psi2 - 1.125*rho2*phi[iv]*psi[iv]
+       + 1.5*rho*phi[iv]*psi[iv]);
+
+    p3 = 0.25*(kappa1 + kappa2 - 8.0*kappa3)*psi2*psi[iv];
+    p4 = (kappa1 + kappa2 + 16.0*kappa3)*(0.09375*psi2 + 0.125)*psi2;
+
+    p0 = p1 + p2 + p3 + p4;
+
+    /* Gradient terms in d_ab (those in rho vanish) */
+
+    dphi2    = dphi[X][iv]*dphi[X][iv] + dphi[Y][iv]*dphi[Y][iv]
+             + dphi[Z][iv]*dphi[Z][iv];
+    dpsi2    = dpsi[X][iv]*dpsi[X][iv] + dpsi[Y][iv]*dpsi[Y][iv]
+             + dpsi[Z][iv]*dpsi[Z][iv];
+    dphidpsi = dphi[X][iv]*dpsi[X][iv] + dphi[Y][iv]*dpsi[Y][iv]
+             + dphi[Z][iv]*dpsi[Z][iv];
+
+    p1 = 0.5*dphi2 + phi[iv]*delsq[FE_PHI][iv];
+    p2 = 0.5*dpsi2 + psi[iv]*delsq[FE_PSI][iv];
+    p3 = rho*delsq[FE_PHI][iv];
+    p4 = rho*delsq[FE_PSI][iv];
+
     for (ia = 0; ia < 3; ia++) {
       for (ib = 0; ib < 3; ib++) {
-	s[ia][ib][iv] = s1[ia][ib];
+	s[ia][ib][iv] = p0*d[ia][ib]
+	  + kphiphi*(dphi[ia][iv]*dphi[ib][iv] - p1*d[ia][ib])
+	  + kpsipsi*(dpsi[ia][iv]*dpsi[ib][iv] - p2*d[ia][ib])
+	  - krhophi*p3*d[ia][ib]
+	  + krhorho*p4*d[ia][ib]
+	  + kphipsi*(dphi[ia][iv]*dpsi[ib][iv] + dpsi[ia][iv]*dphi[ib][iv]
+		     - (dphidpsi + phi[iv]*delsq[FE_PSI][iv]
+			+ psi[iv]*delsq[FE_PHI][iv])*d[ia][ib]);
       }
     }
   }
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  and Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2021 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Shan Chen (shan.chen@epfl.ch)
@@ -20,6 +20,7 @@
 #include "free_energy.h"
 #include "field.h"
 #include "field_grad.h"
+#include "util_commit.h"
 
 typedef struct fe_ternary_s fe_ternary_t;
 typedef struct fe_ternary_param_s fe_ternary_param_t;
@@ -41,6 +42,7 @@ struct fe_ternary_s {
   fe_ternary_param_t * param;       /* Parameters */
   field_t * phi;                    /* Single field with {phi,psi} */
   field_grad_t * dphi;              /* gradients thereof */
+  util_commit_t commit;             /* Parameters last sent to target */
   fe_ternary_t * target;            /* Device copy */
 };
 
@@ -66,5 +68,9 @@ __host__ __device__ int fe_ternary_str(fe_ternary_t * fe, int index,
 				       double s[3][3]);
 __host__ __device__ int fe_ternary_str_v(fe_ternary_t * fe, int index,
 					 double s[3][3][NSIMDVL]);
+__host__ __device__ void fe_ternary_fed_v(fe_ternary_t * fe, int index,
+					  double fed[NSIMDVL]);
+__host__ __device__ void fe_ternary_mu_v(fe_ternary_t * fe, int index,
+					 double mu[][NSIMDVL]);
 
 #endif
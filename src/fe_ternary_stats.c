@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2021 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -225,27 +225,29 @@ __global__ void fe_ternary_bulk_kernel(kernel_ctxt_t * ktx, fe_ternary_t * fe,
   assert(fe);
   assert(febulk);
 
-  kiterations = kernel_iterations(ktx);
+  kiterations = kernel_vector_iterations(ktx);
 
   tid = threadIdx.x;
   fepart[tid] = 0.0;
 
-  for_simt_parallel(kindex, kiterations, 1) {
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
 
-    int ic, jc, kc, index;
-    int status;
-    double fed;
+    int iv;
+    int index;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int maskv[NSIMDVL];
+    double fed[NSIMDVL];
 
-    ic = kernel_coords_ic(ktx, kindex);
-    jc = kernel_coords_jc(ktx, kindex);
-    kc = kernel_coords_kc(ktx, kindex);
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
 
-    index = kernel_coords_index(ktx, ic, jc, kc);
-    map_status(map, index, &status);
+    index = kernel_baseindex(ktx, kindex);
+    fe_ternary_fed_v(fe, index, fed);
 
-    if (status == MAP_FLUID) {
-      fe_ternary_fed(fe, index, &fed);
-      fepart[tid] += fed;
+    for (iv = 0; iv < NSIMDVL; iv++) {
+      int status = MAP_BOUNDARY;
+      map_status(map, index + iv, &status);
+      if (maskv[iv] && status == MAP_FLUID) fepart[tid] += fed[iv];
     }
   }
 
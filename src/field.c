@@ -14,7 +14,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -337,6 +337,7 @@ __host__ int field_init_io_info(field_t * obj, int grid[3], int form_in,
   io_info_write_set(obj->info, IO_FORMAT_ASCII, field_write_ascii);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, field_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, field_read_ascii);
+  io_info_read_buf_set(obj->info, (io_buf_cb_ft) field_read_buf);
 
   /* ASCII format size is 23 bytes per element plus a '\n' */
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY, obj->nf*sizeof(double));
@@ -10,7 +10,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2009-2019 The University of Edinburgh
+ *  (c) 2009-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -50,6 +50,8 @@ typedef int (* fe_htensor_ft)(fe_t * fe, int index, double h[3][3]);
 /* Vectorised versions */
 typedef void (* fe_htensor_v_ft)(fe_t * fe, int index,double h[3][3][NSIMDVL]);
 typedef void (* fe_stress_v_ft)(fe_t * fe, int index, double s[3][3][NSIMDVL]);
+typedef void (* fe_fed_v_ft)(fe_t * fe, int index, double fed[NSIMDVL]);
+typedef void (* fe_mu_v_ft)(fe_t * fe, int index, double mu[][NSIMDVL]);
 
 struct fe_vt_s {
   /* Order is important: actual tables must appear thus... */
@@ -67,6 +69,8 @@ struct fe_vt_s {
   fe_stress_v_ft stress_v;      /* Vectorised stress (total) version */
   fe_stress_v_ft str_symm_v;    /* Symmetric part */
   fe_stress_v_ft str_anti_v;    /* Antisymmetric part */
+  fe_fed_v_ft fed_v;            /* Vectorised free energy density */
+  fe_mu_v_ft mu_v;              /* Vectorised chemical potential(s) */
 };
 
 struct fe_s {
@@ -122,6 +126,10 @@ struct fe_s {
  *      potential(s), and the stress, respectively. The index argument
  *      is the single location on the lattice.
  *
+ *      Vectorised versions (e.g., fed_v, mu_v) compute the same
+ *      quantities at the NSIMDVL consecutive sites starting at index;
+ *      mu_v returns mu[n][iv] for order parameter n and site iv.
+ *
  *   5. Define a static vtable structure and add the functions from
  *      stage4 to the vtable in the appropriate positions. If
  *      functions are not relevant, a NULL entry is acceptable.
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -31,6 +31,8 @@ static int hydro_u_read_ascii(FILE * fp, int index, void * self);
 
 static __global__
 void hydro_field_set(hydro_t * hydro, double * field, double, double, double);
+static __global__
+void hydro_field_axpy(hydro_t * hydro, double a, const double * x, double * y);
 
 __global__ void hydro_accumulate_kernel(kernel_ctxt_t * ktx, hydro_t * hydro,
                                         double fnet[3]);
@@ -297,6 +299,40 @@ __host__ int hydro_u_zero(hydro_t * obj, const double uzero[NHDIM]) {
 }
 
 
+/*****************************************************************************
+ *
+ *  hydro_u_accumulate
+ *
+ *  obj->u += a*src->u at all sites (e.g., for a time average).
+ *  The two objects must have the same size.
+ *
+ *****************************************************************************/
+
+__host__ int hydro_u_accumulate(hydro_t * obj, double a, const hydro_t * src) {
+
+  dim3 nblk, ntpb;
+  double * u = NULL;
+  double * usrc = NULL;
+
+  assert(obj);
+  assert(src);
+  assert(obj->nsite == src->nsite);
+
+  tdpAssert(tdpMemcpy(&u, &obj->u->target->data, sizeof(double *),
+		      tdpMemcpyDeviceToHost));
+  tdpAssert(tdpMemcpy(&usrc, &src->u->target->data, sizeof(double *),
+		      tdpMemcpyDeviceToHost));
+
+  kernel_launch_param(obj->nsite, &nblk, &ntpb);
+  tdpLaunchKernel(hydro_field_axpy, nblk, ntpb, 0, 0,
+		  obj->target, a, usrc, u);
+
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  hydro_f_zero
@@ -396,6 +432,33 @@ void hydro_field_set(hydro_t * hydro, double * field, double zx, double zy,
   return;
 }
 
+/*****************************************************************************
+ *
+ *  hydro_field_axpy
+ *
+ *****************************************************************************/
+
+static __global__
+void hydro_field_axpy(hydro_t * hydro, double a, const double * x,
+		      double * y) {
+  int kindex;
+
+  assert(hydro);
+  assert(x);
+  assert(y);
+
+  for_simt_parallel(kindex, hydro->nsite, 1) {
+    y[addr_rank1(hydro->nsite, NHDIM, kindex, X)]
+      += a*x[addr_rank1(hydro->nsite, NHDIM, kindex, X)];
+    y[addr_rank1(hydro->nsite, NHDIM, kindex, Y)]
+      += a*x[addr_rank1(hydro->nsite, NHDIM, kindex, Y)];
+    y[addr_rank1(hydro->nsite, NHDIM, kindex, Z)]
+      += a*x[addr_rank1(hydro->nsite, NHDIM, kindex, Z)];
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  hydro_lees_edwards
@@ -866,7 +929,6 @@ __host__ int hydro_correct_momentum(hydro_t * hydro) {
   cs_ltot(hydro->cs, ltot);
   rv = 1.0/(ltot[X]*ltot[Y]*ltot[Z]);
 
-  tdpAssert(tdpDeviceSynchronize());
   tdpAssert(tdpMemcpy(fnet, fnetd, 3*sizeof(double), tdpMemcpyDeviceToHost));
 
   /* Compute global correction */
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -63,6 +63,7 @@ __host__ int hydro_lees_edwards(hydro_t * obj);
 __host__ int hydro_correct_momentum(hydro_t * obj);
 __host__ int hydro_f_zero(hydro_t * obj, const double fzero[3]);
 __host__ int hydro_u_zero(hydro_t * obj, const double uzero[3]);
+__host__ int hydro_u_accumulate(hydro_t * obj, double a, const hydro_t * src);
 __host__ int hydro_rho0(hydro_t * hydro, double rho0);
 
 __host__ int hydro_io_write(hydro_t * hydro, int timestep, io_event_t * event);
@@ -17,7 +17,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2020 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -52,8 +52,16 @@ struct interact_s {
   void * abstr[INTERACT_MAX];        /* Abstract interaction types */
   compute_ft compute[INTERACT_MAX];  /* Corresponding compute functions */
   stat_ft stats[INTERACT_MAX];       /* Statisitics functions */
+
+  int nhash;                         /* Size of bond lookup table */
+  colloid_t ** hash;                 /* Colloid index -> colloid lookup */
 };
 
+static int interact_bond_hash_build(interact_t * obj,
+				    colloids_info_t * cinfo);
+static colloid_t * interact_bond_hash_find(interact_t * obj, int index,
+					   const double r[3]);
+
 /*****************************************************************************
  *
  *  interact_create
@@ -90,6 +98,7 @@ void interact_free(interact_t * obj) {
 
   assert(obj);
 
+  free(obj->hash);
   free(obj);
 
   return;
@@ -189,6 +198,41 @@ int interact_compute(interact_t * interact, colloids_info_t * cinfo,
 
   colloids_info_ntotal(cinfo, &nc);
 
+  if (nc > 0) {
+    interact_forces(interact, cinfo, map, psi, ewald);
+
+    if (is_statistics_step()) {
+
+      pe_info(interact->pe, "\nParticle statistics:\n");
+
+      interact_stats(interact, cinfo);
+      pe_info(interact->pe, "\n");
+      stats_colloid_velocity_minmax(cinfo);
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  interact_forces
+ *
+ *  As interact_compute(), but without the statistics; this may be
+ *  called more than once per time step (e.g., Brownian dynamics).
+ *
+ *****************************************************************************/
+
+int interact_forces(interact_t * interact, colloids_info_t * cinfo,
+		    map_t * map, psi_t * psi, ewald_t * ewald) {
+
+  int nc;
+
+  assert(interact);
+  assert(cinfo);
+
+  colloids_info_ntotal(cinfo, &nc);
+
   if (nc > 0) {
     colloids_update_forces_zero(cinfo);
     colloids_update_forces_external(cinfo, psi);
@@ -203,14 +247,6 @@ int interact_compute(interact_t * interact, colloids_info_t * cinfo,
       if (ewald) ewald_sum(ewald);
     }
 
-    if (is_statistics_step()) {
-
-      pe_info(interact->pe, "\nParticle statistics:\n");
-
-      interact_stats(interact, cinfo);
-      pe_info(interact->pe, "\n");
-      stats_colloid_velocity_minmax(cinfo);
-    }
     colloids_update_forces_ext(cinfo);
   }
 
@@ -647,17 +683,22 @@ int interact_find_bonds(interact_t * obj, colloids_info_t * cinfo) {
  *  interact_find_bonds_all
  *
  *  Examine the local colloids and match any bonded interactions
- *  in terms of pointers.
+ *  in terms of pointers. The resulting local bonds and angles are
+ *  then available as contiguous lists (colloids_info_bond_lists_build()).
  *
  *  Include nextra cells in each direction into the halo region.
  *
+ *  Partners are found by index via a lookup table, rather than by
+ *  search of neighbouring cells, so the cost is proportional to the
+ *  number of bonds. If there is more than one periodic image of a
+ *  partner, the nearest is taken.
+ *
  *****************************************************************************/
 
 int interact_find_bonds_all(interact_t * obj, colloids_info_t * cinfo,
 			    int nextra) {
 
-  int ic1, jc1, kc1, ic2, jc2, kc2;
-  int di[2], dj[2], dk[2];
+  int ic1, jc1, kc1;
   int n1, n2;
   int ncell[3];
 
@@ -671,44 +712,27 @@ int interact_find_bonds_all(interact_t * obj, colloids_info_t * cinfo,
   assert(cinfo);
 
   colloids_info_ncell(cinfo, ncell);
+  interact_bond_hash_build(obj, cinfo);
 
   for (ic1 = 1 - nextra; ic1 <= ncell[X] + nextra; ic1++) {
-    colloids_info_climits(cinfo, X, ic1, di); 
     for (jc1 = 1 - nextra; jc1 <= ncell[Y] + nextra; jc1++) {
-      colloids_info_climits(cinfo, Y, jc1, dj);
       for (kc1 = 1 - nextra; kc1 <= ncell[Z] + nextra; kc1++) {
-        colloids_info_climits(cinfo, Z, kc1, dk);
 
         colloids_info_cell_list_head(cinfo, ic1, jc1, kc1, &pc1);
         for (; pc1; pc1 = pc1->next) {
 
-	  if (pc1->s.nbonds == 0) continue;
-
-	  for (ic2 = di[0]; ic2 <= di[1]; ic2++) {
-	    for (jc2 = dj[0]; jc2 <= dj[1]; jc2++) {
-	      for (kc2 = dk[0]; kc2 <= dk[1]; kc2++) {
-   
-		colloids_info_cell_list_head(cinfo, ic2, jc2, kc2, &pc2);
-		for (; pc2; pc2 = pc2->next) {
-
-		  if (pc2->s.nbonds == 0) continue; 
-                  
-		  for (n1 = 0; n1 < pc1->s.nbonds; n1++) {
-		    if (pc1->s.bond[n1] == pc2->s.index) {
-		      nbondfound += 1;
-		      pc1->bonded[n1] = pc2;
-		      /* And bond is reciprocated */
-		      for (n2 = 0; n2 < pc2->s.nbonds; n2++) {
-			if (pc2->s.bond[n2] == pc1->s.index) {
-			  nbondpair += 1;
-			  pc2->bonded[n2] = pc1;
-			}
-		      }
-		    }
-		  }
-
-		  /* Cell list */
-	        }
+	  for (n1 = 0; n1 < pc1->s.nbonds; n1++) {
+
+	    pc2 = interact_bond_hash_find(obj, pc1->s.bond[n1], pc1->s.r);
+	    if (pc2 == NULL) continue;
+
+	    nbondfound += 1;
+	    pc1->bonded[n1] = pc2;
+	    /* And bond is reciprocated */
+	    for (n2 = 0; n2 < pc2->s.nbonds; n2++) {
+	      if (pc2->s.bond[n2] == pc1->s.index) {
+		nbondpair += 1;
+		pc2->bonded[n2] = pc1;
 	      }
 	    }
 	  }
@@ -722,9 +746,97 @@ int interact_find_bonds_all(interact_t * obj, colloids_info_t * cinfo,
     pe_fatal(obj->pe, "Find bonds: bond not reciprocated\n");
   }
 
+  colloids_info_bond_lists_build(cinfo);
+
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  interact_bond_hash_build
+ *
+ *  Open addressing table of all bonded colloids (including halo)
+ *  keyed on colloid index. A power of two at least twice the number
+ *  of entries.
+ *
+ *****************************************************************************/
+
+static int interact_bond_hash_build(interact_t * obj,
+				    colloids_info_t * cinfo) {
+  int nentry = 0;
+  int nhash = 1;
+  colloid_t * pc = NULL;
+
+  assert(obj);
+  assert(cinfo);
+
+  for (int n = 0; n < cinfo->ncells; n++) {
+    for (pc = cinfo->clist[n]; pc; pc = pc->next) {
+      if (pc->s.nbonds > 0) nentry += 1;
+    }
+  }
+
+  while (nhash < 2*nentry) nhash *= 2;
+
+  if (nhash > obj->nhash) {
+    free(obj->hash);
+    obj->hash = (colloid_t **) malloc(nhash*sizeof(colloid_t *));
+    assert(obj->hash);
+    if (obj->hash == NULL) pe_fatal(obj->pe, "malloc(bond hash) failed\n");
+    obj->nhash = nhash;
+  }
+
+  for (int n = 0; n < obj->nhash; n++) obj->hash[n] = NULL;
+
+  for (int n = 0; n < cinfo->ncells; n++) {
+    for (pc = cinfo->clist[n]; pc; pc = pc->next) {
+      unsigned int h = 2654435761u*((unsigned int) pc->s.index);
+      if (pc->s.nbonds == 0) continue;
+      h = h & (obj->nhash - 1);
+      while (obj->hash[h]) h = (h + 1) & (obj->nhash - 1);
+      obj->hash[h] = pc;
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  interact_bond_hash_find
+ *
+ *  Return the (nearest to r) bonded colloid with the given index,
+ *  or NULL if not present.
+ *
+ *****************************************************************************/
+
+static colloid_t * interact_bond_hash_find(interact_t * obj, int index,
+					   const double r[3]) {
+  unsigned int mask = obj->nhash - 1;
+  unsigned int h = 2654435761u*((unsigned int) index);
+  double r2min = DBL_MAX;
+  colloid_t * pc = NULL;
+
+  assert(obj);
+
+  if (obj->nhash == 0) return NULL;
+
+  for (h = h & mask; obj->hash[h]; h = (h + 1) & mask) {
+    colloid_t * pc2 = obj->hash[h];
+    if (pc2->s.index == index) {
+      double r12[3] = {pc2->s.r[X] - r[X], pc2->s.r[Y] - r[Y],
+		       pc2->s.r[Z] - r[Z]};
+      double r2 = r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z];
+      if (r2 < r2min) {
+	r2min = r2;
+	pc = pc2;
+      }
+    }
+  }
+
+  return pc;
+}
+
 /*****************************************************************************
  *
  *  interact_rcmax
@@ -6,7 +6,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2011-2020 The University of Edinburgh
+ *  (c) 2011-2023 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epc.ed.ac.uk)
  *
@@ -54,6 +54,8 @@ int interact_hc_set(interact_t * obj, interact_enum_t it, double hc);
 int interact_range_check(interact_t * obj, colloids_info_t * cinfo);
 int interact_compute(interact_t * interact, colloids_info_t * cinfo,
 		     map_t * map, psi_t * psi, ewald_t * ewald);
+int interact_forces(interact_t * interact, colloids_info_t * cinfo,
+		    map_t * map, psi_t * psi, ewald_t * ewald);
 int interact_pairwise(interact_t * interact, colloids_info_t * cinfo);
 int interact_wall(interact_t * interact, colloids_info_t * cinfo);
 int interact_bonds(interact_t * obj, colloids_info_t * cinfo);
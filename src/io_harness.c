@@ -16,11 +16,15 @@
  *  lattice Cartesian communicator. Each IO communicator group so
  *  defined then deals with its own file.
  *
+ *  A single-file binary read may be served by a collective MPI/IO
+ *  read if the object provides a buffer callback (see
+ *  io_info_read_buf_set()).
+ *
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2007-2022 The University of Edinburgh
+ *  (c) 2007-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -37,9 +41,12 @@
 #include "util_fopen.h"
 #include "leesedwards.h"
 #include "io_harness.h"
+#include "io_impl.h"
 
 static void io_set_group_filename(char *, const char *, io_info_t *);
 static long int io_file_offset(int, int, io_info_t *);
+static int io_read_data_mpio(io_info_t * obj, const char * filename,
+			     void * data);
 static int io_decomposition_create(pe_t * pe, cs_t * cs, const int grid[3],
 				   io_decomposition_t ** p);
 static int io_decomposition_free(io_decomposition_t *);
@@ -638,6 +645,25 @@ int io_info_read_set(io_info_t * obj, int format, io_rw_cb_ft f) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  io_info_read_buf_set
+ *
+ *  Per-site read from a binary record held in memory. If present,
+ *  single file binary input uses a collective read.
+ *
+ *****************************************************************************/
+
+int io_info_read_buf_set(io_info_t * obj, io_buf_cb_ft f) {
+
+  assert(obj);
+  assert(f);
+
+  obj->read_buf = f;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  io_info_write_set
@@ -1073,6 +1099,11 @@ int io_read_data(io_info_t * obj, const char * filename_stub, void * data) {
 
   if (obj->single_file_read) {
     snprintf(filename_io, FILENAME_MAX, "%s.%3.3d-%3.3d", filename_stub, 1, 1);
+
+    if (obj->read_buf && obj->processor_independent &&
+	obj->read_data == obj->read_binary) {
+      return io_read_data_mpio(obj, filename_io, data);
+    }
   }
 
   if (obj->io_comm->rank == 0) {
@@ -1128,6 +1159,96 @@ int io_read_data(io_info_t * obj, const char * filename_stub, void * data) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  io_read_data_mpio
+ *
+ *  The whole file (in serial order) is read collectively by all ranks,
+ *  each receiving its local block in one aggregated buffer which is
+ *  then unpacked site-by-site from memory.
+ *
+ *  The binary record of bytesize_binary is treated as bytes, so the
+ *  object's record may mix types (e.g., map status plus data).
+ *
+ *****************************************************************************/
+
+static int io_read_data_mpio(io_info_t * obj, const char * filename,
+			     void * data) {
+  int ifail = 0;
+  int iogrid[3] = {1, 1, 1};
+  io_options_t opts = io_options_with_iogrid(IO_MODE_MPIIO, IO_RECORD_BINARY,
+					     iogrid);
+  io_element_t element = {.datatype = MPI_CHAR,
+			  .datasize = sizeof(char),
+			  .count    = obj->bytesize_binary,
+			  .endian   = io_endianness()};
+  io_metadata_t meta = {0};
+  io_impl_t * io = NULL;
+
+  assert(obj);
+  assert(obj->read_buf);
+  assert(filename);
+  assert(data);
+
+  {
+    /* Check the file is present and is not short before the collective
+     * read (which would not otherwise detect a short file). */
+    int rank = -1;
+    int ntotal[3] = {0};
+    long int nbytes = -1;
+    long int nexpect = 0;
+    MPI_Comm comm = MPI_COMM_NULL;
+
+    cs_ntotal(obj->cs, ntotal);
+    cs_cart_comm(obj->cs, &comm);
+    MPI_Comm_rank(comm, &rank);
+
+    nexpect = (long int) ntotal[X]*ntotal[Y]*ntotal[Z]*obj->bytesize_binary;
+
+    if (rank == 0) {
+      FILE * fp = util_fopen(filename, "r");
+      if (fp != NULL) {
+	if (fseek(fp, 0, SEEK_END) == 0) nbytes = ftell(fp);
+	fclose(fp);
+      }
+    }
+    MPI_Bcast(&nbytes, 1, MPI_LONG, 0, comm);
+    if (nbytes < 0) pe_fatal(obj->pe, "Failed to open %s\n", filename);
+    if (nbytes < nexpect) {
+      pe_fatal(obj->pe, "File %s is too short (%ld bytes, expected %ld)\n",
+	       filename, nbytes, nexpect);
+    }
+  }
+
+  ifail = io_metadata_initialise(obj->cs, &opts, &element, &meta);
+  if (ifail != 0) pe_fatal(obj->pe, "Bad i/o decomposition for %s\n", filename);
+
+  ifail = io_impl_create(&meta, &io);
+  if (ifail != 0) pe_fatal(obj->pe, "i/o implementation for %s failed\n",
+			   filename);
+
+  ifail = io->impl->read(io, filename);
+  if (ifail != 0) pe_fatal(obj->pe, "Collective read of %s failed\n", filename);
+
+  /* Bulk unpack */
+  {
+    const io_aggregator_t * aggr = io->aggr;
+
+    for (int ib = 0; ib < cs_limits_size(aggr->lim); ib++) {
+      int ic = cs_limits_ic(aggr->lim, ib);
+      int jc = cs_limits_jc(aggr->lim, ib);
+      int kc = cs_limits_kc(aggr->lim, ib);
+      int index = cs_index(obj->cs, ic, jc, kc);
+      obj->read_buf(data, index, aggr->buf + ib*aggr->szelement);
+    }
+  }
+
+  io->impl->free(&io);
+  io_metadata_finalise(&meta);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  io_info_single_file_set
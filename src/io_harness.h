@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2007-2022 The University of Edinburgh
+ *  (c) 2007-2023 The University of Edinburgh
  *
  *  Contributin authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -37,6 +37,9 @@ typedef struct io_info_s io_info_t;
 /* Callback signature for lattice site I/O */
 typedef int (*io_rw_cb_ft)(FILE * fp, int index, void * self);
 
+/* Callback for lattice site read from a memory buffer (binary record) */
+typedef int (*io_buf_cb_ft)(void * self, int index, const char * buf);
+
 typedef struct io_decomposition_s io_decomposition_t;
 
 struct io_decomposition_s {
@@ -77,6 +80,7 @@ struct io_info_s {
   io_rw_cb_ft read_data;
   io_rw_cb_ft read_ascii;
   io_rw_cb_ft read_binary;
+  io_buf_cb_ft read_buf;             /* Optional: allows collective read */
 };
 
 __host__ int io_info_create(pe_t * pe, cs_t * cs, io_info_args_t * arg,
@@ -104,6 +108,7 @@ __host__ int io_info_format_in_set(io_info_t * obj, int form_in);
 __host__ int io_info_format_out_set(io_info_t * obj, int form_out); 
 
 __host__ int io_info_read_set(io_info_t * obj, int format, io_rw_cb_ft);
+__host__ int io_info_read_buf_set(io_info_t * obj, io_buf_cb_ft f);
 __host__ int io_info_write_set(io_info_t * obj, int format, io_rw_cb_ft);
 __host__ int io_write_data(io_info_t * obj, const char * filename_stub, void * data);
 __host__ int io_read_data(io_info_t * obj, const char * filename_stub, void * data);
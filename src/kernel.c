@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2016-2018 The University of Edinburgh
+ *  (c) 2016-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -18,6 +18,7 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "pe.h"
 #include "kernel.h"
@@ -46,35 +47,102 @@ struct kernel_param_s {
 static __device__   kernel_ctxt_t  static_ctxt;   
 static __constant__ kernel_param_t static_param;
 
-static __host__ int kernel_ctxt_commit(kernel_ctxt_t * ctxt, cs_t * cs,
-				       int nsimdvl,
-				       kernel_info_t lim);
+/* Cache of contexts.
+ * A context depends only on (cs, nsimdvl, limits), so the same handful
+ * of contexts is requested by the drivers at every time step. Contexts
+ * are retained and matched on their parameters, so a repeated request
+ * involves no allocation or copy to the target. Each cached entry has
+ * its own device copy, so there is no need to synchronise between a
+ * launch with one context and the creation of the next. */
+
+#define KERNEL_CTXT_CACHE_MAX 32
+
+typedef struct kernel_cache_s kernel_cache_t;
+
+struct kernel_cache_s {
+  int nref;                      /* Number of current users */
+  int stamp;                     /* Time of last request */
+  kernel_ctxt_t * ctxt;          /* Host context (NULL if unused) */
+};
+
+static int            cache_stamp_ = 0;
+static kernel_cache_t cache_[KERNEL_CTXT_CACHE_MAX];
+
+static __device__   kernel_ctxt_t  static_cache_ctxt[KERNEL_CTXT_CACHE_MAX];
+static __constant__ kernel_param_t static_cache_param[KERNEL_CTXT_CACHE_MAX];
+
+static __host__ int kernel_param_compute(cs_t * cs, int nsimdvl,
+					 kernel_info_t lim,
+					 kernel_param_t * param);
+static __host__ int kernel_ctxt_cache_entry(cs_t * cs, int ientry,
+					    kernel_param_t * param);
 
 /*****************************************************************************
  *
  *  kernel_ctxt_create
  *
+ *  A cached context is returned if one is available.
+ *
  *****************************************************************************/
 
 __host__ int kernel_ctxt_create(cs_t * cs, int nsimdvl, kernel_info_t info,
 				kernel_ctxt_t ** p) {
 
   int ndevice;
+  int n;
+  int ientry = -1;
   kernel_ctxt_t * obj = NULL;
+  kernel_param_t param = {0};
 
   assert(p);
   assert(cs);
+  assert(nsimdvl == 1 || nsimdvl == NSIMDVL);
+
+  kernel_param_compute(cs, nsimdvl, info, &param);
+
+  /* Existing entry? */
+
+  for (n = 0; n < KERNEL_CTXT_CACHE_MAX; n++) {
+    if (cache_[n].ctxt == NULL) continue;
+    if (memcmp(cache_[n].ctxt->param, &param, sizeof(kernel_param_t)) == 0) {
+      cache_[n].nref += 1;
+      cache_[n].stamp = ++cache_stamp_;
+      *p = cache_[n].ctxt;
+      return 0;
+    }
+  }
+
+  /* New entry: an empty slot, or else the least recently used
+   * entry not currently in use. */
+
+  for (n = 0; n < KERNEL_CTXT_CACHE_MAX; n++) {
+    if (cache_[n].ctxt == NULL) {
+      ientry = n;
+      break;
+    }
+    if (cache_[n].nref > 0) continue;
+    if (ientry < 0 || cache_[n].stamp < cache_[ientry].stamp) ientry = n;
+  }
+
+  if (ientry >= 0) {
+    kernel_ctxt_cache_entry(cs, ientry, &param);
+    *p = cache_[ientry].ctxt;
+    return 0;
+  }
+
+  /* Cache is full of contexts in use: a temporary context which
+   * uses the static device memory. */
 
   obj = (kernel_ctxt_t *) calloc(1, sizeof(kernel_ctxt_t));
   assert(obj);
   if (obj == NULL) pe_fatal(cs->pe, "calloc(kernel_ctxt_t) failed\n");
 
-  assert(nsimdvl == 1 || nsimdvl == NSIMDVL);
-
   obj->param = (kernel_param_t *) calloc(1, sizeof(kernel_param_t));
   assert(obj->param);
   if (obj->param == NULL) pe_fatal(cs->pe, "calloc(kernel_param_t) failed\n");
 
+  *obj->param = param;
+
   tdpGetDeviceCount(&ndevice);
 
   if (ndevice == 0) {
@@ -87,10 +155,10 @@ __host__ int kernel_ctxt_create(cs_t * cs, int nsimdvl, kernel_info_t info,
     tdpGetSymbolAddress((void **) &tmp, tdpSymbol(static_param));
     tdpAssert(tdpMemcpy(&obj->target->param, &tmp, sizeof(kernel_param_t *),
 			tdpMemcpyHostToDevice));
+    tdpMemcpyToSymbol(tdpSymbol(static_param), obj->param,
+		      sizeof(kernel_param_t), 0, tdpMemcpyHostToDevice);
   }
 
-  kernel_ctxt_commit(obj, cs, nsimdvl, info);
-
   *p = obj;
 
   return 0;
@@ -100,18 +168,83 @@ __host__ int kernel_ctxt_create(cs_t * cs, int nsimdvl, kernel_info_t info,
  *
  *  kernel_ctxt_free
  *
+ *  A cached context is only released; it remains available for reuse.
+ *
  *****************************************************************************/
 
 __host__ int kernel_ctxt_free(kernel_ctxt_t * obj) {
 
+  int n;
+
   assert(obj);
 
+  for (n = 0; n < KERNEL_CTXT_CACHE_MAX; n++) {
+    if (cache_[n].ctxt == obj) {
+      assert(cache_[n].nref > 0);
+      cache_[n].nref -= 1;
+      return 0;
+    }
+  }
+
   free(obj->param);
   free(obj);
 
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  kernel_ctxt_cache_clear
+ *
+ *  A "class" method. Release all cached contexts.
+ *
+ *****************************************************************************/
+
+__host__ int kernel_ctxt_cache_clear(void) {
+
+  int n;
+
+  for (n = 0; n < KERNEL_CTXT_CACHE_MAX; n++) {
+    kernel_ctxt_t * obj = cache_[n].ctxt;
+    if (obj == NULL) continue;
+    free(obj->param);
+    free(obj);
+    cache_[n].ctxt = NULL;
+    cache_[n].nref = 0;
+    cache_[n].stamp = 0;
+  }
+
+  cache_stamp_ = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_ctxt_cache_info
+ *
+ *  A "class" method. Number of cached contexts, and number in use.
+ *
+ *****************************************************************************/
+
+__host__ int kernel_ctxt_cache_info(int * nentry, int * ninuse) {
+
+  int n;
+
+  assert(nentry);
+  assert(ninuse);
+
+  *nentry = 0;
+  *ninuse = 0;
+
+  for (n = 0; n < KERNEL_CTXT_CACHE_MAX; n++) {
+    if (cache_[n].ctxt) *nentry += 1;
+    if (cache_[n].nref > 0) *ninuse += 1;
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  kernel_ctxt_launch_param
@@ -160,62 +293,119 @@ __host__ int kernel_launch_param(int iterations, dim3 * nblk, dim3 * ntpb) {
 
 /*****************************************************************************
  *
- *  kernel_ctxt_commit
+ *  kernel_ctxt_cache_entry
+ *
+ *  Set cache entry ientry to hold a context with the given parameters.
+ *  Storage is allocated on first use of the slot, and recycled
+ *  thereafter.
  *
  *****************************************************************************/
 
-static __host__ int kernel_ctxt_commit(kernel_ctxt_t * obj, cs_t * cs,
-				       int nsimdvl, kernel_info_t lim) {
-
+static __host__ int kernel_ctxt_cache_entry(cs_t * cs, int ientry,
+					    kernel_param_t * param) {
   int ndevice;
+  kernel_ctxt_t * obj = cache_[ientry].ctxt;
+
+  assert(cs);
+  assert(0 <= ientry && ientry < KERNEL_CTXT_CACHE_MAX);
+  assert(cache_[ientry].nref == 0);
+  assert(param);
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (obj == NULL) {
+
+    obj = (kernel_ctxt_t *) calloc(1, sizeof(kernel_ctxt_t));
+    assert(obj);
+    if (obj == NULL) pe_fatal(cs->pe, "calloc(kernel_ctxt_t) failed\n");
+
+    obj->param = (kernel_param_t *) calloc(1, sizeof(kernel_param_t));
+    assert(obj->param);
+    if (obj->param == NULL) pe_fatal(cs->pe, "calloc(kernel_param_t) failed\n");
+
+    if (ndevice == 0) {
+      obj->target = obj;
+    }
+    else {
+      kernel_ctxt_t * ctxt;
+      kernel_param_t * tmp;
+      /* Link to this entry's static device memory */
+      tdpGetSymbolAddress((void **) &ctxt, tdpSymbol(static_cache_ctxt));
+      tdpGetSymbolAddress((void **) &tmp, tdpSymbol(static_cache_param));
+      obj->target = ctxt + ientry;
+      tmp = tmp + ientry;
+      tdpAssert(tdpMemcpy(&obj->target->param, &tmp, sizeof(kernel_param_t *),
+			  tdpMemcpyHostToDevice));
+    }
+    cache_[ientry].ctxt = obj;
+  }
+
+  *obj->param = *param;
+
+  if (ndevice > 0) {
+    tdpMemcpyToSymbol(tdpSymbol(static_cache_param), obj->param,
+		      sizeof(kernel_param_t), ientry*sizeof(kernel_param_t),
+		      tdpMemcpyHostToDevice);
+  }
+
+  cache_[ientry].nref = 1;
+  cache_[ientry].stamp = ++cache_stamp_;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  kernel_param_compute
+ *
+ *  Host computation of the kernel parameters. The result depends only
+ *  on the values provided, which is the basis of the cache.
+ *
+ *****************************************************************************/
+
+static __host__ int kernel_param_compute(cs_t * cs, int nsimdvl,
+					 kernel_info_t lim,
+					 kernel_param_t * param) {
   int kiter;
   int kv_imin;
   int kv_jmin;
   int kv_kmin;
 
   assert(cs);
+  assert(param);
 
-  cs_nhalo(cs, &obj->param->nhalo);
-  cs_nsites(cs, &obj->param->nsites);
-  cs_nlocal(cs, obj->param->nlocal);
+  cs_nhalo(cs, &param->nhalo);
+  cs_nsites(cs, &param->nsites);
+  cs_nlocal(cs, param->nlocal);
 
-  obj->param->nsimdvl = nsimdvl;
-  obj->param->lim = lim;
+  param->nsimdvl = nsimdvl;
+  param->lim = lim;
 
-  obj->param->nklocal[X] = lim.imax - lim.imin + 1;
-  obj->param->nklocal[Y] = lim.jmax - lim.jmin + 1;
-  obj->param->nklocal[Z] = lim.kmax - lim.kmin + 1;
+  param->nklocal[X] = lim.imax - lim.imin + 1;
+  param->nklocal[Y] = lim.jmax - lim.jmin + 1;
+  param->nklocal[Z] = lim.kmax - lim.kmin + 1;
 
-  obj->param->kernel_iterations
-    = obj->param->nklocal[X]*obj->param->nklocal[Y]*obj->param->nklocal[Z];
+  param->kernel_iterations
+    = param->nklocal[X]*param->nklocal[Y]*param->nklocal[Z];
 
   /* Vectorised case */
 
   kv_imin = lim.imin;
-  kv_jmin = 1 - obj->param->nhalo;
-  kv_kmin = 1 - obj->param->nhalo;
+  kv_jmin = 1 - param->nhalo;
+  kv_kmin = 1 - param->nhalo;
 
-  obj->param->nkv_local[X] = obj->param->nklocal[X];
-  obj->param->nkv_local[Y] = obj->param->nlocal[Y] + 2*obj->param->nhalo;
-  obj->param->nkv_local[Z] = obj->param->nlocal[Z] + 2*obj->param->nhalo;
+  param->nkv_local[X] = param->nklocal[X];
+  param->nkv_local[Y] = param->nlocal[Y] + 2*param->nhalo;
+  param->nkv_local[Z] = param->nlocal[Z] + 2*param->nhalo;
 
   /* Offset of first site must be start of a SIMD vector block */
 
   kiter = cs_index(cs, kv_imin, kv_jmin, kv_kmin);
-  obj->param->kindex0 = (kiter/NSIMDVL)*NSIMDVL;
+  param->kindex0 = (kiter/NSIMDVL)*NSIMDVL;
 
   /* Extent of the contiguous block ... */
-  kiter = obj->param->nkv_local[X]*obj->param->nkv_local[Y]*obj->param->nkv_local[Z];
-  obj->param->kernel_vector_iterations = kiter;
-
-  /* Copy the results to device memory */
-
-  tdpGetDeviceCount(&ndevice);
-
-  if (ndevice > 0) {
-    tdpMemcpyToSymbol(tdpSymbol(static_param), obj->param,
-		      sizeof(kernel_param_t), 0, tdpMemcpyHostToDevice);
-  }
+  kiter = param->nkv_local[X]*param->nkv_local[Y]*param->nkv_local[Z];
+  param->kernel_vector_iterations = kiter;
 
   return 0;
 }
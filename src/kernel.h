@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2016-2017 The University of Edinburgh
+ *  (c) 2016-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -50,6 +50,11 @@ __host__ int kernel_ctxt_launch_param(kernel_ctxt_t * obj, dim3 * nblk, dim3 * n
 __host__ int kernel_ctxt_info(kernel_ctxt_t * obj, kernel_info_t * lim);
 __host__ int kernel_ctxt_free(kernel_ctxt_t * obj);
 
+/* Contexts are cached and reused: see kernel.c */
+
+__host__ int kernel_ctxt_cache_clear(void);
+__host__ int kernel_ctxt_cache_info(int * nentry, int * ninuse);
+
 __host__ __device__ int kernel_iterations(kernel_ctxt_t * ctxt);
 __host__ __device__ int kernel_vector_iterations(kernel_ctxt_t * ctxt);
 __host__ __device__ int kernel_baseindex(kernel_ctxt_t * obj, int kindex);
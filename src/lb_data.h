@@ -28,6 +28,7 @@
 #include "io_event.h"
 #include "io_harness.h"  /* Scheduled for removal. Use io_impl.h */
 #include "halo_swap.h"
+#include "util_commit.h"
 
 /* Residual compile-time switches scheduled for removal */
 #ifdef _D2Q9_
@@ -95,6 +96,15 @@ int lb_halo_post(const lb_t * lb, lb_halo_t * h);
 int lb_halo_wait(lb_t * lb, lb_halo_t * h);
 int lb_halo_free(lb_t * lb, lb_halo_t * h);
 
+/* Parameter blocks committed to target symbols (see util_commit.h) */
+
+enum lb_commit_enum {LB_COMMIT_MODEL_PARAM,
+		     LB_COMMIT_COLLIDE_LBP,
+		     LB_COMMIT_COLLIDE_CP,
+		     LB_COMMIT_PROPAGATE_COORDS,
+		     LB_COMMIT_PROPAGATE_LBP,
+		     LB_COMMIT_MAX};
+
 struct lb_data_s {
 
   int ndim;
@@ -124,6 +134,7 @@ struct lb_data_s {
   lb_halo_enum_t haloscheme;    /* halo scheme */
 
   lb_data_options_t opts;       /* Copy of run time options */
+  util_commit_t commit[LB_COMMIT_MAX]; /* Parameters last sent to target */
   lb_halo_t h;                  /* halo information/buffers */
   
   double * recv_buff;
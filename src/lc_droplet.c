@@ -55,7 +55,9 @@ static fe_vt_t fe_drop_hvt = {
   (fe_htensor_v_ft) fe_lc_droplet_mol_field_v,
   (fe_stress_v_ft)  fe_lc_droplet_stress_v,
   (fe_stress_v_ft)  fe_lc_droplet_str_symm_v,
-  (fe_stress_v_ft)  fe_lc_droplet_str_anti_v
+  (fe_stress_v_ft)  fe_lc_droplet_str_anti_v,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 static __constant__ fe_vt_t fe_drop_dvt = {
@@ -72,7 +74,9 @@ static __constant__ fe_vt_t fe_drop_dvt = {
   (fe_htensor_v_ft) fe_lc_droplet_mol_field_v,
   (fe_stress_v_ft)  fe_lc_droplet_stress_v,
   (fe_stress_v_ft)  fe_lc_droplet_str_symm_v,
-  (fe_stress_v_ft)  fe_lc_droplet_str_anti_v
+  (fe_stress_v_ft)  fe_lc_droplet_str_anti_v,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 __host__ __device__
@@ -176,6 +180,8 @@ __host__ int fe_lc_droplet_free(fe_lc_droplet_t * fe) {
   assert(fe);
 
   /* Free constituent parts, then self... */
+  util_commit_reset(fe->commit + 0);
+  util_commit_reset(fe->commit + 1);
   fe_lc_free(fe->lc);
   fe_symm_free(fe->symm);
 
@@ -217,11 +223,17 @@ __host__ int fe_lc_droplet_param_set(fe_lc_droplet_t * fe,
 
   *fe->param = param;
 
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
-		    sizeof(fe_lc_droplet_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(fe->commit + 0, "lc_droplet.c:const_param",
+			   fe->param, sizeof(fe_lc_droplet_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_lc_droplet_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
-  tdpMemcpyToSymbol(tdpSymbol(const_lc), fe->lc->param, sizeof(fe_lc_param_t),
-		    0, tdpMemcpyHostToDevice);
+  if (util_commit_required(fe->commit + 1, "lc_droplet.c:const_lc",
+			   fe->lc->param, sizeof(fe_lc_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_lc), fe->lc->param,
+		      sizeof(fe_lc_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
@@ -38,6 +38,7 @@ struct fe_lc_droplet_s {
   fe_lc_droplet_param_t * param;  /* Coupling parameters */
   fe_lc_t * lc;                   /* LC free energy  etc */
   fe_symm_t * symm;               /* Symmetric free energy etc */
+  util_commit_t commit[2];        /* Parameters last sent to target */
   fe_lc_droplet_t * target;       /* Target pointer */
 };
 
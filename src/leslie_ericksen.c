@@ -25,22 +25,17 @@
 #include "advection_s.h"
 #include "leslie_ericksen.h"
 
-__global__ static void leslie_update_kernel(kernel_ctxt_t * ktx,
-					    fe_polar_t * fe,
-					    field_t * fp,
-					    hydro_t * hydro,
-					    advflux_t * flux,
-					    leslie_param_t param);
-
-__global__ static void leslie_self_advection_kernel(kernel_ctxt_t * ktx,
-						    field_t * p,
-						    hydro_t * hydro,
-						    double swim);
-
-__device__ static void leslie_u_gradient_tensor(kernel_ctxt_t * ktx,
-						hydro_t * hydro,
-						int ic, int jc, int kc,
-						double w[3][3]);
+__global__ static void leslie_update_kernel_v(kernel_ctxt_t * ktx,
+					      fe_polar_t * fe,
+					      field_t * fp,
+					      hydro_t * hydro,
+					      advflux_t * flux,
+					      leslie_param_t param);
+
+__global__ static void leslie_self_advection_kernel_v(kernel_ctxt_t * ktx,
+						      field_t * p,
+						      hydro_t * hydro,
+						      double swim);
 
 /*****************************************************************************
  *
@@ -65,6 +60,10 @@ int leslie_ericksen_create(pe_t * pe, cs_t * cs, fe_polar_t * fe, field_t * p,
   obj->p  = p;
   obj->param = *param;
 
+  /* Advective fluxes are allocated once for the lifetime of the object */
+
+  advflux_cs_create(pe, cs, NVECTOR, &obj->flux);
+
   *pobj = obj;
 
   return 0;
@@ -80,6 +79,7 @@ int leslie_ericksen_free(leslie_ericksen_t ** pobj) {
 
   assert(pobj && *pobj);
 
+  advflux_free((*pobj)->flux);
   free(*pobj);
   *pobj = NULL;
 
@@ -101,22 +101,19 @@ int leslie_ericksen_free(leslie_ericksen_t ** pobj) {
 __host__ int leslie_ericksen_update(leslie_ericksen_t * obj, hydro_t * hydro) {
 
   int nlocal[3] = {0};
-  advflux_t * flux = NULL;
+  hydro_t * hydro_target = NULL;
 
   assert(obj);
-  assert(hydro);
 
   cs_nlocal(obj->cs, nlocal);
 
-  /* Device version should allocate flux obj only once on creation. */
-  advflux_cs_create(obj->pe, obj->cs, 3, &flux);
-
   if (hydro) {
     /* Add self-advection term if present; halo swap; compute
      * advective fluxes */
     leslie_ericksen_self_advection(obj, hydro);
     hydro_u_halo(hydro);
-    advflux_cs_compute(flux, hydro, obj->p);
+    advflux_cs_compute(obj->flux, hydro, obj->p);
+    hydro_target = hydro->target;
   }
 
   {
@@ -125,101 +122,190 @@ __host__ int leslie_ericksen_update(leslie_ericksen_t * obj, hydro_t * hydro) {
     kernel_info_t limits = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
     kernel_ctxt_t * ctxt = NULL;
 
-    kernel_ctxt_create(obj->cs, 1, limits, &ctxt);
+    kernel_ctxt_create(obj->cs, NSIMDVL, limits, &ctxt);
     kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-    tdpLaunchKernel(leslie_update_kernel, nblk, ntpb, 0, 0,
+    tdpLaunchKernel(leslie_update_kernel_v, nblk, ntpb, 0, 0,
 		    ctxt->target, obj->fe->target, obj->p->target,
-		    hydro->target, flux->target, obj->param);
+		    hydro_target, obj->flux->target, obj->param);
     tdpAssert(tdpPeekAtLastError());
     tdpAssert(tdpDeviceSynchronize());
 
     kernel_ctxt_free(ctxt);
   }
 
-  advflux_free(flux);
-
   return 0;
 }
 
 /*****************************************************************************
  *
- *  leslie_update_kernel
+ *  leslie_update_kernel_v
  *
  *  hydro is allowed to be NULL, in which case we have relaxational
- *  dynamics only.
+ *  dynamics only (and the fluxes are not used).
+ *
+ *  The velocity gradient tensor is computed once per site from the
+ *  central difference of u (no Lees-Edwards conditions).
  *
  *****************************************************************************/
 
-__global__ static void leslie_update_kernel(kernel_ctxt_t * ktx,
-					    fe_polar_t * fe,
-					    field_t * fp,
-					    hydro_t * hydro,
-					    advflux_t * flux,
-					    leslie_param_t param) {
+__global__ static void leslie_update_kernel_v(kernel_ctxt_t * ktx,
+					      fe_polar_t * fe,
+					      field_t * fp,
+					      hydro_t * hydro,
+					      advflux_t * flux,
+					      leslie_param_t param) {
   int kindex = 0;
-  int kiterations = 0;
+  __shared__ int kiterations;
   const double dt = 1.0;
+  const double r3 = (1.0/3.0);
 
   assert(ktx);
   assert(fe);
   assert(fp);
   assert(flux);
 
-  kiterations = kernel_iterations(ktx);
+  kiterations = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
+
+    int ia, ib, iv;
+    int index;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int im1[NSIMDVL], ip1[NSIMDVL];
+    int jm1[NSIMDVL], km1[NSIMDVL];
+    int nb[NSIMDVL];
+    int maskv[NSIMDVL];
+
+    double p[3][NSIMDVL];
+    double h[3][NSIMDVL];          /* molecular field (vector) */
+    double w[3][3][NSIMDVL] = {0}; /* Velocity gradient tensor */
+    double d[3][3][NSIMDVL];       /* Symmetric velocity gradient tensor */
+    double omega[3][3][NSIMDVL];   /* Antisymmetric ditto */
+    double tr[NSIMDVL];
+    double sum[NSIMDVL];
+    double div[NSIMDVL];           /* Divergence of advective flux */
+
+    index = kernel_baseindex(ktx, kindex);
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    for (ia = 0; ia < NVECTOR; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	p[ia][iv] = fp->data[addr_rank1(fp->nsites, NVECTOR, index+iv, ia)];
+      }
+    }
+
+    fe_polar_mol_field_v(fe, index, h);
+
+    if (hydro) {
+
+      /* Velocity gradient w[a][b] = d_b u_a; neighbours are masked
+       * to remain in the domain for lanes outside the kernel. */
+
+      for_simd_v(iv, NSIMDVL) nb[iv] = ic[iv] - maskv[iv];
+      kernel_coords_index_v(ktx, nb, jc, kc, im1);
+      for_simd_v(iv, NSIMDVL) nb[iv] = ic[iv] + maskv[iv];
+      kernel_coords_index_v(ktx, nb, jc, kc, ip1);
 
-  for_simt_parallel(kindex, kiterations, 1)  {
+      for (ia = 0; ia < NHDIM; ia++) {
+	for_simd_v(iv, NSIMDVL) {
+	  w[ia][X][iv] = 0.5*
+	    (hydro->u->data[addr_rank1(hydro->nsite, NHDIM, ip1[iv], ia)] -
+	     hydro->u->data[addr_rank1(hydro->nsite, NHDIM, im1[iv], ia)]);
+	}
+      }
+
+      for_simd_v(iv, NSIMDVL) nb[iv] = jc[iv] - maskv[iv];
+      kernel_coords_index_v(ktx, ic, nb, kc, im1);
+      for_simd_v(iv, NSIMDVL) nb[iv] = jc[iv] + maskv[iv];
+      kernel_coords_index_v(ktx, ic, nb, kc, ip1);
+
+      for (ia = 0; ia < NHDIM; ia++) {
+	for_simd_v(iv, NSIMDVL) {
+	  w[ia][Y][iv] = 0.5*
+	    (hydro->u->data[addr_rank1(hydro->nsite, NHDIM, ip1[iv], ia)] -
+	     hydro->u->data[addr_rank1(hydro->nsite, NHDIM, im1[iv], ia)]);
+	}
+      }
 
-    int ic    = kernel_coords_ic(ktx, kindex);
-    int jc    = kernel_coords_jc(ktx, kindex);
-    int kc    = kernel_coords_kc(ktx, kindex);
-    int index = kernel_coords_index(ktx, ic, jc, kc);
+      for_simd_v(iv, NSIMDVL) nb[iv] = kc[iv] - maskv[iv];
+      kernel_coords_index_v(ktx, ic, jc, nb, im1);
+      for_simd_v(iv, NSIMDVL) nb[iv] = kc[iv] + maskv[iv];
+      kernel_coords_index_v(ktx, ic, jc, nb, ip1);
+
+      for (ia = 0; ia < NHDIM; ia++) {
+	for_simd_v(iv, NSIMDVL) {
+	  w[ia][Z][iv] = 0.5*
+	    (hydro->u->data[addr_rank1(hydro->nsite, NHDIM, ip1[iv], ia)] -
+	     hydro->u->data[addr_rank1(hydro->nsite, NHDIM, im1[iv], ia)]);
+	}
+      }
 
-    double p[3] = {0};
-    double h[3] = {0};          /* molecular field (vector) */
-    double w[3][3] = {0};       /* Velocity gradient tensor */
-    double d[3][3] = {0};       /* Symmetric velocity gradient tensor */
-    double omega[3][3] = {0};   /* Antisymmetric ditto */
+      /* Enforce tracelessness */
 
-    field_vector(fp, index, p);
-    fe_polar_mol_field(fe, index, h);
-    if (hydro) leslie_u_gradient_tensor(ktx, hydro, ic, jc, kc, w);
+      for_simd_v(iv, NSIMDVL) tr[iv] = r3*(w[X][X][iv] + w[Y][Y][iv] + w[Z][Z][iv]);
+      for_simd_v(iv, NSIMDVL) w[X][X][iv] -= tr[iv];
+      for_simd_v(iv, NSIMDVL) w[Y][Y][iv] -= tr[iv];
+      for_simd_v(iv, NSIMDVL) w[Z][Z][iv] -= tr[iv];
+    }
 
     /* Note that the convection for Leslie Ericksen is that
      * w_ab = d_a u_b, which is the transpose of what the
-     * above returns. Hence an extra minus sign in the
+     * above computes. Hence an extra minus sign in the
      * omega term in the following. */
 
-    for (int ia = 0; ia < 3; ia++) {
-      for (int ib = 0; ib < 3; ib++) {
-	d[ia][ib]     =  0.5*(w[ia][ib] + w[ib][ia]);
-	omega[ia][ib] = -0.5*(w[ia][ib] - w[ib][ia]);
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	for_simd_v(iv, NSIMDVL) {
+	  d[ia][ib][iv]     =  0.5*(w[ia][ib][iv] + w[ib][ia][iv]);
+	  omega[ia][ib][iv] = -0.5*(w[ia][ib][iv] - w[ib][ia][iv]);
+	}
       }
     }
 
-    /* updates involve the following fluxes */
+    /* Divergence of the advective fluxes involves (ic-1), (jc-1) and
+     * (kc-1), which are masked out if not a valid kernel site. */
+
+    for_simd_v(iv, NSIMDVL) nb[iv] = ic[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, nb, jc, kc, im1);
+    for_simd_v(iv, NSIMDVL) nb[iv] = jc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, nb, kc, jm1);
+    for_simd_v(iv, NSIMDVL) nb[iv] = kc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, jc, nb, km1);
 
-    int im1 = cs_index(flux->cs, ic-1, jc, kc);
-    int jm1 = cs_index(flux->cs, ic, jc-1, kc);
-    int km1 = cs_index(flux->cs, ic, jc, kc-1);
+    for (ia = 0; ia < 3; ia++) {
 
-    for (int ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
+      for (ib = 0; ib < 3; ib++) {
+	for_simd_v(iv, NSIMDVL) {
+	  sum[iv] += param.lambda*d[ia][ib][iv]*p[ib][iv]
+	    - omega[ia][ib][iv]*p[ib][iv];
+	}
+      }
 
-      double sum = 0.0;
-      for (int ib = 0; ib < 3; ib++) {
-	sum += param.lambda*d[ia][ib]*p[ib] - omega[ia][ib]*p[ib];
+      for_simd_v(iv, NSIMDVL) div[iv] = 0.0;
+      if (hydro) {
+	for_simd_v(iv, NSIMDVL) {
+	  div[iv] = - flux->fx[addr_rank1(flux->nsite, 3, index+iv, ia)]
+	            + flux->fx[addr_rank1(flux->nsite, 3, im1[iv], ia)]
+	            - flux->fy[addr_rank1(flux->nsite, 3, index+iv, ia)]
+	            + flux->fy[addr_rank1(flux->nsite, 3, jm1[iv], ia)]
+	            - flux->fz[addr_rank1(flux->nsite, 3, index+iv, ia)]
+	            + flux->fz[addr_rank1(flux->nsite, 3, km1[iv], ia)];
+	}
       }
 
-      p[ia] += dt*(- flux->fx[addr_rank1(flux->nsite, 3, index, ia)]
-		   + flux->fx[addr_rank1(flux->nsite, 3, im1,   ia)]
-		   - flux->fy[addr_rank1(flux->nsite, 3, index, ia)]
-		   + flux->fy[addr_rank1(flux->nsite, 3, jm1,   ia)]
-		   - flux->fz[addr_rank1(flux->nsite, 3, index, ia)]
-		   + flux->fz[addr_rank1(flux->nsite, 3, km1,   ia)]
-		   + sum + param.Gamma*h[ia]);
+      for_simd_v(iv, NSIMDVL) {
+	if (maskv[iv]) p[ia][iv] += dt*(div[iv] + sum[iv] + param.Gamma*h[ia][iv]);
+      }
     }
 
-    field_vector_set(fp, index, p);
+    for (ia = 0; ia < NVECTOR; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	fp->data[addr_rank1(fp->nsites, NVECTOR, index+iv, ia)] = p[ia][iv];
+      }
+    }
   }
 
   return;
@@ -227,40 +313,41 @@ __global__ static void leslie_update_kernel(kernel_ctxt_t * ktx,
 
 /*****************************************************************************
  *
- *  leslie_self_advection_kernel
+ *  leslie_self_advection_kernel_v
  *
  *****************************************************************************/
 
-__global__ static void leslie_self_advection_kernel(kernel_ctxt_t * ktx,
-						    field_t * p,
-						    hydro_t * hydro,
-						    double swim) {
+__global__ static void leslie_self_advection_kernel_v(kernel_ctxt_t * ktx,
+						      field_t * p,
+						      hydro_t * hydro,
+						      double swim) {
   int kindex = 0;
-  int kiterations = 0;
+  __shared__ int kiterations;
 
   assert(ktx);
   assert(p);
   assert(hydro);
 
-  kiterations = kernel_iterations(ktx);
-
-  for_simt_parallel(kindex, kiterations, 1) {
+  kiterations = kernel_vector_iterations(ktx);
 
-    int ic    = kernel_coords_ic(ktx, kindex);
-    int jc    = kernel_coords_jc(ktx, kindex);
-    int kc    = kernel_coords_kc(ktx, kindex);
-    int index = kernel_coords_index(ktx, ic, jc, kc);
-    double p3[3] = {0};
-    double u3[3] = {0};
+  for_simt_parallel(kindex, kiterations, NSIMDVL) {
 
-    field_vector(p, index, p3);
-    hydro_u(hydro, index, u3);
+    int ia, iv;
+    int index;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int maskv[NSIMDVL];
 
-    u3[X] += swim*p3[X];
-    u3[Y] += swim*p3[Y];
-    u3[Z] += swim*p3[Z];
+    index = kernel_baseindex(ktx, kindex);
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
 
-    hydro_u_set(hydro, index, u3);
+    for (ia = 0; ia < NHDIM; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	int haddr = addr_rank1(hydro->nsite, NHDIM, index+iv, ia);
+	int paddr = addr_rank1(p->nsites, NVECTOR, index+iv, ia);
+	hydro->u->data[haddr] += maskv[iv]*swim*p->data[paddr];
+      }
+    }
   }
 
   return;
@@ -296,10 +383,10 @@ __host__ int leslie_ericksen_self_advection(leslie_ericksen_t * obj,
     kernel_info_t limits = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
     kernel_ctxt_t * ctxt = NULL;
 
-    kernel_ctxt_create(obj->cs, 1, limits, &ctxt);
+    kernel_ctxt_create(obj->cs, NSIMDVL, limits, &ctxt);
     kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-    tdpLaunchKernel(leslie_self_advection_kernel, nblk, ntpb, 0, 0,
+    tdpLaunchKernel(leslie_self_advection_kernel_v, nblk, ntpb, 0, 0,
 		    ctxt->target, obj->p->target, hydro->target,
 		    obj->param.swim);
     tdpAssert(tdpPeekAtLastError());
@@ -310,62 +397,3 @@ __host__ int leslie_ericksen_self_advection(leslie_ericksen_t * obj,
 
   return 0;
 }
-
-/*****************************************************************************
- *
- *  leslie_u_gradient_tensor
- *
- *  A copy of the hydro_u_gradient_tensor() routine with no Lees-Edwards
- *  conditions.
- *
- *  A __device__ version is required.
- *
- *****************************************************************************/
-
-__device__ static void leslie_u_gradient_tensor(kernel_ctxt_t * ktx,
-						hydro_t * hydro,
-						int ic, int jc, int kc,
-						double w[3][3]) {
-  assert(hydro);
-
-  int m1 = kernel_coords_index(ktx, ic - 1, jc, kc);
-  int p1 = kernel_coords_index(ktx, ic + 1, jc, kc);
-
-  w[X][X] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, X)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, X)]);
-  w[Y][X] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Y)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Y)]);
-  w[Z][X] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Z)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Z)]);
-
-  m1 = kernel_coords_index(ktx, ic, jc - 1, kc);
-  p1 = kernel_coords_index(ktx, ic, jc + 1, kc);
-
-  w[X][Y] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, X)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, X)]);
-  w[Y][Y] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Y)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Y)]);
-  w[Z][Y] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Z)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Z)]);
-
-  m1 = kernel_coords_index(ktx, ic, jc, kc - 1);
-  p1 = kernel_coords_index(ktx, ic, jc, kc + 1);
-
-  w[X][Z] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, X)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, X)]);
-  w[Y][Z] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Y)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Y)]);
-  w[Z][Z] = 0.5*(hydro->u->data[addr_rank1(hydro->nsite, NHDIM, p1, Z)] -
-		 hydro->u->data[addr_rank1(hydro->nsite, NHDIM, m1, Z)]);
-
-  /* Enforce tracelessness */
-
-  {
-    double tr = (1.0/3.0)*(w[X][X] + w[Y][Y] + w[Z][Z]);
-    w[X][X] -= tr;
-    w[Y][Y] -= tr;
-    w[Z][Z] -= tr;
-  }
-
-  return;
-}
@@ -6,7 +6,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  and Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
@@ -19,6 +19,7 @@
 #include "coords.h"
 #include "field.h"
 #include "hydro.h"
+#include "advection.h"
 #include "polar_active.h"
 
 typedef struct leslie_param_s leslie_param_t;
@@ -36,6 +37,7 @@ struct leslie_ericksen_s {
   fe_polar_t * fe;               /* Free energy */
   field_t * p;                   /* Vector order parameter field */
   leslie_param_t param;          /* Parameters */
+  advflux_t * flux;              /* Advective fluxes */
 };
 
 int leslie_ericksen_create(pe_t * pe, cs_t * cs, fe_polar_t * fe, field_t * p,
@@ -28,6 +28,7 @@
 #include "timer.h"
 #include "coords_rt.h"
 #include "coords.h"
+#include "kernel.h"
 #include "leesedwards_rt.h"
 #include "control.h"
 #include "util.h"
@@ -134,6 +135,7 @@ struct ludwig_s {
   lees_edw_t * le;          /* Lees Edwards sliding periodic boundaries */
   lb_t * lb;                /* Lattice Botlzmann */
   hydro_t * hydro;          /* Hydrodynamic quantities */
+  hydro_t * hydro_avg;      /* Time-averaged velocity (op_interval > 1) */
   field_t * phi;            /* Scalar order parameter */
   field_t * p;              /* Vector order parameter */
   field_t * q;              /* Tensor order parameter */
@@ -178,6 +180,9 @@ struct ludwig_s {
   stats_rheo_t * stat_rheo;    /* Rheology diagnostics */
   stats_turb_t * stat_turb;    /* Turbulent diagnostics */
   timekeeper_t tk;             /* Time keeper */
+
+  int op_nsubstep;             /* Order parameter steps per LB step */
+  int op_interval;             /* LB steps per order parameter step */
 };
 
 static int ludwig_rt(ludwig_t * ludwig);
@@ -185,6 +190,8 @@ static int ludwig_report_momentum(ludwig_t * ludwig);
 static int ludwig_report_statistics(ludwig_t * ludwig, int itimestep);
 static int ludwig_colloids_update(ludwig_t * ludwig);
 static int ludwig_colloids_update_low_freq(ludwig_t * ludwig);
+static int ludwig_order_parameter_rt(ludwig_t * ludwig);
+static int ludwig_order_parameter_halo(ludwig_t * ludwig);
 
 int ludwig_timekeeper_init(ludwig_t * ludwig);
 int free_energy_init_rt(ludwig_t * ludwig);
@@ -245,6 +252,7 @@ static int ludwig_rt(ludwig_t * ludwig) {
   ran_init_rt(pe, rt);
   hydro_rt(pe, rt, cs, ludwig->le, &ludwig->hydro);
   visc_model_init_rt(pe, rt, ludwig);
+  ludwig_order_parameter_rt(ludwig);
 
   lb_bc_open_rt(pe, rt, cs, ludwig->lb, &ludwig->inflow, &ludwig->outflow);
   phi_bc_open_rt(pe, rt, cs, &ludwig->phi_inflow, &ludwig->phi_outflow);
@@ -755,26 +763,52 @@ void ludwig_run(const char * inputfile) {
 		  ludwig->map);
       }
 
-      if (ludwig->pch) {
-	phi_cahn_hilliard(ludwig->pch, ludwig->fe, ludwig->phi,
-			  ludwig->hydro,
-			  ludwig->map, ludwig->noise_phi);
-      }
-
       if (ludwig->p) {
 	leslie_ericksen_update(ludwig->leslie, ludwig->hydro);
       }
 
-      if (ludwig->q) {
-	if (ludwig->hydro) {
-	  TIMER_start(TIMER_U_HALO);
- 	  hydro_u_halo(ludwig->hydro);
-	  TIMER_stop(TIMER_U_HALO);
+      {
+	/* Binary fluid and liquid crystal may be sub-cycled (several
+	 * order parameter steps per LB step), or updated only every
+	 * op_interval LB steps using the time-averaged velocity. */
+
+	int nsubstep = ludwig->op_nsubstep;
+	hydro_t * hydro = ludwig->hydro;
+
+	if (ludwig->op_interval > 1) {
+	  if (hydro) {
+	    hydro = ludwig->hydro_avg;
+	    hydro_u_accumulate(hydro, 1.0/ludwig->op_interval, ludwig->hydro);
+	  }
+	  if (step % ludwig->op_interval) nsubstep = 0;
 	}
 
-	beris_edw_update(ludwig->be, ludwig->fe, ludwig->q, ludwig->q_grad,
-			 ludwig->hydro,
-			 ludwig->collinfo, ludwig->map, ludwig->noise_rho);
+	for (int isub = 0; isub < nsubstep; isub++) {
+
+	  if (isub > 0) ludwig_order_parameter_halo(ludwig);
+
+	  if (ludwig->pch) {
+	    phi_cahn_hilliard(ludwig->pch, ludwig->fe, ludwig->phi,
+			      hydro,
+			      ludwig->map, ludwig->noise_phi);
+	  }
+
+	  if (ludwig->q) {
+	    if (hydro) {
+	      TIMER_start(TIMER_U_HALO);
+	      hydro_u_halo(hydro);
+	      TIMER_stop(TIMER_U_HALO);
+	    }
+
+	    beris_edw_update(ludwig->be, ludwig->fe, ludwig->q, ludwig->q_grad,
+			     hydro,
+			     ludwig->collinfo, ludwig->map, ludwig->noise_rho);
+	  }
+	}
+
+	if (nsubstep > 0 && ludwig->hydro_avg) {
+	  hydro_u_zero(ludwig->hydro_avg, uzero);
+	}
       }
 
       TIMER_stop(TIMER_ORDER_PARAMETER_UPDATE);
@@ -790,8 +824,8 @@ void ludwig_run(const char * inputfile) {
 
       hydro_u_zero(ludwig->hydro, uzero);
 
-      /* Viscosity computation */
-      if (ludwig->visc) {
+      /* Viscosity computation (unless evaluated in the collision) */
+      if (ludwig->visc && ludwig->visc->func->local == NULL) {
 	ludwig->visc->func->update(ludwig->visc, ludwig->hydro);
       }
 
@@ -925,7 +959,8 @@ void ludwig_run(const char * inputfile) {
     if (is_shear_measurement_step()) {
       lb_memcpy(ludwig->lb, tdpMemcpyDeviceToDevice);
       stats_rheology_stress_profile_accumulate(ludwig->stat_rheo, ludwig->lb,
-					       ludwig->fe, ludwig->hydro);
+					       ludwig->fe, ludwig->pth,
+					       ludwig->hydro);
     }
 
     if (is_shear_output_step()) {
@@ -1007,6 +1042,7 @@ void ludwig_run(const char * inputfile) {
   if (ludwig->map)       map_free(ludwig->map);
   if (ludwig->pch)       phi_ch_free(ludwig->pch);
   if (ludwig->pth)       pth_free(ludwig->pth);
+  if (ludwig->hydro_avg) hydro_free(ludwig->hydro_avg);
   if (ludwig->hydro)     hydro_free(ludwig->hydro);
   if (ludwig->lb)        lb_free(ludwig->lb);
 
@@ -1018,6 +1054,7 @@ void ludwig_run(const char * inputfile) {
 
   physics_free(ludwig->phys);
   if (ludwig->le) lees_edw_free(ludwig->le);
+  kernel_ctxt_cache_clear();
   cs_free(ludwig->cs);
   rt_report_unused_keys(ludwig->rt, RT_INFO);
   rt_free(ludwig->rt);
@@ -1202,6 +1239,25 @@ int free_energy_init_rt(ludwig_t * ludwig) {
 
     rt_int_parameter(rt, "cahn_hilliard_options_conserve",
 		     &ch_options.conserve);
+
+    /* Semi-implicit update: stabiliser defaults to kappa */
+
+    rt_int_parameter(rt, "cahn_hilliard_options_implicit",
+		     &ch_options.implicit);
+    if (ch_options.implicit) {
+      fe_symm_param_t param = {0};
+      fe_symm_param(fe, &param);
+      ch_options.stabiliser = param.kappa;
+      rt_double_parameter(rt, "cahn_hilliard_options_stabiliser",
+			  &ch_options.stabiliser);
+      rt_int_parameter(rt, "cahn_hilliard_options_maxits",
+		       &ch_options.maxits);
+      rt_double_parameter(rt, "cahn_hilliard_options_reltol",
+			  &ch_options.reltol);
+      pe_info(pe, "Semi-implicit update  =  on\n");
+      pe_info(pe, "Stabiliser A          = %12.5e\n", ch_options.stabiliser);
+    }
+
     phi_ch_create(pe, cs, le, &ch_options, &ludwig->pch);
 
     /* Order parameter noise */
@@ -2043,6 +2099,133 @@ int visc_model_init_rt(pe_t * pe, rt_t * rt, ludwig_t * ludwig) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  ludwig_order_parameter_rt
+ *
+ *  Time step of the order parameter relative to the LB time step.
+ *
+ *    fd_order_parameter_substeps  N  N order parameter steps of size
+ *                                    dt = 1/N per LB step
+ *    fd_order_parameter_interval  K  One order parameter step of size
+ *                                    dt = K every K LB steps, using
+ *                                    the velocity averaged over the K steps
+ *
+ *  Only the binary Cahn-Hilliard and Beris-Edwards updates take a time
+ *  step, so other order parameter dynamics require the default N = K = 1.
+ *
+ *****************************************************************************/
+
+static int ludwig_order_parameter_rt(ludwig_t * ludwig) {
+
+  int im = 0;
+  int nsubstep = 1;
+  int interval = 1;
+  pe_t * pe = NULL;
+  rt_t * rt = NULL;
+
+  assert(ludwig);
+
+  pe = ludwig->pe;
+  rt = ludwig->rt;
+
+  rt_int_parameter(rt, "fd_order_parameter_substeps", &nsubstep);
+  rt_int_parameter(rt, "fd_order_parameter_interval", &interval);
+
+  if (nsubstep < 1) pe_fatal(pe, "fd_order_parameter_substeps must be >= 1\n");
+  if (interval < 1) pe_fatal(pe, "fd_order_parameter_interval must be >= 1\n");
+
+  ludwig->op_nsubstep = nsubstep;
+  ludwig->op_interval = interval;
+
+  if (nsubstep == 1 && interval == 1) return 0;
+
+  if (nsubstep > 1 && interval > 1) {
+    pe_info(pe, "fd_order_parameter_substeps and fd_order_parameter_interval\n");
+    pe_fatal(pe, "cannot both be greater than one. Please check the input\n");
+  }
+
+  lb_ndist(ludwig->lb, &im);
+
+  if (ludwig->ch || ludwig->p || im == 2 || ludwig->psi) {
+    pe_info(pe, "Order parameter sub-cycling is available for the binary\n");
+    pe_info(pe, "Cahn-Hilliard and Beris-Edwards updates only\n");
+    pe_fatal(pe, "Please check the input and try again\n");
+  }
+
+  {
+    double dt = (nsubstep > 1) ? 1.0/nsubstep : 1.0*interval;
+
+    if (ludwig->pch) phi_ch_dt_set(ludwig->pch, dt);
+    if (ludwig->be) beris_edw_dt_set(ludwig->be, dt);
+
+    pe_info(pe, "\n");
+    pe_info(pe, "Order parameter time step\n");
+    pe_info(pe, "-------------------------\n");
+    pe_info(pe, "Steps per LB step:            %d\n", nsubstep);
+    pe_info(pe, "LB steps per step:            %d\n", interval);
+    pe_info(pe, "Time step:                    %14.7e\n", dt);
+  }
+
+  if (interval > 1 && ludwig->hydro) {
+    /* Time-averaged velocity accumulated at every LB step */
+    hydro_options_t opts = hydro_options_nhalo(ludwig->hydro->nhcomm);
+    double uzero[3] = {0.0, 0.0, 0.0};
+
+    hydro_create(pe, ludwig->cs, ludwig->le, &opts, &ludwig->hydro_avg);
+    hydro_u_zero(ludwig->hydro_avg, uzero);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  ludwig_order_parameter_halo
+ *
+ *  Halo swap and gradients before an order parameter sub-step after
+ *  the first in an LB step.
+ *
+ *****************************************************************************/
+
+static int ludwig_order_parameter_halo(ludwig_t * ludwig) {
+
+  assert(ludwig);
+
+  TIMER_start(TIMER_PHI_GRADIENTS);
+
+  if (ludwig->phi) {
+
+    TIMER_start(TIMER_PHI_HALO);
+    field_halo(ludwig->phi);
+    TIMER_stop(TIMER_PHI_HALO);
+
+    if (ludwig->phi_inflow) {
+      phi_bc_open_t * inflow = ludwig->phi_inflow;
+      inflow->func->update(inflow, ludwig->phi);
+    }
+    if (ludwig->phi_outflow) {
+      phi_bc_open_t * outflow = ludwig->phi_outflow;
+      outflow->func->update(outflow, ludwig->phi);
+    }
+
+    field_grad_compute(ludwig->phi_grad);
+  }
+
+  if (ludwig->q) {
+    TIMER_start(TIMER_PHI_HALO);
+    field_halo(ludwig->q);
+    TIMER_stop(TIMER_PHI_HALO);
+
+    field_grad_compute(ludwig->q_grad);
+    fe_lc_redshift_compute(ludwig->cs, ludwig->fe_lc);
+  }
+
+  TIMER_stop(TIMER_PHI_GRADIENTS);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  ludwig_colloids_update_low_freq
@@ -2111,14 +2294,13 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
 
   TIMER_start(TIMER_HALO_LATTICE);
 
-  /* __NVCC__ */
+  /* The rebuild kernels work on the target copy, which requires
+   * a full halo (including edges and corners). */
   if (ndevice == 0) {
     lb_halo(ludwig->lb);
   }
   else {
-    /* Pull data back, then full host halo swap */
-    lb_memcpy(ludwig->lb, tdpMemcpyDeviceToHost);
-    lb_halo_swap(ludwig->lb, LB_HALO_OPENMP_FULL);
+    lb_halo_swap(ludwig->lb, LB_HALO_TARGET);
   }
 
   TIMER_stop(TIMER_HALO_LATTICE);
@@ -2128,20 +2310,30 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
 
   TIMER_start(TIMER_REBUILD);
 
+  TIMER_start(TIMER_REBUILD_MAP);
   build_update_map(ludwig->cs, ludwig->collinfo, ludwig->map);
+  TIMER_stop(TIMER_REBUILD_MAP);
+
+  TIMER_start(TIMER_REBUILD_REMOVE_REPLACE);
   build_remove_replace(ludwig->fe, ludwig->collinfo, ludwig->lb, ludwig->phi,
 		       ludwig->p, ludwig->q, ludwig->psi, ludwig->map);
+  TIMER_stop(TIMER_REBUILD_REMOVE_REPLACE);
+
+  TIMER_start(TIMER_REBUILD_LINKS);
   build_update_links(ludwig->cs, ludwig->collinfo, ludwig->wall, ludwig->map,
 		     &ludwig->lb->model);
-
-  TIMER_stop(TIMER_REBUILD);
+  TIMER_stop(TIMER_REBUILD_LINKS);
 
   if (iconserve) {
+    TIMER_start(TIMER_REBUILD_CONSERVATION);
     colloid_sums_halo(ludwig->collinfo, COLLOID_SUM_CONSERVATION);
     build_conservation(ludwig->collinfo, ludwig->phi, ludwig->psi,
 		       &ludwig->lb->model);
+    TIMER_stop(TIMER_REBUILD_CONSERVATION);
   }
 
+  TIMER_stop(TIMER_REBUILD);
+
   TIMER_start(TIMER_FORCES);
 
   interact_compute(ludwig->interact, ludwig->collinfo, ludwig->map,
@@ -2150,13 +2342,6 @@ int ludwig_colloids_update(ludwig_t * ludwig) {
 
   TIMER_stop(TIMER_FORCES);
 
-
-  /* __NVCC__ TODO: remove */
-
-  colloids_memcpy(ludwig->collinfo, tdpMemcpyHostToDevice);
-  map_memcpy(ludwig->map, tdpMemcpyHostToDevice);
-  lb_memcpy(ludwig->lb, tdpMemcpyHostToDevice);
-
   return 0;
 }
 
@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -18,16 +18,32 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "pe.h"
 #include "coords.h"
 #include "coords_field.h"
 #include "map.h"
+#include "util_fopen.h"
 
 static int map_read(FILE * fp, int index, void * self);
 static int map_write(FILE * fp, int index, void * self);
 static int map_read_ascii(FILE * fp, int index, void * self);
+static int map_read_buf(map_t * map, int index, const char * buf);
 static int map_write_ascii(FILE * fp, int index, void * self);
+static int map_rle_read_run(FILE * fp, int32_t run[2], int ndata,
+			    double * data);
+static int map_rle_write_run(FILE * fp, const int32_t run[2], int ndata,
+			     const double * data);
+
+/* Run-length encoded file format: a header of five int32_t
+ *   { MAP_RLE_MAGIC, ntotal[X], ntotal[Y], ntotal[Z], ndata }
+ * followed by runs of sites in serial order (z running fastest).
+ * Each run is { int32_t status, int32_t count } followed, for non-fluid
+ * status only, by ndata doubles common to all sites in the run. */
+
+#define MAP_RLE_MAGIC 0x454c524d
 
 /*****************************************************************************
  *
@@ -232,6 +248,7 @@ int map_init_io_info(map_t * obj, int grid[3], int form_in, int form_out) {
   io_info_write_set(obj->info, IO_FORMAT_ASCII, map_write_ascii);
   io_info_read_set(obj->info, IO_FORMAT_BINARY, map_read);
   io_info_read_set(obj->info, IO_FORMAT_ASCII, map_read_ascii);
+  io_info_read_buf_set(obj->info, (io_buf_cb_ft) map_read_buf);
 
   sz = sizeof(char) + obj->ndata*sizeof(double);
   io_info_set_bytesize(obj->info, IO_FORMAT_BINARY, sz);
@@ -259,6 +276,226 @@ __host__ int map_io_info(map_t * obj, io_info_t ** info) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  map_read_rle
+ *
+ *  Read status (and data) from a run-length encoded file. Each rank
+ *  streams through the runs once, keeping only the sites in the local
+ *  domain, so there is no full-resolution copy of the geometry either
+ *  on disk or in memory. The halo is not updated.
+ *
+ *  A file which is short, or has runs extending beyond the last site,
+ *  or has trailing data, is fatal.
+ *
+ *****************************************************************************/
+
+__host__ int map_read_rle(map_t * map, const char * filename) {
+
+  int ifail = 0;
+  int ntotal[3] = {0};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  int32_t header[5] = {0};
+  int32_t run[2] = {0};
+  size_t rend = 0;               /* One past last site of current run */
+  double * rdata = NULL;
+  FILE * fp = NULL;
+
+  assert(map);
+  assert(filename);
+
+  cs_ntotal(map->cs, ntotal);
+  cs_nlocal(map->cs, nlocal);
+  cs_nlocal_offset(map->cs, noffset);
+
+  fp = util_fopen(filename, "r");
+  if (fp == NULL) pe_fatal(map->pe, "Failed to open %s\n", filename);
+
+  if (fread(header, sizeof(int32_t), 5, fp) != 5) ifail = -1;
+  if (header[0] != MAP_RLE_MAGIC) ifail = -1;
+  if (ifail) pe_fatal(map->pe, "%s: not a run-length encoded map\n", filename);
+
+  if (header[1] != ntotal[X] || header[2] != ntotal[Y] ||
+      header[3] != ntotal[Z]) {
+    pe_fatal(map->pe, "%s: system size %d %d %d does not match\n", filename,
+	     header[1], header[2], header[3]);
+  }
+  if (header[4] != map->ndata) {
+    pe_fatal(map->pe, "%s: ndata %d does not match map ndata %d\n", filename,
+	     header[4], map->ndata);
+  }
+
+  rdata = (double *) calloc(map->ndata + 1, sizeof(double));
+  assert(rdata);
+  if (rdata == NULL) pe_fatal(map->pe, "calloc(rdata) failed\n");
+
+  /* Local sites are visited in increasing serial order, so the runs
+   * are only ever traversed forwards. */
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      size_t ifo = noffset[X] + ic - 1;
+      size_t jfo = noffset[Y] + jc - 1;
+      size_t isite = (ifo*ntotal[Y] + jfo)*ntotal[Z] + noffset[Z];
+
+      for (int kc = 1; kc <= nlocal[Z]; kc++, isite++) {
+	int index = cs_index(map->cs, ic, jc, kc);
+
+	while (isite >= rend) {
+	  ifail = map_rle_read_run(fp, run, map->ndata, rdata);
+	  if (ifail) pe_fatal(map->pe, "%s: bad or missing run\n", filename);
+	  rend += run[1];
+	}
+	map_status_set(map, index, run[0]);
+	map_data_set(map, index, rdata);
+      }
+    }
+  }
+
+  /* The rank holding the last site checks the runs end exactly at
+   * the last site, and that nothing follows. */
+
+  if (noffset[X] + nlocal[X] == ntotal[X] &&
+      noffset[Y] + nlocal[Y] == ntotal[Y] &&
+      noffset[Z] + nlocal[Z] == ntotal[Z]) {
+    size_t nsites = (size_t) ntotal[X]*ntotal[Y]*ntotal[Z];
+    if (rend != nsites || fgetc(fp) != EOF) {
+      pe_fatal(map->pe, "%s: runs do not end at the last site\n", filename);
+    }
+  }
+
+  free(rdata);
+  fclose(fp);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  map_write_rle
+ *
+ *  Serial only (e.g., for utilities generating a geometry). Fluid sites
+ *  carry no data in the file, so any data at fluid sites is not kept.
+ *
+ *****************************************************************************/
+
+__host__ int map_write_rle(map_t * map, const char * filename) {
+
+  int ifail = 0;
+  int ntotal[3] = {0};
+  int32_t run[2] = {0};          /* status, count */
+  double * data = NULL;
+  double * rdata = NULL;
+  FILE * fp = NULL;
+
+  assert(map);
+  assert(filename);
+
+  if (pe_mpi_size(map->pe) > 1) pe_fatal(map->pe, "map_write_rle() serial\n");
+
+  cs_ntotal(map->cs, ntotal);
+
+  data  = (double *) calloc(map->ndata + 1, sizeof(double));
+  rdata = (double *) calloc(map->ndata + 1, sizeof(double));
+  assert(data);
+  assert(rdata);
+  if (data == NULL || rdata == NULL) pe_fatal(map->pe, "calloc() failed\n");
+
+  fp = util_fopen(filename, "w");
+  if (fp == NULL) pe_fatal(map->pe, "Failed to open %s\n", filename);
+
+  {
+    int32_t header[5] = {MAP_RLE_MAGIC, ntotal[X], ntotal[Y], ntotal[Z],
+			 map->ndata};
+    if (fwrite(header, sizeof(int32_t), 5, fp) != 5) ifail = -1;
+  }
+
+  for (int ic = 1; ic <= ntotal[X]; ic++) {
+    for (int jc = 1; jc <= ntotal[Y]; jc++) {
+      for (int kc = 1; kc <= ntotal[Z]; kc++) {
+	int index = cs_index(map->cs, ic, jc, kc);
+	int status = MAP_FLUID;
+	int same = 0;
+
+	map_status(map, index, &status);
+	map_data(map, index, data);
+
+	same = (run[1] > 0 && run[0] == status && run[1] < INT32_MAX);
+	if (same && status != MAP_FLUID) {
+	  same = (memcmp(data, rdata, map->ndata*sizeof(double)) == 0);
+	}
+
+	if (same == 0) {
+	  if (run[1] > 0) ifail += map_rle_write_run(fp, run, map->ndata, rdata);
+	  run[0] = status;
+	  run[1] = 0;
+	  memcpy(rdata, data, map->ndata*sizeof(double));
+	}
+	run[1] += 1;
+      }
+    }
+  }
+
+  ifail += map_rle_write_run(fp, run, map->ndata, rdata);
+
+  if (ifail) pe_fatal(map->pe, "Write to %s failed\n", filename);
+
+  fclose(fp);
+  free(rdata);
+  free(data);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  map_rle_read_run
+ *
+ *  Data is zero for fluid runs. Returns zero on success.
+ *
+ *****************************************************************************/
+
+static int map_rle_read_run(FILE * fp, int32_t run[2], int ndata,
+			    double * data) {
+  assert(fp);
+  assert(data);
+
+  if (fread(run, sizeof(int32_t), 2, fp) != 2) return -1;
+  if (run[0] < 0 || run[0] >= MAP_STATUS_MAX || run[1] <= 0) return -1;
+
+  if (run[0] == MAP_FLUID) {
+    for (int n = 0; n < ndata; n++) data[n] = 0.0;
+  }
+  else {
+    size_t nr = fread(data, sizeof(double), ndata, fp);
+    if (nr != (size_t) ndata) return -1;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  map_rle_write_run
+ *
+ *****************************************************************************/
+
+static int map_rle_write_run(FILE * fp, const int32_t run[2], int ndata,
+			     const double * data) {
+  assert(fp);
+  assert(data);
+
+  if (fwrite(run, sizeof(int32_t), 2, fp) != 2) return -1;
+
+  if (run[0] != MAP_FLUID) {
+    size_t nw = fwrite(data, sizeof(double), ndata, fp);
+    if (nw != (size_t) ndata) return -1;
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  map_halo
@@ -525,6 +762,30 @@ static int map_read(FILE * fp, int index, void * self) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  map_read_buf
+ *
+ *  As map_read(), but the binary record is in memory (status, data).
+ *
+ *****************************************************************************/
+
+static int map_read_buf(map_t * map, int index, const char * buf) {
+
+  assert(map);
+  assert(buf);
+
+  map->status[addr_rank0(map->nsite, index)] = buf[0];
+
+  for (int n = 0; n < map->ndata; n++) {
+    int indexf = addr_rank1(map->nsite, map->ndata, index, n);
+    memcpy(&map->data[indexf], buf + sizeof(char) + n*sizeof(double),
+	   sizeof(double));
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  map_write_ascii
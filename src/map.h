@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2021 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -51,6 +51,8 @@ __host__ int map_volume_allreduce(map_t * obj, int status, int * volume);
 __host__ int map_halo(map_t * obj);
 __host__ int map_init_io_info(map_t * obj, int grid[3], int form_in, int form_out);
 __host__ int map_io_info(map_t * obj, io_info_t ** info);
+__host__ int map_read_rle(map_t * map, const char * filename);
+__host__ int map_write_rle(map_t * map, const char * filename);
 
 __host__ __device__ int map_status(map_t * obj, int index, int * status);
 __host__ __device__ int map_status_set(map_t * obj, int index, int status);
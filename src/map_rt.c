@@ -11,7 +11,7 @@
  *       Not to be confused with wall initialisations, which update
  *       the map status, but are separate (see wall_rt.c).
  *
- *  (c) 2021-2022 The University of Edinburgh
+ *  (c) 2021-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *    Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -95,7 +95,8 @@ int map_init_rt(pe_t * pe, cs_t * cs, rt_t * rt, map_t ** map) {
  *  map_init_porous_media_from_file
  *
  *  The file must have stub "capillary", e.g., "capillary.001-001"
- *  for serial.
+ *  for serial. A run-length encoded file ("porous_media_format RLE")
+ *  is "capillary.rle"; see map_read_rle().
  *
  *****************************************************************************/
 
@@ -162,8 +163,13 @@ int map_init_porous_media_from_file(pe_t * pe, cs_t * cs, rt_t * rt,
   map_init_io_info(map, grid, form_in, form_out);
   map_io_info(map, &iohandler);
 
-  io_info_set_processor_independent(iohandler);
-  io_read_data(iohandler, "capillary", map);
+  if (strcmp(format, "RLE") == 0) {
+    map_read_rle(map, "capillary.rle");
+  }
+  else {
+    io_info_set_processor_independent(iohandler);
+    io_read_data(iohandler, "capillary", map);
+  }
   map_pm_set(map, 1);
 
   map_halo(map);
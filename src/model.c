@@ -245,6 +245,10 @@ __host__ int lb_free(lb_t * lb) {
   lb_halo_free(lb, &lb->h);
   lb_model_free(&lb->model);
 
+  for (int n = 0; n < LB_COMMIT_MAX; n++) {
+    util_commit_reset(lb->commit + n);
+  }
+
   free(lb->param);
   free(lb);
 
@@ -375,8 +379,12 @@ __host__ int lb_collide_param_commit(lb_t * lb) {
 
   assert(lb);
 
-  tdpMemcpyToSymbol(tdpSymbol(static_param), lb->param,
-		    sizeof(lb_collide_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(lb->commit + LB_COMMIT_MODEL_PARAM,
+			   "model.c:static_param", lb->param,
+			   sizeof(lb_collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(static_param), lb->param,
+		      sizeof(lb_collide_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
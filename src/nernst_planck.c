@@ -71,6 +71,8 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "cs_limits.h"
+#include "hydro_impl.h"
 #include "advection.h"
 #include "advection_bcs.h"
 #include "nernst_planck.h"
@@ -87,14 +89,11 @@ static int nernst_planck_no_flux_condition(map_t * map, int nk, double * fx,
 					   double * fy, double * fz);
 static int nernst_planck_update(psi_t * psi, double * fe, double * fy,
 				double * fz);
-static int nernst_planck_fluxes_d3qx(psi_t * psi, fe_t * fe, hydro_t * hydro, 
-		map_t * map, colloids_info_t * cinfo, double ** flx);
-static int nernst_planck_update_d3qx(psi_t * psi, 
-				map_t * map, double ** flx);
 static double max_acc; 
 
-int np_advective_fluxes(psi_t * psi, hydro_t * hydro, double ** flux);
-int np_no_flux_boundary(psi_t * psi, map_t * map, double ** flux);
+static double np_d3qx_site(psi_t * psi, fe_t * fe, hydro_t * hydro,
+			   map_t * map, colloids_info_t * cinfo, double dt,
+			   int ic, int jc, int kc, double * rhonew);
 
 /*****************************************************************************
  *
@@ -344,155 +343,190 @@ static int nernst_planck_update(psi_t * psi, double * fx, double * fy,
  *  The map object is allowed to be NULL, in which case no boundary
  *  condition corrections are attempted.
  *
+ *  The advective and diffusive fluxes, the no-flux condition, and the
+ *  update are fused in a single pass over sites. As each site computes
+ *  all of its own link fluxes, there is no flux storage; the new charge
+ *  densities are held in the psi_t workspace until all sites are
+ *  complete.
+ *
+ *  The electrokinetic objects (psi_t and the electro free energies)
+ *  have no target copy, so the sites are shared between host threads
+ *  rather than run as a target kernel.
+ *
  *****************************************************************************/
 
 int nernst_planck_driver_d3qx(psi_t * psi, fe_t * fe, hydro_t * hydro, 
 			      map_t * map, colloids_info_t * cinfo) {
 
-  int nk;              /* Number of electrolyte species */
-  int ia;
-
-  double ** flx = NULL;
-
-  psi_nk(psi, &nk);
-
-  /* Allocate fluxes and initialise to zero */
-  flx = (double **) calloc((size_t) psi->nsites*nk, sizeof(double *));
-  assert(flx);
-  if (flx == NULL) pe_fatal(psi->pe, "calloc(flx) failed\n");
+  int nlocal[3] = {0};
+  double dt = 0.0;
+  double maxacc = 0.0;
 
-  for (ia = 0; ia < psi->nsites*nk; ia++) {
-    int nflux = psi->stencil->npoints;
-    flx[ia] = (double *) calloc(nflux-1, sizeof(double));
-    assert(flx[ia]);
-    if (flx[ia] == NULL) pe_fatal(psi->pe, "calloc(flx[]) failed\n");
-  }
+  assert(psi);
+  assert(psi->rhonew);
+  assert(fe);
+  assert(fe->func->mu_solv);
 
-  /* Add advective fluxes */
-  if (hydro) np_advective_fluxes(psi, hydro, flx);
+  cs_nlocal(psi->cs, nlocal);
+  psi_multistep_timestep(psi, &dt);
 
-  /* Add diffusive fluxes */
-  nernst_planck_fluxes_d3qx(psi, fe, hydro, map, cinfo, flx);
-  
-  /* Apply no-flux BC */
-  if (map) np_no_flux_boundary(psi, map, flx);
+  {
+    cs_limits_t lim = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
+    int nk = psi->nk;
+    int nsites = psi->nsites;
+
+    #pragma omp parallel
+    {
+      double amax = 0.0;
+
+      #pragma omp for
+      for (int ib = 0; ib < cs_limits_size(lim); ib++) {
+	int ic = cs_limits_ic(lim, ib);
+	int jc = cs_limits_jc(lim, ib);
+	int kc = cs_limits_kc(lim, ib);
+	double acc = np_d3qx_site(psi, fe, hydro, map, cinfo, dt, ic, jc, kc,
+				  psi->rhonew);
+	if (amax < acc) amax = acc;
+      }
 
-  /* Update charges */
-  nernst_planck_update_d3qx(psi, map, flx);
+      #pragma omp critical
+      {
+	if (maxacc < amax) maxacc = amax;
+      }
 
-  for (ia = 0; ia < psi->nsites*nk; ia++) {
-    free(flx[ia]);
+      /* Implicit barrier above; copy back the new densities */
+
+      #pragma omp for
+      for (int ib = 0; ib < cs_limits_size(lim); ib++) {
+	int ic = cs_limits_ic(lim, ib);
+	int jc = cs_limits_jc(lim, ib);
+	int kc = cs_limits_kc(lim, ib);
+	int index = cs_index(psi->cs, ic, jc, kc);
+	for (int n = 0; n < nk; n++) {
+	  psi->rho->data[addr_rank1(nsites, nk, index, n)]
+	    = psi->rhonew[addr_rank1(nsites, nk, index, n)];
+	}
+      }
+    }
   }
-  free(flx);
+
+  nernst_planck_maxacc_set(maxacc);
 
   return 0;
 }
 
 /*****************************************************************************
  *
- *  nernst_planck_fluxes_d3qx
+ *  np_d3qx_site
  *
- *  Compute diffusive fluxes.
+ *  At fluid site (ic, jc, kc), for each link in the stencil, the flux
+ *  is the 'centred difference' advective flux (if hydro), less the
+ *  diffusive flux to a fluid neighbour (for sites not in a colloid),
+ *  set to zero at a solid neighbour (if map). As we compute
+ *    rho(n+1) = rho(n) - div.flux,
+ *  the diffusive part carries an extra minus sign.
  *
- *  We assume we can accumulate the diffusive and advective fluxes separately.
- *
- *  As we compute rho(n+1) = rho(n) - div.flux in the update routine,
- *  there is an extra minus sign in the fluxes here. This conincides
- *  with the sign of the advective fluxes, if present.
+ *  The update is an Euler forward step into rhonew. The return value
+ *  is the maximum relative change in rho over species at this site.
  *
  *****************************************************************************/
 
-static int nernst_planck_fluxes_d3qx(psi_t * psi, fe_t * fe, hydro_t * hydro, 
-				     map_t * map, colloids_info_t * cinfo,
-				     double ** flx) {
-
-  int ic, jc, kc; 
-  int index0, index1;
-  int nlocal[3];
-  int n, nk; /* Number of charged species */
-  int c;
-  int status1;
-
-  double b0, b1;
-  double mu0, mu1;
-  double rho0, rho1;
-  double mu_s0, mu_s1;   /* Solvation chemical potential, from free energy */
-  
-  double eunit, reunit;
-  double dt;
-
+static double np_d3qx_site(psi_t * psi, fe_t * fe, hydro_t * hydro,
+			   map_t * map, colloids_info_t * cinfo, double dt,
+			   int ic, int jc, int kc, double * rhonew) {
+
+  const int nk = psi->nk;
+  const int nsites = psi->nsites;
+  const double * rho = psi->rho->data;
+  const double * psid = psi->psi->data;
+  const stencil_t * s = psi->stencil;
+
+  int index0 = cs_index(psi->cs, ic, jc, kc);
+  int status0 = MAP_FLUID;
+  double eunit = 0.0;
+  double reunit = 0.0;
+  double amax = 0.0;
+  double u0[3] = {0};
+  double mu0[PSI_NKMAX] = {0};
+  double acc[PSI_NKMAX] = {0};
   colloid_t * pc = NULL;
 
-  double * __restrict__ psidata = psi->psi->data;
-  double * __restrict__ rhodata = psi->rho->data;
-
   LB_RCS_TABLE(rcs);
 
-  assert(psi);
-  assert(fe);
-  assert(fe->func->mu_solv);
-  assert(flx);
-
-  cs_nlocal(psi->cs, nlocal);
-
   psi_unit_charge(psi, &eunit);
   reunit = 1.0/eunit;
 
-  psi_nk(psi, &nk);
-  psi_multistep_timestep(psi, &dt);
+  for (int n = 0; n < nk; n++) {
+    rhonew[addr_rank1(nsites, nk, index0, n)]
+      = rho[addr_rank1(nsites, nk, index0, n)];
+  }
 
+  if (map) map_status(map, index0, &status0);
+  if (status0 != MAP_FLUID) return amax;
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  if (cinfo) colloids_info_map(cinfo, index0, &pc);
+  if (hydro) hydro_u(hydro, index0, u0);
 
-	index0 = cs_index(psi->cs, ic, jc, kc);
-        colloids_info_map(cinfo, index0, &pc);
+  if (pc == NULL) {
+    for (int n = 0; n < nk; n++) {
+      double mu_s0 = 0.0;
+      fe->func->mu_solv(fe, index0, n, &mu_s0);
+      mu0[n] = reunit*mu_s0 + psi->valency[n]*psid[addr_rank0(nsites, index0)];
+    }
+  }
 
-	if (pc) {
-	  continue;
-	}
-	else {
-	  stencil_t * s = psi->stencil;
-	  assert(s);
+  for (int p = 1; p < s->npoints; p++) {
 
-	  for (c = 1; c < s->npoints; c++) {
+    int8_t cx  = s->cv[p][X];
+    int8_t cy  = s->cv[p][Y];
+    int8_t cz  = s->cv[p][Z];
+    int8_t pcv = cx*cx + cy*cy + cz*cz;
+    int index1 = cs_index(psi->cs, ic + cx, jc + cy, kc + cz);
+    int status1 = MAP_FLUID;
+    double u = 0.0;
 
-	    int8_t cx  = s->cv[c][X];
-	    int8_t cy  = s->cv[c][Y];
-	    int8_t cz  = s->cv[c][Z];
-	    int8_t pcv = cx*cx + cy*cy + cz*cz;
+    if (map) map_status(map, index1, &status1);
 
-	    index1 = cs_index(psi->cs, ic + cx, jc + cy, kc + cz);
-	    map_status(map, index1, &status1);
+    if (hydro) {
+      double u1[3] = {0};
+      hydro_u(hydro, index1, u1);
+      u = 0.5*((u0[X]+u1[X])*cx + (u0[Y]+u1[Y])*cy + (u0[Z]+u1[Z])*cz);
+    }
 
-	    if (status1 == MAP_FLUID) {
+    for (int n = 0; n < nk; n++) {
 
-	      for (n = 0; n < nk; n++) {
+      double rho0 = rho[addr_rank1(nsites, nk, index0, n)];
+      double rho1 = rho[addr_rank1(nsites, nk, index1, n)];
+      double flux = 0.0;
 
-		fe->func->mu_solv(fe, index0, n, &mu_s0);
-		mu0 = reunit*mu_s0
-		  + psi->valency[n]*psidata[addr_rank0(psi->nsites, index0)];
-		rho0 = rhodata[addr_rank1(psi->nsites, nk, index0, n)];
+      if (hydro) flux = u*0.5*(rho0 + rho1);
 
-		fe->func->mu_solv(fe, index1, n, &mu_s1);
-		mu1 = reunit*mu_s1
-		  + psi->valency[n]* psidata[addr_rank0(psi->nsites, index1)];
-		b0 = exp(mu0 - mu1);
-		b1 = exp(mu1 - mu0);
-		rho1 = rhodata[addr_rank1(psi->nsites, nk, index1, n)]*b1;
-
-		flx[addr_rank1(psi->nsites, nk, index0, n)][c - 1]
-		  -= psi->diffusivity[n]*0.5*(1.0 + b0)*(rho1 - rho0)*rcs[pcv];
-	      }
-	    }
-	  }
-        }
+      if (pc == NULL && status1 == MAP_FLUID) {
+	double mu_s1 = 0.0;
+	double mu1 = 0.0;
+	double b0, b1;
+	fe->func->mu_solv(fe, index1, n, &mu_s1);
+	mu1 = reunit*mu_s1 + psi->valency[n]*psid[addr_rank0(nsites, index1)];
+	b0 = exp(mu0[n] - mu1);
+	b1 = exp(mu1 - mu0[n]);
+	rho1 = rho1*b1;
+	flux -= psi->diffusivity[n]*0.5*(1.0 + b0)*(rho1 - rho0)*rcs[pcv];
       }
+
+      /* No normal flux at solid */
+      if (map) flux *= (status1 == MAP_FLUID);
+
+      rhonew[addr_rank1(nsites, nk, index0, n)] -= flux*dt;
+      acc[n] += fabs(flux*dt);
     }
   }
 
-  return 0;
+  for (int n = 0; n < nk; n++) {
+    acc[n] /= fabs(rhonew[addr_rank1(nsites, nk, index0, n)]);
+    if (amax < acc[n]) amax = acc[n];
+  }
+
+  return amax;
 }
 
 /*****************************************************************************
@@ -675,66 +709,6 @@ int nernst_planck_fluxes_force_d3qx(psi_t * psi, fe_t * fe, hydro_t * hydro,
   return 0;
 }
 
-/*****************************************************************************
- *
- *  nernst_planck_update_d3qx
- *
- *  Update the rho_k from the fluxes (D3QX stencil). Euler forward step.
- *
- *****************************************************************************/
-
-static int nernst_planck_update_d3qx(psi_t * psi, map_t * map, double ** flx) {
-
-  int ic, jc, kc, index;
-  int nsites;
-  int nlocal[3];
-  int n, nk;
-  int c;
-  int status;
-  double acc, maxacc=0.0;
-  double dt;
-
-  assert(psi);
-  assert(flx);
-
-  cs_nsites(psi->cs, &nsites);
-  cs_nlocal(psi->cs, nlocal);
-
-  psi_nk(psi, &nk);
-  psi_multistep_timestep(psi, &dt);
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-
-	index = cs_index(psi->cs, ic, jc, kc);
-        map_status(map, index, &status);
-
-        if (status == MAP_FLUID) {
-	  stencil_t * s = psi->stencil;
-	  for (n = 0; n < nk; n++) {
-
-	    acc = 0.0;
-	    for (c = 1; c < s->npoints; c++) {
-	      psi->rho->data[addr_rank1(nsites, nk, index, n)]
-		-= flx[addr_rank1(nsites, nk, index, n)][c - 1] * dt;
-	      acc += fabs(flx[addr_rank1(nsites, nk, index, n)][c - 1] * dt);
-	    }
-
-	    acc /= fabs(psi->rho->data[addr_rank1(nsites, nk, index, n)]);
-	    if (maxacc < acc) maxacc = acc; 
-	  }
-	}
-
-      }
-    }
-  }
-
-  nernst_planck_maxacc_set(maxacc);
-
-  return 0;
-}
-
 /*****************************************************************************
  *
  *  nernst_planck_maxacc_set
@@ -821,125 +795,3 @@ int nernst_planck_adjust_multistep(psi_t * psi) {
 
   return 0;
 } 
-
-/*****************************************************************************
- *
- *  np_advective_fluxes
- *
- *  'Centred difference' advective fluxes for the char densities rho.
- *
- *  Symmetric two-point stencil.
- *
- *****************************************************************************/
-
-int np_advective_fluxes(psi_t * psi, hydro_t * hydro, double ** flx) {
-
-  int nlocal[3] = {0};
-  cs_t * cs = NULL;
-  stencil_t * s = NULL;
-
-  double * __restrict__ rho = psi->rho->data;
-
-  assert(psi);
-  assert(hydro);
-  assert(flx);
-
-  cs = psi->cs;
-  s = psi->stencil;
-  assert(cs);
-  assert(s);
-
-  cs_nlocal(cs, nlocal);
-
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
-
-	int index0 = cs_index(cs, ic, jc, kc);
-	double u0[3] = {0};
-	hydro_u(hydro, index0, u0);
-
-        for (int p = 1; p < s->npoints; p++) {
-
-	  int8_t cx = s->cv[p][X];
-	  int8_t cy = s->cv[p][Y];
-	  int8_t cz = s->cv[p][Z];
-	  int index1 = cs_index(cs, ic + cx, jc + cy, kc + cz);
-	  double u1[3] = {0};
-	  double u = 0.0;
-	  hydro_u(hydro, index1, u1);
-
-	  u = 0.5*((u0[X]+u1[X])*cx + (u0[Y]+u1[Y])*cy + (u0[Z]+u1[Z])*cz);
-
-	  for (int n = 0; n < psi->nk; n++) {
-	    double rho0 = rho[addr_rank1(psi->nsites, psi->nk, index0, n)];
-	    double rho1 = rho[addr_rank1(psi->nsites, psi->nk, index1, n)];
-	    double flux = u*0.5*(rho0 + rho1);
-	    flx[addr_rank1(psi->nsites, psi->nk, index0, n)][p-1] = flux;
-	  }
-	}
-	/* Next site */
-      }
-    }
-  }
-
-  return 0;
-}
-
-/*****************************************************************************
- *
- *  advective_bcs_no_flux_d3qx
- *
- *  Set normal fluxes at solid fluid interfaces to zero.
- *
- *****************************************************************************/
-
-int np_no_flux_boundary(psi_t * psi, map_t * map, double ** flx) {
-
-  int nlocal[3] = {0};
-  cs_t * cs = NULL;
-  stencil_t * s = NULL;
-
-  assert(psi);
-  assert(map);
-  assert(flx);
-
-  cs = psi->cs;
-  s  = psi->stencil;
-  assert(cs);
-  assert(s);
-
-  cs_nlocal(cs, nlocal);
-
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
-
-	int index0 = cs_index(cs, ic, jc, kc);
-	int mask0  = 1;
-	int status = MAP_BOUNDARY;
-	map_status(map, index0, &status);
-	mask0 = (status == MAP_FLUID);
-
-	for (int p = 1; p < s->npoints; p++) {
-
-	  int8_t cx = s->cv[p][X];
-	  int8_t cy = s->cv[p][Y];
-	  int8_t cz = s->cv[p][Z];
-	  int index1 = cs_index(cs, ic + cx, jc + cy, kc + cz);
-	  int mask = 1;
-
-	  map_status(map, index1, &status);
-	  mask = (status == MAP_FLUID);
-	  mask = mask*mask0;
-
-	  for (int n = 0;  n < psi->nk; n++) {
-	    flx[addr_rank1(psi->nsites, psi->nk, index0, n)][p-1] *= mask;
-	  }
-	}
-      }
-    }
-  }
-
-  return 0;
-}
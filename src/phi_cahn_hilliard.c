@@ -24,11 +24,22 @@
  *  This requires fixes at the plane boudaries to get consistent
  *  fluxes.
  *
+ *  An optional linearly stabilised semi-implicit update is available
+ *  (info.implicit). If the explicit update is d phi = -div F, then
+ *  we solve
+ *
+ *     (1 + M A \nabla^4) delta = -div F
+ *
+ *  for the actual increment delta, where A is a stabilising
+ *  coefficient (typically the interfacial kappa). The extra term
+ *  is added to the face fluxes, so the conservative flux form, the
+ *  no-flux boundaries and the Lees-Edwards fix up are retained.
+ *
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributions:
  *  Thanks to Markus Gross, who helped to validate the noise implementation.
@@ -61,6 +72,21 @@ static int phi_ch_random_flux(phi_ch_t * pch, noise_t * noise);
 static int phi_ch_subtract_sum_phi_after_forward_step(phi_ch_t * pch,
 						      field_t * phif,
 						      map_t * map);
+
+static int phi_ch_si_create(phi_ch_t * pch, phi_ch_si_t ** si);
+static int phi_ch_si_free(phi_ch_si_t * si);
+static int phi_ch_semi_implicit(phi_ch_t * pch, map_t * map);
+
+/* Semi-implicit workspace */
+
+struct phi_ch_si_s {
+  field_t * x;          /* Solution (the increment delta) */
+  field_t * r;          /* Residual */
+  field_t * p;          /* Search direction */
+  field_t * ap;         /* Operator applied to search direction */
+  field_t * w;          /* Laplacian (temporary) */
+  double * sum;         /* Device reduction result */
+};
 /* Utility container */
 
 typedef struct ch_kernel_s ch_kernel_t;
@@ -112,6 +138,26 @@ __global__ static void phi_ch_var_flux_acc_kernel(kernel_ctxt_t * ktx,
 						  const field_t * var,
 						  advflux_t * flux);
 
+__global__ static void phi_ch_si_rhs_kernel(kernel_ctxt_t * ktx,
+					    lees_edw_t * le,
+					    advflux_t * flux, field_t * x,
+					    field_t * r, field_t * p,
+					    int ys, double wz);
+__global__ static void phi_ch_si_laplacian_kernel(kernel_ctxt_t * ktx,
+						  lees_edw_t * le, map_t * map,
+						  field_t * in, field_t * out);
+__global__ static void phi_ch_si_axpby_kernel(kernel_ctxt_t * ktx,
+					      lees_edw_t * le, double a,
+					      field_t * x, double b,
+					      field_t * y);
+__global__ static void phi_ch_si_dot_kernel(kernel_ctxt_t * ktx,
+					    lees_edw_t * le, field_t * a,
+					    field_t * b, double * sum);
+__global__ static void phi_ch_si_flux_kernel(kernel_ctxt_t * ktx,
+					     lees_edw_t * le, map_t * map,
+					     field_t * w, advflux_t * flux,
+					     double c);
+
 /*****************************************************************************
  *
  *  phi_ch_create
@@ -138,6 +184,7 @@ __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
   obj->cs = cs;
   obj->le = le;
   obj->info = *options;
+  obj->dt = 1.0;
   advflux_le_create(pe, cs, le, 1, &obj->flux);
 
   if (obj->info.conserve) {
@@ -145,6 +192,12 @@ __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
     field_create(pe, cs, NULL, "compensated sum", &opts, &obj->csum);
   }
 
+  if (obj->info.implicit) {
+    if (obj->info.maxits <= 0) obj->info.maxits = 1000;
+    if (obj->info.reltol <= 0.0) obj->info.reltol = 1.0e-08;
+    phi_ch_si_create(obj, &obj->si);
+  }
+
   pe_retain(pe);
   lees_edw_retain(le);
 
@@ -167,12 +220,32 @@ __host__ int phi_ch_free(phi_ch_t * pch) {
   pe_free(pch->pe);
 
   if (pch->csum) field_free(pch->csum);
+  if (pch->si) phi_ch_si_free(pch->si);
   advflux_free(pch->flux);
   free(pch);
   
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  phi_ch_dt_set
+ *
+ *  A time step other than unity allows sub-cycling (dt < 1) or
+ *  less frequent updates (dt > 1) relative to the LB step.
+ *
+ *****************************************************************************/
+
+__host__ int phi_ch_dt_set(phi_ch_t * pch, double dt) {
+
+  assert(pch);
+  assert(dt > 0.0);
+
+  pch->dt = dt;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  phi_cahn_hilliard
@@ -218,6 +291,10 @@ int phi_cahn_hilliard(phi_ch_t * pch, fe_t * fe, field_t * phi,
   field_nf(phi, &nf);
   assert(nf == 1);
 
+  if (noise_phi && pch->dt != 1.0) {
+    pe_fatal(pch->pe, "Cahn-Hilliard noise requires unit time step\n");
+  }
+
   /* Compute any advective fluxes first, then accumulate diffusive
    * and random fluxes. */
 
@@ -267,6 +344,14 @@ int phi_cahn_hilliard(phi_ch_t * pch, fe_t * fe, field_t * phi,
 
   if (map) advection_bcs_no_normal_flux(nf, pch->flux, map);
 
+  /* All fluxes so far are per unit time */
+
+  if (pch->dt != 1.0) advflux_scale(pch->flux, pch->dt);
+
+  /* Stabilising implicit contribution (fluxes again) */
+
+  if (pch->info.implicit) phi_ch_semi_implicit(pch, map);
+
   phi_ch_le_fix_fluxes(pch, nf);
 
   /* TODO REPLACE 1/2 WITH MEANINGFUL SYMBOLS */
@@ -324,7 +409,6 @@ static int phi_ch_flux_mu1(phi_ch_t * pch, fe_t * fe) {
   tdpLaunchKernel(phi_ch_flux_mu1_kernel, nblk, ntpb, 0, 0,
 		  ctxt->target, letarget, fetarget, pch->flux->target, mobility);
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   kernel_ctxt_free(ctxt);
 
@@ -972,7 +1056,8 @@ static int phi_ch_le_fix_fluxes_parallel(phi_ch_t * pch, int nf) {
  *
  *  phi new = phi old - dt*(flux_out - flux_in)
  *
- *  The time step is the LB time step dt = 1. All sites are processed
+ *  The time step dt (by default the LB time step dt = 1) is already
+ *  included in the fluxes; see phi_ch_dt_set(). All sites are processed
  *  to include solid-stored values in the case of Langmuir-Hinshelwood.
  *  It also avoids a conditional on solid/fluid status.
  *
@@ -1005,7 +1090,6 @@ static int phi_ch_update_forward_step(phi_ch_t * pch, field_t * phif) {
 		  ctxt->target, le, phif->target, pch->flux->target, ys, wz);
 
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   kernel_ctxt_free(ctxt);
 
@@ -1099,7 +1183,6 @@ static int phi_ch_update_conserve(phi_ch_t * pch, field_t * phi) {
 		  pch->csum->target, ys, wz);
 
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   kernel_ctxt_free(ctxt);
 
@@ -1151,7 +1234,6 @@ static int phi_ch_subtract_sum_phi_after_forward_step(phi_ch_t * pch, field_t *
 		  ctxt->target, phif->target, map->target, local_d);
 
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   /* Communication stage for global correction... */
   tdpAssert(tdpMemcpy(&local, local_d, sizeof(phi_correct_t),
@@ -1176,7 +1258,6 @@ static int phi_ch_subtract_sum_phi_after_forward_step(phi_ch_t * pch, field_t *
 		  ctxt->target, phif->target, map->target, local_d);
 
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   kernel_ctxt_free(ctxt);
   tdpFree(local_d);
@@ -1385,7 +1466,6 @@ static int phi_ch_flux_mu_ext(phi_ch_t * pch) {
   tdpLaunchKernel(phi_ch_flux_mu_ext_kernel, nblk, ntpb, 0, 0,
 		  ctxt->target, letarget, pch->flux->target, ch);
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   kernel_ctxt_free(ctxt);
 
@@ -1464,7 +1544,6 @@ __host__ int phi_ch_dif_flux_driver(phi_ch_t * pch, fe_t * fe,
     tdpLaunchKernel(phi_ch_dif_flux_kernel, nblk, ntpb, 0, 0,
 		    ctxt->target, pch->flux->target, fetarget, mobility);
     tdpAssert(tdpPeekAtLastError());
-    tdpAssert(tdpDeviceSynchronize());
 
     kernel_ctxt_free(ctxt);
   }
@@ -1601,7 +1680,6 @@ __host__ int phi_ch_var_flux_driver(field_t * var,
 		    ctxt->target, var->target, noise->target, mktvar);
 
     tdpAssert(tdpPeekAtLastError());
-    tdpAssert(tdpDeviceSynchronize());
 
     kernel_ctxt_free(ctxt);
   }
@@ -1674,7 +1752,6 @@ __host__ int phi_ch_var_flux_acc_driver(phi_ch_t * pch, const field_t * var) {
 		    ctxt->target, var->target, pch->flux->target);
 
     tdpAssert(tdpPeekAtLastError());
-    tdpAssert(tdpDeviceSynchronize());
 
     kernel_ctxt_free(ctxt);
   }
@@ -1745,3 +1822,603 @@ __global__ static void phi_ch_var_flux_acc_kernel(kernel_ctxt_t * ktx,
 
   return;
 }
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_create
+ *
+ *  Workspace for the semi-implicit solve. The fields carry the
+ *  Lees-Edwards buffers so the same halo/interpolation applies.
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_create(phi_ch_t * pch, phi_ch_si_t ** psi) {
+
+  int nhalo = 0;
+  phi_ch_si_t * si = NULL;
+  field_options_t opts = {0};
+
+  assert(pch);
+  assert(psi);
+
+  si = (phi_ch_si_t *) calloc(1, sizeof(phi_ch_si_t));
+  assert(si);
+  if (si == NULL) pe_fatal(pch->pe, "calloc(phi_ch_si_t) failed\n");
+
+  cs_nhalo(pch->cs, &nhalo);
+  opts = field_options_ndata_nhalo(1, nhalo);
+
+  field_create(pch->pe, pch->cs, pch->le, "si-x",  &opts, &si->x);
+  field_create(pch->pe, pch->cs, pch->le, "si-r",  &opts, &si->r);
+  field_create(pch->pe, pch->cs, pch->le, "si-p",  &opts, &si->p);
+  field_create(pch->pe, pch->cs, pch->le, "si-ap", &opts, &si->ap);
+  field_create(pch->pe, pch->cs, pch->le, "si-w",  &opts, &si->w);
+
+  tdpAssert(tdpMalloc((void **) &si->sum, sizeof(double)));
+
+  *psi = si;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_free
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_free(phi_ch_si_t * si) {
+
+  assert(si);
+
+  tdpAssert(tdpFree(si->sum));
+  field_free(si->w);
+  field_free(si->ap);
+  field_free(si->p);
+  field_free(si->r);
+  field_free(si->x);
+  free(si);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_halo
+ *
+ *  Halo swap plus Lees-Edwards buffer interpolation, if required.
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_halo(phi_ch_t * pch, field_t * f) {
+
+  assert(pch);
+  assert(f);
+
+  field_halo(f);
+  if (lees_edw_nplane_total(pch->le) > 0) field_leesedwards(f);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_dot
+ *
+ *  Global inner product (a, b) over the local domain.
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_dot(phi_ch_t * pch, kernel_ctxt_t * ctxt,
+			 field_t * a, field_t * b, double * result) {
+
+  double sum_local = 0.0;
+  dim3 nblk, ntpb;
+  lees_edw_t * le = NULL;
+  MPI_Comm comm = MPI_COMM_NULL;
+
+  assert(pch);
+  assert(ctxt);
+  assert(result);
+
+  lees_edw_target(pch->le, &le);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpAssert(tdpMemcpy(pch->si->sum, &sum_local, sizeof(double),
+		      tdpMemcpyHostToDevice));
+
+  tdpLaunchKernel(phi_ch_si_dot_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, le, a->target, b->target, pch->si->sum);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  tdpAssert(tdpMemcpy(&sum_local, pch->si->sum, sizeof(double),
+		      tdpMemcpyDeviceToHost));
+
+  cs_cart_comm(pch->cs, &comm);
+  MPI_Allreduce(&sum_local, result, 1, MPI_DOUBLE, MPI_SUM, comm);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_axpby
+ *
+ *  y <- a x + b y
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_axpby(phi_ch_t * pch, kernel_ctxt_t * ctxt,
+			   double a, field_t * x, double b, field_t * y) {
+  dim3 nblk, ntpb;
+  lees_edw_t * le = NULL;
+
+  assert(pch);
+  assert(ctxt);
+
+  lees_edw_target(pch->le, &le);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  tdpLaunchKernel(phi_ch_si_axpby_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, le, a, x->target, b, y->target);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_laplacian
+ *
+ *  out <- \nabla^2 in (the halo of "in" is updated first).
+ *
+ *****************************************************************************/
+
+static int phi_ch_si_laplacian(phi_ch_t * pch, kernel_ctxt_t * ctxt,
+			       map_t * map, field_t * in, field_t * out) {
+  dim3 nblk, ntpb;
+  lees_edw_t * le = NULL;
+  map_t * maptarget = NULL;
+
+  assert(pch);
+  assert(ctxt);
+
+  lees_edw_target(pch->le, &le);
+  if (map) maptarget = map->target;
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  phi_ch_si_halo(pch, in);
+
+  tdpLaunchKernel(phi_ch_si_laplacian_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, le, maptarget, in->target, out->target);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_semi_implicit
+ *
+ *  The current fluxes F (advective, diffusive, any noise) give the
+ *  explicit increment b = -div F. We solve
+ *
+ *    (1 + c \nabla^2 \nabla^2) x = b     with c = dt M A
+ *
+ *  via conjugate gradient (the operator is symmetric positive
+ *  definite) and add the face fluxes c grad (\nabla^2 x), so that
+ *  the forward step produces x.
+ *
+ *  The Laplacian has no-flux faces at solid sites, consistent with
+ *  the existing boundary conditions, so phi is conserved.
+ *
+ *****************************************************************************/
+
+static int phi_ch_semi_implicit(phi_ch_t * pch, map_t * map) {
+
+  int nlocal[3];
+  int xs, ys, zs;
+  int converged = 0;
+  double wz = 1.0;
+  double mobility = 0.0;
+  double c;
+  double rr0 = 0.0, rr = 0.0, rrnew = 0.0, pap = 0.0;
+  dim3 nblk, ntpb;
+
+  physics_t * phys = NULL;
+  phi_ch_si_t * si = NULL;
+  lees_edw_t * le = NULL;
+  map_t * maptarget = NULL;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  kernel_ctxt_t * ctxtf = NULL;
+
+  assert(pch);
+  assert(pch->si);
+
+  si = pch->si;
+
+  physics_ref(&phys);
+  physics_mobility(phys, &mobility);
+  c = pch->dt*mobility*pch->info.stabiliser;
+
+  lees_edw_nlocal(pch->le, nlocal);
+  lees_edw_target(pch->le, &le);
+  lees_edw_strides(pch->le, &xs, &ys, &zs);
+  if (nlocal[Z] == 1) wz = 0.0;
+  if (map) maptarget = map->target;
+
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
+
+  kernel_ctxt_create(pch->cs, 1, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
+
+  /* Right hand side b = -div F; x = 0, r = p = b */
+
+  tdpLaunchKernel(phi_ch_si_rhs_kernel, nblk, ntpb, 0, 0,
+		  ctxt->target, le, pch->flux->target, si->x->target,
+		  si->r->target, si->p->target, ys, wz);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  phi_ch_si_dot(pch, ctxt, si->r, si->r, &rr0);
+  rr = rr0;
+
+  if (rr0 > 0.0) {
+
+    for (int n = 0; n < pch->info.maxits; n++) {
+
+      /* ap = p + c \nabla^2 \nabla^2 p */
+      phi_ch_si_laplacian(pch, ctxt, map, si->p, si->w);
+      phi_ch_si_laplacian(pch, ctxt, map, si->w, si->ap);
+      phi_ch_si_axpby(pch, ctxt, 1.0, si->p, c, si->ap);
+
+      phi_ch_si_dot(pch, ctxt, si->p, si->ap, &pap);
+
+      phi_ch_si_axpby(pch, ctxt, +rr/pap, si->p,  1.0, si->x);
+      phi_ch_si_axpby(pch, ctxt, -rr/pap, si->ap, 1.0, si->r);
+
+      phi_ch_si_dot(pch, ctxt, si->r, si->r, &rrnew);
+
+      if (rrnew < pch->info.reltol*pch->info.reltol*rr0) {
+	converged = 1;
+	break;
+      }
+
+      phi_ch_si_axpby(pch, ctxt, 1.0, si->r, rrnew/rr, si->p);
+      rr = rrnew;
+    }
+
+    if (converged == 0) {
+      pe_info(pch->pe, "\n");
+      pe_info(pch->pe, "Cahn-Hilliard implicit solve exceeded %d iterations\n",
+	      pch->info.maxits);
+      pe_info(pch->pe, "Residual %14.7e (initial) %14.7e (final)\n\n",
+	      sqrt(rr0), sqrt(rrnew));
+    }
+
+    /* Stabilising fluxes c grad w, with w = \nabla^2 x, which
+     * require w in the halo region. */
+
+    phi_ch_si_laplacian(pch, ctxt, map, si->x, si->w);
+    phi_ch_si_halo(pch, si->w);
+
+    limits.imin = 1; limits.imax = nlocal[X];
+    limits.jmin = 0; limits.jmax = nlocal[Y];
+    limits.kmin = 0; limits.kmax = nlocal[Z];
+
+    kernel_ctxt_create(pch->cs, 1, limits, &ctxtf);
+    kernel_ctxt_launch_param(ctxtf, &nblk, &ntpb);
+
+    tdpLaunchKernel(phi_ch_si_flux_kernel, nblk, ntpb, 0, 0,
+		    ctxtf->target, le, maptarget, si->w->target,
+		    pch->flux->target, c);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+
+    kernel_ctxt_free(ctxtf);
+  }
+
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_fluid
+ *
+ *  Returns 1.0 for a fluid site, 0.0 otherwise (map may be NULL).
+ *
+ *****************************************************************************/
+
+static __host__ __device__ double phi_ch_si_fluid(kernel_ctxt_t * ktx,
+						  map_t * map,
+						  int ic, int jc, int kc) {
+  int status = MAP_FLUID;
+
+  if (map) {
+    int index = kernel_coords_index(ktx, ic, jc, kc);
+    map_status(map, index, &status);
+  }
+
+  return (status == MAP_FLUID) ? 1.0 : 0.0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_rhs_kernel
+ *
+ *****************************************************************************/
+
+__global__ static void phi_ch_si_rhs_kernel(kernel_ctxt_t * ktx,
+					    lees_edw_t * le,
+					    advflux_t * flux, field_t * x,
+					    field_t * r, field_t * p,
+					    int ys, double wz) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(le);
+  assert(flux);
+
+  kiterations = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = lees_edw_index(le, ic, jc, kc);
+
+    double b = -(+ flux->fe[addr_rank0(flux->nsite, index)]
+		 - flux->fw[addr_rank0(flux->nsite, index)]
+		 + flux->fy[addr_rank0(flux->nsite, index)]
+		 - flux->fy[addr_rank0(flux->nsite, index - ys)]
+		 + wz*flux->fz[addr_rank0(flux->nsite, index)]
+		 - wz*flux->fz[addr_rank0(flux->nsite, index - 1)]);
+
+    x->data[addr_rank1(x->nsites, 1, index, 0)] = 0.0;
+    r->data[addr_rank1(r->nsites, 1, index, 0)] = b;
+    p->data[addr_rank1(p->nsites, 1, index, 0)] = b;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_laplacian_kernel
+ *
+ *  Seven-point Laplacian with zero flux across fluid/solid faces.
+ *  The mask uses the real system coordinates (cf. advection_bcs.c).
+ *
+ *****************************************************************************/
+
+__global__ static void phi_ch_si_laplacian_kernel(kernel_ctxt_t * ktx,
+						  lees_edw_t * le, map_t * map,
+						  field_t * in, field_t * out) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(le);
+  assert(in);
+  assert(out);
+
+  kiterations = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int icm1 = lees_edw_ic_to_buff(le, ic, -1);
+    int icp1 = lees_edw_ic_to_buff(le, ic, +1);
+    int index0 = lees_edw_index(le, ic, jc, kc);
+
+    double m0 = phi_ch_si_fluid(ktx, map, ic, jc, kc);
+    double f0 = in->data[addr_rank1(in->nsites, 1, index0, 0)];
+    double lap = 0.0;
+
+    {
+      int index1 = lees_edw_index(le, icm1, jc, kc);
+      double m1 = phi_ch_si_fluid(ktx, map, ic-1, jc, kc);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+    {
+      int index1 = lees_edw_index(le, icp1, jc, kc);
+      double m1 = phi_ch_si_fluid(ktx, map, ic+1, jc, kc);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+    {
+      int index1 = lees_edw_index(le, ic, jc-1, kc);
+      double m1 = phi_ch_si_fluid(ktx, map, ic, jc-1, kc);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+    {
+      int index1 = lees_edw_index(le, ic, jc+1, kc);
+      double m1 = phi_ch_si_fluid(ktx, map, ic, jc+1, kc);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+    {
+      int index1 = lees_edw_index(le, ic, jc, kc-1);
+      double m1 = phi_ch_si_fluid(ktx, map, ic, jc, kc-1);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+    {
+      int index1 = lees_edw_index(le, ic, jc, kc+1);
+      double m1 = phi_ch_si_fluid(ktx, map, ic, jc, kc+1);
+      lap += m1*(in->data[addr_rank1(in->nsites, 1, index1, 0)] - f0);
+    }
+
+    out->data[addr_rank1(out->nsites, 1, index0, 0)] = m0*lap;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_axpby_kernel
+ *
+ *****************************************************************************/
+
+__global__ static void phi_ch_si_axpby_kernel(kernel_ctxt_t * ktx,
+					      lees_edw_t * le, double a,
+					      field_t * x, double b,
+					      field_t * y) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(le);
+  assert(x);
+  assert(y);
+
+  kiterations = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = lees_edw_index(le, ic, jc, kc);
+    int iaddr = addr_rank1(y->nsites, 1, index, 0);
+
+    y->data[iaddr] = a*x->data[iaddr] + b*y->data[iaddr];
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_dot_kernel
+ *
+ *  Local contribution to (a, b) accumulated to sum.
+ *
+ *****************************************************************************/
+
+__global__ static void phi_ch_si_dot_kernel(kernel_ctxt_t * ktx,
+					    lees_edw_t * le, field_t * a,
+					    field_t * b, double * sum) {
+  int kindex;
+  int kiterations;
+  int tid;
+
+  __shared__ double sum_local[TARGET_MAX_THREADS_PER_BLOCK];
+
+  assert(ktx);
+  assert(le);
+  assert(a);
+  assert(b);
+  assert(sum);
+
+  kiterations = kernel_iterations(ktx);
+
+  tid = threadIdx.x;
+  sum_local[tid] = 0.0;
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int index = lees_edw_index(le, ic, jc, kc);
+    int iaddr = addr_rank1(a->nsites, 1, index, 0);
+
+    sum_local[tid] += a->data[iaddr]*b->data[iaddr];
+  }
+
+  /* Reduction */
+
+  __syncthreads();
+
+  if (tid == 0) {
+    double sum_block = 0.0;
+    for (int it = 0; it < blockDim.x; it++) {
+      sum_block += sum_local[it];
+    }
+    tdpAtomicAddDouble(sum, sum_block);
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  phi_ch_si_flux_kernel
+ *
+ *  Accumulate the stabilising fluxes c grad w at each face (zero at
+ *  fluid/solid faces). The divergence of these is c \nabla^2 w
+ *  with the same Laplacian as above.
+ *
+ *****************************************************************************/
+
+__global__ static void phi_ch_si_flux_kernel(kernel_ctxt_t * ktx,
+					     lees_edw_t * le, map_t * map,
+					     field_t * w, advflux_t * flux,
+					     double c) {
+  int kindex;
+  int kiterations;
+
+  assert(ktx);
+  assert(le);
+  assert(w);
+  assert(flux);
+
+  kiterations = kernel_iterations(ktx);
+
+  for_simt_parallel(kindex, kiterations, 1) {
+
+    int ic = kernel_coords_ic(ktx, kindex);
+    int jc = kernel_coords_jc(ktx, kindex);
+    int kc = kernel_coords_kc(ktx, kindex);
+    int icm1 = lees_edw_ic_to_buff(le, ic, -1);
+    int icp1 = lees_edw_ic_to_buff(le, ic, +1);
+    int index0 = lees_edw_index(le, ic, jc, kc);
+    int index1;
+
+    double m0 = phi_ch_si_fluid(ktx, map, ic, jc, kc);
+    double m1;
+    double w0 = w->data[addr_rank1(w->nsites, 1, index0, 0)];
+    double w1;
+
+    /* x-direction (between ic-1 and ic) */
+
+    index1 = lees_edw_index(le, icm1, jc, kc);
+    m1 = phi_ch_si_fluid(ktx, map, ic-1, jc, kc);
+    w1 = w->data[addr_rank1(w->nsites, 1, index1, 0)];
+    flux->fw[addr_rank0(flux->nsite, index0)] += c*m0*m1*(w0 - w1);
+
+    /* ...and between ic and ic+1 */
+
+    index1 = lees_edw_index(le, icp1, jc, kc);
+    m1 = phi_ch_si_fluid(ktx, map, ic+1, jc, kc);
+    w1 = w->data[addr_rank1(w->nsites, 1, index1, 0)];
+    flux->fe[addr_rank0(flux->nsite, index0)] += c*m0*m1*(w1 - w0);
+
+    /* y direction */
+
+    index1 = lees_edw_index(le, ic, jc+1, kc);
+    m1 = phi_ch_si_fluid(ktx, map, ic, jc+1, kc);
+    w1 = w->data[addr_rank1(w->nsites, 1, index1, 0)];
+    flux->fy[addr_rank0(flux->nsite, index0)] += c*m0*m1*(w1 - w0);
+
+    /* z direction */
+
+    index1 = lees_edw_index(le, ic, jc, kc+1);
+    m1 = phi_ch_si_fluid(ktx, map, ic, jc, kc+1);
+    w1 = w->data[addr_rank1(w->nsites, 1, index1, 0)];
+    flux->fz[addr_rank0(flux->nsite, index0)] += c*m0*m1*(w1 - w0);
+  }
+
+  return;
+}
@@ -6,7 +6,7 @@
  *  Edinburgh Parallel Computing Centre
  *
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
- *  (c) 2010-2019 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
@@ -25,9 +25,14 @@
 
 typedef struct phi_ch_s phi_ch_t;
 typedef struct phi_ch_info_s phi_ch_info_t;
+typedef struct phi_ch_si_s phi_ch_si_t;
 
 struct phi_ch_info_s {
-  int conserve; /* 0 = normal; 1 = compensated sum */
+  int conserve;       /* 0 = normal; 1 = compensated sum */
+  int implicit;       /* 0 = explicit; 1 = stabilised semi-implicit */
+  double stabiliser;  /* Coefficient A of implicit biharmonic term */
+  int maxits;         /* Maximum iterations for implicit solve */
+  double reltol;      /* Relative tolerance for implicit solve */
 };
 
 struct phi_ch_s {
@@ -37,12 +42,15 @@ struct phi_ch_s {
   field_t * csum;
   lees_edw_t * le;
   advflux_t * flux;
+  phi_ch_si_t * si;   /* Semi-implicit workspace (if required) */
+  double dt;          /* Time step (default unity) */
 };
 
 __host__ int phi_ch_create(pe_t * pe, cs_t * cs, lees_edw_t * le,
 			   phi_ch_info_t * info,
 			   phi_ch_t ** pch);
 __host__ int phi_ch_free(phi_ch_t * pch);
+__host__ int phi_ch_dt_set(phi_ch_t * pch, double dt);
 
 __host__ int phi_cahn_hilliard(phi_ch_t * pch, fe_t * fe, field_t * phi,
 			       hydro_t * hydro, map_t * map,
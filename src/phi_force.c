@@ -18,7 +18,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2011-2022 The University of Edinburgh
+ *  (c) 2011-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -39,22 +39,47 @@
 #include "physics.h"
 
 
-static int phi_force_compute_fluxes(lees_edw_t * le, fe_t * fe, int nall,
-				    double * fxe,
-				    double * fxw,
-				    double * fxy,
-				    double * fxz);
-static int phi_force_flux_divergence(cs_t * cs, hydro_t * hydro, double * fe,
-				     double * fw, double * fy, double * fz);
+static int phi_force_flux_stress(cs_t * cs, lees_edw_t * le, fe_t * fe,
+				 int nall, double * str);
+static int phi_force_compute_fluxes(cs_t * cs, lees_edw_t * le, int nall,
+				    double * str,
+				    double * fluxe, double * fluxw,
+				    double * fluxy, double * fluxz);
+static int phi_force_flux_divergence(cs_t * cs, hydro_t * hydro, int nall,
+				     double * fluxe, double * fluxw,
+				     double * fluxy, double * fluxz);
 static int phi_force_flux_fix_local(lees_edw_t * le, int nall, double * fluxe,
 				    double * fluxw);
-static int phi_force_flux_divergence_with_fix(cs_t * cs,
-					      hydro_t * hydro, double * fe,
-					      double * fw,
-					      double * fy, double * fz);
 static int phi_force_flux(cs_t * cs, lees_edw_t * le, fe_t * fe,
-			  wall_t * wall, hydro_t * hydro);
-static __host__ int phi_force_wallx(cs_t * cs, wall_t * wall, fe_t * fe, double * fxe, double * fxw);
+			  wall_t * wall, pth_t * pth, hydro_t * hydro);
+static __host__ int phi_force_wallx(cs_t * cs, wall_t * wall, int nall,
+				    double * str, double * fluxe,
+				    double * fluxw);
+
+__global__ void phi_force_stress_kernel_v(kernel_ctxt_t * ktx, fe_t * fe,
+					  int nall, double * str);
+__global__ void phi_force_stress_buffer_kernel(lees_edw_t * le, fe_t * fe,
+					       int nall, double * str);
+__global__ void phi_force_flux_kernel_v(kernel_ctxt_t * ktx, lees_edw_t * le,
+					int nall, double * str,
+					double * fluxe, double * fluxw,
+					double * fluxy, double * fluxz);
+__global__ void phi_force_flux_divergence_kernel_v(kernel_ctxt_t * ktx,
+						   hydro_t * hydro, int nall,
+						   double * fluxe,
+						   double * fluxw,
+						   double * fluxy,
+						   double * fluxz);
+__global__ void phi_force_fix_sum_kernel(lees_edw_t * le, int nall,
+					 double * fluxe, double * fluxw,
+					 double * fbar);
+__global__ void phi_force_fix_apply_kernel(lees_edw_t * le, int nall,
+					   double ra, double * fcor,
+					   double * fluxe, double * fluxw);
+__global__ void phi_force_wallx_kernel(cs_t * cs, int nall, int iswest,
+				       int iseast, double * str,
+				       double * fluxe, double * fluxw,
+				       double * fw);
 
 /*****************************************************************************
  *
@@ -91,9 +116,7 @@ __host__ int phi_force_calculation(pe_t * pe, cs_t * cs, lees_edw_t * le,
   if (nplanes > 0) {
     /* Must use the flux method for LE planes */
 
-    hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
-    phi_force_flux(cs, le, fe, wall, hydro);
-    hydro_memcpy(hydro, tdpMemcpyHostToDevice);
+    phi_force_flux(cs, le, fe, wall, pth, hydro);
   }
   else {
     switch (pth->method) {
@@ -271,6 +294,7 @@ __host__ int phi_force_external_chemical_potential(cs_t * cs, field_t * phi,
 }
 
 
+
 /*****************************************************************************
  *
  *  phi_force_flux
@@ -281,230 +305,373 @@ __host__ int phi_force_external_chemical_potential(cs_t * cs, field_t * phi,
  *  The flux form is used to ensure conservation, and to allow
  *  the appropriate corrections when LE planes are present.
  *
- *  TODO: the "ownership" is not very clear here. Where does it
- *        belong?
+ *  The stress is computed once per site (including the LE buffer
+ *  sites) and stored; the face fluxes are then formed from the
+ *  stored stress. All the work is done on the target.
+ *
+ *  The stress and fluxes are held in a workspace owned by pth, which
+ *  is allocated at the first call and released by pth_free().
  *
  *****************************************************************************/
 
 static int phi_force_flux(cs_t * cs, lees_edw_t * le, fe_t * fe,
-			  wall_t * wall, hydro_t * hydro) {
-  int n;
+			  wall_t * wall, pth_t * pth, hydro_t * hydro) {
+  int nall;
   int iswall[3];
-  int fix_fluxes = 1;
 
-  double * fluxe;
-  double * fluxw;
-  double * fluxy;
-  double * fluxz;
+  double * str = NULL;      /* Stress (target) */
+  double * fluxe = NULL;    /* Fluxes (target) */
+  double * fluxw = NULL;
+  double * fluxy = NULL;
+  double * fluxz = NULL;
 
+  assert(cs);
+  assert(le);
+  assert(fe);
+  assert(pth);
   assert(hydro);
 
   wall_present_dim(wall, iswall);
-  cs_nsites(cs, &n);
+  if (iswall[Y]) pe_fatal(hydro->pe, "Not allowed\n");
+  if (iswall[Z]) pe_fatal(hydro->pe, "Not allowed\n");
 
-  fluxe = (double *) malloc(3*n*sizeof(double));
-  fluxw = (double *) malloc(3*n*sizeof(double));
-  fluxy = (double *) malloc(3*n*sizeof(double));
-  fluxz = (double *) malloc(3*n*sizeof(double));
+  lees_edw_nsites(le, &nall);
 
-  if (fluxe == NULL) pe_fatal(hydro->pe, "malloc(fluxe) force failed");
-  if (fluxw == NULL) pe_fatal(hydro->pe, "malloc(fluxw) force failed");
-  if (fluxy == NULL) pe_fatal(hydro->pe, "malloc(fluxy) force failed");
-  if (fluxz == NULL) pe_fatal(hydro->pe, "malloc(fluxz) force failed");
+  if (pth->nflux != nall) {
+    if (pth->flux) tdpAssert(tdpFree(pth->flux));
+    size_t nsz = 21*(size_t) nall*sizeof(double);
+    tdpAssert(tdpMalloc((void **) &pth->flux, nsz));
+    pth->nflux = nall;
+  }
 
-  phi_force_compute_fluxes(le, fe, n, fluxe, fluxw, fluxy, fluxz);
+  str   = pth->flux;
+  fluxe = str   + 9*nall;
+  fluxw = fluxe + 3*nall;
+  fluxy = fluxw + 3*nall;
+  fluxz = fluxy + 3*nall;
 
-  if (iswall[X]) phi_force_wallx(cs, wall, fe, fluxe, fluxw);
-  if (iswall[Y]) pe_fatal(hydro->pe, "Not allowed\n");
-  if (iswall[Z]) pe_fatal(hydro->pe, "Not allowed\n");
+  phi_force_flux_stress(cs, le, fe, nall, str);
+  phi_force_compute_fluxes(cs, le, nall, str, fluxe, fluxw, fluxy, fluxz);
 
-  if (fix_fluxes || wall_present(wall)) {
-    phi_force_flux_fix_local(le, n, fluxe, fluxw);
-    phi_force_flux_divergence(cs, hydro, fluxe, fluxw, fluxy, fluxz);
-  }
-  else {
-    phi_force_flux_divergence_with_fix(cs, hydro, fluxe, fluxw, fluxy, fluxz);
-  }
+  if (iswall[X]) phi_force_wallx(cs, wall, nall, str, fluxe, fluxw);
 
-  free(fluxz);
-  free(fluxy);
-  free(fluxw);
-  free(fluxe);
+  phi_force_flux_fix_local(le, nall, fluxe, fluxw);
+  phi_force_flux_divergence(cs, hydro, nall, fluxe, fluxw, fluxy, fluxz);
 
   return 0;
 }
 
 /*****************************************************************************
  *
- *  phi_force_compute_fluxes
- *
- *  Linearly interpolate the chemical stress to the cell faces to get
- *  the momentum fluxes.
+ *  phi_force_flux_stress
  *
- *  This is designed for LE planes; the chemical stress routine must
- *  be called directly, as phi_force_stress cannot handle the planes.
+ *  Compute and store the stress at all sites required by the fluxes:
+ *  one point into the halo, and the LE buffer sites (which are beyond
+ *  the reach of the kernel context, so are treated separately).
  *
  *****************************************************************************/
 
-
-static int phi_force_compute_fluxes(lees_edw_t * le, fe_t * fe, int nall,
-				    double * fluxe, double * fluxw,
-				    double * fluxy, double * fluxz) {
-
-  int ia, ic, jc, kc, icm1, icp1;
-  int index, index1;
+static int phi_force_flux_stress(cs_t * cs, lees_edw_t * le, fe_t * fe,
+				 int nall, double * str) {
   int nlocal[3];
+  int nxbuffer;
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  fe_t * fe_target = NULL;
+  lees_edw_t * le_target = NULL;
 
-  double pth0[3][3];
-  double pth1[3][3];
-
+  assert(cs);
   assert(le);
   assert(fe);
-  assert(fe->func->stress);
+  assert(fe->func->target);
+  assert(str);
 
-  lees_edw_nlocal(le, nlocal);
+  cs_nlocal(cs, nlocal);
+  lees_edw_nxbuffer(le, &nxbuffer);
+  lees_edw_target(le, &le_target);
+  fe->func->target(fe, &fe_target);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    icm1 = lees_edw_ic_to_buff(le, ic, -1);
-    icp1 = lees_edw_ic_to_buff(le, ic, +1);
-    for (jc = 0; jc <= nlocal[Y]; jc++) {
-      for (kc = 0; kc <= nlocal[Z]; kc++) {
+  limits.imin = 0; limits.imax = nlocal[X] + 1;
+  limits.jmin = 0; limits.jmax = nlocal[Y] + 1;
+  limits.kmin = 0; limits.kmax = nlocal[Z] + 1;
 
-	index = lees_edw_index(le, ic, jc, kc);
+  kernel_ctxt_create(cs, NSIMDVL, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-	/* Compute pth at current point */
-	fe->func->stress(fe, index, pth0);
+  tdpLaunchKernel(phi_force_stress_kernel_v, nblk, ntpb, 0, 0,
+		  ctxt->target, fe_target, nall, str);
 
-	/* fluxw_a = (1/2)[P(i, j, k) + P(i-1, j, k)]_xa */
-	
-	index1 = lees_edw_index(le, icm1, jc, kc);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-	fe->func->stress(fe, index1, pth1);
+  kernel_ctxt_free(ctxt);
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxw[addr_rank1(nall,3,index,ia)] = 0.5*(pth1[ia][X] + pth0[ia][X]);
-	}
+  if (nxbuffer > 0) {
+    int nbuf = nxbuffer*(nlocal[Y] + 2)*(nlocal[Z] + 2);
 
-	/* fluxe_a = (1/2)[P(i, j, k) + P(i+1, j, k)_xa */
+    kernel_launch_param(nbuf, &nblk, &ntpb);
 
-	index1 = lees_edw_index(le, icp1, jc, kc);
-	fe->func->stress(fe, index1, pth1);
+    tdpLaunchKernel(phi_force_stress_buffer_kernel, nblk, ntpb, 0, 0,
+		    le_target, fe_target, nall, str);
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxe[addr_rank1(nall,3,index,ia)] = 0.5*(pth1[ia][X] + pth0[ia][X]);
-	}
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
+  }
 
-	/* fluxy_a = (1/2)[P(i, j, k) + P(i, j+1, k)]_ya */
+  return 0;
+}
 
-	index1 = lees_edw_index(le, ic, jc+1, kc);
-	fe->func->stress(fe, index1, pth1);
+/*****************************************************************************
+ *
+ *  phi_force_stress_kernel_v
+ *
+ *****************************************************************************/
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxy[addr_rank1(nall,3,index,ia)] = 0.5*(pth1[ia][Y] + pth0[ia][Y]);
-	}
+__global__ void phi_force_stress_kernel_v(kernel_ctxt_t * ktx, fe_t * fe,
+					  int nall, double * str) {
+  int kindex;
+  int kiter;
 
-	/* fluxz_a = (1/2)[P(i, j, k) + P(i, j, k+1)]_za */
+  assert(ktx);
+  assert(fe);
+  assert(fe->func->stress_v);
+  assert(str);
+
+  kiter = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, NSIMDVL) {
+
+    int ia, ib, iv;
+    int index;
+    double s[3][3][NSIMDVL];
+
+    index = kernel_baseindex(ktx, kindex);
 
-	index1 = lees_edw_index(le, ic, jc, kc+1);
-	fe->func->stress(fe, index1, pth1);
+    fe->func->stress_v(fe, index, s);
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxz[addr_rank1(nall,3,index,ia)] = 0.5*(pth1[ia][Z] + pth0[ia][Z]);
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	for_simd_v(iv, NSIMDVL) {
+	  str[addr_rank2(nall,3,3,index+iv,ia,ib)] = s[ia][ib][iv];
 	}
-	/* Next site */
       }
     }
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
  *
- *  phi_force_flux_divergence
+ *  phi_force_stress_buffer_kernel
  *
- *  Take the diverence of the momentum fluxes to get a force on the
- *  fluid site.
+ *  Stress at the LE buffer sites ic = nlocal[X] + nhalo + 1, ...
+ *  with 0 <= jc <= nlocal[Y] + 1 and 0 <= kc <= nlocal[Z] + 1.
  *
  *****************************************************************************/
 
-static int phi_force_flux_divergence(cs_t * cs, hydro_t * hydro,
-				     double * fluxe, double * fluxw,
-				     double * fluxy, double * fluxz) {
+__global__ void phi_force_stress_buffer_kernel(lees_edw_t * le, fe_t * fe,
+					       int nall, double * str) {
+  int n;
+  int nbuf;
+  int nhalo;
+  int nxbuffer;
   int nlocal[3];
-  int nsf;
-  int ic, jc, kc, ia;
-  int index, indexj, indexk;
+
+  assert(le);
+  assert(fe);
+  assert(fe->func->stress);
+  assert(str);
+
+  lees_edw_nhalo(le, &nhalo);
+  lees_edw_nlocal(le, nlocal);
+  lees_edw_nxbuffer(le, &nxbuffer);
+
+  nbuf = nxbuffer*(nlocal[Y] + 2)*(nlocal[Z] + 2);
+
+  for_simt_parallel(n, nbuf, 1) {
+
+    int ia, ib;
+    int ic, jc, kc, index;
+    double s[3][3];
+
+    ic = nlocal[X] + nhalo + 1 + n/((nlocal[Y] + 2)*(nlocal[Z] + 2));
+    jc = (n/(nlocal[Z] + 2)) % (nlocal[Y] + 2);
+    kc = n % (nlocal[Z] + 2);
+    index = lees_edw_index(le, ic, jc, kc);
+
+    fe->func->stress(fe, index, s);
+
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	str[addr_rank2(nall,3,3,index,ia,ib)] = s[ia][ib];
+      }
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  phi_force_compute_fluxes
+ *
+ *  Linearly interpolate the chemical stress to the cell faces to get
+ *  the momentum fluxes.
+ *
+ *****************************************************************************/
+
+static int phi_force_compute_fluxes(cs_t * cs, lees_edw_t * le, int nall,
+				    double * str,
+				    double * fluxe, double * fluxw,
+				    double * fluxy, double * fluxz) {
+  int nlocal[3];
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
+  lees_edw_t * le_target = NULL;
 
   assert(cs);
-  assert(hydro);
-  assert(fluxe);
-  assert(fluxw);
-  assert(fluxy);
-  assert(fluxz);
+  assert(le);
 
   cs_nlocal(cs, nlocal);
-  cs_nsites(cs, &nsf);
+  lees_edw_target(le, &le_target);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 0; limits.jmax = nlocal[Y];
+  limits.kmin = 0; limits.kmax = nlocal[Z];
 
-	double force[3] = {0};
+  kernel_ctxt_create(cs, NSIMDVL, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-        index  = cs_index(cs, ic, jc, kc);
-	indexj = cs_index(cs, ic, jc-1, kc);
-	indexk = cs_index(cs, ic, jc, kc-1);
+  tdpLaunchKernel(phi_force_flux_kernel_v, nblk, ntpb, 0, 0,
+		  ctxt->target, le_target, nall, str,
+		  fluxe, fluxw, fluxy, fluxz);
 
-	for (ia = 0; ia < 3; ia++) {
-	  force[ia] = -(+ fluxe[addr_rank1(nsf,3,index,ia)]
-			- fluxw[addr_rank1(nsf,3,index,ia)]
-			+ fluxy[addr_rank1(nsf,3,index,ia)]
-			- fluxy[addr_rank1(nsf,3,indexj,ia)]
-			+ fluxz[addr_rank1(nsf,3,index,ia)]
-			- fluxz[addr_rank1(nsf,3,indexk,ia)]);
-	}
-	hydro_f_local_add(hydro, index, force);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  kernel_ctxt_free(ctxt);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_force_flux_kernel_v
+ *
+ *  fluxw_a = (1/2)[P(i, j, k) + P(i-1, j, k)]_xa
+ *  fluxe_a = (1/2)[P(i, j, k) + P(i+1, j, k)]_xa
+ *  fluxy_a = (1/2)[P(i, j, k) + P(i, j+1, k)]_ya
+ *  fluxz_a = (1/2)[P(i, j, k) + P(i, j, k+1)]_za
+ *
+ *  where the x-neighbours may be LE buffer sites.
+ *
+ *****************************************************************************/
+
+__global__ void phi_force_flux_kernel_v(kernel_ctxt_t * ktx, lees_edw_t * le,
+					int nall, double * str,
+					double * fluxe, double * fluxw,
+					double * fluxy, double * fluxz) {
+  int kindex;
+  int kiter;
+
+  assert(ktx);
+  assert(le);
+  assert(str);
+
+  kiter = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, NSIMDVL) {
+
+    int ia, iv;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int pm[NSIMDVL];
+    int index0[NSIMDVL], index1[NSIMDVL];
+    int maskv[NSIMDVL];
+
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_coords_index_v(ktx, ic, jc, kc, index0);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    /* West face (ic - 1 and ic) */
+
+    for_simd_v(iv, NSIMDVL) {
+      pm[iv] = lees_edw_ic_to_buff(le, ic[iv], -maskv[iv]);
+    }
+    lees_edw_index_v(le, pm, jc, kc, index1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	fluxw[addr_rank1(nall,3,index0[iv],ia)] = maskv[iv]*0.5*
+	  (str[addr_rank2(nall,3,3,index1[iv],ia,X)] +
+	   str[addr_rank2(nall,3,3,index0[iv],ia,X)]);
       }
     }
+
+    /* East face (ic and ic + 1) */
+
+    for_simd_v(iv, NSIMDVL) {
+      pm[iv] = lees_edw_ic_to_buff(le, ic[iv], +maskv[iv]);
+    }
+    lees_edw_index_v(le, pm, jc, kc, index1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	fluxe[addr_rank1(nall,3,index0[iv],ia)] = maskv[iv]*0.5*
+	  (str[addr_rank2(nall,3,3,index1[iv],ia,X)] +
+	   str[addr_rank2(nall,3,3,index0[iv],ia,X)]);
+      }
+    }
+
+    /* y direction */
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = jc[iv] + maskv[iv];
+    lees_edw_index_v(le, ic, pm, kc, index1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	fluxy[addr_rank1(nall,3,index0[iv],ia)] = maskv[iv]*0.5*
+	  (str[addr_rank2(nall,3,3,index1[iv],ia,Y)] +
+	   str[addr_rank2(nall,3,3,index0[iv],ia,Y)]);
+      }
+    }
+
+    /* z direction */
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = kc[iv] + maskv[iv];
+    lees_edw_index_v(le, ic, jc, pm, index1);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	fluxz[addr_rank1(nall,3,index0[iv],ia)] = maskv[iv]*0.5*
+	  (str[addr_rank2(nall,3,3,index1[iv],ia,Z)] +
+	   str[addr_rank2(nall,3,3,index0[iv],ia,Z)]);
+      }
+    }
+    /* Next site */
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
  *
- *  phi_force_flux_divergence_with_fix
+ *  phi_force_flux_divergence
  *
  *  Take the diverence of the momentum fluxes to get a force on the
  *  fluid site.
  *
- *  It is intended that these fluxes are uncorrected, and that a
- *  global constraint on the total force is enforced. This costs
- *  one Allreduce per call. 
- *
- *  TODO:
- *  The assert(0) indicates this routine is unused; the "local"
- *  version below is preferred.
- *
  *****************************************************************************/
 
-static int phi_force_flux_divergence_with_fix(cs_t * cs,
-					      hydro_t * hydro,
-					      double * fluxe, double * fluxw,
-					      double * fluxy,
-					      double * fluxz) {
+static int phi_force_flux_divergence(cs_t * cs, hydro_t * hydro, int nall,
+				     double * fluxe, double * fluxw,
+				     double * fluxy, double * fluxz) {
   int nlocal[3];
-  int ic, jc, kc, index, ia;
-  int indexj, indexk;
-  int nsf;
-
-  double f[3];
-  double fsum_local[3];
-  double fsum[3];
-  double rv;
-  double ltot[3];
-  MPI_Comm comm;
+  dim3 nblk, ntpb;
+  kernel_info_t limits;
+  kernel_ctxt_t * ctxt = NULL;
 
   assert(cs);
   assert(hydro);
@@ -513,82 +680,94 @@ static int phi_force_flux_divergence_with_fix(cs_t * cs,
   assert(fluxy);
   assert(fluxz);
 
-  assert(0); /* NO TEST? */
-
-  cs_ltot(cs, ltot);
   cs_nlocal(cs, nlocal);
-  cs_nsites(cs, &nsf);
-  cs_cart_comm(cs, &comm);
 
-  for (ia = 0; ia < 3; ia++) {
-    fsum_local[ia] = 0.0;
-  }
+  limits.imin = 1; limits.imax = nlocal[X];
+  limits.jmin = 1; limits.jmax = nlocal[Y];
+  limits.kmin = 1; limits.kmax = nlocal[Z];
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  kernel_ctxt_create(cs, NSIMDVL, limits, &ctxt);
+  kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
 
-        index  = cs_index(cs, ic, jc, kc);
-	indexj = cs_index(cs, ic, jc-1, kc);
-	indexk = cs_index(cs, ic, jc, kc-1);
-
-	for (ia = 0; ia < 3; ia++) {
-	  f[ia]
-	    = - (+ fluxe[addr_rank1(nsf,3,index,ia)]
-		 - fluxw[addr_rank1(nsf,3,index,ia)]
-		 + fluxy[addr_rank1(nsf,3,index,ia)]
-		 - fluxy[addr_rank1(nsf,3,indexj,ia)]
-		 + fluxz[addr_rank1(nsf,3,index,ia)]
-		 - fluxz[addr_rank1(nsf,3,indexk,ia)]);
-	  fsum_local[ia] += f[ia];
-	}
-      }
-    }
-  }
+  tdpLaunchKernel(phi_force_flux_divergence_kernel_v, nblk, ntpb, 0, 0,
+		  ctxt->target, hydro->target, nall,
+		  fluxe, fluxw, fluxy, fluxz);
 
-  MPI_Allreduce(fsum_local, fsum, 3, MPI_DOUBLE, MPI_SUM, comm);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-  rv = 1.0/(ltot[X]*ltot[Y]*ltot[Z]);
+  kernel_ctxt_free(ctxt);
 
-  for (ia = 0; ia < 3; ia++) {
-    fsum[ia] *= rv;
-  }
+  return 0;
+}
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+/*****************************************************************************
+ *
+ *  phi_force_flux_divergence_kernel_v
+ *
+ *****************************************************************************/
 
-        index  = cs_index(cs, ic, jc, kc);
-	indexj = cs_index(cs, ic, jc-1, kc);
-	indexk = cs_index(cs, ic, jc, kc-1);
-
-	for (ia = 0; ia < 3; ia++) {
-	  f[ia]
-	    = - (+ fluxe[addr_rank1(nsf,3,index,ia)]
-		 - fluxw[addr_rank1(nsf,3,index,ia)]
-		 + fluxy[addr_rank1(nsf,3,index,ia)]
-		 - fluxy[addr_rank1(nsf,3,indexj,ia)]
-		 + fluxz[addr_rank1(nsf,3,index,ia)]
-		 - fluxz[addr_rank1(nsf,3,indexk,ia)]);
-	  f[ia] -= fsum[ia];
-	}
-	hydro_f_local_add(hydro, index, f);
+__global__ void phi_force_flux_divergence_kernel_v(kernel_ctxt_t * ktx,
+						   hydro_t * hydro, int nall,
+						   double * fluxe,
+						   double * fluxw,
+						   double * fluxy,
+						   double * fluxz) {
+  int kindex;
+  int kiter;
+
+  assert(ktx);
+  assert(hydro);
+
+  kiter = kernel_vector_iterations(ktx);
+
+  for_simt_parallel(kindex, kiter, NSIMDVL) {
+
+    int ia, iv;
+    int ic[NSIMDVL], jc[NSIMDVL], kc[NSIMDVL];
+    int pm[NSIMDVL];
+    int index0[NSIMDVL], indexj[NSIMDVL], indexk[NSIMDVL];
+    int maskv[NSIMDVL];
+
+    kernel_coords_v(ktx, kindex, ic, jc, kc);
+    kernel_coords_index_v(ktx, ic, jc, kc, index0);
+    kernel_mask_v(ktx, ic, jc, kc, maskv);
+
+    for_simd_v(iv, NSIMDVL) pm[iv] = jc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, pm, kc, indexj);
+    for_simd_v(iv, NSIMDVL) pm[iv] = kc[iv] - maskv[iv];
+    kernel_coords_index_v(ktx, ic, jc, pm, indexk);
+
+    for (ia = 0; ia < 3; ia++) {
+      for_simd_v(iv, NSIMDVL) {
+	double f = -(+ fluxe[addr_rank1(nall,3,index0[iv],ia)]
+		     - fluxw[addr_rank1(nall,3,index0[iv],ia)]
+		     + fluxy[addr_rank1(nall,3,index0[iv],ia)]
+		     - fluxy[addr_rank1(nall,3,indexj[iv],ia)]
+		     + fluxz[addr_rank1(nall,3,index0[iv],ia)]
+		     - fluxz[addr_rank1(nall,3,indexk[iv],ia)]);
+	hydro->force->data[addr_rank1(hydro->nsite, NHDIM, index0[iv], ia)]
+	  += f*maskv[iv];
       }
     }
+    /* Next site */
   }
 
-  return 0;
+  return;
 }
 
 /*****************************************************************************
  *
  *  phi_force_flux_fix_local
  *
- *  A per-plane version of the above. We know that, integrated across the
- *  area of the plane, the fluxw and fluxe contributions must be equal.
- *  Owing to the interpolation, this may not be exactly satisfied.
+ *  We know that, integrated across the area of each plane, the fluxw
+ *  and fluxe contributions must be equal. Owing to the interpolation,
+ *  this may not be exactly satisfied.
  *
- *  For each plane, there is therefore a correction.
+ *  For each plane, there is therefore a correction. The local sums
+ *  over each plane are formed on the target (one component of one
+ *  plane per thread, so the order of summation is fixed), reduced on
+ *  the host, and the correction applied on the target.
  *
  *****************************************************************************/
 
@@ -597,79 +776,157 @@ static int phi_force_flux_fix_local(lees_edw_t * le, int nall,
 
   int nlocal[3];
   int nplane;
-  int nhalo;
-  int ic, jc, kc, index, index1, ia, ip;
+  size_t nsz;
+  dim3 nblk, ntpb;
 
   double * fbar = NULL;     /* Local sum over plane */
   double * fcor = NULL;     /* Global correction */
+  double * ftarget = NULL;  /* Target copy of sum/correction */
   double ra;                /* Normaliser */
   double ltot[3];
 
+  lees_edw_t * le_target = NULL;
   MPI_Comm comm;
 
   assert(le);
 
-  lees_edw_ltot(le, ltot);
-
   nplane = lees_edw_nplane_local(le);
 
   if (nplane == 0) return 0;
 
-  lees_edw_nhalo(le, &nhalo);
+  lees_edw_ltot(le, ltot);
   lees_edw_nlocal(le, nlocal);
   lees_edw_plane_comm(le, &comm);
+  lees_edw_target(le, &le_target);
+
+  nsz = 3*nplane*sizeof(double);
 
   fbar = (double *) calloc(3*nplane, sizeof(double));
   fcor = (double *) calloc(3*nplane, sizeof(double));
-
   assert(fbar);
   assert(fcor);
   /* TODO: decide "ownership" to find pe */
 
-  for (ip = 0; ip < nplane; ip++) { 
+  tdpAssert(tdpMalloc((void **) &ftarget, nsz));
 
-    ic = lees_edw_plane_location(le, ip);
+  kernel_launch_param(3*nplane, &nblk, &ntpb);
 
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  tdpLaunchKernel(phi_force_fix_sum_kernel, nblk, ntpb, 0, 0,
+		  le_target, nall, fluxe, fluxw, ftarget);
 
-        index = lees_edw_index(le, ic, jc, kc);
-        index1 = lees_edw_index(le, ic + 1, jc, kc);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-	for (ia = 0; ia < 3; ia++) {
-	  fbar[3*ip + ia] += - fluxe[addr_rank1(nall,3,index,ia)]
-	    + fluxw[addr_rank1(nall,3,index1,ia)];
-	}
-      }
-    }
-  }
+  tdpAssert(tdpMemcpy(fbar, ftarget, nsz, tdpMemcpyDeviceToHost));
 
   MPI_Allreduce(fbar, fcor, 3*nplane, MPI_DOUBLE, MPI_SUM, comm);
 
   ra = 0.5/(ltot[Y]*ltot[Z]);
 
-  for (ip = 0; ip < nplane; ip++) { 
+  tdpAssert(tdpMemcpy(ftarget, fcor, nsz, tdpMemcpyHostToDevice));
+
+  kernel_launch_param(nplane*nlocal[Y]*nlocal[Z], &nblk, &ntpb);
+
+  tdpLaunchKernel(phi_force_fix_apply_kernel, nblk, ntpb, 0, 0,
+		  le_target, nall, ra, ftarget, fluxe, fluxw);
+
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  tdpAssert(tdpFree(ftarget));
+  free(fcor);
+  free(fbar);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  phi_force_fix_sum_kernel
+ *
+ *  fbar[3*ip + ia] is the sum over local plane ip of component ia.
+ *
+ *****************************************************************************/
+
+__global__ void phi_force_fix_sum_kernel(lees_edw_t * le, int nall,
+					 double * fluxe, double * fluxw,
+					 double * fbar) {
+  int n;
+  int nplane;
+  int nlocal[3];
+
+  assert(le);
+  assert(fluxe);
+  assert(fluxw);
+  assert(fbar);
+
+  nplane = lees_edw_nplane_local(le);
+  lees_edw_nlocal(le, nlocal);
+
+  for_simt_parallel(n, 3*nplane, 1) {
+
+    int ip = n / 3;
+    int ia = n % 3;
+    int ic, jc, kc;
+    double sum = 0.0;
 
     ic = lees_edw_plane_location(le, ip);
 
     for (jc = 1; jc <= nlocal[Y]; jc++) {
       for (kc = 1; kc <= nlocal[Z]; kc++) {
-
-        index  = lees_edw_index(le, ic, jc, kc);
-        index1 = lees_edw_index(le, ic + 1, jc, kc);
-
-	for (ia = 0; ia < 3; ia++) {
-	  fluxe[addr_rank1(nall,3,index,ia)] += ra*fcor[3*ip + ia];
-	  fluxw[addr_rank1(nall,3,index1,ia)] -= ra*fcor[3*ip +ia];
-	}
+	int index  = lees_edw_index(le, ic, jc, kc);
+	int index1 = lees_edw_index(le, ic + 1, jc, kc);
+	sum += - fluxe[addr_rank1(nall,3,index,ia)]
+	       + fluxw[addr_rank1(nall,3,index1,ia)];
       }
     }
+
+    fbar[n] = sum;
   }
 
-  free(fcor);
-  free(fbar);
+  return;
+}
 
-  return 0;
+/*****************************************************************************
+ *
+ *  phi_force_fix_apply_kernel
+ *
+ *  One site of one plane per iteration.
+ *
+ *****************************************************************************/
+
+__global__ void phi_force_fix_apply_kernel(lees_edw_t * le, int nall,
+					   double ra, double * fcor,
+					   double * fluxe, double * fluxw) {
+  int n;
+  int nplane;
+  int nlocal[3];
+
+  assert(le);
+  assert(fcor);
+  assert(fluxe);
+  assert(fluxw);
+
+  nplane = lees_edw_nplane_local(le);
+  lees_edw_nlocal(le, nlocal);
+
+  for_simt_parallel(n, nplane*nlocal[Y]*nlocal[Z], 1) {
+
+    int ia;
+    int ip = n/(nlocal[Y]*nlocal[Z]);
+    int jc = 1 + (n/nlocal[Z]) % nlocal[Y];
+    int kc = 1 + n % nlocal[Z];
+    int ic = lees_edw_plane_location(le, ip);
+    int index  = lees_edw_index(le, ic, jc, kc);
+    int index1 = lees_edw_index(le, ic + 1, jc, kc);
+
+    for (ia = 0; ia < 3; ia++) {
+      fluxe[addr_rank1(nall,3,index,ia)]  += ra*fcor[3*ip + ia];
+      fluxw[addr_rank1(nall,3,index1,ia)] -= ra*fcor[3*ip + ia];
+    }
+  }
+
+  return;
 }
 
 /*****************************************************************************
@@ -684,68 +941,98 @@ static int phi_force_flux_fix_local(lees_edw_t * le, int nall,
  *****************************************************************************/
 
 static __host__
-int phi_force_wallx(cs_t * cs, wall_t * wall, fe_t * fe, double * fluxe,
-			   double * fluxw) {
+int phi_force_wallx(cs_t * cs, wall_t * wall, int nall, double * str,
+		    double * fluxe, double * fluxw) {
 
-  int ic, jc, kc;
-  int index, ia;
-  int nsf;
-  int nlocal[3];
+  int iswest, iseast;
   int mpisz[3];
   int mpicoords[3];
+  dim3 nblk, ntpb;
 
-  double fw[3];         /* Net force on wall */
-  double pth0[3][3];    /* Chemical stress at fluid point next to wall */
+  double fw[3] = {0.0, 0.0, 0.0};   /* Net force on wall */
+  double * fwtarget = NULL;
+  cs_t * cstarget = NULL;
 
   assert(cs);
   assert(wall);
-  assert(fe);
-  assert(fe->func->stress);
 
-  cs_nlocal(cs, nlocal);
-  cs_nsites(cs, &nsf);
   cs_cartsz(cs, mpisz);
   cs_cart_coords(cs, mpicoords);
+  cs_target(cs, &cstarget);
 
-  fw[X] = 0.0;
-  fw[Y] = 0.0;
-  fw[Z] = 0.0;
+  iswest = (mpicoords[X] == 0);
+  iseast = (mpicoords[X] == mpisz[X] - 1);
 
-  if (mpicoords[X] == 0) {
-    ic = 1;
+  tdpAssert(tdpMalloc((void **) &fwtarget, 3*sizeof(double)));
 
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  kernel_launch_param(3, &nblk, &ntpb);
 
-	index = cs_index(cs, ic, jc, kc);
-	fe->func->stress(fe, index, pth0);
+  tdpLaunchKernel(phi_force_wallx_kernel, nblk, ntpb, 0, 0,
+		  cstarget, nall, iswest, iseast, str, fluxe, fluxw, fwtarget);
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxw[addr_rank1(nsf,3,index,ia)] = pth0[ia][X];
-	  fw[ia] -= pth0[ia][X];
-	}
-      }
-    }
-  }
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
 
-  if (mpicoords[X] == mpisz[X] - 1) {
-    ic = nlocal[X];
+  tdpAssert(tdpMemcpy(fw, fwtarget, 3*sizeof(double), tdpMemcpyDeviceToHost));
+  tdpAssert(tdpFree(fwtarget));
 
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  wall_momentum_add(wall, fw);
 
-	index = cs_index(cs, ic, jc, kc);
-	fe->func->stress(fe, index, pth0);
+  return 0;
+}
 
-	for (ia = 0; ia < 3; ia++) {
-	  fluxe[addr_rank1(nsf,3,index,ia)] = pth0[ia][X];
-	  fw[ia] += pth0[ia][X];
+/*****************************************************************************
+ *
+ *  phi_force_wallx_kernel
+ *
+ *  One component ia of the wall stress per iteration.
+ *
+ *****************************************************************************/
+
+__global__ void phi_force_wallx_kernel(cs_t * cs, int nall, int iswest,
+				       int iseast, double * str,
+				       double * fluxe, double * fluxw,
+				       double * fw) {
+  int ia;
+  int nlocal[3];
+
+  assert(cs);
+  assert(str);
+  assert(fw);
+
+  cs_nlocal(cs, nlocal);
+
+  for_simt_parallel(ia, 3, 1) {
+
+    int jc, kc, index;
+    double fwa = 0.0;
+
+    if (iswest) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
+	  double p = 0.0;
+	  index = cs_index(cs, 1, jc, kc);
+	  p = str[addr_rank2(nall,3,3,index,ia,X)];
+	  fluxw[addr_rank1(nall,3,index,ia)] = p;
+	  fwa -= p;
 	}
       }
     }
-  }
 
-  wall_momentum_add(wall, fw);
+    if (iseast) {
+      for (jc = 1; jc <= nlocal[Y]; jc++) {
+	for (kc = 1; kc <= nlocal[Z]; kc++) {
+	  double p = 0.0;
+	  index = cs_index(cs, nlocal[X], jc, kc);
+	  p = str[addr_rank2(nall,3,3,index,ia,X)];
+	  fluxe[addr_rank1(nall,3,index,ia)] = p;
+	  fwa += p;
+	}
+      }
+    }
 
-  return 0;
+    fw[ia] = fwa;
+  }
+
+  return;
 }
@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -21,6 +21,7 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "physics.h"
 #include "timer.h"
 #include "kernel.h"
 #include "phi_force_stress.h"
@@ -53,6 +54,7 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pobj) {
   obj->pe = pe;
   obj->cs = cs;
   obj->method = method;
+  obj->stamp = -1;
   cs_nsites(cs, &obj->nsites);
 
   /* malloc() here in all cases on host (even if not required). */
@@ -112,6 +114,7 @@ __host__ int pth_free(pth_t * pth) {
     tdpFree(pth->target);
   }
 
+  if (pth->flux) tdpAssert(tdpFree(pth->flux));
   if (pth->str) free(pth->str);
   free(pth);
 
@@ -166,6 +169,10 @@ __host__ int pth_memcpy(pth_t * pth, tdpMemcpyKind flag) {
  *  Compute the stress everywhere and store. This allows that the
  *  full stress, or just the antisymmetric part is needed.
  *
+ *  If the full stress is computed, it is stamped with the current
+ *  time step so that diagnostics taken later in the same step may
+ *  use it (see pth_stress_current()).
+ *
  *****************************************************************************/
 
 __host__ int pth_stress_compute(pth_t * pth, fe_t * fe) {
@@ -176,11 +183,13 @@ __host__ int pth_stress_compute(pth_t * pth, fe_t * fe) {
   kernel_info_t limits;
   kernel_ctxt_t * ctxt = NULL;
   fe_t * fe_target = NULL;
+  physics_t * phys = NULL;
 
   assert(pth);
   assert(fe);
   assert(fe->func->target);
 
+  physics_ref(&phys);
   cs_nlocal(pth->cs, nlocal);
   nextra = 1; /* Limits extend one point into the halo */
 
@@ -200,11 +209,13 @@ __host__ int pth_stress_compute(pth_t * pth, fe_t * fe) {
       tdpLaunchKernel(pth_kernel_a_v, nblk, ntpb, 0, 0,
 	  ctxt->target, pth->target, fe_target);
     }
+    pth->stamp = -1;
   }
   else {
     /* Full stress */
     tdpLaunchKernel(pth_kernel_v, nblk, ntpb, 0, 0,
 		    ctxt->target, pth->target, fe_target);
+    pth->stamp = physics_control_timestep(phys);
   }
 
   tdpAssert(tdpPeekAtLastError());
@@ -215,6 +226,32 @@ __host__ int pth_stress_compute(pth_t * pth, fe_t * fe) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  pth_stress_current
+ *
+ *  Returns 1 if the stored stress is the full stress computed at the
+ *  current time step, otherwise 0. The stress is held on the target;
+ *  a host consumer must pth_memcpy() before use.
+ *
+ *****************************************************************************/
+
+__host__ int pth_stress_current(const pth_t * pth) {
+
+  int current = 0;
+  physics_t * phys = NULL;
+
+  assert(pth);
+
+  physics_ref(&phys);
+
+  if (pth->stamp >= 0) {
+    current = (pth->stamp == physics_control_timestep(phys));
+  }
+
+  return current;
+}
+
 /*****************************************************************************
  *
  *  pth_kernel
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -30,6 +30,9 @@ struct pth_s {
   int method;           /* Method for force computation */
   int nsites;           /* Number of sites allocated */
   double * str;         /* Stress may be antisymmetric */
+  int stamp;            /* Time step of last full stress (-1 if none) */
+  int nflux;            /* Sites in LE flux workspace (0 if none) */
+  double * flux;        /* LE flux workspace (target) [21*nflux] */
   pth_t * target;       /* Target memory */
 };
 
@@ -37,6 +40,7 @@ __host__ int pth_create(pe_t * pe, cs_t * cs, int method, pth_t ** pth);
 __host__ int pth_free(pth_t * pth);
 __host__ int pth_memcpy(pth_t * pth, tdpMemcpyKind flag);
 __host__ int pth_stress_compute(pth_t * pth, fe_t * fe);
+__host__ int pth_stress_current(const pth_t * pth);
 
 __host__ __device__ void pth_stress(pth_t * pth,  int index, double p[3][3]);
 __host__ __device__ void pth_stress_set(pth_t * pth, int index, double p[3][3]);
@@ -34,7 +34,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2011-2018 The University of Edinburgh
+ *  (c) 2011-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -67,7 +67,9 @@ static fe_vt_t fe_polar_hvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_polar_stress_v,
   (fe_stress_v_ft)  fe_polar_stress_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     fe_polar_fed_v,
+  (fe_mu_v_ft)      NULL
 };
 
 static  __constant__ fe_vt_t fe_polar_dvt = {
@@ -84,7 +86,9 @@ static  __constant__ fe_vt_t fe_polar_dvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_polar_stress_v,
   (fe_stress_v_ft)  fe_polar_stress_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     fe_polar_fed_v,
+  (fe_mu_v_ft)      NULL
 };
 
 
@@ -158,6 +162,7 @@ __host__ int fe_polar_free(fe_polar_t * fe) {
 
   if (fe->target != fe) tdpAssert(tdpFree(fe->target));
 
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
 
@@ -213,8 +218,11 @@ __host__ int fe_polar_param_commit(fe_polar_t * fe) {
 
   assert(fe);
 
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
-		    sizeof(fe_polar_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&fe->commit, "polar_active.c:const_param",
+			   fe->param, sizeof(fe_polar_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_polar_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
@@ -366,27 +374,77 @@ int fe_polar_stress(fe_polar_t * fe, int index, double s[3][3]) {
  *
  *  fe_polar_stress_v
  *
- *  Requires optimisation.
+ *  Vectorised version of fe_polar_stress(). The arithmetic is in the
+ *  same order as the scalar version, so results are identical.
  *
  *****************************************************************************/
 
 __host__ __device__
 void fe_polar_stress_v(fe_polar_t * fe, int index, double s[3][3][NSIMDVL]) {
 
-  int ia, ib, iv;
-  double s1[3][3];
+  int ia, ib, ic, iv;
+
+  double sum[NSIMDVL];
+  double pdoth[NSIMDVL];
+  double p2[NSIMDVL];
+  double p[3][NSIMDVL];
+  double h[3][NSIMDVL];
+  double dp[3][3][NSIMDVL];
+
+  const double r3 = (1.0/3.0);
+  KRONECKER_DELTA_CHAR(d);
 
   assert(fe);
+  assert(fe->p);
+  assert(fe->dp);
+  assert(fe->param);
 
-  for (iv = 0; iv < NSIMDVL; iv++) {
-    fe_polar_stress(fe, index+iv, s1);
-    for (ia = 0; ia < 3; ia++) {
-      for (ib = 0; ib < 3; ib++) {
-	s[ia][ib][iv] = s1[ia][ib];
+  for (ia = 0; ia < NVECTOR; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      p[ia][iv] = fe->p->data[addr_rank1(fe->p->nsites, NVECTOR, index+iv, ia)];
+    }
+    for (ib = 0; ib < NVECTOR; ib++) {
+      for_simd_v(iv, NSIMDVL) {
+	dp[ia][ib][iv] = fe->dp->grad[addr_rank2(fe->dp->nsite, NVECTOR,
+						 NVECTOR, index+iv, ib, ia)];
       }
     }
   }
 
+  fe_polar_mol_field_v(fe, index, h);
+
+  for_simd_v(iv, NSIMDVL) p2[iv] = 0.0;
+  for_simd_v(iv, NSIMDVL) pdoth[iv] = 0.0;
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) p2[iv] += p[ia][iv]*p[ia][iv];
+    for_simd_v(iv, NSIMDVL) pdoth[iv] += p[ia][iv]*h[ia][iv];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
+      for (ic = 0; ic < 3; ic++) {
+	for_simd_v(iv, NSIMDVL) sum[iv] += dp[ia][ic][iv]*dp[ib][ic][iv];
+      }
+      for_simd_v(iv, NSIMDVL) {
+	s[ia][ib][iv] = 0.5*(p[ia][iv]*h[ib][iv] - p[ib][iv]*h[ia][iv])
+	  - fe->param->lambda*(0.5*(p[ia][iv]*h[ib][iv] + p[ib][iv]*h[ia][iv])
+			       - r3*d[ia][ib]*pdoth[iv])
+	  - fe->param->kappa1*sum[iv]
+	  - fe->param->zeta*(p[ia][iv]*p[ib][iv] - r3*d[ia][ib]*p2[iv]);
+      }
+    }
+  }
+
+  /* Negative sign as in the scalar version */
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) s[ia][ib][iv] = -s[ia][ib][iv];
+    }
+  }
+
   return;
 }
 
@@ -426,3 +484,112 @@ int fe_polar_mol_field(fe_polar_t * fe, int index, double h[3]) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  fe_polar_mol_field_v
+ *
+ *  Vectorised version of fe_polar_mol_field().
+ *
+ *****************************************************************************/
+
+__host__ __device__
+void fe_polar_mol_field_v(fe_polar_t * fe, int index, double h[3][NSIMDVL]) {
+
+  int ia, iv;
+
+  double p2[NSIMDVL];
+  double p[3][NSIMDVL];
+  double dsqp[3][NSIMDVL];
+
+  assert(fe);
+  assert(fe->p);
+  assert(fe->dp);
+
+  for (ia = 0; ia < NVECTOR; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      p[ia][iv] = fe->p->data[addr_rank1(fe->p->nsites, NVECTOR, index+iv, ia)];
+    }
+    for_simd_v(iv, NSIMDVL) {
+      dsqp[ia][iv] = fe->dp->delsq[addr_rank1(fe->dp->nsite, NVECTOR,
+					      index+iv, ia)];
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) p2[iv] = 0.0;
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) p2[iv] += p[ia][iv]*p[ia][iv];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      h[ia][iv] = -fe->param->a*p[ia][iv] + -fe->param->b*p2[iv]*p[ia][iv]
+	+ fe->param->kappa1*dsqp[ia][iv];
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_polar_fed_v
+ *
+ *  Vectorised version of fe_polar_fed().
+ *
+ *****************************************************************************/
+
+__host__ __device__
+void fe_polar_fed_v(fe_polar_t * fe, int index, double fed[NSIMDVL]) {
+
+  int ia, ib, ic, iv;
+
+  double p2[NSIMDVL];
+  double dp1[NSIMDVL];
+  double dp3[NSIMDVL];
+  double sum[NSIMDVL];
+  double p[3][NSIMDVL];
+  double dp[3][3][NSIMDVL];
+  LEVI_CIVITA_CHAR(e);
+
+  assert(fe);
+  assert(fe->p);
+  assert(fe->dp);
+
+  for (ia = 0; ia < NVECTOR; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      p[ia][iv] = fe->p->data[addr_rank1(fe->p->nsites, NVECTOR, index+iv, ia)];
+    }
+    for (ib = 0; ib < NVECTOR; ib++) {
+      for_simd_v(iv, NSIMDVL) {
+	dp[ia][ib][iv] = fe->dp->grad[addr_rank2(fe->dp->nsite, NVECTOR,
+						 NVECTOR, index+iv, ib, ia)];
+      }
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) p2[iv] = 0.0;
+  for_simd_v(iv, NSIMDVL) dp1[iv] = 0.0;
+  for_simd_v(iv, NSIMDVL) dp3[iv] = 0.0;
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) p2[iv] += p[ia][iv]*p[ia][iv];
+    for_simd_v(iv, NSIMDVL) sum[iv] = 0.0;
+    for (ib = 0; ib < 3; ib++) {
+      for_simd_v(iv, NSIMDVL) dp1[iv] += dp[ia][ib][iv]*dp[ia][ib][iv];
+      for (ic = 0; ic < 3; ic++) {
+	for_simd_v(iv, NSIMDVL) sum[iv] += e[ia][ib][ic]*dp[ib][ic][iv];
+      }
+    }
+    for_simd_v(iv, NSIMDVL) dp3[iv] += sum[iv]*sum[iv];
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+    fed[iv] = 0.5*fe->param->a*p2[iv] + 0.25*fe->param->b*p2[iv]*p2[iv]
+      + 0.5*fe->param->kappa1*dp1[iv]
+      + 0.5*fe->param->delta*fe->param->kappa1*dp3[iv];
+  }
+
+  return;
+}
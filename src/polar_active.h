@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2018 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -20,6 +20,7 @@
 #include "free_energy.h"
 #include "field.h"
 #include "field_grad.h"
+#include "util_commit.h"
 
 typedef struct fe_polar_s fe_polar_t;
 typedef struct fe_polar_param_s fe_polar_param_t;
@@ -46,6 +47,7 @@ struct fe_polar_s {
   fe_polar_param_t * param; /* Parameters */
   field_t * p;              /* Vector order parameter */
   field_grad_t * dp;        /* Gradients thereof */
+  util_commit_t commit;     /* Parameters last sent to target */
   fe_polar_t * target;      /* Device pointer */
 };
 
@@ -62,5 +64,9 @@ __host__ __device__ int fe_polar_fed(fe_polar_t * fe, int index, double * fed);
 __host__ __device__ int fe_polar_mol_field(fe_polar_t * fe, int index, double h[3]);
 __host__ __device__ int fe_polar_stress(fe_polar_t * fe, int index, double s[3][3]);
 __host__ __device__ void fe_polar_stress_v(fe_polar_t * fe, int index, double s[3][3][NSIMDVL]);
+__host__ __device__ void fe_polar_mol_field_v(fe_polar_t * fe, int index,
+					      double h[3][NSIMDVL]);
+__host__ __device__ void fe_polar_fed_v(fe_polar_t * fe, int index,
+					double fed[NSIMDVL]);
 
 #endif
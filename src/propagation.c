@@ -72,11 +72,18 @@ __host__ int lb_propagation_driver(lb_t * lb) {
   limits.jmin = 1; limits.jmax = nlocal[Y];
   limits.kmin = 1; limits.kmax = nlocal[Z];
 
-  tdpMemcpyToSymbol(tdpSymbol(coords), lb->cs->param,
-		    sizeof(cs_param_t), 0, tdpMemcpyHostToDevice);
-  tdpMemcpyToSymbol(tdpSymbol(lbp), lb->param,
-		    sizeof(lb_collide_param_t), 0,
-		    tdpMemcpyHostToDevice);
+  if (util_commit_required(lb->commit + LB_COMMIT_PROPAGATE_COORDS,
+			   "propagation.c:coords", lb->cs->param,
+			   sizeof(cs_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(coords), lb->cs->param, sizeof(cs_param_t), 0,
+		      tdpMemcpyHostToDevice);
+  }
+  if (util_commit_required(lb->commit + LB_COMMIT_PROPAGATE_LBP,
+			   "propagation.c:lbp", lb->param,
+			   sizeof(lb_collide_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(lbp), lb->param, sizeof(lb_collide_param_t), 0,
+		      tdpMemcpyHostToDevice);
+  }
 
   kernel_ctxt_create(lb->cs, NSIMDVL, limits, &ctxt);
   kernel_ctxt_launch_param(ctxt, &nblk, &ntpb);
@@ -129,6 +129,9 @@ int psi_initialise(pe_t * pe, cs_t * cs, const psi_options_t * opts,
     field_create(pe, cs, le, "qsi", &opts->rho, &psi->rho);
   }
 
+  psi->rhonew = (double *) calloc((size_t) psi->nsites*psi->nk, sizeof(double));
+  if (psi->rhonew == NULL) pe_fatal(pe, "calloc(psi->rhonew) failed\n");
+
   psi->nfreq_io = INT_MAX;
 
   /* Copy of the options structure */
@@ -151,6 +154,7 @@ int psi_finalise(psi_t * psi) {
   field_free(psi->rho);
   field_free(psi->psi);
 
+  free(psi->rhonew);
   free(psi->valency);
   free(psi->diffusivity);
 
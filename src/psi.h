@@ -45,6 +45,7 @@ struct psi_s {
 
   field_t * psi;            /* Electric potential */
   field_t * rho;            /* Charge densities */
+  double * rhonew;          /* Workspace for charge density update */
 
   double * diffusivity;     /* Diffusivity for each species */
   int * valency;            /* Valency for each species */
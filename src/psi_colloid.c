@@ -27,6 +27,8 @@
 
 static int psi_colloid_charge_accum(psi_t * psi, colloids_info_t * cinfo,
 				    int index, double * rho, double * weight);
+static int psi_colloid_rho_deposit(psi_t * psi, colloids_info_t * cinfo,
+				   colloid_t * colloid, const double rho[2]);
 
 /* Additional forward declaration */
 colloid_t * colloid_at_site_index(int);
@@ -43,44 +45,95 @@ colloid_t * colloid_at_site_index(int);
  *  here could be extended into the halo regions if a halo swap
  *  is not required for other reasons.
  *
- *  A more effiecient version would probably compute and store
- *  1/volume for each particle in advance before trawling through
- *  the lattice.
+ *  The densities are computed once per colloid, and the covered
+ *  sites are only visited if the densities have changed since the
+ *  last call (e.g., via a change in volume or in the deficit
+ *  deltaq carried by build_conservation_psi()), or if the colloid
+ *  has gained sites in the map update (see build_remove_replace()).
+ *  Otherwise, the covered sites already hold the correct values.
  *
  *****************************************************************************/
 
 int psi_colloid_rho_set(psi_t * obj, colloids_info_t * cinfo) {
 
-  int ic, jc, kc, index;
-  int nlocal[3];
-
-  double rho0, rho1, volume;
   colloid_t * pc = NULL;
 
   assert(obj);
   assert(cinfo);
 
-  cs_nlocal(obj->cs, nlocal);
+  /* Make sure lists are up-to-date */
+  colloids_info_update_lists(cinfo);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  colloids_info_all_head(cinfo, &pc);
 
-	index = cs_index(obj->cs, ic, jc, kc);
-	colloids_info_map(cinfo, index, &pc);
+  for (; pc; pc = pc->nextall) {
 
-	if (pc) {
-	  util_discrete_volume_sphere(pc->s.r, pc->s.a0, &volume);
+    double volume = 0.0;
+    double rho[2] = {0};
 
-          /* The dmax() here prevents -ve dq dropping density below zero */
-	  rho0 = dmax(0.0, pc->s.q0 + pc->s.deltaq0) / volume;
-	  rho1 = dmax(0.0, pc->s.q1 + pc->s.deltaq1) / volume;
+    util_discrete_volume_sphere(pc->s.r, pc->s.a0, &volume);
 
-	  psi_rho_set(obj, index, 0, rho0);
-	  psi_rho_set(obj, index, 1, rho1);
-	}
+    /* No lattice sites are covered anywhere */
+    if (volume == 0.0) continue;
 
-	/* Next site */
+    /* The dmax() here prevents -ve dq dropping density below zero */
+    rho[0] = dmax(0.0, pc->s.q0 + pc->s.deltaq0) / volume;
+    rho[1] = dmax(0.0, pc->s.q1 + pc->s.deltaq1) / volume;
+
+    if (pc->rhoq_valid && rho[0] == pc->rhoq[0] && rho[1] == pc->rhoq[1]) {
+      continue;
+    }
+
+    psi_colloid_rho_deposit(obj, cinfo, pc, rho);
+
+    pc->rhoq[0] = rho[0];
+    pc->rhoq[1] = rho[1];
+    pc->rhoq_valid = 1;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_colloid_rho_deposit
+ *
+ *  Set the charge densities rho[2] at local sites covered by colloid.
+ *  Only sites within a cubic box around the colloid need be examined.
+ *
+ *****************************************************************************/
+
+static int psi_colloid_rho_deposit(psi_t * psi, colloids_info_t * cinfo,
+				   colloid_t * colloid, const double rho[2]) {
+  int nlocal[3];
+  int noffset[3];
+  int ilo[3], ihi[3];
+
+  assert(psi);
+  assert(cinfo);
+  assert(colloid);
+
+  cs_nlocal(psi->cs, nlocal);
+  cs_nlocal_offset(psi->cs, noffset);
+
+  for (int ia = 0; ia < 3; ia++) {
+    double r0 = colloid->s.r[ia] - 1.0*noffset[ia];
+    ilo[ia] = imax(1,          (int) floor(r0 - colloid->s.a0));
+    ihi[ia] = imin(nlocal[ia], (int) ceil (r0 + colloid->s.a0));
+  }
+
+  for (int ic = ilo[X]; ic <= ihi[X]; ic++) {
+    for (int jc = ilo[Y]; jc <= ihi[Y]; jc++) {
+      for (int kc = ilo[Z]; kc <= ihi[Z]; kc++) {
+
+	int index = cs_index(psi->cs, ic, jc, kc);
+	colloid_t * pc = NULL;
+
+	colloids_info_map(cinfo, index, &pc);
+	if (pc != colloid) continue;
+
+	psi_rho_set(psi, index, 0, rho[0]);
+	psi_rho_set(psi, index, 1, rho[1]);
       }
     }
   }
@@ -21,6 +21,7 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "cs_limits.h"
 #include "physics.h"
 #include "fe_electro.h"
 #include "fe_electro_symmetric.h"
@@ -32,6 +33,13 @@ int psi_force_gradmu_e(psi_t * psi, fe_t * fe, hydro_t * hydro,
 int psi_force_gradmu_es(psi_t * psi, fe_t * fe, field_t * phi, hydro_t * hydro,
 			colloids_info_t * cinfo);
 
+static int psi_force_gradmu_driver(psi_t * psi, fe_t * fe, field_t * phi,
+				   hydro_t * hydro, colloids_info_t * cinfo);
+static void psi_force_gradmu_site(psi_t * psi, fe_t * fe, field_t * phi,
+				  double ktr, int index, double force[3]);
+static void psi_force_divstress_site(psi_t * psi, fe_t * fe, int ic, int jc,
+				     int kc, double force[3]);
+
 /*****************************************************************************
  *
  *  psi_force_gradmu
@@ -66,7 +74,6 @@ int psi_force_gradmu(psi_t * psi, fe_t * fe, field_t * phi,
  *  psi_force_gradmu_e
  *
  *  The first of two versions, this one for FE_ELECTRO.
- *  There is some repetition of code which could be rationalised.
  *
  *  If hydro is NULL, there is no force on the fluid, but there
  *  can be a force on the colloids.
@@ -76,106 +83,11 @@ int psi_force_gradmu(psi_t * psi, fe_t * fe, field_t * phi,
 int psi_force_gradmu_e(psi_t * psi, fe_t * fe, hydro_t * hydro,
 		       colloids_info_t * cinfo) {
 
-  int ic, jc, kc;
-  int ia;
-  int nlocal[3];
-  int index;
-  int xs, ys, zs;       /* Coordinate strides */
-  double rho_elec;      /* Species and electric charge density */
-  double e[3];          /* Total electric field */
-  double kt, eunit, reunit;
-  double force[3];
-  /* Cummulative forces for momentum correction */
-  double flocal[4] = {0.0, 0.0, 0.0, 0.0};
-  double fsum[4];
-
-  physics_t * phys = NULL;
-  MPI_Comm comm;
-
-  colloid_t * pc = NULL;
-
-  assert(fe);
   assert(psi);
+  assert(fe);
   assert(cinfo);
 
-  cs_nlocal(psi->cs, nlocal);
-  cs_strides(psi->cs, &xs, &ys, &zs);
-  cs_cart_comm(psi->cs, &comm);
-
-  physics_ref(&phys);
-  physics_kt(phys, &kt);
-  psi_unit_charge(psi, &eunit);
-  reunit = 1.0/eunit;
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-
-        index = cs_index(psi->cs, ic, jc, kc);
-	colloids_info_map(cinfo, index, &pc);
-
-	/* Contribution from ionic electrostatic part
-           Note: The sum over the ionic species and the
-                 gradient of the electrostatic potential
-                 are implicitly calculated */
-
-	psi_rho_elec(psi, index, &rho_elec);
-	psi_electric_field(psi, index, e);
-
-	for (ia = 0; ia < 3; ia++) {
-	  e[ia] *= kt*reunit;
-	  force[ia] = rho_elec*e[ia];
-	}
-
-	/* If solid, accumulate contribution to colloid;
-	   otherwise to fluid node */
-
-	if (pc) {
-	  pc->force[X] += force[X];
-	  pc->force[Y] += force[Y];
-	  pc->force[Z] += force[Z];
-	}
-	else {
-	  if (hydro) hydro_f_local_add(hydro, index, force);
-	  flocal[3] += 1.0;
-	}
-
-	/* Accumulate contribution to total force on system */
-
-	flocal[X] += force[X];
-	flocal[Y] += force[Y];
-	flocal[Z] += force[Z];
-
-      }
-    }
-  }
-
-  MPI_Allreduce(flocal, fsum, 4, MPI_DOUBLE, MPI_SUM, comm);
-
-  fsum[X] /= fsum[3];
-  fsum[Y] /= fsum[3];
-  fsum[Z] /= fsum[3];
-
-  /* Now actually compute the force on the fluid with the correction
-     (based on number of fluid nodes) and store */
-
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
-
-        index = cs_index(psi->cs, ic, jc, kc);
-
-	colloids_info_map(cinfo, index, &pc);
-	if (pc) continue;
-
-        force[X] = - fsum[X];
-        force[Y] = - fsum[Y];
-        force[Z] = - fsum[Z];
-
-	if (hydro) hydro_f_local_add(hydro, index, force);
-      }
-    }
-  }
+  psi_force_gradmu_driver(psi, fe, NULL, hydro, cinfo);
 
   return 0;
 }
@@ -195,138 +107,119 @@ int psi_force_gradmu_e(psi_t * psi, fe_t * fe, hydro_t * hydro,
 int psi_force_gradmu_es(psi_t * psi, fe_t * fe, field_t * phi, hydro_t * hydro,
 			colloids_info_t * cinfo) {
 
-  int ic, jc, kc;
-  int in, nk;
-  int ia;
-  int nlocal[3];
-  int index;
-  int xs, ys, zs;       /* Coordinate strides */
-  double rho, rho_elec; /* Species and electric charge density */
-  double e[3];          /* Total electric field */
-  double muphim1, muphip1, musm1, musp1;
-  double phi0;          /* Compositional order parameter */
-  double kt, eunit, reunit;
-  double force[3];
-  /* Cummulative forces for momentum correction */
-  double flocal[4] = {0.0, 0.0, 0.0, 0.0};
-  double fsum[4];
+  assert(psi);
+  assert(fe);
+  assert(phi);
+  assert(cinfo);
 
+  assert(psi->nk == 2); /* This routine is not completely general */
+
+  psi_force_gradmu_driver(psi, fe, phi, hydro, cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  psi_force_gradmu_driver
+ *
+ *  Fluid sites are independent and are shared between host threads,
+ *  with a reduction for the total force and the number of fluid
+ *  sites. Sites inside colloids then accumulate the force on the
+ *  relevant colloid in serial. The momentum correction (based on the
+ *  number of fluid sites) is applied to fluid sites in a second pass.
+ *
+ *  If phi is NULL, the FE_ELECTRO force is computed, otherwise the
+ *  FE_ELECTRO_SYMMETRIC force.
+ *
+ *****************************************************************************/
+
+static int psi_force_gradmu_driver(psi_t * psi, fe_t * fe, field_t * phi,
+				   hydro_t * hydro, colloids_info_t * cinfo) {
+  int nlocal[3] = {0};
+  int ncolloid = 0;
+  double kt = 0.0;
+  double eunit = 0.0;
+  double ktr = 0.0;     /* kT/(unit charge) */
+  double fx = 0.0;      /* Cumulative force for momentum correction */
+  double fy = 0.0;
+  double fz = 0.0;
+  double nfluid = 0.0;
+  double flocal[4] = {0.0, 0.0, 0.0, 0.0};
+  double fsum[4] = {0.0, 0.0, 0.0, 0.0};
   physics_t * phys = NULL;
   MPI_Comm comm;
 
-  colloid_t * pc = NULL;
-
-  assert(fe);
   assert(psi);
-  assert(phi);
+  assert(fe);
   assert(cinfo);
 
   cs_nlocal(psi->cs, nlocal);
-  cs_strides(psi->cs, &xs, &ys, &zs);
   cs_cart_comm(psi->cs, &comm);
 
   physics_ref(&phys);
   physics_kt(phys, &kt);
   psi_unit_charge(psi, &eunit);
-  reunit = 1.0/eunit;
-
-  psi_nk(psi, &nk);
-  assert(nk == 2); /* This routine is not completely general */
+  ktr = kt*(1.0/eunit);
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  {
+    cs_limits_t lim = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
 
-        index = cs_index(psi->cs, ic, jc, kc);
-	colloids_info_map(cinfo, index, &pc);
-
-	/* X-direction */
-
-	field_scalar(phi, index, &phi0);
+    #pragma omp parallel for reduction(+: fx, fy, fz, nfluid)
+    for (int ib = 0; ib < cs_limits_size(lim); ib++) {
 
-	/* Contribution from composition part */
-	fe->func->mu(fe, index - xs, &muphim1);
-	fe->func->mu(fe, index + xs, &muphip1);
-
-	force[X] = -phi0*0.5*(muphip1 - muphim1);
-
-	/* Contribution from ionic solvation part */
-	for (in = 0; in < nk; in++) {
-	  psi_rho(psi, index, in, &rho);
-	  fe->func->mu_solv(fe, index - xs, in, &musm1);
-	  fe->func->mu_solv(fe, index + xs, in, &musp1);
-	  force[X] -= rho*0.5*(musp1 - musm1);
-	}
-
-	/* Y-direction */
-
-	/* Contribution from composition part */
-	fe->func->mu(fe, index - ys, &muphim1);
-	fe->func->mu(fe, index + ys, &muphip1);
-	force[Y] = -phi0*0.5*(muphip1 - muphim1);
-
-	/* Contribution from ionic solvation part */
-
-	for (in = 0; in < nk; in++) {
-	  psi_rho(psi, index, in, &rho); 
-	  fe->func->mu_solv(fe, index - ys, in, &musm1);
-	  fe->func->mu_solv(fe, index + ys, in, &musp1);
-	  force[Y] -= rho*0.5*(musp1 - musm1);
-	}
+      int ic = cs_limits_ic(lim, ib);
+      int jc = cs_limits_jc(lim, ib);
+      int kc = cs_limits_kc(lim, ib);
+      int index = cs_index(psi->cs, ic, jc, kc);
+      colloid_t * pc = NULL;
 
-	/* Z-direction */
-	/* Contribution from composition part */
+      colloids_info_map(cinfo, index, &pc);
 
-	fe->func->mu(fe, index - zs, &muphim1);
-	fe->func->mu(fe, index + zs, &muphip1);
-	force[Z] = -phi0*0.5*(muphip1 - muphim1);
+      if (pc == NULL) {
+	double force[3] = {0};
+	psi_force_gradmu_site(psi, fe, phi, ktr, index, force);
+	if (hydro) hydro_f_local_add(hydro, index, force);
+	fx += force[X];
+	fy += force[Y];
+	fz += force[Z];
+	nfluid += 1.0;
+      }
+    }
+  }
 
-	/* Contribution from ionic solvation part */
-	for (in = 0; in < nk; in++) {
-	  psi_rho(psi, index, in, &rho); 
-	  fe->func->mu_solv(fe, index - zs, in, &musm1);
-	  fe->func->mu_solv(fe, index + zs, in, &musp1);
-	  force[Z] -= rho*0.5*(musp1 - musm1);
-	}
+  /* Colloid sites */
 
-	/* Contribution from ionic electrostatic part
-           Note: The sum over the ionic species and the
-                 gradient of the electrostatic potential
-                 are implicitly calculated */
+  colloids_info_ntotal(cinfo, &ncolloid);
 
-	psi_rho_elec(psi, index, &rho_elec);
-	psi_electric_field(psi, index, e);
+  for (int ic = 1; ic <= nlocal[X] && ncolloid > 0; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
 
-	for (ia = 0; ia < 3; ia++) {
-	  e[ia] *= kt*reunit;
-	  force[ia] += rho_elec*e[ia];
-	}
+	int index = cs_index(psi->cs, ic, jc, kc);
+	colloid_t * pc = NULL;
 
-	/* If solid, accumulate contribution to colloid;
-	   otherwise to fluid node */
+	colloids_info_map(cinfo, index, &pc);
 
 	if (pc) {
-
+	  double force[3] = {0};
+	  psi_force_gradmu_site(psi, fe, phi, ktr, index, force);
 	  pc->force[X] += force[X];
 	  pc->force[Y] += force[Y];
 	  pc->force[Z] += force[Z];
-
-	}
-	else {
-	  if (hydro) hydro_f_local_add(hydro, index, force);
-	  flocal[3] += 1.0;
+	  fx += force[X];
+	  fy += force[Y];
+	  fz += force[Z];
 	}
-
-	/* Accumulate contribution to total force on system */
-
-	flocal[X] += force[X];
-	flocal[Y] += force[Y];
-	flocal[Z] += force[Z];
-
       }
     }
   }
 
+  flocal[X] = fx;
+  flocal[Y] = fy;
+  flocal[Z] = fz;
+  flocal[3] = nfluid;
+
   MPI_Allreduce(flocal, fsum, 4, MPI_DOUBLE, MPI_SUM, comm);
 
   fsum[X] /= fsum[3];
@@ -336,20 +229,23 @@ int psi_force_gradmu_es(psi_t * psi, fe_t * fe, field_t * phi, hydro_t * hydro,
   /* Now actually compute the force on the fluid with the correction
      (based on number of fluid nodes) and store */
 
-  for (ic = 1; ic <= nlocal[X]; ic++) {
-    for (jc = 1; jc <= nlocal[Y]; jc++) {
-      for (kc = 1; kc <= nlocal[Z]; kc++) {
+  if (hydro) {
+    cs_limits_t lim = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
 
-        index = cs_index(psi->cs, ic, jc, kc);
+    #pragma omp parallel for
+    for (int ib = 0; ib < cs_limits_size(lim); ib++) {
 
-	colloids_info_map(cinfo, index, &pc);
-	if (pc) continue;
+      int ic = cs_limits_ic(lim, ib);
+      int jc = cs_limits_jc(lim, ib);
+      int kc = cs_limits_kc(lim, ib);
+      int index = cs_index(psi->cs, ic, jc, kc);
+      colloid_t * pc = NULL;
 
-        force[X] = - fsum[X];
-        force[Y] = - fsum[Y];
-        force[Z] = - fsum[Z];
+      colloids_info_map(cinfo, index, &pc);
 
-	if (hydro) hydro_f_local_add(hydro, index, force);
+      if (pc == NULL) {
+	double force[3] = {-fsum[X], -fsum[Y], -fsum[Z]};
+	hydro_f_local_add(hydro, index, force);
       }
     }
   }
@@ -357,6 +253,72 @@ int psi_force_gradmu_es(psi_t * psi, fe_t * fe, field_t * phi, hydro_t * hydro,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  psi_force_gradmu_site
+ *
+ *  Force at site index, where ktr is kT/(unit charge). The contribution
+ *  from the ionic electrostatic part is always present. If phi is
+ *  present, the composition and ionic solvation contributions are added.
+ *
+ *  Note: The sum over the ionic species and the gradient of the
+ *        electrostatic potential are implicitly calculated.
+ *
+ *****************************************************************************/
+
+static void psi_force_gradmu_site(psi_t * psi, fe_t * fe, field_t * phi,
+				  double ktr, int index, double force[3]) {
+  int str[3] = {0};
+  double rho_elec = 0.0;
+  double e[3] = {0};
+
+  cs_strides(psi->cs, str + X, str + Y, str + Z);
+
+  force[X] = 0.0;
+  force[Y] = 0.0;
+  force[Z] = 0.0;
+
+  if (phi) {
+    double phi0 = 0.0;
+
+    field_scalar(phi, index, &phi0);
+
+    for (int ia = 0; ia < 3; ia++) {
+
+      double muphim1 = 0.0;
+      double muphip1 = 0.0;
+
+      /* Contribution from composition part */
+      fe->func->mu(fe, index - str[ia], &muphim1);
+      fe->func->mu(fe, index + str[ia], &muphip1);
+      force[ia] = -phi0*0.5*(muphip1 - muphim1);
+
+      /* Contribution from ionic solvation part */
+      for (int n = 0; n < psi->nk; n++) {
+	double rho = 0.0;
+	double musm1 = 0.0;
+	double musp1 = 0.0;
+	psi_rho(psi, index, n, &rho);
+	fe->func->mu_solv(fe, index - str[ia], n, &musm1);
+	fe->func->mu_solv(fe, index + str[ia], n, &musp1);
+	force[ia] -= rho*0.5*(musp1 - musm1);
+      }
+    }
+  }
+
+  /* Contribution from ionic electrostatic part */
+
+  psi_rho_elec(psi, index, &rho_elec);
+  psi_electric_field(psi, index, e);
+
+  for (int ia = 0; ia < 3; ia++) {
+    e[ia] *= ktr;
+    force[ia] += rho_elec*e[ia];
+  }
+
+  return;
+}
+
 /*****************************************************************************
  *
  *  psi_force_divstress
@@ -366,67 +328,108 @@ int psi_force_gradmu_es(psi_t * psi, fe_t * fe, field_t * phi, hydro_t * hydro,
  *
  *  The stress is to include the full electric field.
  *
+ *  Fluid sites are independent and are shared between host threads
+ *  (psi_t and the electro free energies have no target copy, so this
+ *  is not a target kernel). Sites inside colloids then accumulate the
+ *  force on the relevant colloid in serial.
+ *
  *****************************************************************************/
 
 int psi_force_divstress(psi_t * psi, fe_t * fe, hydro_t * hydro,
 			colloids_info_t * cinfo) {
 
   int nlocal[3] = {0};
-  cs_t * cs = NULL;
-  stencil_t * s = NULL;
 
   assert(psi);
+  assert(fe);
   assert(cinfo);
 
-  cs = psi->cs;
-  s  = psi->stencil;
-  assert(cs);
-  assert(s);
+  cs_nlocal(psi->cs, nlocal);
 
-  cs_nlocal(cs, nlocal);
+  {
+    cs_limits_t lim = {1, nlocal[X], 1, nlocal[Y], 1, nlocal[Z]};
 
-  for (int ic = 1; ic <= nlocal[X]; ic++) {
-    for (int jc = 1; jc <= nlocal[Y]; jc++) {
-      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+    #pragma omp parallel for
+    for (int ib = 0; ib < cs_limits_size(lim); ib++) {
 
-	int index = cs_index(cs, ic, jc, kc);
-	double force[3] = {0};
-	colloid_t * pc = NULL;
+      int ic = cs_limits_ic(lim, ib);
+      int jc = cs_limits_jc(lim, ib);
+      int kc = cs_limits_kc(lim, ib);
+      int index = cs_index(psi->cs, ic, jc, kc);
+      colloid_t * pc = NULL;
 
-	colloids_info_map(cinfo, index, &pc);
+      colloids_info_map(cinfo, index, &pc);
+
+      if (pc == NULL) {
+	double force[3] = {0};
+	psi_force_divstress_site(psi, fe, ic, jc, kc, force);
+	if (hydro) hydro_f_local_add(hydro, index, force);
+      }
+    }
+  }
 
-	/* Calculate divergence based on the stencil */
-	for (int p = 1; p < s->npoints; p++) {
+  /* Colloid sites */
 
-	  int8_t cx = s->cv[p][X];
-	  int8_t cy = s->cv[p][Y];
-	  int8_t cz = s->cv[p][Z];
-	  int index1 = cs_index(cs, ic + cx, jc + cy, kc + cz);
-	  double pth[3][3] = {0};
+  {
+    int ncolloid = 0;
+    colloids_info_ntotal(cinfo, &ncolloid);
+    if (ncolloid == 0) return 0;
+  }
 
-	  fe->func->stress(fe, index1, pth);
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
 
-	  for (int ia = 0; ia < 3; ia++) {
-	    for (int ib = 0; ib < 3; ib++) {
-	      force[ia] -= s->wgradients[p]*pth[ia][ib]*s->cv[p][ib];
-	    }
-	  }
-	}
+	int index = cs_index(psi->cs, ic, jc, kc);
+	colloid_t * pc = NULL;
 
-        /* Store the force on the colloid or on the lattice */
+	colloids_info_map(cinfo, index, &pc);
 
 	if (pc) {
+	  double force[3] = {0};
+	  psi_force_divstress_site(psi, fe, ic, jc, kc, force);
 	  pc->force[X] += force[X];
 	  pc->force[Y] += force[Y];
 	  pc->force[Z] += force[Z];
 	}
-	else {
-	  hydro_f_local_add(hydro, index, force);
-	}
-
       }
     }
   }
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  psi_force_divstress_site
+ *
+ *  Divergence of the stress at (ic, jc, kc) based on the stencil.
+ *
+ *****************************************************************************/
+
+static void psi_force_divstress_site(psi_t * psi, fe_t * fe, int ic, int jc,
+				     int kc, double force[3]) {
+
+  stencil_t * s = psi->stencil;
+
+  assert(s);
+
+  for (int p = 1; p < s->npoints; p++) {
+
+    int8_t cx = s->cv[p][X];
+    int8_t cy = s->cv[p][Y];
+    int8_t cz = s->cv[p][Z];
+    int index1 = cs_index(psi->cs, ic + cx, jc + cy, kc + cz);
+    double pth[3][3] = {0};
+
+    fe->func->stress(fe, index1, pth);
+
+    for (int ia = 0; ia < 3; ia++) {
+      for (int ib = 0; ib < 3; ib++) {
+	force[ia] -= s->wgradients[p]*pth[ia][ib]*s->cv[p][ib];
+      }
+    }
+  }
+
+  return;
+}
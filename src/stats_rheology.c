@@ -17,7 +17,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -327,14 +327,19 @@ int stats_rheology_stress_profile_zero(stats_rheo_t * stat) {
  *  Accumulate the contribution to the mean stress profile
  *  for this time step.
  *
+ *  If pth is not NULL and holds the stress for the current step,
+ *  that is used in preference to recomputing the thermodynamic
+ *  stress site by site.
+ *
  *****************************************************************************/
 
 int stats_rheology_stress_profile_accumulate(stats_rheo_t * stat, lb_t * lb,
-					     fe_t * fe,
+					     fe_t * fe, pth_t * pth,
 					     hydro_t * hydro) {
 
   int ic, jc, kc, index;
   int nlocal[3];
+  int use_pth = 0;
   int ia, ib, ndata;
   double rho, rrho;
   double u[3];
@@ -346,6 +351,11 @@ int stats_rheology_stress_profile_accumulate(stats_rheo_t * stat, lb_t * lb,
 
   cs_nlocal(stat->cs, nlocal);
 
+  if (pth && pth_stress_current(pth)) {
+    use_pth = 1;
+    pth_memcpy(pth, tdpMemcpyDeviceToHost);
+  }
+
   for (ic = 1; ic <= nlocal[X]; ic++) {
     for (jc = 1; jc <= nlocal[Y]; jc++) {
       for (kc = 1; kc <= nlocal[Z]; kc++) {
@@ -378,7 +388,12 @@ int stats_rheology_stress_profile_accumulate(stats_rheo_t * stat, lb_t * lb,
 
 	/* Thermodynamic part of stress */
 
-	fe->func->stress(fe, index, s);
+	if (use_pth) {
+	  pth_stress(pth, index, s);
+	}
+	else {
+	  fe->func->stress(fe, index, s);
+	}
 
 	stat->sxy[NSTAT1*(ic-1) + 1] += s[X][Y];
 
@@ -736,13 +751,17 @@ int stats_rheology_stress_section(stats_rheo_t * stat, const char * filename) {
  *  Note that the viscous stress is constructed from the second
  *  moment of the distribution.
  *
+ *  The thermodynamic stress is taken from pth if it is current.
+ *
  *****************************************************************************/
 
-int stats_rheology_mean_stress(lb_t * lb, fe_t * fe, const char * filename) {
+int stats_rheology_mean_stress(lb_t * lb, fe_t * fe, pth_t * pth,
+			       const char * filename) {
 
 #define NCOMP 27
 
   int nlocal[3];
+  int use_pth = 0;
   int ic, jc, kc, index, ia, ib;
   double stress[3][3];
   double rhouu[3][3];
@@ -772,6 +791,11 @@ int stats_rheology_mean_stress(lb_t * lb, fe_t * fe, const char * filename) {
   physics_eta_shear(phys, &eta);
   viscous = -rcs2*eta*2.0/(1.0 + 6.0*eta);
 
+  if (pth && pth_stress_current(pth)) {
+    use_pth = 1;
+    pth_memcpy(pth, tdpMemcpyDeviceToHost);
+  }
+
   for (ia = 0; ia < 3; ia++) {
     for (ib = 0; ib < 3; ib++) {
       stress[ia][ib] = 0.0;
@@ -791,7 +815,12 @@ int stats_rheology_mean_stress(lb_t * lb, fe_t * fe, const char * filename) {
 	lb_0th_moment(lb, index, LB_RHO, &rho);
 	lb_1st_moment(lb, index, LB_RHO, u);
 	lb_2nd_moment(lb, index, LB_RHO, s);
-        fe->func->stress(fe, index, plocal);
+	if (use_pth) {
+	  pth_stress(pth, index, plocal);
+	}
+	else {
+	  fe->func->stress(fe, index, plocal);
+	}
 
 	rrho = 1.0/rho;
         for (ia = 0; ia < 3; ia++) {
@@ -7,7 +7,7 @@
  *
  *  $Id: stats_rheology.h,v 1.3 2009-10-14 17:16:01 kevin Exp $
  *
- *  (c) 2009-2022 The University of Edinburgh
+ *  (c) 2009-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -20,6 +20,7 @@
 #include "free_energy.h"
 #include "lb_data.h"
 #include "hydro.h"
+#include "phi_force_stress.h"
 
 typedef struct stats_rheo_s stats_rheo_t;
 
@@ -27,9 +28,9 @@ int stats_rheology_create(pe_t * pe, cs_t * cs, stats_rheo_t ** prheo);
 int stats_rheology_free(stats_rheo_t * rheo);
 
 int stats_rheology_stress_profile_accumulate(stats_rheo_t * rheo,
-					     lb_t * lb, fe_t * fe,
+					     lb_t * lb, fe_t * fe, pth_t * pth,
 					     hydro_t * hydro);
-int stats_rheology_mean_stress(lb_t * lb, fe_t * fe,
+int stats_rheology_mean_stress(lb_t * lb, fe_t * fe, pth_t * pth,
 			       const char * filename);
 
 int stats_rheology_free_energy_density_profile(stats_rheo_t * rheo, fe_t * fe,
@@ -46,7 +46,7 @@
  *  Edinburgh Soft Matter and Statistical Phyiscs Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -59,15 +59,56 @@
 
 #include "pe.h"
 #include "coords.h"
+#include "kernel.h"
 #include "physics.h"
 #include "colloids.h"
 #include "colloid_sums.h"
 #include "util.h"
 #include "subgrid.h"
 
-static double d_peskin(double);
+/* Particles are held in cell list order, and the occupied cells are
+ * optionally partitioned into SUBGRID_NCOLOUR colours by cell parity.
+ * If all cells are at least SUBGRID_LCELL_COLOUR lattice units wide,
+ * particles in different cells of the same colour cannot share a
+ * lattice site (the delta function has support |r| < 2). Particles
+ * in the same cell may share sites, so the spreading kernel takes one
+ * cell per thread and treats the particles in that cell in turn. */
+
+#define SUBGRID_NCOLOUR      8
+#define SUBGRID_LCELL_COLOUR 4.0
+#define SUBGRID_DRANGE       1.0   /* Max. range of interpolation - 1 */
+
+typedef struct subgrid_list_s subgrid_list_t;
+
+struct subgrid_list_s {
+  int npart;                          /* Number of subgrid particles */
+  int ncolour;                        /* 1 or SUBGRID_NCOLOUR */
+  int cstart[SUBGRID_NCOLOUR + 1];    /* Offset of each colour in cell[] */
+  int * cell;                         /* Offset of each cell in list */
+  colloid_t ** pc;                    /* Particles in list order */
+  double * r0;                        /* Local positions [3*npart] */
+  double * f;                         /* fex or fsub [3*npart] */
+  int * celltarget;                   /* Target copy of cell */
+  double * r0target;                  /* Target copy of r0 */
+  double * ftarget;                   /* Target copy of f */
+};
+
+static int subgrid_list_create(colloids_info_t * cinfo, int colour,
+			       subgrid_list_t * list);
+static int subgrid_list_reserve(colloids_info_t * cinfo, int npart);
 static int subgrid_interpolation(colloids_info_t * cinfo, hydro_t * hydro);
-static const double drange_ = 1.0; /* Max. range of interpolation - 1 */
+
+static __host__ __device__ double d_peskin(double);
+static __host__ __device__ int subgrid_weights(double r0, int nlocal,
+					       int * ifirst, double w[4]);
+
+__global__ void subgrid_interpolation_kernel(cs_t * cs, hydro_t * hydro,
+					     int npart, const double * r0,
+					     double * fsub);
+__global__ void subgrid_spread_kernel(cs_t * cs, colloids_info_t * cinfo,
+				      hydro_t * hydro, int c0, int c1,
+				      const int * cell, const double * r0,
+				      const double * fex, int atomic);
 
 /*****************************************************************************
  *
@@ -76,130 +117,178 @@ static const double drange_ = 1.0; /* Max. range of interpolation - 1 */
  *  For each particle, accumulate the force on the relevant surrounding
  *  lattice nodes. Only nodes in the local domain are involved.
  *
+ *  The cells of each colour are spread in turn by a kernel. If
+ *  colouring is not possible, each particle is treated as a "cell"
+ *  of its own and updates to the fluid force are atomic.
+ *
  *  If there are no subgrid particles, hydro is allowed to be NULL.
  *
  *****************************************************************************/
 
-
 int subgrid_force_from_particles(colloids_info_t * cinfo, hydro_t * hydro,
 				 wall_t * wall) {
 
-  int ic, jc, kc;
-  int i, j, k, i_min, i_max, j_min, j_max, k_min, k_max;
-  int index;
-  int nlocal[3], offset[3];
-  int ncell[3];
-
-  double r[3], r0[3], force[3];
-  double dr;
-  colloid_t * p_colloid = NULL;  /* Subgrid colloid */
-  colloid_t * presolved = NULL;  /* Resolved colloid occupuing node */
+  int n, ia;
+  int atomic;
+  double lcell[3];
+  cs_t * cstarget = NULL;
+  subgrid_list_t list = {0};
 
   assert(cinfo);
   assert(wall);
 
   if (cinfo->nsubgrid == 0) return 0;
 
-  cs_nlocal(cinfo->cs, nlocal);
-  cs_nlocal_offset(cinfo->cs, offset);
-  colloids_info_ncell(cinfo, ncell);
-
   /* Add any wall lubrication corrections before communication to
    * find total external force on each particle */
 
   subgrid_wall_lubrication(cinfo, wall);
   colloid_sums_halo(cinfo, COLLOID_SUM_FORCE_EXT_ONLY);
 
-  /* While there is no device implementation, must copy back-and forth
-   * the force. */
-
   assert(hydro);
-  hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
 
-  /* Loop through all cells (including the halo cells) */
+  colloids_info_lcell(cinfo, lcell);
+  atomic = (lcell[X] < SUBGRID_LCELL_COLOUR ||
+	    lcell[Y] < SUBGRID_LCELL_COLOUR ||
+	    lcell[Z] < SUBGRID_LCELL_COLOUR);
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+  subgrid_list_create(cinfo, !atomic, &list);
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  for (n = 0; n < list.npart; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      list.f[3*n + ia] = list.pc[n]->fex[ia];
+    }
+  }
 
-	for ( ; p_colloid; p_colloid = p_colloid->next) {
+  if (list.npart > 0) {
 
-          if (p_colloid->s.type != COLLOID_TYPE_SUBGRID) continue;
+    int ic;
+    int ndevice;
 
-	  /* Need to translate the colloid position to "local"
-	   * coordinates, so that the correct range of lattice
-	   * nodes is found */
+    tdpGetDeviceCount(&ndevice);
+    cs_target(cinfo->cs, &cstarget);
 
-	  r0[X] = p_colloid->s.r[X] - 1.0*offset[X];
-	  r0[Y] = p_colloid->s.r[Y] - 1.0*offset[Y];
-	  r0[Z] = p_colloid->s.r[Z] - 1.0*offset[Z];
+    if (ndevice > 0) {
+      tdpAssert(tdpMemcpy(list.ftarget, list.f, 3*list.npart*sizeof(double),
+			  tdpMemcpyHostToDevice));
+    }
 
-	  /* Work out which local lattice sites are involved
-	   * and loop around */
+    for (ic = 0; ic < list.ncolour; ic++) {
 
-	  i_min = imax(1,         (int) floor(r0[X] - drange_));
-	  i_max = imin(nlocal[X], (int) ceil (r0[X] + drange_));
-	  j_min = imax(1,         (int) floor(r0[Y] - drange_));
-	  j_max = imin(nlocal[Y], (int) ceil (r0[Y] + drange_));
-	  k_min = imax(1,         (int) floor(r0[Z] - drange_));
-	  k_max = imin(nlocal[Z], (int) ceil (r0[Z] + drange_));
+      int c0 = list.cstart[ic];
+      int c1 = list.cstart[ic + 1];
+      dim3 nblk, ntpb;
 
-	  for (i = i_min; i <= i_max; i++) {
-	    for (j = j_min; j <= j_max; j++) {
-	      for (k = k_min; k <= k_max; k++) {
+      if (c1 == c0) continue;
 
-		index = cs_index(cinfo->cs, i, j, k);
+      kernel_launch_param(c1 - c0, &nblk, &ntpb);
+      tdpLaunchKernel(subgrid_spread_kernel, nblk, ntpb, 0, 0,
+		      cstarget, cinfo->target, hydro->target, c0, c1,
+		      list.celltarget, list.r0target, list.ftarget, atomic);
+      tdpAssert(tdpPeekAtLastError());
+      tdpAssert(tdpDeviceSynchronize());
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  subgrid_spread_kernel
+ *
+ *  One cell per iteration for cells c0 <= c < c1; the particles in
+ *  each cell are treated serially, so that, within a colour, the
+ *  (non-atomic) update of the fluid force is free of conflicts.
+ *  Sites occupied by resolved colloids pass the force (and torque)
+ *  to that colloid; these updates are always atomic.
+ *
+ *****************************************************************************/
 
-		/* Separation between r0 and the coordinate position of
-		 * this site */
+__global__ void subgrid_spread_kernel(cs_t * cs, colloids_info_t * cinfo,
+				      hydro_t * hydro, int c0, int c1,
+				      const int * cell, const double * r0,
+				      const double * fex, int atomic) {
+  int kc;
 
-		r[X] = r0[X] - 1.0*i;
-		r[Y] = r0[Y] - 1.0*j;
-		r[Z] = r0[Z] - 1.0*k;
+  assert(cs);
+  assert(cinfo);
+  assert(hydro);
+  assert(cell);
+  assert(r0);
+  assert(fex);
 
-		dr = d_peskin(r[X])*d_peskin(r[Y])*d_peskin(r[Z]);
-            
-		force[X] = p_colloid->fex[X]*dr;
-		force[Y] = p_colloid->fex[Y]*dr;
-		force[Z] = p_colloid->fex[Z]*dr;
+  for_simt_parallel(kc, c1 - c0, 1) {
 
-		colloids_info_map(cinfo, index, &presolved);
+    int n;
+    int i, j, k, index;
+    int nlocal[3], offset[3];
+    int ifirst[3], nw[3];
+    double wx[4], wy[4], wz[4];
+    double dr;
+    double force[3];
 
-		if (presolved == NULL) {
-		  hydro_f_local_add(hydro, index, force);
-		}
-		else {
-		  double rd[3] = {0};
-		  double torque[3] = {0};
-		  presolved->force[X] += force[X];
-		  presolved->force[Y] += force[Y];
-		  presolved->force[Z] += force[Z];
-		  rd[X] = 1.0*i - (presolved->s.r[X] - 1.0*offset[X]);
-		  rd[Y] = 1.0*j - (presolved->s.r[Y] - 1.0*offset[Y]);
-		  rd[Z] = 1.0*k - (presolved->s.r[Z] - 1.0*offset[Z]);
-		  cross_product(rd, force, torque);
-		  presolved->torque[X] += torque[X];
-		  presolved->torque[Y] += torque[Y];
-		  presolved->torque[Z] += torque[Z];
-                }
+    cs_nlocal(cs, nlocal);
+    cs_nlocal_offset(cs, offset);
+
+    for (n = cell[c0 + kc]; n < cell[c0 + kc + 1]; n++) {
+
+      /* Weights for the local lattice sites involved (in each direction) */
+
+      nw[X] = subgrid_weights(r0[3*n + X], nlocal[X], &ifirst[X], wx);
+      nw[Y] = subgrid_weights(r0[3*n + Y], nlocal[Y], &ifirst[Y], wy);
+      nw[Z] = subgrid_weights(r0[3*n + Z], nlocal[Z], &ifirst[Z], wz);
+
+      for (i = 0; i < nw[X]; i++) {
+	for (j = 0; j < nw[Y]; j++) {
+	  for (k = 0; k < nw[Z]; k++) {
+
+	    colloid_t * presolved = NULL;
+
+	    index = cs_index(cs, ifirst[X] + i, ifirst[Y] + j, ifirst[Z] + k);
 
+	    dr = wx[i]*wy[j]*wz[k];
+	    force[X] = fex[3*n + X]*dr;
+	    force[Y] = fex[3*n + Y]*dr;
+	    force[Z] = fex[3*n + Z]*dr;
+
+	    presolved = cinfo->map_new[index];
+
+	    if (presolved == NULL) {
+	      if (atomic) {
+		double * f = hydro->force->data;
+		tdpAtomicAddDouble(f + addr_rank1(hydro->nsite, 3, index, X),
+				   force[X]);
+		tdpAtomicAddDouble(f + addr_rank1(hydro->nsite, 3, index, Y),
+				   force[Y]);
+		tdpAtomicAddDouble(f + addr_rank1(hydro->nsite, 3, index, Z),
+				   force[Z]);
+	      }
+	      else {
+		hydro_f_local_add(hydro, index, force);
 	      }
 	    }
+	    else {
+	      double rd[3] = {0};
+	      double torque[3] = {0};
+	      rd[X] = 1.0*(ifirst[X] + i) - (presolved->s.r[X] - 1.0*offset[X]);
+	      rd[Y] = 1.0*(ifirst[Y] + j) - (presolved->s.r[Y] - 1.0*offset[Y]);
+	      rd[Z] = 1.0*(ifirst[Z] + k) - (presolved->s.r[Z] - 1.0*offset[Z]);
+	      cross_product(rd, force, torque);
+	      tdpAtomicAddDouble(&presolved->force[X], force[X]);
+	      tdpAtomicAddDouble(&presolved->force[Y], force[Y]);
+	      tdpAtomicAddDouble(&presolved->force[Z], force[Z]);
+	      tdpAtomicAddDouble(&presolved->torque[X], torque[X]);
+	      tdpAtomicAddDouble(&presolved->torque[Y], torque[Y]);
+	      tdpAtomicAddDouble(&presolved->torque[Z], torque[Z]);
+	    }
 	  }
-
-	  /* Next colloid */
 	}
-
-	/* Next cell */
       }
     }
   }
 
-  hydro_memcpy(hydro, tdpMemcpyHostToDevice);
-
-  return 0;
+  return;
 }
 
 /*****************************************************************************
@@ -299,117 +388,326 @@ int subgrid_update(colloids_info_t * cinfo, hydro_t * hydro, int noise_flag) {
  *  Interpolate (delta function method) the lattice velocity field
  *  to the position of the particles.
  *
+ *  Each particle gathers from the local lattice independently, so
+ *  all particles are treated by a single kernel.
+ *
  *****************************************************************************/
 
 static int subgrid_interpolation(colloids_info_t * cinfo, hydro_t * hydro) {
 
-  int ic, jc, kc;
-  int i, j, k, i_min, i_max, j_min, j_max, k_min, k_max;
-  int index;
-  int nlocal[3], offset[3];
-  int ncell[3];
-
-  double r0[3], r[3], u[3];
-  double dr;
-  colloid_t * p_colloid;
+  int n, ia;
+  int ndevice;
+  cs_t * cstarget = NULL;
+  subgrid_list_t list = {0};
 
   assert(cinfo);
   assert(hydro);
 
-  cs_nlocal(cinfo->cs, nlocal);
-  cs_nlocal_offset(cinfo->cs, offset);
-  colloids_info_ncell(cinfo, ncell);
+  subgrid_list_create(cinfo, 0, &list);
 
-  /* While there is no subgrid device implementation,
-     need to recover the current velocity. */
+  if (list.npart > 0) {
 
-  hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
+    dim3 nblk, ntpb;
 
-  /* Loop through all cells (including the halo cells) and set
-   * the velocity at each particle to zero for this step. */
+    cs_target(cinfo->cs, &cstarget);
 
-  for (ic = 0; ic <= ncell[X] + 1; ic++) {
-    for (jc = 0; jc <= ncell[Y] + 1; jc++) {
-      for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+    kernel_launch_param(list.npart, &nblk, &ntpb);
+    tdpLaunchKernel(subgrid_interpolation_kernel, nblk, ntpb, 0, 0,
+		    cstarget, hydro->target, list.npart, list.r0target,
+		    list.ftarget);
+    tdpAssert(tdpPeekAtLastError());
+    tdpAssert(tdpDeviceSynchronize());
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+    tdpGetDeviceCount(&ndevice);
 
-	for ( ; p_colloid; p_colloid = p_colloid->next) {
+    if (ndevice > 0) {
+      tdpAssert(tdpMemcpy(list.f, list.ftarget, 3*list.npart*sizeof(double),
+			  tdpMemcpyDeviceToHost));
+    }
+  }
 
-          if (p_colloid->s.type != COLLOID_TYPE_SUBGRID) continue;
+  /* Velocity at each particle (all copies) for this step. */
+
+  for (n = 0; n < list.npart; n++) {
+    for (ia = 0; ia < 3; ia++) {
+      list.pc[n]->fsub[ia] = list.f[3*n + ia];
+    }
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  subgrid_interpolation_kernel
+ *
+ *  One particle per iteration.
+ *
+ *****************************************************************************/
+
+__global__ void subgrid_interpolation_kernel(cs_t * cs, hydro_t * hydro,
+					     int npart, const double * r0,
+					     double * fsub) {
+  int n;
+
+  assert(cs);
+  assert(hydro);
+  assert(r0);
+  assert(fsub);
+
+  for_simt_parallel(n, npart, 1) {
 
-	  p_colloid->fsub[X] = 0.0;
-	  p_colloid->fsub[Y] = 0.0;
-	  p_colloid->fsub[Z] = 0.0;
+    int i, j, k, index;
+    int nlocal[3];
+    int ifirst[3], nw[3];
+    double wx[4], wy[4], wz[4];
+    double dr;
+    double u[3];
+    double usum[3] = {0.0, 0.0, 0.0};
+
+    cs_nlocal(cs, nlocal);
+
+    nw[X] = subgrid_weights(r0[3*n + X], nlocal[X], &ifirst[X], wx);
+    nw[Y] = subgrid_weights(r0[3*n + Y], nlocal[Y], &ifirst[Y], wy);
+    nw[Z] = subgrid_weights(r0[3*n + Z], nlocal[Z], &ifirst[Z], wz);
+
+    for (i = 0; i < nw[X]; i++) {
+      for (j = 0; j < nw[Y]; j++) {
+	for (k = 0; k < nw[Z]; k++) {
+
+	  index = cs_index(cs, ifirst[X] + i, ifirst[Y] + j, ifirst[Z] + k);
+
+	  dr = wx[i]*wy[j]*wz[k];
+	  hydro_u(hydro, index, u);
+
+	  usum[X] += u[X]*dr;
+	  usum[Y] += u[Y]*dr;
+	  usum[Z] += u[Z]*dr;
 	}
       }
     }
+
+    fsub[3*n + X] = usum[X];
+    fsub[3*n + Y] = usum[Y];
+    fsub[3*n + Z] = usum[Z];
   }
 
-  /* And add up the contributions to the velocity from the lattice. */
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  subgrid_list_create
+ *
+ *  Collect the subgrid particles from all cells (including halo cells)
+ *  in cell list order, with local positions. Occupied cells are
+ *  recorded by their offset in the list; if colour is set, the cells
+ *  are partitioned by the parity of the cell coordinates. Otherwise,
+ *  each particle is given a "cell" of its own.
+ *
+ *  The list refers to the workspace held by cinfo; target copies
+ *  of cell and r0 are up-to-date on return. f is not initialised.
+ *
+ *****************************************************************************/
+
+static int subgrid_list_create(colloids_info_t * cinfo, int colour,
+			       subgrid_list_t * list) {
+
+  int ic, jc, kc, icol;
+  int n = 0;
+  int nc = 0;
+  int ndevice;
+  int ncell[3];
+  int offset[3];
+  colloid_t * pc = NULL;
+
+  assert(cinfo);
+  assert(list);
+
+  colloids_info_ncell(cinfo, ncell);
+  cs_nlocal_offset(cinfo->cs, offset);
+
+  list->ncolour = (colour) ? SUBGRID_NCOLOUR : 1;
 
   for (ic = 0; ic <= ncell[X] + 1; ic++) {
     for (jc = 0; jc <= ncell[Y] + 1; jc++) {
       for (kc = 0; kc <= ncell[Z] + 1; kc++) {
+	colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
+	for ( ; pc; pc = pc->next) {
+	  if (pc->s.type == COLLOID_TYPE_SUBGRID) n += 1;
+	}
+      }
+    }
+  }
 
-	colloids_info_cell_list_head(cinfo, ic, jc, kc, &p_colloid);
+  list->npart = n;
+  list->cstart[0] = 0;
+  for (icol = 1; icol <= list->ncolour; icol++) list->cstart[icol] = 0;
 
-	for ( ; p_colloid; p_colloid = p_colloid->next) {
+  if (n == 0) return 0;
 
-          if (p_colloid->s.type != COLLOID_TYPE_SUBGRID) continue;
+  subgrid_list_reserve(cinfo, n);
 
-	  /* Need to translate the colloid position to "local"
-	   * coordinates, so that the correct range of lattice
-	   * nodes is found */
+  list->pc         = cinfo->subgrid_pc;
+  list->cell       = cinfo->subgrid_cell;
+  list->r0         = cinfo->subgrid_r0;
+  list->f          = cinfo->subgrid_f;
+  list->celltarget = cinfo->subgrid_celltarget;
+  list->r0target   = cinfo->subgrid_r0target;
+  list->ftarget    = cinfo->subgrid_ftarget;
 
-	  r0[X] = p_colloid->s.r[X] - 1.0*offset[X];
-	  r0[Y] = p_colloid->s.r[Y] - 1.0*offset[Y];
-	  r0[Z] = p_colloid->s.r[Z] - 1.0*offset[Z];
+  n = 0;
 
-	  /* Work out which local lattice sites are involved
-	   * and loop around */
+  for (icol = 0; icol < list->ncolour; icol++) {
 
-	  i_min = imax(1,         (int) floor(r0[X] - drange_));
-	  i_max = imin(nlocal[X], (int) ceil (r0[X] + drange_));
-	  j_min = imax(1,         (int) floor(r0[Y] - drange_));
-	  j_max = imin(nlocal[Y], (int) ceil (r0[Y] + drange_));
-	  k_min = imax(1,         (int) floor(r0[Z] - drange_));
-	  k_max = imin(nlocal[Z], (int) ceil (r0[Z] + drange_));
+    list->cstart[icol] = nc;
 
-	  for (i = i_min; i <= i_max; i++) {
-	    for (j = j_min; j <= j_max; j++) {
-	      for (k = k_min; k <= k_max; k++) {
+    for (ic = 0; ic <= ncell[X] + 1; ic++) {
+      for (jc = 0; jc <= ncell[Y] + 1; jc++) {
+	for (kc = 0; kc <= ncell[Z] + 1; kc++) {
 
-		index = cs_index(cinfo->cs, i, j, k);
+	  int n0 = n;
 
-		/* Separation between r0 and the coordinate position of
-		 * this site */
+	  if (colour && icol != (ic % 2) + 2*(jc % 2) + 4*(kc % 2)) continue;
 
-		r[X] = r0[X] - 1.0*i;
-		r[Y] = r0[Y] - 1.0*j;
-		r[Z] = r0[Z] - 1.0*k;
+	  colloids_info_cell_list_head(cinfo, ic, jc, kc, &pc);
 
-		dr = d_peskin(r[X])*d_peskin(r[Y])*d_peskin(r[Z]);
-		hydro_u(hydro, index, u);
+	  for ( ; pc; pc = pc->next) {
 
-		p_colloid->fsub[X] += u[X]*dr;
-		p_colloid->fsub[Y] += u[Y]*dr;
-		p_colloid->fsub[Z] += u[Z]*dr;
-	      }
-	    }
+	    if (pc->s.type != COLLOID_TYPE_SUBGRID) continue;
+
+	    /* Need to translate the colloid position to "local"
+	     * coordinates, so that the correct range of lattice
+	     * nodes is found */
+
+	    if (colour == 0) list->cell[nc++] = n;
+
+	    list->pc[n] = pc;
+	    list->r0[3*n + X] = pc->s.r[X] - 1.0*offset[X];
+	    list->r0[3*n + Y] = pc->s.r[Y] - 1.0*offset[Y];
+	    list->r0[3*n + Z] = pc->s.r[Z] - 1.0*offset[Z];
+	    n += 1;
 	  }
 
-	  /* Next colloid */
+	  if (colour && n > n0) list->cell[nc++] = n0;
 	}
-
-	/* Next cell */
       }
     }
   }
 
+  list->cstart[list->ncolour] = nc;
+  list->cell[nc] = n;
+  assert(n == list->npart);
+  assert(nc <= n);
+
+  /* Target copies */
+
+  tdpGetDeviceCount(&ndevice);
+
+  if (ndevice > 0) {
+    tdpAssert(tdpMemcpy(list->celltarget, list->cell, (nc + 1)*sizeof(int),
+			tdpMemcpyHostToDevice));
+    tdpAssert(tdpMemcpy(list->r0target, list->r0, 3*n*sizeof(double),
+			tdpMemcpyHostToDevice));
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  subgrid_list_reserve
+ *
+ *  Ensure the workspace held by cinfo has capacity for npart particles.
+ *  Storage is only reallocated if the number of particles grows.
+ *
+ *****************************************************************************/
+
+static int subgrid_list_reserve(colloids_info_t * cinfo, int npart) {
+
+  int ndevice;
+  int nmax;
+
+  assert(cinfo);
+
+  if (npart <= cinfo->nsubgridmax) return 0;
+
+  nmax = npart;
+  tdpGetDeviceCount(&ndevice);
+
+  if (cinfo->subgrid_r0target != cinfo->subgrid_r0) {
+    tdpAssert(tdpFree(cinfo->subgrid_celltarget));
+    tdpAssert(tdpFree(cinfo->subgrid_r0target));
+    tdpAssert(tdpFree(cinfo->subgrid_ftarget));
+  }
+  free(cinfo->subgrid_f);
+  free(cinfo->subgrid_r0);
+  free(cinfo->subgrid_cell);
+  free(cinfo->subgrid_pc);
+
+  cinfo->subgrid_pc   = (colloid_t **) malloc(nmax*sizeof(colloid_t *));
+  cinfo->subgrid_cell = (int *) malloc((nmax + 1)*sizeof(int));
+  cinfo->subgrid_r0   = (double *) malloc(3*nmax*sizeof(double));
+  cinfo->subgrid_f    = (double *) malloc(3*nmax*sizeof(double));
+  assert(cinfo->subgrid_pc);
+  assert(cinfo->subgrid_cell);
+  assert(cinfo->subgrid_r0);
+  assert(cinfo->subgrid_f);
+
+  if (cinfo->subgrid_pc == NULL || cinfo->subgrid_cell == NULL ||
+      cinfo->subgrid_r0 == NULL || cinfo->subgrid_f == NULL) {
+    pe_fatal(cinfo->pe, "malloc(subgrid list) failed\n");
+  }
+
+  cinfo->subgrid_celltarget = cinfo->subgrid_cell;
+  cinfo->subgrid_r0target   = cinfo->subgrid_r0;
+  cinfo->subgrid_ftarget    = cinfo->subgrid_f;
+
+  if (ndevice > 0) {
+    size_t nsz = 3*nmax*sizeof(double);
+    tdpAssert(tdpMalloc((void **) &cinfo->subgrid_celltarget,
+			(nmax + 1)*sizeof(int)));
+    tdpAssert(tdpMalloc((void **) &cinfo->subgrid_r0target, nsz));
+    tdpAssert(tdpMalloc((void **) &cinfo->subgrid_ftarget, nsz));
+  }
+
+  cinfo->nsubgridmax = nmax;
+
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  subgrid_weights
+ *
+ *  For local position r0 in one coordinate direction, return the number
+ *  of local lattice sites involved (at most 4), the first site ifirst,
+ *  and the delta function weight at each.
+ *
+ *  The range is [floor(r0 - 1), ceil(r0 + 1)] restricted to the local
+ *  domain [1, nlocal].
+ *
+ *****************************************************************************/
+
+static __host__ __device__ int subgrid_weights(double r0, int nlocal,
+					       int * ifirst, double w[4]) {
+  int i, i0, i1;
+  int nw = 0;
+
+  i0 = imax(1,      (int) floor(r0 - SUBGRID_DRANGE));
+  i1 = imin(nlocal, (int) ceil (r0 + SUBGRID_DRANGE));
+
+  assert(i1 - i0 < 4);
+
+  for (i = i0; i <= i1; i++) {
+    w[nw++] = d_peskin(r0 - 1.0*i);
+  }
+
+  *ifirst = i0;
+
+  return nw;
+}
+
 /*****************************************************************************
  *
  *  subgrid_wall_lubrication
@@ -454,7 +752,7 @@ int subgrid_wall_lubrication(colloids_info_t * cinfo, wall_t * wall) {
  *
  *****************************************************************************/
 
-static double d_peskin(double r) {
+static __host__ __device__ double d_peskin(double r) {
 
   double rmod;
   double delta = 0.0;
@@ -28,7 +28,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  and Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2021 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -70,9 +70,31 @@ static fe_vt_t fe_surf_hvt = {
   (fe_htensor_v_ft) NULL,             /* Not reelvant */
   (fe_stress_v_ft)  fe_surf_str_v,    /* Total stress (vectorised version) */
   (fe_stress_v_ft)  fe_surf_str_v,    /* Symmetric part (vectorised) */
-  (fe_stress_v_ft)  NULL              /* Antisymmetric part */
+  (fe_stress_v_ft)  NULL,             /* Antisymmetric part */
+  (fe_fed_v_ft)     fe_surf_fed_v,    /* Vectorised free energy density */
+  (fe_mu_v_ft)      fe_surf_mu_v      /* Vectorised chemical potential */
 };
 
+/* Virtual function table (device) */
+
+static __constant__ fe_vt_t fe_surf_dvt = {
+  (fe_free_ft)      NULL,             /* Virtual destructor */
+  (fe_target_ft)    NULL,             /* Return target pointer */
+  (fe_fed_ft)       fe_surf_fed,      /* Free energy density */
+  (fe_mu_ft)        fe_surf_mu,       /* Chemical potential */
+  (fe_mu_solv_ft)   NULL,
+  (fe_str_ft)       fe_surf_str,      /* Total stress */
+  (fe_str_ft)       fe_surf_str,      /* Symmetric stress */
+  (fe_str_ft)       NULL,             /* Antisymmetric stress (not relevant) */
+  (fe_hvector_ft)   NULL,             /* Not relevant */
+  (fe_htensor_ft)   NULL,             /* Not relevant */
+  (fe_htensor_v_ft) NULL,             /* Not reelvant */
+  (fe_stress_v_ft)  fe_surf_str_v,    /* Total stress (vectorised version) */
+  (fe_stress_v_ft)  fe_surf_str_v,    /* Symmetric part (vectorised) */
+  (fe_stress_v_ft)  NULL,             /* Antisymmetric part */
+  (fe_fed_v_ft)     fe_surf_fed_v,    /* Vectorised free energy density */
+  (fe_mu_v_ft)      fe_surf_mu_v      /* Vectorised chemical potential */
+};
 
 static __constant__ fe_surf_param_t const_param;
 
@@ -114,19 +136,37 @@ int fe_surf_create(pe_t * pe, cs_t * cs, field_t * phi,
   tdpGetDeviceCount(&ndevice);
 
   if (ndevice == 0) {
-    fe_surf_param_set(obj, param);
     obj->target = obj;
   }
   else {
-    fe_surf_param_t * tmp;
-    tdpMalloc((void **) &obj->target, sizeof(fe_surf_t));
-    tdpGetSymbolAddress((void **) &tmp, tdpSymbol(const_param));
-    tdpMemcpy(&obj->target->param, tmp, sizeof(fe_surf_param_t *),
-	      tdpMemcpyHostToDevice);
-    /* Now copy. */
-    assert(0); /* No implementation */
+
+    tdpAssert(tdpMalloc((void **) &obj->target, sizeof(fe_surf_t)));
+    tdpAssert(tdpMemset(obj->target, 0, sizeof(fe_surf_t)));
+
+    /* Device function table */
+    {
+      fe_vt_t * vt = NULL;
+      tdpGetSymbolAddress((void **) &vt, tdpSymbol(fe_surf_dvt));
+      tdpAssert(tdpMemcpy(&obj->target->super.func, &vt, sizeof(fe_vt_t *),
+			  tdpMemcpyHostToDevice));
+    }
+
+    /* Constant symbols */
+    {
+      fe_surf_param_t * tmp = NULL;
+      tdpGetSymbolAddress((void **) &tmp, tdpSymbol(const_param));
+      tdpAssert(tdpMemcpy(&obj->target->param, &tmp,
+			  sizeof(fe_surf_param_t *), tdpMemcpyHostToDevice));
+    }
+
+    /* Order parameter and gradient */
+    tdpAssert(tdpMemcpy(&obj->target->phi, &phi->target, sizeof(field_t *),
+			tdpMemcpyHostToDevice));
+    tdpAssert(tdpMemcpy(&obj->target->dphi, &dphi->target,
+			sizeof(field_grad_t *), tdpMemcpyHostToDevice));
   }
 
+  fe_surf_param_set(obj, param);
   *fe = obj;
 
   return 0;
@@ -147,6 +187,7 @@ __host__ int fe_surf_free(fe_surf_t * fe) {
   tdpGetDeviceCount(&ndevice);
   if (ndevice > 0) tdpFree(fe->target);
 
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
 
@@ -221,6 +262,12 @@ __host__ int fe_surf_param_set(fe_surf_t * fe, fe_surf_param_t vals) {
 
   *fe->param = vals;
 
+  if (util_commit_required(&fe->commit, "surfactant.c:const_param",
+			   fe->param, sizeof(fe_surf_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_surf_param_t), 0, tdpMemcpyHostToDevice);
+  }
+
   return 0;
 }
 
@@ -317,7 +364,7 @@ __host__ int fe_surf_langmuir_isotherm(fe_surf_t * fe, double * psi_c) {
  *
  ****************************************************************************/
 
-__host__ int fe_surf_fed(fe_surf_t * fe, int index, double * fed) {
+__host__ __device__ int fe_surf_fed(fe_surf_t * fe, int index, double * fed) {
 
   double field[2];
   double phi;
@@ -369,7 +416,7 @@ __host__ int fe_surf_fed(fe_surf_t * fe, int index, double * fed) {
  *
  ****************************************************************************/
 
-__host__ int fe_surf_mu(fe_surf_t * fe, int index, double * mu) {
+__host__ __device__ int fe_surf_mu(fe_surf_t * fe, int index, double * mu) {
 
   double phi;
   double psi;
@@ -428,7 +475,8 @@ __host__ int fe_surf_mu(fe_surf_t * fe, int index, double * mu) {
  *
  ****************************************************************************/
 
-__host__ int fe_surf_str(fe_surf_t * fe, int index, double s[3][3]) {
+__host__ __device__ int fe_surf_str(fe_surf_t * fe, int index,
+				    double s[3][3]) {
 
   int ia, ib;
   double field[2];
@@ -472,25 +520,176 @@ __host__ int fe_surf_str(fe_surf_t * fe, int index, double s[3][3]) {
 
 /*****************************************************************************
  *
- *  fe_surf_str_v
+ *  fe_surf_fed_v
+ *
+ *  Free energy density (vectorised version). See fe_surf_fed().
+ *
+ *****************************************************************************/
+
+__host__ __device__ void fe_surf_fed_v(fe_surf_t * fe, int index,
+				       double fed[NSIMDVL]) {
+  int iv;
+  double phi[NSIMDVL];
+  double psi[NSIMDVL];
+  double dphisq[NSIMDVL];
+  fe_surf_param_t * param = NULL;
+
+  assert(fe);
+
+  param = fe->param;
+
+  for_simd_v(iv, NSIMDVL) {
+    phi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 0)];
+    psi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 1)];
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+    double dx = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,index+iv,0,X)];
+    double dy = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,index+iv,0,Y)];
+    double dz = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,index+iv,0,Z)];
+    dphisq[iv] = dx*dx + dy*dy + dz*dz;
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+    fed[iv] = 0.5*param->a*phi[iv]*phi[iv]
+      + 0.25*param->b*phi[iv]*phi[iv]*phi[iv]*phi[iv]
+      + 0.5*param->kappa*dphisq[iv];
+
+    fed[iv] += param->kt*(psi[iv]*log(psi[iv])
+			  + (1.0 - psi[iv])*log(1.0 - psi[iv]))
+      - 0.5*param->epsilon*psi[iv]*dphisq[iv]
+      - 0.5*param->beta*psi[iv]*psi[iv]*dphisq[iv]
+      + 0.5*param->w*psi[iv]*phi[iv]*phi[iv];
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_surf_mu_v
  *
- *  Stress (vectorised version) Currently a patch-up.
+ *  Chemical potentials (vectorised version). See fe_surf_mu().
  *
  *****************************************************************************/
 
-int fe_surf_str_v(fe_surf_t * fe, int index, double s[3][3][NSIMDVL]) {
+__host__ __device__ void fe_surf_mu_v(fe_surf_t * fe, int index,
+				      double mu[][NSIMDVL]) {
+  int ia;
+  int iv;
+  double phi[NSIMDVL];
+  double psi[NSIMDVL];
+  double delsq[NSIMDVL];
+  double grad[2][3][NSIMDVL];
+  fe_surf_param_t * param = NULL;
+
+  assert(fe);
+  assert(mu);
+
+  param = fe->param;
+
+  for_simd_v(iv, NSIMDVL) {
+    phi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 0)];
+    psi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 1)];
+    delsq[iv] = fe->dphi->delsq[addr_rank1(fe->dphi->nsite,2,index+iv,0)];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      int n = index + iv;
+      grad[0][ia][iv] = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,n,0,ia)];
+      grad[1][ia][iv] = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,n,1,ia)];
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+
+    double dphidpsi = grad[0][X][iv]*grad[1][X][iv]
+      + grad[0][Y][iv]*grad[1][Y][iv] + grad[0][Z][iv]*grad[1][Z][iv];
+    double dphisq = grad[0][X][iv]*grad[0][X][iv]
+      + grad[0][Y][iv]*grad[0][Y][iv] + grad[0][Z][iv]*grad[0][Z][iv];
+
+    /* mu_phi */
+
+    mu[0][iv] = param->a*phi[iv] + param->b*phi[iv]*phi[iv]*phi[iv]
+      - param->kappa*delsq[iv]
+      + param->w*phi[iv]*psi[iv]
+      + param->epsilon*(psi[iv]*delsq[iv] + dphidpsi)
+      + param->beta*psi[iv]*(psi[iv]*delsq[iv] + 2.0*dphidpsi);
+
+    /* mu_psi */
+
+    mu[1][iv] = param->kt*(log(psi[iv]) - log(1.0 - psi[iv]))
+      + 0.5*param->w*phi[iv]*phi[iv]
+      - 0.5*param->epsilon*dphisq
+      - param->beta*psi[iv]*dphisq;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  fe_surf_str_v
+ *
+ *  Stress (vectorised version). See fe_surf_str().
+ *
+ *****************************************************************************/
 
+__host__ __device__ int fe_surf_str_v(fe_surf_t * fe, int index,
+				      double s[3][3][NSIMDVL]) {
   int ia, ib;
   int iv;
-  double s1[3][3];
+  double phi[NSIMDVL];
+  double psi[NSIMDVL];
+  double delsq[NSIMDVL];
+  double grad[2][3][NSIMDVL];
+  fe_surf_param_t * param = NULL;
+  KRONECKER_DELTA_CHAR(d);
 
   assert(fe);
 
-  for (iv = 0; iv < NSIMDVL; iv++) {
-    fe_surf_str(fe, index + iv, s1);
+  param = fe->param;
+
+  for_simd_v(iv, NSIMDVL) {
+    phi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 0)];
+    psi[iv] = fe->phi->data[addr_rank1(fe->phi->nsites, 2, index + iv, 1)];
+    delsq[iv] = fe->dphi->delsq[addr_rank1(fe->dphi->nsite,2,index+iv,0)];
+  }
+
+  for (ia = 0; ia < 3; ia++) {
+    for_simd_v(iv, NSIMDVL) {
+      int n = index + iv;
+      grad[0][ia][iv] = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,n,0,ia)];
+      grad[1][ia][iv] = fe->dphi->grad[addr_rank2(fe->dphi->nsite,2,3,n,1,ia)];
+    }
+  }
+
+  for_simd_v(iv, NSIMDVL) {
+
+    double p0;
+    double kappa;
+    double dphidpsi = grad[0][X][iv]*grad[1][X][iv]
+      + grad[0][Y][iv]*grad[1][Y][iv] + grad[0][Z][iv]*grad[1][Z][iv];
+    double dphisq = grad[0][X][iv]*grad[0][X][iv]
+      + grad[0][Y][iv]*grad[0][Y][iv] + grad[0][Z][iv]*grad[0][Z][iv];
+
+    p0 = 0.5*param->a*phi[iv]*phi[iv]
+      + 0.75*param->b*phi[iv]*phi[iv]*phi[iv]*phi[iv]
+      - param->kappa*(phi[iv]*delsq[iv] - 0.5*dphisq)
+      - param->kt*log(1.0 - psi[iv])
+      + param->w*psi[iv]*phi[iv]*phi[iv]
+      + param->epsilon*phi[iv]*(dphidpsi + psi[iv]*delsq[iv])
+      + param->beta*psi[iv]*(2.0*phi[iv]*dphidpsi
+			     + phi[iv]*psi[iv]*delsq[iv]
+			     - 0.5*psi[iv]*dphisq);
+
+    kappa = param->kappa - param->epsilon*psi[iv]
+      - param->beta*psi[iv]*psi[iv];
+
     for (ia = 0; ia < 3; ia++) {
       for (ib = 0; ib < 3; ib++) {
-	s[ia][ib][iv] = s1[ia][ib];
+	s[ia][ib][iv] = p0*d[ia][ib] + kappa*grad[0][ia][iv]*grad[0][ib][iv];
       }
     }
   }
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group
  *  and Edinburgh Parallel Computing Centre
  *
- *  (c) 2009-2019 The University of Edinburgh
+ *  (c) 2009-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -19,6 +19,7 @@
 #include "free_energy.h"
 #include "field.h"
 #include "field_grad.h"
+#include "util_commit.h"
 
 typedef struct fe_surfactant_s fe_surf_t;
 typedef struct fe_surfactant_param_s fe_surf_param_t;
@@ -41,6 +42,7 @@ struct fe_surfactant_s {
   fe_surf_param_t * param;         /* Parameters */
   field_t * phi;                   /* Single field with {phi,psi} */
   field_grad_t * dphi;             /* gradients thereof */
+  util_commit_t commit;            /* Parameters last sent to target */
   fe_surf_t * target;              /* Device copy */
 };
 
@@ -56,9 +58,15 @@ __host__ int fe_surf_langmuir_isotherm(fe_surf_t * fe, double * psi_c);
 __host__ int fe_surf_target(fe_surf_t * fe, fe_t ** target);
 
 __host__ int fe_surf_param(fe_surf_t * fe, fe_surf_param_t * param);
-__host__ int fe_surf_fed(fe_surf_t * fe, int index, double * fed);
-__host__ int fe_surf_mu(fe_surf_t * fe, int index, double * mu);
-__host__ int fe_surf_str(fe_surf_t * fe, int index, double s[3][3]);
-__host__ int fe_surf_str_v(fe_surf_t * fe, int index, double s[3][3][NSIMDVL]);
+
+__host__ __device__ int fe_surf_fed(fe_surf_t * fe, int index, double * fed);
+__host__ __device__ int fe_surf_mu(fe_surf_t * fe, int index, double * mu);
+__host__ __device__ int fe_surf_str(fe_surf_t * fe, int index, double s[3][3]);
+__host__ __device__ int fe_surf_str_v(fe_surf_t * fe, int index,
+				      double s[3][3][NSIMDVL]);
+__host__ __device__ void fe_surf_fed_v(fe_surf_t * fe, int index,
+				       double fed[NSIMDVL]);
+__host__ __device__ void fe_surf_mu_v(fe_surf_t * fe, int index,
+				      double mu[][NSIMDVL]);
 
 #endif
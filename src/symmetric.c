@@ -57,7 +57,9 @@ static fe_vt_t fe_symm_hvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_symm_str_v,
   (fe_stress_v_ft)  fe_symm_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 static  __constant__ fe_vt_t fe_symm_dvt = {
@@ -74,7 +76,9 @@ static  __constant__ fe_vt_t fe_symm_dvt = {
   (fe_htensor_v_ft) NULL,
   (fe_stress_v_ft)  fe_symm_str_v,
   (fe_stress_v_ft)  fe_symm_str_v,
-  (fe_stress_v_ft)  NULL
+  (fe_stress_v_ft)  NULL,
+  (fe_fed_v_ft)     NULL,
+  (fe_mu_v_ft)      NULL
 };
 
 /****************************************************************************
@@ -157,6 +161,7 @@ __host__ int fe_symm_free(fe_symm_t * fe) {
 
   if (ndevice > 0) tdpFree(fe->target);
 
+  util_commit_reset(&fe->commit);
   free(fe->param);
   free(fe);
 
@@ -191,8 +196,11 @@ __host__ int fe_symm_kernel_commit(fe_symm_t * fe) {
 
   assert(fe);
 
-  tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param, sizeof(fe_symm_param_t),
-		    0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&fe->commit, "symmetric.c:const_param",
+			   fe->param, sizeof(fe_symm_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(const_param), fe->param,
+		      sizeof(fe_symm_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   return 0;
 }
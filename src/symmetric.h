@@ -19,6 +19,7 @@
 #include "free_energy.h"
 #include "field.h"
 #include "field_grad.h"
+#include "util_commit.h"
 
 typedef struct fe_symm_param_s fe_symm_param_t;
 typedef struct fe_symm_s fe_symm_t;
@@ -32,6 +33,7 @@ struct fe_symm_s {
   fe_symm_param_t * param;     /* Parameters */
   field_t * phi;               /* Scalar order parameter or composition */
   field_grad_t * dphi;         /* Gradients thereof */
+  util_commit_t commit;        /* Parameters last sent to target */
   fe_symm_t * target;          /* Target copy */
 };
 
@@ -7,6 +7,10 @@
  *  There are a number of separate 'timers', each of which can
  *  be started, and stopped, independently.
  *
+ *  A timer may also accumulate a count of work items (e.g., links,
+ *  sites, bytes) via TIMER_count(); the total is reported with the
+ *  statistics if the timer has a unit in timer_unit[].
+ *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
@@ -32,6 +36,7 @@ struct timer_struct {
   double          t_min;
   unsigned int    active;
   unsigned int    nsteps;
+  long int        count;
 };
 
 static pe_t * pe_stat = NULL;
@@ -63,9 +68,26 @@ static const char * timer_name[] = {"Total",
 				    "I/O",
 				    "Forces",
 				    "Rebuild",
+				    "-> update map",
+				    "-> remove/replace",
+				    "-> update links",
+				    "-> conservation",
 				    "BBL",
+				    "-> pass0",
+				    "-> link flatten",
+				    "-> pass1",
+				    "-> pass2",
 				    "Particle updates",
 				    "Particle halos",
+				    "-> halo state",
+				    "Colloid sums",
+				    "-> structure",
+				    "-> dynamics",
+				    "-> active",
+				    "-> subgrid",
+				    "-> conservation",
+				    "-> external force",
+				    "-> diagnostic",
 				    "Fluctuations",
 				    "Ewald Sum total",
 				    "Ewald Real",
@@ -95,6 +117,23 @@ static const char * timer_name[] = {"Total",
                                     "Free3", "Free4", "Free5", "Free6"
 };
 
+/* Units for timers which accumulate a count (others are NULL) */
+
+static const char * timer_unit[TIMER_NTIMERS] = {
+  [TIMER_REBUILD_REMOVE_REPLACE]    = "sites",
+  [TIMER_REBUILD_LINKS]             = "links",
+  [TIMER_BBL_PASS1]                 = "links",
+  [TIMER_BBL_PASS2]                 = "links",
+  [TIMER_PARTICLE_HALO_STATE]       = "bytes",
+  [TIMER_COLLOID_SUMS_STRUCTURE]    = "bytes",
+  [TIMER_COLLOID_SUMS_DYNAMICS]     = "bytes",
+  [TIMER_COLLOID_SUMS_ACTIVE]       = "bytes",
+  [TIMER_COLLOID_SUMS_SUBGRID]      = "bytes",
+  [TIMER_COLLOID_SUMS_CONSERVATION] = "bytes",
+  [TIMER_COLLOID_SUMS_FORCE_EXT]    = "bytes",
+  [TIMER_COLLOID_SUMS_DIAGNOSTIC]   = "bytes"
+};
+
 
 /****************************************************************************
  *
@@ -110,12 +149,16 @@ int TIMER_init(pe_t * pe) {
 
   pe_stat = pe;
 
+  /* Names must match the ids */
+  assert(sizeof(timer_name)/sizeof(timer_name[0]) == TIMER_NTIMERS);
+
   for (n = 0; n < TIMER_NTIMERS; n++) {
     timer[n].t_sum  = 0.0;
     timer[n].t_max  = FLT_MIN;
     timer[n].t_min  = FLT_MAX;
     timer[n].active = 0;
     timer[n].nsteps = 0;
+    timer[n].count  = 0;
   }
 
   return 0;
@@ -189,6 +232,39 @@ void TIMER_stop(const int t_id) {
   return;
 }
 
+/*****************************************************************************
+ *
+ *  TIMER_count
+ *
+ *  Add n work items (links, sites, bytes, ...) to the count for
+ *  the specified timer.
+ *
+ *****************************************************************************/
+
+void TIMER_count(const int t_id, long int n) {
+
+  assert(0 <= t_id && t_id < TIMER_NTIMERS);
+
+  timer[t_id].count += n;
+
+  return;
+}
+
+/*****************************************************************************
+ *
+ *  timer_count
+ *
+ *  Return the (local) count of work items accumulated for timer t_id.
+ *
+ *****************************************************************************/
+
+long int timer_count(const int t_id) {
+
+  assert(0 <= t_id && t_id < TIMER_NTIMERS);
+
+  return timer[t_id].count;
+}
+
 /*****************************************************************************
  *
  *  TIMER_statistics
@@ -234,7 +310,19 @@ void TIMER_statistics() {
 
       pe_info(pe_stat, "%20s: %10.3f %10.3f %10.3f %10.6f", timer_name[n],
 	   t_min, t_max, t_sum, t_sum/(double) timer[n].nsteps);
-      pe_info(pe_stat, " (%d call%s)\n", timer[n].nsteps, timer[n].nsteps > 1 ? "s" : ""); 
+
+      if (timer_unit[n] == NULL) {
+	pe_info(pe_stat, " (%d call%s)\n", timer[n].nsteps,
+		timer[n].nsteps > 1 ? "s" : "");
+      }
+      else {
+	/* Count is the total over all ranks. The line must still end
+	 * in "call(s))" for the benefit of the regression test diff. */
+	long int count = 0;
+	MPI_Reduce(&timer[n].count, &count, 1, MPI_LONG, MPI_SUM, 0, comm);
+	pe_info(pe_stat, " (%ld %s, %d call%s)\n", count, timer_unit[n],
+		timer[n].nsteps, timer[n].nsteps > 1 ? "s" : "");
+      }
     }
   }
 
@@ -46,8 +46,10 @@ __host__ int TIMER_init(pe_t * pe);
 __host__ void TIMER_start(const int);
 __host__ void TIMER_stop(const int);
 __host__ void TIMER_statistics(void);
+__host__ void TIMER_count(const int, long int n);
 
 __host__ double timer_lapse(const int);
+__host__ long int timer_count(const int);
 
 enum timer_id {TIMER_TOTAL = 0,
 	       TIMER_STEPS,
@@ -75,9 +77,26 @@ enum timer_id {TIMER_TOTAL = 0,
 	       TIMER_IO,
 	       TIMER_FORCES,
 	       TIMER_REBUILD,
+	       TIMER_REBUILD_MAP,
+	       TIMER_REBUILD_REMOVE_REPLACE,
+	       TIMER_REBUILD_LINKS,
+	       TIMER_REBUILD_CONSERVATION,
 	       TIMER_BBL,
+	       TIMER_BBL_PASS0,
+	       TIMER_BBL_FLATTEN,
+	       TIMER_BBL_PASS1,
+	       TIMER_BBL_PASS2,
 	       TIMER_PARTICLE_UPDATE,
 	       TIMER_PARTICLE_HALO,
+	       TIMER_PARTICLE_HALO_STATE,
+	       TIMER_COLLOID_SUMS,          /* Followed by one per sum type */
+	       TIMER_COLLOID_SUMS_STRUCTURE,
+	       TIMER_COLLOID_SUMS_DYNAMICS,
+	       TIMER_COLLOID_SUMS_ACTIVE,
+	       TIMER_COLLOID_SUMS_SUBGRID,
+	       TIMER_COLLOID_SUMS_CONSERVATION,
+	       TIMER_COLLOID_SUMS_FORCE_EXT,
+	       TIMER_COLLOID_SUMS_DIAGNOSTIC,
 	       TIMER_FLUCTUATIONS,
                TIMER_EWALD_TOTAL,
                TIMER_EWALD_REAL_SPACE,
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ *
+ *  util_commit.c
+ *
+ *  Parameter blocks (e.g., the collision parameters) are copied to
+ *  constant memory on the target via tdpMemcpyToSymbol(). Most are
+ *  requested at every time step, but change only rarely. This keeps
+ *  a host copy of the last values committed so that the copy to the
+ *  target can be omitted if nothing has changed.
+ *
+ *  Each owning object holds its own record. As the target symbol is
+ *  shared between all objects of a given type, a record of which object
+ *  last committed to each symbol is also kept here, so that a commit
+ *  from a different object is never omitted.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util_commit.h"
+
+/* Last owner of each target symbol (a handful are in use). */
+
+#define UTIL_COMMIT_NSYMBOL_MAX 32
+
+typedef struct util_commit_owner_s util_commit_owner_t;
+
+struct util_commit_owner_s {
+  const char * symbol;
+  const util_commit_t * owner;
+};
+
+static int nsymbol_ = 0;
+static util_commit_owner_t owner_[UTIL_COMMIT_NSYMBOL_MAX] = {0};
+
+static util_commit_owner_t * util_commit_owner(const char * symbol);
+
+/*****************************************************************************
+ *
+ *  util_commit_required
+ *
+ *  Return 1 if the parameters differ from those last committed by this
+ *  object (or there has been no commit, or a commit to the same symbol
+ *  by a different object), in which case the caller must copy the
+ *  parameters to the target. Return 0 if no copy is required.
+ *
+ *****************************************************************************/
+
+int util_commit_required(util_commit_t * obj, const char * symbol,
+			 const void * param, size_t size) {
+
+  util_commit_owner_t * entry = NULL;
+
+  assert(obj);
+  assert(symbol);
+  assert(param);
+  assert(size > 0);
+
+  obj->nrequest += 1;
+
+  /* An object should always commit to the same symbol */
+  assert(obj->symbol == NULL || strcmp(obj->symbol, symbol) == 0);
+  obj->symbol = symbol;
+
+  /* If there is no room to record the owner, commit every time */
+  entry = util_commit_owner(symbol);
+
+  if (entry && entry->owner == obj && obj->last && obj->size == size) {
+    if (memcmp(obj->last, param, size) == 0) return 0;
+  }
+
+  if (obj->last == NULL || obj->size != size) {
+    free(obj->last);
+    obj->size = 0;
+    obj->last = (unsigned char *) malloc(size);
+    assert(obj->last);
+    if (obj->last) obj->size = size;
+  }
+
+  if (obj->last) memcpy(obj->last, param, size);
+  if (entry) entry->owner = (obj->last) ? obj : NULL;
+  obj->ncommit += 1;
+
+  return 1;
+}
+
+/*****************************************************************************
+ *
+ *  util_commit_reset
+ *
+ *  Forget the last values, so that the next request must commit.
+ *  Must be called before the owning object is released.
+ *
+ *****************************************************************************/
+
+int util_commit_reset(util_commit_t * obj) {
+
+  assert(obj);
+
+  for (int n = 0; n < nsymbol_; n++) {
+    if (owner_[n].owner == obj) owner_[n].owner = NULL;
+  }
+
+  free(obj->last);
+  obj->last = NULL;
+  obj->size = 0;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  util_commit_owner
+ *
+ *  Return the owner record for the symbol (a new one if not present),
+ *  or NULL if there is no room.
+ *
+ *****************************************************************************/
+
+static util_commit_owner_t * util_commit_owner(const char * symbol) {
+
+  assert(symbol);
+
+  for (int n = 0; n < nsymbol_; n++) {
+    if (strcmp(owner_[n].symbol, symbol) == 0) return owner_ + n;
+  }
+
+  if (nsymbol_ == UTIL_COMMIT_NSYMBOL_MAX) return NULL;
+
+  owner_[nsymbol_].symbol = symbol;
+  owner_[nsymbol_].owner = NULL;
+  nsymbol_ += 1;
+
+  return owner_ + nsymbol_ - 1;
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************
+ *
+ *  util_commit.h
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#ifndef LUDWIG_UTIL_COMMIT_H
+#define LUDWIG_UTIL_COMMIT_H
+
+#include <stddef.h>
+
+typedef struct util_commit_s util_commit_t;
+
+/* Record of the last parameter block committed to a target symbol by
+ * the owning object. The symbol (a __constant__ parameter block) is
+ * shared by all objects of the same type, so it is identified by name:
+ * a commit is required if the values have changed, or if another
+ * object has committed to the same symbol in the meantime, e.g.,
+ *
+ *   struct obj_s {
+ *     ...
+ *     util_commit_t commit;
+ *   };
+ *
+ *   if (util_commit_required(&obj->commit, "obj_param", param, size)) {
+ *     tdpMemcpyToSymbol(tdpSymbol(obj_param), param, size, ...);
+ *   }
+ *
+ * The owning object must call util_commit_reset() when it is freed. */
+
+struct util_commit_s {
+  const char * symbol;      /* Name of target symbol */
+  size_t size;              /* Size of parameter block (bytes) */
+  unsigned char * last;     /* Copy of last values committed */
+  int nrequest;             /* Number of requests */
+  int ncommit;              /* Number of requests requiring a commit */
+};
+
+int util_commit_required(util_commit_t * obj, const char * symbol,
+			 const void * param, size_t size);
+int util_commit_reset(util_commit_t * obj);
+
+#endif
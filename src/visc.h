@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2020
+ *  (c) 2020-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -17,21 +17,27 @@
 #ifndef LUDWIG_VISC_H
 #define LUDWIG_VISC_H
 
+#include <assert.h>
+#include <math.h>
+
 #include "hydro.h"
 
 typedef enum {VISC_MODEL_ARRHENIUS} visc_model_enum_t;
 
 typedef struct visc_vt_s visc_vt_t;
 typedef struct visc_s visc_t;
+typedef struct visc_local_s visc_local_t;
 
 typedef int (* visc_free_ft)   (visc_t * visc);
 typedef int (* visc_update_ft) (visc_t * visc, hydro_t * hydro);
 typedef int (* visc_stats_ft)  (visc_t * visc, hydro_t * hydro); 
+typedef int (* visc_local_ft)  (visc_t * visc, visc_local_t * local);
 
 struct visc_vt_s {
   visc_free_ft   free;      /* Desctructor */
   visc_update_ft update;    /* Update viscosity */
   visc_stats_ft  stats;     /* Viscosity information */
+  visc_local_ft  local;     /* Site-local description (may be NULL) */
 };
 
 struct visc_s {
@@ -39,5 +45,52 @@ struct visc_s {
   int               id;     /* visc_model_enum_t */
 };
 
+/* Site-local viscosity.
+ * A model which provides a visc_local_t is evaluated at each site
+ * within the collision (via visc_local_eta_v() below), so there is no
+ * separate update() pass and no use of the stored hydro->eta.
+ * The description is plain data, so it may be placed in constant
+ * memory on the target along with the other collision parameters.
+ * A model depending on the local strain rate would add a case which
+ * takes the non-equilibrium stress available in the collision. */
+
+typedef enum {VISC_LOCAL_NONE = 0, VISC_LOCAL_ARRHENIUS} visc_local_enum_t;
+
+struct visc_local_s {
+  int model;                /* visc_local_enum_t */
+  double c0;                /* Arrhenius: eta = exp(c0 + c1 phi) */
+  double c1;                /* ditto */
+  field_t * phi;            /* Composition (target copy) */
+};
+
+/*****************************************************************************
+ *
+ *  visc_local_eta_v
+ *
+ *  Viscosity at sites index0 + iv.
+ *
+ *****************************************************************************/
+
+__host__ __device__ static inline void visc_local_eta_v(const visc_local_t * v,
+							int index0,
+							double eta[NSIMDVL]) {
+  int iv = 0;
+
+  if (v->model == VISC_LOCAL_ARRHENIUS) {
+    const field_t * phi = v->phi;
+    for_simd_v(iv, NSIMDVL) {
+      double phi0 = phi->data[addr_rank0(phi->nsites, index0 + iv)];
+      eta[iv] = exp(v->c0 + v->c1*phi0);
+    }
+  }
+  else {
+    /* No site-local model: should not be here */
+    assert(v->model != VISC_LOCAL_NONE);
+    for_simd_v(iv, NSIMDVL) eta[iv] = 0.0;
+  }
+
+  return;
+}
+
 #endif
 
@@ -13,11 +13,21 @@
  *  where eta_minus is the viscosity of the phi = -phistar phase, and
  *  eta_plus is the viscosity of the +phistar phase.
  *
+ *  Equivalently, ln eta is linear in phi:
+ *
+ *    eta(phi) = exp(c0 + c1 phi)
+ *
+ *  with c0 = 0.5*(ln eta_plus + ln eta_minus) and
+ *       c1 = 0.5*(ln eta_plus - ln eta_minus)/phistar
+ *
+ *  which is the form used when the viscosity is evaluated within the
+ *  collision (see visc_arrhenius_local()).
+ *
  *
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2020
+ *  (c) 2020-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -40,7 +50,8 @@ static __global__ void visc_update_kernel(kernel_ctxt_t * ktx,
 static const visc_vt_t vt_ = {
   (visc_free_ft)   visc_arrhenius_free,
   (visc_update_ft) visc_arrhenius_update,
-  (visc_stats_ft)  visc_arrhenius_stats
+  (visc_stats_ft)  visc_arrhenius_stats,
+  (visc_local_ft)  visc_arrhenius_local
 };
 
 /*****************************************************************************
@@ -140,6 +151,36 @@ __host__ int visc_arrhenius_stats(visc_arrhenius_t * visc, hydro_t * hydro) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  visc_arrhenius_local
+ *
+ *  Site-local description for use in the collision.
+ *
+ *****************************************************************************/
+
+__host__ int visc_arrhenius_local(visc_arrhenius_t * visc,
+				  visc_local_t * local) {
+  double lnplus;
+  double lnminus;
+
+  assert(visc);
+  assert(local);
+  assert(visc->param->eta_plus > 0.0);
+  assert(visc->param->eta_minus > 0.0);
+  assert(visc->param->phistar > 0.0);
+
+  lnplus  = log(visc->param->eta_plus);
+  lnminus = log(visc->param->eta_minus);
+
+  local->model = VISC_LOCAL_ARRHENIUS;
+  local->c0    = 0.5*(lnplus + lnminus);
+  local->c1    = 0.5*(lnplus - lnminus)/visc->param->phistar;
+  local->phi   = visc->phi->target;
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  visc_arrhenius_update
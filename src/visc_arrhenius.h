@@ -51,5 +51,7 @@ __host__ int visc_arrhenius_free(visc_arrhenius_t * visc);
 __host__ int visc_arrhenius_info(visc_arrhenius_t * visc);
 __host__ int visc_arrhenius_update(visc_arrhenius_t * visc, hydro_t * hydro);
 __host__ int visc_arrhenius_stats(visc_arrhenius_t * visc, hydro_t * hydro);
+__host__ int visc_arrhenius_local(visc_arrhenius_t * visc,
+				  visc_local_t * local);
 
 #endif
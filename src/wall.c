@@ -148,6 +148,7 @@ __host__ int wall_free(wall_t * wall) {
     tdpFree(wall->target);
   }
 
+  util_commit_reset(&wall->commit);
   cs_free(wall->cs);
   free(wall->param);
   if (wall->linki) free(wall->linki);
@@ -971,8 +972,11 @@ __host__ int wall_bbl(wall_t * wall) {
   if (wall->param->slip.active) kernel = wall_bbl_slip_kernel;
 
   /* Update kernel constants */
-  tdpMemcpyToSymbol(tdpSymbol(static_param), wall->param,
-		    sizeof(wall_param_t), 0, tdpMemcpyHostToDevice);
+  if (util_commit_required(&wall->commit, "wall.c:static_param",
+			   wall->param, sizeof(wall_param_t))) {
+    tdpMemcpyToSymbol(tdpSymbol(static_param), wall->param,
+		      sizeof(wall_param_t), 0, tdpMemcpyHostToDevice);
+  }
 
   kernel_launch_param(wall->nlink, &nblk, &ntpb);
 
@@ -980,7 +984,6 @@ __host__ int wall_bbl(wall_t * wall) {
 		  wall->target, wall->lb->target, wall->map->target);
 
   tdpAssert(tdpPeekAtLastError());
-  tdpAssert(tdpDeviceSynchronize());
 
   return 0;
 }
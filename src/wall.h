@@ -21,6 +21,7 @@
 #include "coords.h"
 #include "lb_data.h"
 #include "map.h"
+#include "util_commit.h"
 
 typedef enum wall_slip_enum {WALL_NO_SLIP = 0,
 			     WALL_SLIP_XBOT, WALL_SLIP_XTOP,
@@ -66,6 +67,7 @@ struct wall_s {
   cs_t * cs;             /* Reference to coordinate system */
   map_t * map;           /* Reference to map structure */
   lb_t * lb;             /* Reference to LB information */ 
+  util_commit_t commit;  /* Parameters last sent to target */
   wall_t * target;       /* Device memory */
 
   wall_param_t * param;  /* parameters */
@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2018-2022 The University of Edinburgh
+ *  (c) 2018-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Alan Gray (Late of this parish)
@@ -16,7 +16,6 @@
  *****************************************************************************/
 
 #include <assert.h>
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -710,8 +709,21 @@ tdpError_t tdpDeviceEnablePeerAccess(int peerDevice, unsigned int flags) {
   return tdpSuccess;
 }
 
+/* With OpenMP, atomic updates are lock-free using the compiler __atomic
+ * builtins (available in GCC, Clang, Intel, ...): add via fetch-add,
+ * and min/max via a compare-and-swap loop which only writes if the
+ * value changes. Relaxed ordering is sufficient as results are only
+ * read following a barrier or the end of the kernel. Otherwise, fall
+ * back to a critical section. */
+
+#if defined(_OPENMP) && defined(__GNUC__)
+#define TDP_ATOMIC_BUILTINS
+#endif
+
+#ifndef TDP_ATOMIC_BUILTINS
 static int int_max(int a, int b) {return (a > b) ?a :b;}
 static int int_min(int a, int b) {return (a < b) ?a :b;}
+#endif
 
 /*****************************************************************************
  *
@@ -725,7 +737,9 @@ __device__ int tdpAtomicAddInt(int * sum, int val) {
 
   assert(sum);
 
-#ifdef _OPENMP
+#if defined(TDP_ATOMIC_BUILTINS)
+  old = __atomic_fetch_add(sum, val, __ATOMIC_RELAXED);
+#elif defined(_OPENMP)
   #pragma omp critical(atomicAddInt)
   {
     old = *sum;
@@ -753,8 +767,13 @@ __device__ int tdpAtomicMaxInt(int * maxval, int val) {
 
   assert(maxval);
 
-#ifdef _OPENMP
-  /* Ug. */
+#if defined(TDP_ATOMIC_BUILTINS)
+  old = __atomic_load_n(maxval, __ATOMIC_RELAXED);
+  while (val > old) {
+    if (__atomic_compare_exchange_n(maxval, &old, val, 0, __ATOMIC_RELAXED,
+				    __ATOMIC_RELAXED)) break;
+  }
+#elif defined(_OPENMP)
   #pragma omp critical (atomicMaxInt)
   {
     old = *maxval;
@@ -780,7 +799,13 @@ __device__ int tdpAtomicMinInt(int * minval, int val) {
 
   assert(minval);
 
-#ifdef _OPENMP
+#if defined(TDP_ATOMIC_BUILTINS)
+  old = __atomic_load_n(minval, __ATOMIC_RELAXED);
+  while (val < old) {
+    if (__atomic_compare_exchange_n(minval, &old, val, 0, __ATOMIC_RELAXED,
+				    __ATOMIC_RELAXED)) break;
+  }
+#elif defined(_OPENMP)
   #pragma omp critical (tdpAtomicMinInt)
   {
     old = *minval;
@@ -806,7 +831,17 @@ __device__ double tdpAtomicAddDouble(double * sum, double val) {
 
   assert(sum);
 
-#ifdef _OPENMP
+#if defined(TDP_ATOMIC_BUILTINS)
+  {
+    /* No fetch-add for floating point, so compare-and-swap */
+    double newval;
+    __atomic_load(sum, &old, __ATOMIC_RELAXED);
+    do {
+      newval = old + val;
+    } while (!__atomic_compare_exchange(sum, &old, &newval, 0,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  }
+#elif defined(_OPENMP)
   /* Could use "omp capture" here, but not entirely portable without warning */
   #pragma omp critical(tdpAtomicAddDouble)
   {
@@ -821,8 +856,10 @@ __device__ double tdpAtomicAddDouble(double * sum, double val) {
   return old;
 }
 
+#ifndef TDP_ATOMIC_BUILTINS
 static double double_max(double a, double b) {return (a > b) ?a :b;}
 static double double_min(double a, double b) {return (a < b) ?a :b;}
+#endif
 
 /*****************************************************************************
  *
@@ -836,7 +873,13 @@ __device__ double tdpAtomicMaxDouble(double * maxval, double val) {
 
   assert(maxval);
 
-#ifdef _OPENMP
+#if defined(TDP_ATOMIC_BUILTINS)
+  __atomic_load(maxval, &old, __ATOMIC_RELAXED);
+  while (val > old) {
+    if (__atomic_compare_exchange(maxval, &old, &val, 0, __ATOMIC_RELAXED,
+				  __ATOMIC_RELAXED)) break;
+  }
+#elif defined(_OPENMP)
 #pragma omp critical (atomicMaxDouble)
   {
     old = *maxval;
@@ -862,7 +905,13 @@ __device__ double tdpAtomicMinDouble(double * minval, double val) {
 
   assert(minval);
 
-#ifdef _OPENMP
+#if defined(TDP_ATOMIC_BUILTINS)
+  __atomic_load(minval, &old, __ATOMIC_RELAXED);
+  while (val < old) {
+    if (__atomic_compare_exchange(minval, &old, &val, 0, __ATOMIC_RELAXED,
+				  __ATOMIC_RELAXED)) break;
+  }
+#elif defined(_OPENMP)
   #pragma omp critical (atomicMinDouble)
   {
     old = *minval;
@@ -893,17 +942,17 @@ __device__ double tdpAtomicMinDouble(double * minval, double val) {
 __device__ int tdpAtomicBlockAddInt(int * partsum) {
 
 #ifdef _OPENMP
-  int istr;
-  int nblock;
+  /* One barrier, after which thread zero combines the partial sums.
+   * For a host thread count this is cheaper than a barrier per level
+   * of a tree. */
+
   int nthread = omp_get_num_threads();
   int idx = omp_get_thread_num();
 
-  nblock = pow(2, ceil(log(1.0*nthread)/log(2)));
-
-  for (istr = nblock/2; istr > 0; istr /= 2) {
-    #pragma omp barrier
-    if (idx < istr && idx + istr < nthread) {
-      partsum[idx] += partsum[idx + istr];
+  #pragma omp barrier
+  if (idx == 0) {
+    for (int it = 1; it < nthread; it++) {
+      partsum[0] += partsum[it];
     }
   }
 #endif
@@ -920,17 +969,15 @@ __device__ int tdpAtomicBlockAddInt(int * partsum) {
 __device__ double tdpAtomicBlockAddDouble(double * partsum) {
 
 #ifdef _OPENMP
-  int istr;
-  int nblock;
+  /* As for tdpAtomicBlockAddInt() */
+
   int nthread = omp_get_num_threads();
   int idx = omp_get_thread_num();
 
-  nblock = pow(2, ceil(log(1.0*nthread)/log(2)));
-
-  for (istr = nblock/2; istr > 0; istr /= 2) {
-    #pragma omp barrier
-    if (idx < istr && idx + istr < nthread) {
-      partsum[idx] += partsum[idx + istr];
+  #pragma omp barrier
+  if (idx == 0) {
+    for (int it = 1; it < nthread; it++) {
+      partsum[0] += partsum[it];
     }
   }
 #endif
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2021 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Alan Gray (alang@epcc.ed.ac.uk)
@@ -63,6 +63,76 @@ __global__ void kerneltest1(int * n) {
   return;
 }
 
+/* Test 2: atomics and block reduction (sum, min, max of p) */
+
+typedef struct result_s {
+  int isum;
+  int imin;
+  int imax;
+  double dsum;
+  double dmin;
+  double dmax;
+  double dblock;
+} result_t;
+
+__global__ void kerneltest2(result_t * r) {
+
+  int p;
+  int tid = threadIdx.x;
+  __shared__ double partsum[TARGET_MAX_THREADS_PER_BLOCK];
+
+  partsum[tid] = 0.0;
+
+  for_simt_parallel(p, NARRAY, 1) {
+    tdpAtomicAddInt(&r->isum, p);
+    tdpAtomicMinInt(&r->imin, p);
+    tdpAtomicMaxInt(&r->imax, p);
+    tdpAtomicAddDouble(&r->dsum, 1.0*p);
+    tdpAtomicMinDouble(&r->dmin, 1.0*p);
+    tdpAtomicMaxDouble(&r->dmax, 1.0*p);
+    partsum[tid] += 1.0*p;
+  }
+
+  {
+    double sum = tdpAtomicBlockAddDouble(partsum);
+    if (tid == 0) tdpAtomicAddDouble(&r->dblock, sum);
+  }
+
+  return;
+}
+
+__host__ int test2(void) {
+
+  dim3 nblk, ntpb;
+  int nsum = NARRAY*(NARRAY - 1)/2;
+  result_t r_h = {0, NARRAY, -1, 0.0, NARRAY, -1.0, 0.0};
+  result_t * r_d = NULL;
+
+  tdpAssert(tdpMalloc((void **) &r_d, sizeof(result_t)));
+  tdpAssert(tdpMemcpy(r_d, &r_h, sizeof(result_t), tdpMemcpyHostToDevice));
+
+  ntpb.x = tdp_get_max_threads(); ntpb.y = 1; ntpb.z = 1;
+  nblk.x = (NARRAY + ntpb.x - 1)/ntpb.x; nblk.y = 1; nblk.z = 1;
+
+  tdpLaunchKernel(kerneltest2, nblk, ntpb, 0, 0, r_d);
+  tdpAssert(tdpPeekAtLastError());
+  tdpAssert(tdpDeviceSynchronize());
+
+  tdpAssert(tdpMemcpy(&r_h, r_d, sizeof(result_t), tdpMemcpyDeviceToHost));
+
+  if (r_h.isum != nsum)          printf("Wrong atomic add int\n");
+  if (r_h.imin != 0)             printf("Wrong atomic min int\n");
+  if (r_h.imax != NARRAY - 1)    printf("Wrong atomic max int\n");
+  if (r_h.dsum != 1.0*nsum)      printf("Wrong atomic add double\n");
+  if (r_h.dmin != 0.0)           printf("Wrong atomic min double\n");
+  if (r_h.dmax != NARRAY - 1.0)  printf("Wrong atomic max double\n");
+  if (r_h.dblock != 1.0*nsum)    printf("Wrong block add double\n");
+
+  tdpAssert(tdpFree(r_d));
+
+  return 0;
+}
+
 int main(int argc, char * argv[]) {
 
   dim3 nblk, ntpb;
@@ -97,5 +167,7 @@ int main(int argc, char * argv[]) {
     if (n_h[p] != 2*p) printf("Wrong %3d %3d\n", p, n_h[p]);
   }
 
+  test2();
+
   return 0;
 }
@@ -0,0 +1,226 @@
+/*****************************************************************************
+ *
+ *  test_advection.c
+ *
+ *  Advective fluxes for the wide and limited schemes.
+ *
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "leesedwards.h"
+#include "physics.h"
+#include "advection_s.h"
+#include "tests.h"
+
+int test_advection_order_scheme(void);
+int test_advflux_scheme(pe_t * pe, int scheme);
+
+/*****************************************************************************
+ *
+ *  test_advection_suite
+ *
+ *****************************************************************************/
+
+int test_advection_suite(void) {
+
+  pe_t * pe = NULL;
+  physics_t * phys = NULL;  /* Dependency via Lees Edwards */
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+
+  test_advection_order_scheme();
+  test_advflux_scheme(pe, ADVFLUX_SCHEME_ORDER_4);
+  test_advflux_scheme(pe, ADVFLUX_SCHEME_ORDER_5);
+  test_advflux_scheme(pe, ADVFLUX_SCHEME_MUSCL);
+  test_advflux_scheme(pe, ADVFLUX_SCHEME_WENO5);
+
+  pe_info(pe, "PASS     ./unit/test_advection\n");
+
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_advection_order_scheme
+ *
+ *  The run time order is independent of the run time limited scheme.
+ *
+ *****************************************************************************/
+
+int test_advection_order_scheme(void) {
+
+  int order = 0;
+  int scheme = -1;
+
+  advection_order(&order);
+  advection_scheme(&scheme);
+  assert(order == 1);
+  assert(scheme == ADVFLUX_SCHEME_DEFAULT);
+
+  advection_order_set(3);
+  advection_scheme_set(ADVFLUX_SCHEME_WENO5);
+  advection_order(&order);
+  advection_scheme(&scheme);
+  assert(order == 3);
+  assert(scheme == ADVFLUX_SCHEME_WENO5);
+
+  /* Restore the defaults */
+  advection_order_set(1);
+  advection_scheme_set(ADVFLUX_SCHEME_DEFAULT);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_advflux_scheme
+ *
+ *  A step in x advected by a uniform velocity. The fluxes with and
+ *  without Lees-Edwards planes must agree, and the limited schemes
+ *  must not produce face values outside the range of the field.
+ *
+ *****************************************************************************/
+
+int test_advflux_scheme(pe_t * pe, int scheme) {
+
+  int nhalo = 3;
+  int ntotal[3] = {16, 8, 8};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double u0[3] = {0.25, -0.125, 0.0625};
+  double rmax = 0.0;
+
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  hydro_t * hydro = NULL;
+  field_t * phi = NULL;
+  advflux_t * flxcs = NULL;
+  advflux_t * flxle = NULL;
+
+  assert(pe);
+
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  {
+    lees_edw_options_t opts = {0};
+    lees_edw_create(pe, cs, &opts, &le);
+  }
+
+  {
+    hydro_options_t opts = hydro_options_nhalo(nhalo);
+    hydro_create(pe, cs, le, &opts, &hydro);
+    hydro_u_zero(hydro, u0);
+  }
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(1, nhalo);
+    field_create(pe, cs, le, "phi", &opts, &phi);
+  }
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	int ix = noffset[X] + ic;
+	int iy = noffset[Y] + jc;
+	double phi0 = (ix <= ntotal[X]/2) ? +1.0 : -1.0;
+	if (iy <= ntotal[Y]/2) phi0 = 0.5*phi0;
+	field_scalar_set(phi, index, phi0);
+      }
+    }
+  }
+
+  field_memcpy(phi, tdpMemcpyHostToDevice);
+  field_halo(phi);
+
+  advflux_cs_create(pe, cs, 1, &flxcs);
+  advflux_le_create(pe, cs, le, 1, &flxle);
+  advflux_scheme_set(flxcs, scheme);
+  advflux_scheme_set(flxle, scheme);
+
+  advection_x(flxcs, hydro, phi);
+  advection_x(flxle, hydro, phi);
+
+  advflux_memcpy(flxcs, tdpMemcpyDeviceToHost);
+  advflux_memcpy(flxle, tdpMemcpyDeviceToHost);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index0 = cs_index(cs, ic, jc, kc);
+	int indexm = cs_index(cs, ic-1, jc, kc);
+	double fx = flxcs->fx[addr_rank1(flxcs->nsite, 1, index0, 0)];
+	double fw = flxcs->fx[addr_rank1(flxcs->nsite, 1, indexm, 0)];
+	double fy = flxcs->fy[addr_rank1(flxcs->nsite, 1, index0, 0)];
+	double fz = flxcs->fz[addr_rank1(flxcs->nsite, 1, index0, 0)];
+
+	/* Same faces with and without (trivial) Lees-Edwards */
+	assert(fabs(fx - flxle->fe[addr_rank1(flxle->nsite, 1, index0, 0)])
+	       < DBL_EPSILON);
+	assert(fabs(fw - flxle->fw[addr_rank1(flxle->nsite, 1, index0, 0)])
+	       < DBL_EPSILON);
+	assert(fabs(fy - flxle->fy[addr_rank1(flxle->nsite, 1, index0, 0)])
+	       < DBL_EPSILON);
+	assert(fabs(fz - flxle->fz[addr_rank1(flxle->nsite, 1, index0, 0)])
+	       < DBL_EPSILON);
+
+	/* Uniform field in z: exact for all the schemes */
+	{
+	  double phi0 = 0.0;
+	  field_scalar(phi, index0, &phi0);
+	  assert(fabs(fz - u0[Z]*phi0) < DBL_EPSILON);
+	}
+
+	rmax = fmax(rmax, fabs(fx/u0[X]));
+	rmax = fmax(rmax, fabs(fy/u0[Y]));
+      }
+    }
+  }
+
+  {
+    MPI_Comm comm = MPI_COMM_NULL;
+    double rmax_local = rmax;
+    cs_cart_comm(cs, &comm);
+    MPI_Allreduce(&rmax_local, &rmax, 1, MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  /* Bounded (|phi| <= 1) for the limited schemes; the linear schemes
+   * overshoot at the step. */
+
+  if (scheme == ADVFLUX_SCHEME_MUSCL) assert(rmax <= 1.0);
+  if (scheme == ADVFLUX_SCHEME_WENO5) assert(rmax <= 1.0 + FLT_EPSILON);
+  if (scheme == ADVFLUX_SCHEME_ORDER_4) assert(rmax > 1.0);
+  if (scheme == ADVFLUX_SCHEME_ORDER_5) assert(rmax > 1.0);
+
+  advflux_free(flxle);
+  advflux_free(flxcs);
+  field_free(phi);
+  hydro_free(hydro);
+  lees_edw_free(le);
+  cs_free(cs);
+
+  return 0;
+}
@@ -5,7 +5,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2014-2017 The University of Edinburgh
+ *  (c) 2014-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -87,6 +87,17 @@ int test_angle_cosine1(pe_t * pe, cs_t * cs) {
 
   test_create_trimer(cinfo, a, r1, r2, r3, pc3);
   interact_find_bonds(interact, cinfo);
+
+  /* Bond list has each bond once; angle list is (centre, bond[0], bond[1]) */
+
+  if (pe_mpi_size(pe) == 1) {
+    test_assert(cinfo->nbondlist == 2);
+    test_assert(cinfo->nanglelist == 1);
+    test_assert(cinfo->anglelist[0] == pc3[1]);
+    test_assert(cinfo->anglelist[1] == pc3[0]);
+    test_assert(cinfo->anglelist[2] == pc3[2]);
+  }
+
   interact_angles(interact, cinfo);
 
   if (pe_mpi_size(pe) == 1) {
@@ -0,0 +1,471 @@
+/*****************************************************************************
+ *
+ *  test_bbl.c
+ *
+ *  Bounce back on links: the link passes are compared against a
+ *  serial reference computed here from the host link lists.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "util.h"
+#include "colloids_halo.h"
+#include "colloid_sums.h"
+#include "build.h"
+#include "wall.h"
+#include "bbl.h"
+#include "tests.h"
+
+typedef struct test_bbl_ref_s test_bbl_ref_t;
+
+struct test_bbl_ref_s {
+  double f0[3];
+  double t0[3];
+  double zeta[21];
+  double sump;
+};
+
+static int test_bbl_links_c2(pe_t * pe, cs_t * cs);
+static int test_bbl_pass1_reference(colloid_t * pc, lb_t * lb, double rho0,
+				    test_bbl_ref_t * ref);
+static int test_bbl_pass2_reference(colloid_t * pc, lb_t * lb, double rho0,
+				    const test_bbl_ref_t * ref,
+				    double stress[3][3]);
+static int test_bbl_same(double a, double b);
+
+/*****************************************************************************
+ *
+ *  test_bbl_suite
+ *
+ *****************************************************************************/
+
+int test_bbl_suite(void) {
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+
+  /* The reference is computed by the owner of both colloids */
+
+  if (pe_mpi_size(pe) == 1) test_bbl_links_c2(pe, cs);
+
+  cs_free(cs);
+  pe_info(pe, "PASS     ./unit/test_bbl\n");
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_bbl_links_c2
+ *
+ *  Two colloids close enough to have colloid-colloid links; one is
+ *  a squirmer. Velocities are fixed, so the update is known. The
+ *  distributions are not uniform.
+ *
+ *****************************************************************************/
+
+static int test_bbl_links_c2(pe_t * pe, cs_t * cs) {
+
+  int ia, ib;
+  int n;
+  int index, nsites;
+  int ncell[3] = {4, 4, 4};
+  int nfluid = 0;
+  int nsolid = 0;
+  int ncolloid = 0;
+
+  double rho0;
+  double a0 = 2.3;
+  double r1[3] = {29.9, 32.2, 31.9};
+  double r2[3] = {34.6, 32.5, 31.7};
+  double ltot[3];
+  double stress[3][3] = {0};
+  double slocal[3][3] = {0};
+
+  lb_data_options_t options = lb_data_options_default();
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+  wall_t * wall = NULL;
+  bbl_t * bbl = NULL;
+  physics_t * phys = NULL;
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+  test_bbl_ref_t ref[2] = {0};
+
+  assert(pe);
+  assert(cs);
+
+  physics_create(pe, &phys);
+  physics_rho0(phys, &rho0);
+  cs_ltot(cs, ltot);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+  map_create(pe, cs, 0, &map);
+  lb_data_create(pe, cs, &options, &lb);
+  wall_create(pe, cs, map, lb, &wall);
+  bbl_create(pe, cs, lb, &bbl);
+
+  /* Distributions which are not at rest */
+
+  cs_nsites(cs, &nsites);
+  for (index = 0; index < nsites; index++) {
+    for (int p = 0; p < lb->model.nvel; p++) {
+      double f = lb->model.wv[p]*(1.0 + 0.01*sin(0.1*index + p));
+      lb_f_set(lb, index, p, LB_RHO, f);
+    }
+  }
+
+  colloids_info_add_local(cinfo, 1, r1, &pc);
+  assert(pc);
+  pc->s.a0 = a0;
+  pc->s.v[X] = 0.001; pc->s.v[Y] = -0.002; pc->s.v[Z] = 0.0005;
+  pc->s.w[X] = 0.0001; pc->s.w[Y] = 0.0; pc->s.w[Z] = -0.0002;
+
+  colloids_info_add_local(cinfo, 2, r2, &pc);
+  assert(pc);
+  pc->s.a0 = a0;
+  pc->s.type = COLLOID_TYPE_ACTIVE;
+  pc->s.b1 = 0.01;
+  pc->s.b2 = 0.005;
+  pc->s.m[X] = 1.0; pc->s.m[Y] = 0.0; pc->s.m[Z] = 0.0;
+  pc->s.v[X] = -0.001; pc->s.v[Y] = 0.0; pc->s.v[Z] = 0.002;
+
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+  colloids_info_update_lists(cinfo);
+
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    pc->s.isfixedw = 1;
+    pc->s.isfixeds = 1;
+    for (ia = 0; ia < 3; ia++) {
+      pc->s.isfixedrxyz[ia] = 1;
+      pc->s.isfixedvxyz[ia] = 1;
+    }
+  }
+
+  build_update_map(cs, cinfo, map);
+  build_update_links(cs, cinfo, NULL, map, &lb->model);
+  colloid_sums_halo(cinfo, COLLOID_SUM_STRUCTURE);
+  bbl_active_set(bbl, cinfo);
+
+  /* Some change of shape to be accounted */
+
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    pc->deltam = 0.01*pc->s.index;
+    for (colloid_link_t * lnk = pc->lnk; lnk; lnk = lnk->next) {
+      if (lnk->status == LINK_COLLOID) nsolid += 1;
+    }
+  }
+  assert(nsolid > 0);
+
+  /* Missing distributions are set independent of the passes which
+   * follow, so the pass 1 reference can be computed in advance. */
+
+  bbl_pass0(bbl, lb, cinfo);
+
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    n = pc->s.index - 1;
+    test_bbl_pass1_reference(pc, lb, rho0, ref + n);
+  }
+
+  bounce_back_on_links(bbl, lb, wall, cinfo);
+
+  /* Pass 1: the zeta are retained, and f0 is recoverable from fhydro
+   * as the velocities are fixed. */
+
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    double fhydro[3] = {0};
+    const double * zeta = ref[pc->s.index - 1].zeta;
+    const double * f0 = ref[pc->s.index - 1].f0;
+
+    ncolloid += 1;
+    for (ia = 0; ia < 21; ia++) {
+      assert(test_bbl_same(pc->zeta[ia], zeta[ia]));
+    }
+
+    fhydro[X] = f0[X]
+      -(zeta[0]*pc->s.v[X] + zeta[1]*pc->s.v[Y] + zeta[2]*pc->s.v[Z] +
+	zeta[3]*pc->s.w[X] + zeta[4]*pc->s.w[Y] + zeta[5]*pc->s.w[Z]);
+    fhydro[Y] = f0[Y]
+      -(zeta[ 1]*pc->s.v[X] + zeta[ 6]*pc->s.v[Y] + zeta[ 7]*pc->s.v[Z] +
+	zeta[ 8]*pc->s.w[X] + zeta[ 9]*pc->s.w[Y] + zeta[10]*pc->s.w[Z]);
+    fhydro[Z] = f0[Z]
+      -(zeta[ 2]*pc->s.v[X] + zeta[ 7]*pc->s.v[Y] + zeta[11]*pc->s.v[Z] +
+	zeta[12]*pc->s.w[X] + zeta[13]*pc->s.w[Y] + zeta[14]*pc->s.w[Z]);
+
+    for (ia = 0; ia < 3; ia++) {
+      assert(test_bbl_same(pc->diagnostic.fhydro[ia], fhydro[ia]));
+    }
+  }
+  assert(ncolloid == 2);
+
+  /* Pass 2: the surface stress and the bounced-back distributions */
+
+  colloids_info_all_head(cinfo, &pc);
+  for ( ; pc; pc = pc->nextall) {
+    double sc[3][3] = {0};
+    n = pc->s.index - 1;
+    nfluid += test_bbl_pass2_reference(pc, lb, rho0, ref + n, sc);
+    for (ia = 0; ia < 3; ia++) {
+      for (ib = 0; ib < 3; ib++) {
+	stress[ia][ib] += sc[ia][ib];
+      }
+    }
+  }
+  assert(nfluid > 0);
+
+  bbl_surface_stress(bbl, slocal);
+
+  for (ia = 0; ia < 3; ia++) {
+    for (ib = 0; ib < 3; ib++) {
+      double rv = 1.0/(ltot[X]*ltot[Y]*ltot[Z]);
+      assert(test_bbl_same(slocal[ia][ib], rv*stress[ia][ib]));
+    }
+  }
+
+  bbl_free(bbl);
+  wall_free(wall);
+  lb_free(lb);
+  map_free(map);
+  colloids_info_free(cinfo);
+  physics_free(phys);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_bbl_pass1_reference
+ *
+ *  Serial sums over the links of one colloid (cf. Nguyen and Ladd).
+ *  The distributions are not changed.
+ *
+ *****************************************************************************/
+
+static int test_bbl_pass1_reference(colloid_t * pc, lb_t * lb, double rho0,
+				    test_bbl_ref_t * ref) {
+
+  int ia;
+  double rsumw = 1.0/pc->sumw;
+  double cbar[3], rxcbar[3];
+  double deltam = pc->deltam*rsumw;
+  LB_RCS2_DOUBLE(rcs2);
+
+  const lb_model_t * model = &lb->model;
+
+  for (ia = 0; ia < 3; ia++) {
+    cbar[ia]   = pc->cbar[ia]*rsumw;
+    rxcbar[ia] = pc->rxcbar[ia]*rsumw;
+    ref->f0[ia] = pc->f0[ia];
+    ref->t0[ia] = pc->t0[ia];
+  }
+  ref->sump = pc->sump;
+
+  for (colloid_link_t * lnk = pc->lnk; lnk; lnk = lnk->next) {
+
+    int ij = lnk->p;
+    int ji = model->nvel - ij;
+    double dm, delta, fdist;
+    double c[3], rbxc[3];
+
+    if (lnk->status == LINK_UNUSED) continue;
+
+    if (lnk->status == LINK_FLUID) {
+      lb_f(lb, lnk->i, ij, 0, &fdist);
+      dm = 2.0*fdist - model->wv[ij]*deltam;
+      delta = 2.0*rcs2*model->wv[ij]*rho0;
+
+      if (pc->s.type == COLLOID_TYPE_ACTIVE) {
+	double mod, rmod, dm_a, cost, plegendre, sint;
+	double tans[3], vector1[3];
+
+	mod = modulus(lnk->rb)*modulus(pc->s.m);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	cost = rmod*dot_product(lnk->rb, pc->s.m);
+	if (cost*cost > 1.0) cost = 1.0;
+	sint = sqrt(1.0 - cost*cost);
+
+	cross_product(lnk->rb, pc->s.m, vector1);
+	cross_product(vector1, lnk->rb, tans);
+
+	mod = modulus(tans);
+	rmod = 0.0;
+	if (mod != 0.0) rmod = 1.0/mod;
+	plegendre = -sint*(pc->s.b2*cost + pc->s.b1);
+
+	dm_a = 0.0;
+	for (ia = 0; ia < 3; ia++) {
+	  dm_a += -delta*plegendre*rmod*tans[ia]*model->cv[ij][ia];
+	}
+	dm += dm_a;
+	ref->sump += dm_a;
+      }
+    }
+    else {
+      lb_f(lb, lnk->i, ij, 0, &fdist);
+      dm = fdist;
+      lb_f(lb, lnk->j, ji, 0, &fdist);
+      dm += fdist;
+      delta = 0.0;
+    }
+
+    for (ia = 0; ia < 3; ia++) {
+      c[ia] = 1.0*model->cv[ij][ia];
+    }
+    cross_product(lnk->rb, c, rbxc);
+
+    for (ia = 0; ia < 3; ia++) {
+      ref->f0[ia] += dm*c[ia];
+      ref->t0[ia] += dm*rbxc[ia];
+      c[ia] -= cbar[ia];
+      rbxc[ia] -= rxcbar[ia];
+    }
+
+    ref->zeta[ 0] += delta*c[X]*c[X];
+    ref->zeta[ 1] += delta*c[X]*c[Y];
+    ref->zeta[ 2] += delta*c[X]*c[Z];
+    ref->zeta[ 3] += delta*c[X]*rbxc[X];
+    ref->zeta[ 4] += delta*c[X]*rbxc[Y];
+    ref->zeta[ 5] += delta*c[X]*rbxc[Z];
+    ref->zeta[ 6] += delta*c[Y]*c[Y];
+    ref->zeta[ 7] += delta*c[Y]*c[Z];
+    ref->zeta[ 8] += delta*c[Y]*rbxc[X];
+    ref->zeta[ 9] += delta*c[Y]*rbxc[Y];
+    ref->zeta[10] += delta*c[Y]*rbxc[Z];
+    ref->zeta[11] += delta*c[Z]*c[Z];
+    ref->zeta[12] += delta*c[Z]*rbxc[X];
+    ref->zeta[13] += delta*c[Z]*rbxc[Y];
+    ref->zeta[14] += delta*c[Z]*rbxc[Z];
+    ref->zeta[15] += delta*rbxc[X]*rbxc[X];
+    ref->zeta[16] += delta*rbxc[X]*rbxc[Y];
+    ref->zeta[17] += delta*rbxc[X]*rbxc[Z];
+    ref->zeta[18] += delta*rbxc[Y]*rbxc[Y];
+    ref->zeta[19] += delta*rbxc[Y]*rbxc[Z];
+    ref->zeta[20] += delta*rbxc[Z]*rbxc[Z];
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_bbl_pass2_reference
+ *
+ *  After the event, the outside distributions f_i are unchanged, so
+ *  check the bounced-back f_j and accumulate the colloid's contribution
+ *  to the stress. The colloid cbar, rxcbar are already normalised by
+ *  pass 1. Returns the number of fluid links.
+ *
+ *****************************************************************************/
+
+static int test_bbl_pass2_reference(colloid_t * pc, lb_t * lb, double rho0,
+				    const test_bbl_ref_t * ref,
+				    double stress[3][3]) {
+  int ia;
+  int nfluid = 0;
+  double dms = 0.0;
+  double deltam;
+  double sump = ref->sump;
+  LB_RCS2_DOUBLE(rcs2);
+
+  const lb_model_t * model = &lb->model;
+
+  /* pc->deltam, pc->sump are reset at the end of pass 2 */
+
+  deltam = 0.01*pc->s.index*(1.0/pc->sumw);
+  if (pc->s.type == COLLOID_TYPE_ACTIVE) sump /= pc->sumw;
+
+  for (ia = 0; ia < 3; ia++) {
+    dms += pc->s.v[ia]*pc->cbar[ia];
+    dms += pc->s.w[ia]*pc->rxcbar[ia];
+  }
+  dms = 2.0*rcs2*rho0*dms;
+
+  for (colloid_link_t * lnk = pc->lnk; lnk; lnk = lnk->next) {
+
+    int ij = lnk->p;
+    int ji = model->nvel - ij;
+    double dm, fdist, fnew;
+
+    if (lnk->status == LINK_FLUID) {
+      double df, vdotc;
+      double wxrb[3];
+
+      lb_f(lb, lnk->i, ij, 0, &fdist);
+      dm = 2.0*fdist - model->wv[ij]*deltam;
+
+      cross_product(pc->s.w, lnk->rb, wxrb);
+      vdotc = 0.0;
+      for (ia = 0; ia < 3; ia++) {
+	vdotc += (pc->s.v[ia] + wxrb[ia])*model->cv[ij][ia];
+      }
+      vdotc = 2.0*rcs2*model->wv[ij]*vdotc;
+      df = rho0*vdotc + model->wv[ij]*deltam;
+      df += model->wv[ij]*sump;
+      df -= model->wv[ij]*dms;
+
+      lb_f(lb, lnk->j, ji, 0, &fnew);
+      assert(test_bbl_same(fnew, fdist - df));
+
+      for (ia = 0; ia < 3; ia++) {
+	stress[ia][X] += lnk->rb[X]*(dm - df)*model->cv[ij][ia];
+	stress[ia][Y] += lnk->rb[Y]*(dm - df)*model->cv[ij][ia];
+	stress[ia][Z] += lnk->rb[Z]*(dm - df)*model->cv[ij][ia];
+      }
+      nfluid += 1;
+    }
+    else if (lnk->status == LINK_COLLOID) {
+      lb_f(lb, lnk->i, ij, 0, &fdist);
+      dm = fdist;
+      lb_f(lb, lnk->j, ji, 0, &fdist);
+      dm += fdist;
+
+      for (ia = 0; ia < 3; ia++) {
+	stress[ia][X] += lnk->rb[X]*dm*model->cv[ij][ia];
+	stress[ia][Y] += lnk->rb[Y]*dm*model->cv[ij][ia];
+	stress[ia][Z] += lnk->rb[Z]*dm*model->cv[ij][ia];
+      }
+    }
+  }
+
+  return nfluid;
+}
+
+/*****************************************************************************
+ *
+ *  test_bbl_same
+ *
+ *  The order of summation is the same, so agreement should be close
+ *  to exact.
+ *
+ *****************************************************************************/
+
+static int test_bbl_same(double a, double b) {
+
+  return (fabs(a - b) <= DBL_EPSILON*fabs(b));
+}
@@ -10,24 +10,37 @@
  *  Contributing authors:
  *    Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
- *  (c) 2013-2017 The University of Edinburgh
+ *  (c) 2013-2023 The University of Edinburgh
  *
  *****************************************************************************/
 
 #include <assert.h>
 #include <float.h>
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "pe.h"
+#include "util.h"
 #include "coords.h"
 #include "leesedwards.h"
 #include "field.h"
 #include "field_grad.h"
+#include "gradient_3d_7pt_fluid.h"
+#include "physics.h"
+#include "blue_phase.h"
 #include "blue_phase_beris_edwards.h"
+#include "noise.h"
 #include "tests.h"
 
 static int do_test_be_tmatrix(void);
 static int do_test_be1(void);
+static int do_test_be_fused(void);
+static int do_test_be_dt(void);
+static int do_test_be_dt_noise(void);
+static int test_be_dt_steps(beris_edw_t * be, fe_t * fe, field_t * fq,
+			    field_grad_t * fqgrad, map_t * map,
+			    noise_t * noise, int nstep);
 
 /*****************************************************************************
  *
@@ -41,6 +54,9 @@ int test_be_suite(void) {
 
   do_test_be1();
   do_test_be_tmatrix();
+  do_test_be_fused();
+  do_test_be_dt();
+  do_test_be_dt_noise();
 
   return 0;
 }
@@ -108,3 +124,452 @@ static int do_test_be_tmatrix(void) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  do_test_be_fused
+ *
+ *  The fused update (molecular field computed in the update kernel)
+ *  must agree with the standard update.
+ *
+ *****************************************************************************/
+
+static int do_test_be_fused(void) {
+
+  int nhalo = 2;
+  int ntotal[3] = {8, 8, 8};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double dqmax = 0.0;
+  double * q0 = NULL;
+  double * q1 = NULL;
+  PI_DOUBLE(pi);
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  map_t * map = NULL;
+  field_t * fq = NULL;
+  field_grad_t * fqgrad = NULL;
+  fe_lc_t * fe = NULL;
+  beris_edw_t * be = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  lees_edw_create(pe, cs, NULL, &le);
+  map_create(pe, cs, 0, &map);
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(NQAB, nhalo);
+    field_create(pe, cs, le, "q", &opts, &fq);
+    field_grad_create(pe, fq, 2, &fqgrad);
+    field_grad_set(fqgrad, grad_3d_7pt_fluid_d2, NULL);
+  }
+
+  {
+    fe_lc_param_t param = {.a0 = 0.01, .gamma = 3.0, .kappa0 = 0.01,
+			   .kappa1 = 0.01, .q0 = 0.2, .xi = 0.7,
+			   .redshift = 1.0, .rredshift = 1.0};
+    beris_edw_param_t bep = {.xi = 0.7, .gamma = 0.5};
+    fe_lc_create(pe, cs, le, fq, fqgrad, &fe);
+    fe_lc_param_set(fe, &param);
+    beris_edw_create(pe, cs, le, &be);
+    beris_edw_param_set(be, &bep);
+  }
+
+  /* Some smooth, non-uniform, q (local sites) */
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double x = 2.0*pi*(noffset[X] + ic)/ntotal[X];
+	double y = 2.0*pi*(noffset[Y] + jc)/ntotal[Y];
+	double z = 2.0*pi*(noffset[Z] + kc)/ntotal[Z];
+	double q[NQAB] = {0.1*cos(y), 0.05*sin(z), 0.02*cos(x + y),
+			  -0.1*cos(z), 0.03*sin(x)};
+	field_scalar_array_set(fq, index, q);
+      }
+    }
+  }
+
+  q0 = (double *) malloc(NQAB*fq->nsites*sizeof(double));
+  q1 = (double *) malloc(NQAB*fq->nsites*sizeof(double));
+  assert(q0);
+  assert(q1);
+
+  field_memcpy(fq, tdpMemcpyHostToDevice);
+  field_halo(fq);
+  field_grad_compute(fqgrad);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+  memcpy(q0, fq->data, NQAB*fq->nsites*sizeof(double));
+
+  /* Standard, then fused from the same initial state */
+
+  beris_edw_update(be, (fe_t *) fe, fq, fqgrad, NULL, NULL, map, NULL);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+  memcpy(q1, fq->data, NQAB*fq->nsites*sizeof(double));
+
+  memcpy(fq->data, q0, NQAB*fq->nsites*sizeof(double));
+  field_memcpy(fq, tdpMemcpyHostToDevice);
+
+  beris_edw_fused_set(be, 1);
+  beris_edw_update(be, (fe_t *) fe, fq, fqgrad, NULL, NULL, map, NULL);
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	for (int n = 0; n < NQAB; n++) {
+	  int iaddr = addr_rank1(fq->nsites, NQAB, index, n);
+	  test_assert(fabs(fq->data[iaddr] - q1[iaddr]) < DBL_EPSILON);
+	  dqmax = fmax(dqmax, fabs(q1[iaddr] - q0[iaddr]));
+	}
+      }
+    }
+  }
+
+  /* The update is not trivial */
+  test_assert(dqmax > 0.0);
+
+  free(q1);
+  free(q0);
+  beris_edw_free(be);
+  fe_lc_free(fe);
+  field_grad_free(fqgrad);
+  field_free(fq);
+  map_free(map);
+  lees_edw_free(le);
+  cs_free(cs);
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_be_dt
+ *
+ *  With a0 = 0 and q0 = 0 (and no flow) the update is pure diffusion
+ *  of each component of Q with D = Gamma kappa0. For Q = Q0 cos(k x)
+ *  each step of size dt multiplies Q by 1 + dt D sigma, where
+ *  sigma = 2(cos k - 1) is the eigenvalue of the discrete Laplacian.
+ *
+ *  N sub-steps of dt = 1/N must reproduce this, and agree with a
+ *  single unit step to O(dt^2). Likewise one step of dt = N against
+ *  N unit steps.
+ *
+ *****************************************************************************/
+
+static int do_test_be_dt(void) {
+
+  int nhalo = 2;
+  int nstep = 4;
+  int ntotal[3] = {16, 8, 8};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double * q1 = NULL;
+  double * qn = NULL;
+  double k = 0.0;
+  double x = 0.0;
+  PI_DOUBLE(pi);
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  map_t * map = NULL;
+  field_t * fq = NULL;
+  field_grad_t * fqgrad = NULL;
+  fe_lc_t * fe = NULL;
+  beris_edw_t * be = NULL;
+
+  fe_lc_param_t param = {.a0 = 0.0, .gamma = 0.0, .kappa0 = 0.04,
+			 .kappa1 = 0.04, .q0 = 0.0, .xi = 0.7,
+			 .redshift = 1.0, .rredshift = 1.0};
+  beris_edw_param_t bep = {.xi = 0.7, .gamma = 0.5};
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  lees_edw_create(pe, cs, NULL, &le);
+  map_create(pe, cs, 0, &map);
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(NQAB, nhalo);
+    field_create(pe, cs, le, "q", &opts, &fq);
+    field_grad_create(pe, fq, 2, &fqgrad);
+    field_grad_set(fqgrad, grad_3d_7pt_fluid_d2, NULL);
+  }
+
+  fe_lc_create(pe, cs, le, fq, fqgrad, &fe);
+  fe_lc_param_set(fe, &param);
+  beris_edw_create(pe, cs, le, &be);
+  beris_edw_param_set(be, &bep);
+
+  q1 = (double *) malloc(NQAB*fq->nsites*sizeof(double));
+  qn = (double *) malloc(NQAB*fq->nsites*sizeof(double));
+  assert(q1);
+  assert(qn);
+
+  /* Tolerances below are relative to the largest amplitude 0.1 */
+
+  k = 2.0*pi/ntotal[X];
+  x = bep.gamma*param.kappa0*2.0*(cos(k) - 1.0);
+
+  /* One unit step; then nstep sub-steps of dt = 1/nstep */
+
+  test_be_dt_steps(be, (fe_t *) fe, fq, fqgrad, map, NULL, 1);
+  memcpy(q1, fq->data, NQAB*fq->nsites*sizeof(double));
+
+  beris_edw_dt_set(be, 1.0/nstep);
+  test_be_dt_steps(be, (fe_t *) fe, fq, fqgrad, map, NULL, nstep);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double c = cos(k*(noffset[X] + ic));
+	double q0[NQAB] = {0.1*c, 0.05*c, 0.0, -0.1*c, 0.02*c};
+	for (int n = 0; n < NQAB; n++) {
+	  int iaddr = addr_rank1(fq->nsites, NQAB, index, n);
+	  double qsub = pow(1.0 + x/nstep, nstep)*q0[n];
+	  test_assert(fabs(q1[iaddr] - (1.0 + x)*q0[n]) < 1.0e-14);
+	  test_assert(fabs(fq->data[iaddr] - qsub) < 1.0e-14);
+	  test_assert(fabs(fq->data[iaddr] - q1[iaddr]) <= 0.5*x*x*0.1);
+	}
+      }
+    }
+  }
+
+  /* nstep unit steps; then one step of dt = nstep */
+
+  beris_edw_dt_set(be, 1.0);
+  test_be_dt_steps(be, (fe_t *) fe, fq, fqgrad, map, NULL, nstep);
+  memcpy(qn, fq->data, NQAB*fq->nsites*sizeof(double));
+
+  beris_edw_dt_set(be, 1.0*nstep);
+  test_be_dt_steps(be, (fe_t *) fe, fq, fqgrad, map, NULL, 1);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double c = cos(k*(noffset[X] + ic));
+	double q0[NQAB] = {0.1*c, 0.05*c, 0.0, -0.1*c, 0.02*c};
+	for (int n = 0; n < NQAB; n++) {
+	  int iaddr = addr_rank1(fq->nsites, NQAB, index, n);
+	  double tol = 0.5*nstep*nstep*x*x*0.1;
+	  test_assert(fabs(qn[iaddr] - pow(1.0 + x, nstep)*q0[n]) < 1.0e-14);
+	  test_assert(fabs(fq->data[iaddr] - (1.0 + nstep*x)*q0[n]) < 1.0e-14);
+	  test_assert(fabs(fq->data[iaddr] - qn[iaddr]) <= tol);
+	}
+      }
+    }
+  }
+
+  free(qn);
+  free(q1);
+  beris_edw_free(be);
+  fe_lc_free(fe);
+  field_grad_free(fqgrad);
+  field_free(fq);
+  map_free(map);
+  lees_edw_free(le);
+  cs_free(cs);
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_be_dt_noise
+ *
+ *  From Q = 0 (so H = 0) with no flow, one step of size dt gives the
+ *  increment dt var chi, which must have variance 2 kT Gamma dt per
+ *  noise mode, i.e., var = sqrt(2 kT Gamma / dt). With the same noise
+ *  seed, the increment must scale exactly as sqrt(dt).
+ *
+ *****************************************************************************/
+
+static int do_test_be_dt_noise(void) {
+
+  int nhalo = 2;
+  int ntotal[3] = {16, 16, 8};
+  int nlocal[3] = {0};
+  double kt = 0.001;
+  double * dq1 = NULL;
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  map_t * map = NULL;
+  field_t * fq = NULL;
+  field_grad_t * fqgrad = NULL;
+  fe_lc_t * fe = NULL;
+  beris_edw_t * be = NULL;
+
+  fe_lc_param_t param = {.a0 = 0.01, .gamma = 3.0, .kappa0 = 0.01,
+			 .kappa1 = 0.01, .q0 = 0.2, .xi = 0.7,
+			 .redshift = 1.0, .rredshift = 1.0};
+  beris_edw_param_t bep = {.xi = 0.7, .gamma = 0.5};
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+  physics_kt_set(phys, kt);
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  lees_edw_create(pe, cs, NULL, &le);
+  map_create(pe, cs, 0, &map);
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(NQAB, nhalo);
+    field_create(pe, cs, le, "q", &opts, &fq);
+    field_grad_create(pe, fq, 2, &fqgrad);
+    field_grad_set(fqgrad, grad_3d_7pt_fluid_d2, NULL);
+  }
+
+  fe_lc_create(pe, cs, le, fq, fqgrad, &fe);
+  fe_lc_param_set(fe, &param);
+  beris_edw_create(pe, cs, le, &be);
+  beris_edw_param_set(be, &bep);
+
+  dq1 = (double *) calloc(NQAB*fq->nsites, sizeof(double));
+  assert(dq1);
+
+  {
+    double dt[2] = {1.0, 0.25};
+
+    for (int it = 0; it < 2; it++) {
+
+      noise_t * noise = NULL;
+      double sum[2] = {0};
+      double sum_local[2] = {0};
+
+      noise_create(pe, cs, &noise);
+      noise_init(noise, 0);
+      noise_present_set(noise, NOISE_QAB, 1);
+
+      memset(fq->data, 0, NQAB*fq->nsites*sizeof(double));
+      beris_edw_dt_set(be, dt[it]);
+      test_be_dt_steps(be, (fe_t *) fe, fq, fqgrad, map, noise, 1);
+
+      for (int ic = 1; ic <= nlocal[X]; ic++) {
+	for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	  for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	    int index = cs_index(cs, ic, jc, kc);
+	    double dq[NQAB] = {0};
+	    for (int n = 0; n < NQAB; n++) {
+	      int iaddr = addr_rank1(fq->nsites, NQAB, index, n);
+	      dq[n] = fq->data[iaddr];
+	      if (it == 0) dq1[iaddr] = dq[n];
+	      test_assert(fabs(dq[n] - sqrt(dt[it])*dq1[iaddr]) < DBL_EPSILON);
+	    }
+	    /* Full contraction dQ_ab dQ_ab = sum over the NQAB modes */
+	    sum_local[0] += 1.0;
+	    sum_local[1] += dq[XX]*dq[XX] + dq[YY]*dq[YY]
+	      + (dq[XX] + dq[YY])*(dq[XX] + dq[YY])
+	      + 2.0*(dq[XY]*dq[XY] + dq[XZ]*dq[XZ] + dq[YZ]*dq[YZ]);
+	  }
+	}
+      }
+
+      MPI_Allreduce(sum_local, sum, 2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+      {
+	/* Expect NQAB 2 kT Gamma dt; sample of 2048 sites */
+	double var = sum[1]/(NQAB*sum[0]);
+	double vexpect = 2.0*kt*bep.gamma*dt[it];
+	test_assert(fabs(var - vexpect) < 0.1*vexpect);
+      }
+
+      noise_free(noise);
+    }
+  }
+
+  free(dq1);
+  beris_edw_free(be);
+  fe_lc_free(fe);
+  field_grad_free(fqgrad);
+  field_free(fq);
+  map_free(map);
+  lees_edw_free(le);
+  cs_free(cs);
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_be_dt_steps
+ *
+ *  From Q_ab = Q0_ab cos(k x) at local sites (unless noise is present,
+ *  in which case Q is left as found), take nstep updates with halo and
+ *  gradients between steps as in the sub-cycled time step loop. The
+ *  time step must already be set.
+ *
+ *****************************************************************************/
+
+static int test_be_dt_steps(beris_edw_t * be, fe_t * fe, field_t * fq,
+			    field_grad_t * fqgrad, map_t * map,
+			    noise_t * noise, int nstep) {
+
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  int ntotal[3] = {0};
+  PI_DOUBLE(pi);
+
+  assert(be);
+  assert(fq);
+
+  cs_ntotal(fq->cs, ntotal);
+  cs_nlocal(fq->cs, nlocal);
+  cs_nlocal_offset(fq->cs, noffset);
+
+  if (noise == NULL) {
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(fq->cs, ic, jc, kc);
+	  double c = cos(2.0*pi*(noffset[X] + ic)/ntotal[X]);
+	  double q[NQAB] = {0.1*c, 0.05*c, 0.0, -0.1*c, 0.02*c};
+	  field_scalar_array_set(fq, index, q);
+	}
+      }
+    }
+  }
+
+  field_memcpy(fq, tdpMemcpyHostToDevice);
+
+  for (int n = 0; n < nstep; n++) {
+    field_halo(fq);
+    field_grad_compute(fqgrad);
+    beris_edw_update(be, fe, fq, fqgrad, NULL, NULL, map, noise);
+  }
+
+  field_memcpy(fq, tdpMemcpyDeviceToHost);
+
+  return 0;
+}
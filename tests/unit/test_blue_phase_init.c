@@ -0,0 +1,280 @@
+/*****************************************************************************
+ *
+ *  test_blue_phase_init.c
+ *
+ *  Tests for the liquid crystal initial conditions.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "util.h"
+#include "coords.h"
+#include "leesedwards.h"
+#include "field.h"
+#include "blue_phase.h"
+#include "blue_phase_init.h"
+#include "ran.h"
+#include "tests.h"
+
+int test_bp_init_bpiii(pe_t * pe, cs_t * cs, field_t * fq);
+int test_bp_init_random_q_rectangle(pe_t * pe, cs_t * cs, field_t * fq);
+
+/*****************************************************************************
+ *
+ *  test_bp_init_suite
+ *
+ *****************************************************************************/
+
+int test_bp_init_suite(void) {
+
+  int ntotal[3] = {24, 24, 24};
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  field_t * fq = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  lees_edw_create(pe, cs, NULL, &le);
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(NQAB, 1);
+    field_create(pe, cs, le, "q", &opts, &fq);
+  }
+
+  test_bp_init_bpiii(pe, cs, fq);
+  test_bp_init_random_q_rectangle(pe, cs, fq);
+
+  pe_info(pe, "PASS     ./unit/test_blue_phase_init\n");
+
+  field_free(fq);
+  lees_edw_free(le);
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_bp_init_bpiii
+ *
+ *  The cylinders are located via spatial bins; the result must agree
+ *  with a direct sweep over all cylinders and all local sites, where
+ *  the last cylinder to map a site wins. Use the cholesteric
+ *  environment (1), which has no randomness.
+ *
+ *****************************************************************************/
+
+int test_bp_init_bpiii(pe_t * pe, cs_t * cs, field_t * fq) {
+
+  int ndtc = 40;
+  int radius = 4;
+  int nlocal[3] = {0};
+  int ntotal[3] = {0};
+  int noffset[3] = {0};
+  int seed = 17;
+  int ifail = 0;
+  double specs[3] = {1.0*ndtc, 1.0*radius, 1.0};
+  double * qref = NULL;
+  fe_lc_param_t param = {0};
+  PI_DOUBLE(pi);
+
+  assert(pe);
+  assert(cs);
+  assert(fq);
+
+  param.q0 = 2.0*pi/8.0;
+  param.amplitude0 = 0.3;
+
+  cs_nlocal(cs, nlocal);
+  cs_ntotal(cs, ntotal);
+  cs_nlocal_offset(cs, noffset);
+
+  ran_init_seed(pe, seed);
+  blue_phase_BPIII_init(cs, &param, fq, specs);
+
+  /* Reference: the same serial draws, and a sweep */
+
+  qref = (double *) calloc(9*fq->nsites, sizeof(double));
+  assert(qref);
+
+  ran_init_seed(pe, seed);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double y = noffset[Y] + jc;
+	double n[3] = {cos(param.q0*y), 0.0, -sin(param.q0*y)};
+	double q[3][3] = {0};
+	fe_lc_q_uniaxial(&param, n, q);
+	for (int ia = 0; ia < 3; ia++) {
+	  for (int ib = 0; ib < 3; ib++) {
+	    qref[9*index + 3*ia + ib] = param.amplitude0*q[ia][ib];
+	  }
+	}
+      }
+    }
+  }
+
+  for (int in = 0; in < ndtc; in++) {
+    double mx[3][3] = {0};
+    double my[3][3] = {0};
+    double a = 2.0*pi*ran_serial_uniform();
+    double b = 2.0*pi*ran_serial_uniform();
+    double c[3] = {0};
+
+    c[X] = ntotal[X]*ran_serial_uniform();
+    c[Y] = ntotal[Y]*ran_serial_uniform();
+    c[Z] = ntotal[Z]*ran_serial_uniform();
+
+    blue_phase_M_rot(mx, X, a);
+    blue_phase_M_rot(my, Y, b);
+
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int ir, jr, kr;
+	  double rc[3] = {0};
+	  double rr[3] = {0};
+	  rc[X] = (double) (noffset[X] + ic) - c[X];
+	  rc[Y] = (double) (noffset[Y] + jc) - c[Y];
+	  rc[Z] = (double) (noffset[Z] + kc) - c[Z];
+	  if (rc[X]*rc[X] + rc[Y]*rc[Y] + rc[Z]*rc[Z] >= radius*radius) {
+	    continue;
+	  }
+	  for (int ia = 0; ia < 3; ia++) {
+	    for (int ik = 0; ik < 3; ik++) {
+	      for (int il = 0; il < 3; il++) {
+		rr[ia] += my[ia][ik]*mx[ik][il]*rc[il];
+	      }
+	    }
+	  }
+	  ir = (int)(c[X] + rr[X] - noffset[X]);
+	  jr = (int)(c[Y] + rr[Y] - noffset[Y]);
+	  kr = (int)(c[Z] + rr[Z] - noffset[Z]);
+	  if (ir < 1 || ir > nlocal[X]) continue;
+	  if (jr < 1 || jr > nlocal[Y]) continue;
+	  if (kr < 1 || kr > nlocal[Z]) continue;
+	  {
+	    int index = cs_index(cs, ir, jr, kr);
+	    double * q = qref + 9*index;
+	    q[3*X + X] = -param.amplitude0*cos(2*param.q0*rc[Y]);
+	    q[3*X + Y] = 0.0;
+	    q[3*X + Z] = param.amplitude0*sin(2.0*param.q0*rc[Y]);
+	    q[3*Y + X] = q[3*X + Y];
+	    q[3*Y + Y] = -param.amplitude0*cos(2.0*param.q0*rc[X]);
+	    q[3*Y + Z] = -param.amplitude0*sin(2.0*param.q0*rc[X]);
+	    q[3*Z + X] = q[3*X + Z];
+	    q[3*Z + Y] = q[3*Y + Z];
+	    q[3*Z + Z] = - q[3*X + X] - q[3*Y + Y];
+	  }
+	}
+      }
+    }
+  }
+
+  /* Compare */
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double q[3][3] = {0};
+	field_tensor(fq, index, q);
+	for (int ia = 0; ia < 3; ia++) {
+	  for (int ib = 0; ib < 3; ib++) {
+	    double diff = q[ia][ib] - qref[9*index + 3*ia + ib];
+	    if (fabs(diff) > DBL_EPSILON) ifail += 1;
+	  }
+	}
+      }
+    }
+  }
+
+  assert(ifail == 0);
+
+  free(qref);
+
+  return ifail;
+}
+
+/*****************************************************************************
+ *
+ *  test_bp_init_random_q_rectangle
+ *
+ *  Sites outside the rectangle are unchanged, and the rectangle
+ *  limits (global coordinates) are not modified.
+ *
+ *****************************************************************************/
+
+int test_bp_init_random_q_rectangle(pe_t * pe, cs_t * cs, field_t * fq) {
+
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  int rmin[3] = {4, 5, 6};
+  int rmax[3] = {12, 13, 14};
+  int ifail = 0;
+  double n[3] = {1.0, 0.0, 0.0};
+  fe_lc_param_t param = {0};
+
+  assert(pe);
+  assert(cs);
+  assert(fq);
+
+  param.amplitude0 = 0.3;
+
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  blue_phase_nematic_init(cs, &param, fq, n);
+  blue_phase_random_q_rectangle(cs, &param, fq, rmin, rmax);
+
+  assert(rmin[X] ==  4 && rmin[Y] ==  5 && rmin[Z] ==  6);
+  assert(rmax[X] == 12 && rmax[Y] == 13 && rmax[Z] == 14);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    int ix = noffset[X] + ic;
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      int iy = noffset[Y] + jc;
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int iz = noffset[Z] + kc;
+	int index = cs_index(cs, ic, jc, kc);
+	int inside = (rmin[X] <= ix && ix <= rmax[X] &&
+		      rmin[Y] <= iy && iy <= rmax[Y] &&
+		      rmin[Z] <= iz && iz <= rmax[Z]);
+	double q[3][3] = {0};
+	field_tensor(fq, index, q);
+
+	/* Traceless, and nematic order (amplitude0) only outside */
+	if (fabs(q[X][X] + q[Y][Y] + q[Z][Z]) > DBL_EPSILON) ifail += 1;
+	if (inside) {
+	  if (fabs(q[X][X]) > 0.01 + DBL_EPSILON) ifail += 1;
+	}
+	else {
+	  if (fabs(q[X][X] - param.amplitude0) > DBL_EPSILON) ifail += 1;
+	}
+      }
+    }
+  }
+
+  assert(ifail == 0);
+
+  return ifail;
+}
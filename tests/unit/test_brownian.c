@@ -0,0 +1,350 @@
+/*****************************************************************************
+ *
+ *  test_brownian.c
+ *
+ *  Brownian dynamics for colloids (no fluid).
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "util.h"
+#include "colloids_halo.h"
+#include "brownian.h"
+#include "tests.h"
+
+int test_brownian_options(void);
+int test_brownian_step_no_inertia(pe_t * pe, cs_t * cs);
+int test_brownian_step_ermak_buckholz(pe_t * pe, cs_t * cs);
+int test_brownian_run(pe_t * pe, cs_t * cs, double kt, double dr[3]);
+
+/*****************************************************************************
+ *
+ *  test_brownian_suite
+ *
+ *****************************************************************************/
+
+int test_brownian_suite(void) {
+
+  int ntotal[3] = {16, 16, 16};
+  double dr1[3] = {0};
+  double dr2[3] = {0};
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  physics_create(pe, &phys);
+  physics_eta_shear_set(phys, 0.1);
+
+  test_brownian_options();
+  test_brownian_step_no_inertia(pe, cs);
+  test_brownian_step_ermak_buckholz(pe, cs);
+
+  /* With kT = 0 the displacement is the drift only; with kT > 0 the
+   * result must be repeatable (it depends only on the particle rng). */
+
+  test_brownian_run(pe, cs, 0.0, dr1);
+  test_brownian_run(pe, cs, 1.0e-04, dr1);
+  test_brownian_run(pe, cs, 1.0e-04, dr2);
+
+  assert(fabs(dr1[X] - dr2[X]) < DBL_EPSILON);
+  assert(fabs(dr1[Y] - dr2[Y]) < DBL_EPSILON);
+  assert(fabs(dr1[Z] - dr2[Z]) < DBL_EPSILON);
+
+  pe_info(pe, "PASS     ./unit/test_brownian\n");
+
+  physics_free(phys);
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_brownian_options
+ *
+ *****************************************************************************/
+
+int test_brownian_options(void) {
+
+  brownian_options_t opts = brownian_options_default();
+
+  assert(opts.method == BROWNIAN_NO_INERTIA);
+  assert(fabs(opts.dt - 1.0) < DBL_EPSILON);
+  assert(brownian_options_valid(&opts));
+
+  opts.dt = 0.0;
+  assert(brownian_options_valid(&opts) == 0);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_brownian_step_no_inertia
+ *
+ *  At zero temperature: dr = dt F / (6 pi eta a), w = T / (8 pi eta a^3).
+ *
+ *****************************************************************************/
+
+int test_brownian_step_no_inertia(pe_t * pe, cs_t * cs) {
+
+  int ncell[3] = {2, 2, 2};
+  double r0[3] = {8.0, 8.0, 8.0};
+  double eta = 0.0;
+  double ah = 1.25;
+  double fex[3] = {0.001, -0.002, 0.003};
+  double tex[3] = {0.0, 0.0, 0.01};
+  PI_DOUBLE(pi);
+
+  brownian_options_t opts = brownian_options_default();
+  brownian_t * bd = NULL;
+  colloids_info_t * cinfo = NULL;
+  colloid_t * pc = NULL;
+  physics_t * phys = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  physics_ref(&phys);
+  physics_kt_set(phys, 0.0);
+  physics_eta_shear(phys, &eta);
+
+  opts.dt = 0.5;
+  brownian_create(pe, cs, &opts, &bd);
+  colloids_info_create(pe, cs, ncell, &cinfo);
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+
+  if (pc) {
+    int ia;
+    double rgamma = 1.0/(6.0*pi*eta*ah);
+    double wgamma = 1.0/(8.0*pi*eta*ah*ah*ah);
+
+    pc->s.ah = ah;
+    pc->s.rng = 1;
+    pc->s.s[X] = 1.0;
+    pc->s.m[X] = 1.0;
+    for (ia = 0; ia < 3; ia++) {
+      pc->fex[ia] = fex[ia];
+      pc->tex[ia] = tex[ia];
+    }
+
+    brownian_step(bd, cinfo);
+
+    for (ia = 0; ia < 3; ia++) {
+      assert(fabs(pc->s.dr[ia] - opts.dt*rgamma*fex[ia]) < DBL_EPSILON);
+      assert(fabs(pc->s.v[ia] - rgamma*fex[ia]) < DBL_EPSILON);
+      assert(fabs(pc->s.w[ia] - wgamma*tex[ia]) < DBL_EPSILON);
+    }
+
+    /* Rotation about z: s moves from x towards y */
+    assert(pc->s.s[X] < 1.0);
+    assert(pc->s.s[Y] > 0.0);
+    assert(fabs(dot_product(pc->s.s, pc->s.s) - 1.0) < DBL_EPSILON);
+  }
+
+  assert(bd->nstep == 1);
+
+  colloids_info_free(cinfo);
+  brownian_free(bd);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_brownian_step_ermak_buckholz
+ *
+ *  At zero temperature, v = c0 v0 + c1 F/m and dr = c1 v0 + c2 F/m,
+ *  where v0 is the velocity at the start of the step. Both from rest
+ *  and from a non-zero v0.
+ *
+ *****************************************************************************/
+
+int test_brownian_step_ermak_buckholz(pe_t * pe, cs_t * cs) {
+
+  int ncell[3] = {2, 2, 2};
+  double r0[3] = {8.0, 8.0, 8.0};
+  double eta = 0.0;
+  double rho0 = 0.0;
+  double ah = 1.25;
+  double fex[3] = {0.001, -0.002, 0.003};
+  double v0[3] = {0.01, 0.02, -0.005};
+  PI_DOUBLE(pi);
+
+  brownian_options_t opts = brownian_options_default();
+  brownian_t * bd = NULL;
+  colloids_info_t * cinfo = NULL;
+  colloid_t * pc = NULL;
+  physics_t * phys = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  physics_ref(&phys);
+  physics_kt_set(phys, 0.0);
+  physics_eta_shear(phys, &eta);
+
+  opts.method = BROWNIAN_ERMAK_BUCKHOLZ;
+  brownian_create(pe, cs, &opts, &bd);
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_rho0(cinfo, &rho0);
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+
+  if (pc) {
+    double rmass = 1.0/((4.0/3.0)*pi*rho0*ah*ah*ah);
+    double xi = 6.0*pi*eta*ah*rmass;
+    double c0 = exp(-xi*opts.dt);
+    double c1 = (1.0 - c0)/xi;
+    double c2 = (opts.dt - c1)/xi;
+
+    pc->s.ah = ah;
+    pc->s.rng = 1;
+    for (int ia = 0; ia < 3; ia++) {
+      pc->fex[ia] = fex[ia];
+    }
+
+    /* From rest: the displacement is c2 F/m only */
+
+    brownian_step(bd, cinfo);
+
+    for (int ia = 0; ia < 3; ia++) {
+      double v = rmass*c1*fex[ia];
+      assert(fabs(pc->s.v[ia] - v) < DBL_EPSILON);
+      assert(fabs(pc->s.dr[ia] - rmass*c2*fex[ia]) < DBL_EPSILON);
+    }
+
+    /* Non-zero initial velocity */
+
+    for (int ia = 0; ia < 3; ia++) {
+      pc->s.v[ia] = v0[ia];
+    }
+
+    brownian_step(bd, cinfo);
+
+    for (int ia = 0; ia < 3; ia++) {
+      double v = c0*v0[ia] + rmass*c1*fex[ia];
+      double dr = c1*v0[ia] + rmass*c2*fex[ia];
+      assert(fabs(pc->s.v[ia] - v) < DBL_EPSILON);
+      assert(fabs(pc->s.dr[ia] - dr) < DBL_EPSILON);
+    }
+  }
+
+  colloids_info_free(cinfo);
+  brownian_free(bd);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_brownian_run
+ *
+ *  A single sedimenting particle, which crosses the periodic boundary
+ *  in x. The global (minimum image) displacement is returned in dr.
+ *
+ *****************************************************************************/
+
+int test_brownian_run(pe_t * pe, cs_t * cs, double kt, double dr[3]) {
+
+  int nstep = 20;
+  int ncell[3] = {2, 2, 2};
+  int ntotal = 0;
+  double r0[3] = {16.2, 8.0, 8.0};
+  double g[3] = {0.05, 0.0, 0.0};
+  double ah = 1.0;
+  double eta = 0.0;
+  double rlocal[3] = {0};
+  PI_DOUBLE(pi);
+
+  brownian_options_t opts = brownian_options_default();
+  brownian_t * bd = NULL;
+  interact_t * interact = NULL;
+  map_t * map = NULL;
+  colloids_info_t * cinfo = NULL;
+  colloid_t * pc = NULL;
+  physics_t * phys = NULL;
+  MPI_Comm comm;
+
+  assert(pe);
+  assert(cs);
+
+  physics_ref(&phys);
+  physics_kt_set(phys, kt);
+  physics_fgrav_set(phys, g);
+  physics_eta_shear(phys, &eta);
+
+  brownian_create(pe, cs, &opts, &bd);
+  interact_create(pe, cs, &interact);
+  map_create(pe, cs, 0, &map);
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+  if (pc) {
+    pc->s.a0 = ah;
+    pc->s.ah = ah;
+    pc->s.rng = 17;
+  }
+  colloids_info_ntotal_set(cinfo);
+  colloids_halo_state(cinfo);
+
+  brownian_run(bd, cinfo, interact, map, nstep);
+
+  /* Still one particle; find its displacement */
+
+  colloids_info_ntotal(cinfo, &ntotal);
+  assert(ntotal == 1);
+
+  colloids_info_local_head(cinfo, &pc);
+  if (pc) {
+    assert(pc->s.r[X] < r0[X]);
+    cs_minimum_distance(cs, r0, pc->s.r, rlocal);
+  }
+
+  cs_cart_comm(cs, &comm);
+  MPI_Allreduce(rlocal, dr, 3, MPI_DOUBLE, MPI_SUM, comm);
+
+  if (kt == 0.0) {
+    /* Drift only */
+    double drift = nstep*opts.dt*g[X]/(6.0*pi*eta*ah);
+    assert(drift > 0.5);
+    assert(fabs(dr[X] - drift) < FLT_EPSILON);
+    assert(fabs(dr[Y]) < DBL_EPSILON);
+    assert(fabs(dr[Z]) < DBL_EPSILON);
+  }
+  else {
+    assert(fabs(dr[Y]) > 0.0);
+    assert(fabs(dr[Z]) > 0.0);
+  }
+
+  colloids_info_free(cinfo);
+  map_free(map);
+  interact_free(interact);
+  brownian_free(bd);
+
+  g[X] = 0.0;
+  physics_fgrav_set(phys, g);
+
+  return 0;
+}
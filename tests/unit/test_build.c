@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2013-2022 The University of Edinburgh
+ *  (c) 2013-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -20,10 +20,13 @@
 #include <stdio.h>
 
 #include "pe.h"
+#include "util.h"
 #include "coords.h"
 #include "colloids_halo.h"
 #include "colloid_sums.h"
+#include "physics.h"
 #include "build.h"
+#include "psi_colloid.h"
 #include "tests.h"
 
 static int test_build_links_model_c1(pe_t * pe, cs_t * cs, int nvel,
@@ -32,6 +35,10 @@ static int test_build_links_model_c2(pe_t * pe, cs_t * cs, int nvel,
 				     double a0, double r0[3]);
 static int test_build_rebuild_c1(pe_t * pe, cs_t * cs, int nvel,
 				 double a0, double r0[3]);
+static int test_build_remove_replace_c1(pe_t * pe, cs_t * cs, double a0,
+					double r0[3]);
+static int test_build_psi_rho_c1(pe_t * pe, cs_t * cs, double a0,
+				 double r0[3]);
 
 /*****************************************************************************
  *
@@ -63,6 +70,8 @@ int test_build_suite(void) {
   test_build_links_model_c1(pe, cs, nvel, a0, r0);
   test_build_links_model_c2(pe, cs, nvel, a0, r0);
   test_build_rebuild_c1(pe, cs, nvel, a0, r0);
+  if (pe_mpi_size(pe) == 1) test_build_remove_replace_c1(pe, cs, a0, r0);
+  if (pe_mpi_size(pe) == 1) test_build_psi_rho_c1(pe, cs, a0, r0);
 
   a0 = 4.77;
   r0[X] = lmin[X] + delta; r0[Y] = 0.5*ltot[Y]; r0[Z] = 0.5*ltot[Z];
@@ -318,3 +327,255 @@ static int test_build_rebuild_c1(pe_t * pe, cs_t * cs, int nvel,
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_build_remove_replace_c1
+ *
+ *  Move a single colloid through a uniform fluid and check the
+ *  mass and momentum corrections from fluid removal/replacement.
+ *  Serial only, as the corrections are not summed over copies.
+ *
+ *****************************************************************************/
+
+static int test_build_remove_replace_c1(pe_t * pe, cs_t * cs, double a0,
+					double r0[3]) {
+
+  int ic, jc, kc, index;
+  int nsites;
+  int nlocal[3];
+  int ncell[3] = {2, 2, 2};
+  int nremove = 0;
+  int nreplace = 0;
+  int ncolloid = 0;
+  int status;
+
+  double rho = 1.01;
+  double u[3] = {0.001, 0.002, -0.003};
+  double rho0;
+
+  lb_data_options_t options = lb_data_options_default();
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+  physics_t * phys = NULL;
+  colloid_t * pc = NULL;
+  colloid_t * pcold = NULL;
+  colloid_t * pcnew = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  physics_create(pe, &phys);
+  physics_rho0(phys, &rho0);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+  map_create(pe, cs, 0, &map);
+  lb_data_create(pe, cs, &options, &lb);
+
+  /* Uniform fluid everywhere, including the halo */
+
+  cs_nsites(cs, &nsites);
+  for (index = 0; index < nsites; index++) {
+    lb_1st_moment_equilib_set(lb, index, rho, u);
+  }
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+  assert(pc);
+  pc->s.a0 = a0;
+  pc->s.dr[X] = 0.5;
+  pc->s.dr[Y] = 0.25;
+  pc->s.dr[Z] = 0.0;
+  colloids_info_ntotal_set(cinfo);
+
+  colloids_halo_state(cinfo);
+  build_update_map(cs, cinfo, map);
+  build_update_links(cs, cinfo, NULL, map, &lb->model);
+
+  /* Move and rebuild */
+
+  colloids_info_position_update(cinfo);
+  colloids_info_update_cell_list(cinfo);
+  colloids_halo_state(cinfo);
+  build_update_map(cs, cinfo, map);
+
+  /* The local colloid pc is retained across the update */
+  pc->s.rebuild = 0;
+
+  cs_nlocal(cs, nlocal);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	colloids_info_map_old(cinfo, index, &pcold);
+	colloids_info_map(cinfo, index, &pcnew);
+	map_status(map, index, &status);
+	assert((pcnew != NULL) == (status == MAP_COLLOID));
+	if (pcnew) ncolloid += 1;
+	if (pcold == NULL && pcnew != NULL) nremove += 1;
+	if (pcold != NULL && pcnew == NULL) nreplace += 1;
+      }
+    }
+  }
+
+  assert(ncolloid > 0);
+  assert(nremove > 0);
+  assert(nreplace > 0);
+
+  build_remove_replace(NULL, cinfo, lb, NULL, NULL, NULL, NULL, map);
+
+  /* Removed fluid adds (rho - rho0), rho u; replaced fluid takes
+   * the same away. */
+
+  assert(pc->s.rebuild == 1);
+  assert(fabs(pc->deltam - (nreplace - nremove)*(rho - rho0)) < FLT_EPSILON);
+  assert(fabs(pc->f0[X] - (nremove - nreplace)*rho*u[X]) < FLT_EPSILON);
+  assert(fabs(pc->f0[Y] - (nremove - nreplace)*rho*u[Y]) < FLT_EPSILON);
+  assert(fabs(pc->f0[Z] - (nremove - nreplace)*rho*u[Z]) < FLT_EPSILON);
+
+  /* Replaced sites are restored to the uniform fluid */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	index = cs_index(cs, ic, jc, kc);
+	colloids_info_map_old(cinfo, index, &pcold);
+	colloids_info_map(cinfo, index, &pcnew);
+	if (pcold != NULL && pcnew == NULL) {
+	  double rhonew = 0.0;
+	  lb_0th_moment(lb, index, LB_RHO, &rhonew);
+	  assert(fabs(rhonew - rho) < FLT_EPSILON);
+	}
+      }
+    }
+  }
+
+  lb_free(lb);
+  map_free(map);
+  colloids_info_free(cinfo);
+  physics_free(phys);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_build_psi_rho_c1
+ *
+ *  Colloid charge densities are set at covered sites, and are set
+ *  again after a move and rebuild has changed the covered sites.
+ *  Newly uncovered sites receive the surrounding fluid charge.
+ *
+ *****************************************************************************/
+
+static int test_build_psi_rho_c1(pe_t * pe, cs_t * cs, double a0,
+				 double r0[3]) {
+
+  int nhalo = 0;
+  int nsites = 0;
+  int nlocal[3] = {0};
+  int ncell[3] = {2, 2, 2};
+  double rho = 1.0e-03;
+  double q[2] = {1.0, 0.5};
+
+  lb_data_options_t options = lb_data_options_default();
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+  psi_t * psi = NULL;
+  physics_t * phys = NULL;
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  cs_nhalo(cs, &nhalo);
+  cs_nsites(cs, &nsites);
+  cs_nlocal(cs, nlocal);
+
+  physics_create(pe, &phys);
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+  map_create(pe, cs, 0, &map);
+  lb_data_create(pe, cs, &options, &lb);
+
+  {
+    psi_options_t opts = psi_options_default(nhalo);
+    psi_create(pe, cs, &opts, &psi);
+  }
+
+  /* Uniform charge everywhere, including the halo */
+
+  for (int index = 0; index < nsites; index++) {
+    psi_rho_set(psi, index, 0, rho);
+    psi_rho_set(psi, index, 1, rho);
+  }
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+  assert(pc);
+  pc->s.a0 = a0;
+  pc->s.q0 = q[0];
+  pc->s.q1 = q[1];
+  pc->s.dr[X] = 0.5;
+  pc->s.dr[Y] = 0.25;
+  pc->s.dr[Z] = 0.0;
+  colloids_info_ntotal_set(cinfo);
+
+  colloids_halo_state(cinfo);
+  build_update_map(cs, cinfo, map);
+  build_update_links(cs, cinfo, NULL, map, &lb->model);
+
+  for (int nstep = 0; nstep < 2; nstep++) {
+
+    double volume = 0.0;
+
+    if (nstep == 1) {
+      /* Move and rebuild; pc gains sites, so must be set afresh */
+      colloids_info_position_update(cinfo);
+      colloids_info_update_cell_list(cinfo);
+      colloids_halo_state(cinfo);
+      build_update_map(cs, cinfo, map);
+      build_remove_replace(NULL, cinfo, lb, NULL, NULL, NULL, psi, map);
+      assert(pc->rhoq_valid == 0);
+    }
+
+    psi_colloid_rho_set(psi, cinfo);
+    assert(pc->rhoq_valid == 1);
+
+    util_discrete_volume_sphere(pc->s.r, pc->s.a0, &volume);
+
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(cs, ic, jc, kc);
+	  double rho0 = 0.0;
+	  double rho1 = 0.0;
+	  colloid_t * pcnew = NULL;
+
+	  colloids_info_map(cinfo, index, &pcnew);
+	  psi_rho(psi, index, 0, &rho0);
+	  psi_rho(psi, index, 1, &rho1);
+
+	  if (pcnew) {
+	    assert(fabs(rho0 - q[0]/volume) < DBL_EPSILON);
+	    assert(fabs(rho1 - q[1]/volume) < DBL_EPSILON);
+	  }
+	  else {
+	    assert(fabs(rho0 - rho) < DBL_EPSILON);
+	    assert(fabs(rho1 - rho) < DBL_EPSILON);
+	  }
+	}
+      }
+    }
+  }
+
+  psi_free(&psi);
+  lb_free(lb);
+  map_free(map);
+  colloids_info_free(cinfo);
+  physics_free(phys);
+
+  return 0;
+}
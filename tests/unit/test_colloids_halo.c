@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -27,6 +27,7 @@
 int test_colloids_halo111(pe_t * pe, cs_t * cs);
 int test_colloids_halo211(pe_t * pe, cs_t * cs);
 int test_colloids_halo_repeat(pe_t * pe, cs_t * cs);
+int test_colloids_halo_state_fields(pe_t * pe, cs_t * cs);
 static void test_position(cs_t * cs, const double r1[3], const double r2[3]);
 
 /*****************************************************************************
@@ -49,6 +50,7 @@ int test_colloids_halo_suite(void) {
   test_colloids_halo111(pe, cs);
   test_colloids_halo211(pe, cs);
   test_colloids_halo_repeat(pe, cs);
+  test_colloids_halo_state_fields(pe, cs);
 
   pe_info(pe, "PASS     ./unit/test_colloids_halo\n");
   cs_free(cs);
@@ -410,6 +412,71 @@ int test_colloids_halo_repeat(pe_t * pe, cs_t * cs) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  test_colloids_halo_state_fields
+ *
+ *  The halo message omits the padding in colloid_state_t; make sure
+ *  the (non-padding) state at either end of the state arrives intact.
+ *
+ *****************************************************************************/
+
+int test_colloids_halo_state_fields(pe_t * pe, cs_t * cs) {
+
+  int ncell[3] = {2, 2, 2};
+  int noffset[3];
+  int index;
+  double r0[3];
+  double lmin[3];
+
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  cs_lmin(cs, lmin);
+  cs_nlocal_offset(cs, noffset);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  assert(cinfo);
+
+  r0[X] = lmin[X] + 1.0*(noffset[X] + 1);
+  r0[Y] = lmin[Y] + 1.0*(noffset[Y] + 1);
+  r0[Z] = lmin[Z] + 1.0*(noffset[Z] + 1);
+
+  index = 1 + pe_mpi_rank(pe);
+  colloids_info_add_local(cinfo, index, r0, &pc);
+  assert(pc);
+
+  pc->s.nbonds = 1;
+  pc->s.bond[0] = 2;
+  pc->s.inter_type = 3;
+  pc->s.a0 = 2.3;
+  pc->s.q0 = 4.0;
+  pc->s.al = 5.0;
+  pc->s.deltaphi = 6.0;
+
+  colloids_halo_state(cinfo);
+
+  /* Image in the upper x halo */
+
+  colloids_info_cell_list_head(cinfo, ncell[X] + 1, 1, 1, &pc);
+  test_assert(pc != NULL);
+  test_assert(pc->s.index == index);
+  test_assert(pc->s.nbonds == 1);
+  test_assert(pc->s.bond[0] == 2);
+  test_assert(pc->s.inter_type == 3);
+  test_assert(fabs(pc->s.a0 - 2.3) < DBL_EPSILON);
+  test_assert(fabs(pc->s.q0 - 4.0) < DBL_EPSILON);
+  test_assert(fabs(pc->s.al - 5.0) < DBL_EPSILON);
+  test_assert(fabs(pc->s.deltaphi - 0.0) < DBL_EPSILON);
+
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  test_position
@@ -0,0 +1,197 @@
+/*****************************************************************************
+ *
+ *  test_colloids_init.c
+ *
+ *  Random sequential addition initialisation.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "colloids.h"
+#include "colloids_init.h"
+#include "tests.h"
+
+int test_colloids_init_rsa(pe_t * pe, cs_t * cs, int np, int nrelax);
+int test_colloids_init_rsa_repeat(pe_t * pe, cs_t * cs, int np);
+
+static int test_colloids_init_state(colloid_state_t * s0);
+static int test_colloids_init_overlaps(cs_t * cs, colloids_info_t * cinfo,
+				       double hmax);
+
+/*****************************************************************************
+ *
+ *  test_colloids_init_suite
+ *
+ *****************************************************************************/
+
+int test_colloids_init_suite(void) {
+
+  int ntotal[3] = {32, 32, 32};
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+
+  /* Volume fraction (with dh = 0) approx 0.1, with no push-off, and
+   * approx 0.5, which requires push-off. */
+
+  test_colloids_init_rsa(pe, cs, 64, 0);
+  test_colloids_init_rsa(pe, cs, 320, 10000);
+  test_colloids_init_rsa_repeat(pe, cs, 320);
+
+  pe_info(pe, "PASS     ./unit/test_colloids_init\n");
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_init_rsa
+ *
+ *****************************************************************************/
+
+int test_colloids_init_rsa(pe_t * pe, cs_t * cs, int np, int nrelax) {
+
+  int ncell[3] = {2, 2, 2};
+  int ntotal = 0;
+  colloid_state_t s0 = {0};
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  test_colloids_init_state(&s0);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_init_rsa(pe, cs, cinfo, np, &s0, NULL, 0.0, 13, nrelax);
+
+  colloids_info_ntotal(cinfo, &ntotal);
+  assert(ntotal == np);
+
+  test_colloids_init_overlaps(cs, cinfo, 2.0*s0.ah);
+
+  colloids_info_free(cinfo);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_init_rsa_repeat
+ *
+ *  The same seed must give exactly the same positions.
+ *
+ *****************************************************************************/
+
+int test_colloids_init_rsa_repeat(pe_t * pe, cs_t * cs, int np) {
+
+  int ncell[3] = {2, 2, 2};
+  int nmatch = 0;
+  colloid_state_t s0 = {0};
+  colloids_info_t * cinfo1 = NULL;
+  colloids_info_t * cinfo2 = NULL;
+  colloid_t * pc1 = NULL;
+  colloid_t * pc2 = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  test_colloids_init_state(&s0);
+
+  colloids_info_create(pe, cs, ncell, &cinfo1);
+  colloids_info_create(pe, cs, ncell, &cinfo2);
+  colloids_init_rsa(pe, cs, cinfo1, np, &s0, NULL, 0.0, 17, 10000);
+  colloids_init_rsa(pe, cs, cinfo2, np, &s0, NULL, 0.0, 17, 10000);
+
+  colloids_info_local_head(cinfo1, &pc1);
+
+  for ( ; pc1; pc1 = pc1->nextlocal) {
+    colloids_info_local_head(cinfo2, &pc2);
+    for ( ; pc2; pc2 = pc2->nextlocal) {
+      if (pc2->s.index != pc1->s.index) continue;
+      assert(pc2->s.r[X] == pc1->s.r[X]);
+      assert(pc2->s.r[Y] == pc1->s.r[Y]);
+      assert(pc2->s.r[Z] == pc1->s.r[Z]);
+      nmatch += 1;
+    }
+  }
+
+  {
+    int nlocal = 0;
+    colloids_info_nlocal(cinfo1, &nlocal);
+    assert(nmatch == nlocal);
+  }
+
+  colloids_info_free(cinfo2);
+  colloids_info_free(cinfo1);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_init_state
+ *
+ *****************************************************************************/
+
+static int test_colloids_init_state(colloid_state_t * s0) {
+
+  assert(s0);
+
+  s0->a0 = 2.3;
+  s0->ah = 2.3;
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_colloids_init_overlaps
+ *
+ *  Independent (all pairs) check of local particles.
+ *
+ *****************************************************************************/
+
+static int test_colloids_init_overlaps(cs_t * cs, colloids_info_t * cinfo,
+				       double hmax) {
+  int noverlap = 0;
+  colloid_t * pc1 = NULL;
+  colloid_t * pc2 = NULL;
+
+  assert(cs);
+  assert(cinfo);
+
+  colloids_info_local_head(cinfo, &pc1);
+
+  for ( ; pc1; pc1 = pc1->nextlocal) {
+    for (pc2 = pc1->nextlocal; pc2; pc2 = pc2->nextlocal) {
+      double r12[3];
+      cs_minimum_distance(cs, pc1->s.r, pc2->s.r, r12);
+      if (r12[X]*r12[X] + r12[Y]*r12[Y] + r12[Z]*r12[Z] < hmax*hmax) {
+	noverlap += 1;
+      }
+    }
+  }
+
+  assert(noverlap == 0);
+
+  return noverlap;
+}
@@ -31,6 +31,7 @@ __host__ int test_fe_surf_xi_etc(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_surf_fed(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_surf_mu(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_surf_str(pe_t * pe, cs_t * cs, field_t * phi);
+__host__ int test_fe_surf_vector(pe_t * pe, cs_t * cs, field_t * phi);
 
 /* Some reference parameters */
 static fe_surf_param_t pref = {-0.0208333,    /* a */
@@ -78,6 +79,7 @@ __host__ int test_fe_surfactant1_suite(void) {
     test_fe_surf_fed(pe, cs, phi);
     test_fe_surf_mu(pe, cs, phi);
     test_fe_surf_str(pe, cs, phi);
+    test_fe_surf_vector(pe, cs, phi);
 
     field_free(phi);
     cs_free(cs);
@@ -361,3 +363,67 @@ __host__ int test_fe_surf_str(pe_t * pe, cs_t * cs, field_t * phi) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_fe_surf_vector
+ *
+ *  Vectorised fed, mu, and stress against the scalar versions.
+ *
+ *****************************************************************************/
+
+__host__ int test_fe_surf_vector(pe_t * pe, cs_t * cs, field_t * phi) {
+
+  int ifail = 0;
+  int index0 = 5;
+  double fed[NSIMDVL] = {0};
+  double mu[2][NSIMDVL] = {0};
+  double s[3][3][NSIMDVL] = {0};
+
+  field_grad_t * dphi = NULL;
+  fe_surf_t * fe = NULL;
+
+  assert(pe);
+  assert(cs);
+  assert(phi);
+
+  field_grad_create(pe, phi, 2, &dphi);
+  fe_surf_create(pe, cs, phi, dphi, pref, &fe);
+
+  for (int iv = 0; iv < NSIMDVL; iv++) {
+    double phipsi[2] = {-0.7 + 0.1*iv, 0.6 - 0.05*iv};
+    double d2phi[2]  = {0.1, -0.2};
+    double grad[2][3] = {{0.1, -0.2, 0.3 - 0.1*iv}, {-0.1, 0.05, 0.2}};
+    field_scalar_array_set(phi, index0 + iv, phipsi);
+    field_grad_pair_grad_set(dphi, index0 + iv, grad);
+    field_grad_pair_delsq_set(dphi, index0 + iv, d2phi);
+  }
+
+  fe_surf_fed_v(fe, index0, fed);
+  fe_surf_mu_v(fe, index0, mu);
+  fe_surf_str_v(fe, index0, s);
+
+  for (int iv = 0; iv < NSIMDVL; iv++) {
+    double fed1 = 0.0;
+    double mu1[2] = {0};
+    double s1[3][3] = {0};
+    fe_surf_fed(fe, index0 + iv, &fed1);
+    fe_surf_mu(fe, index0 + iv, mu1);
+    fe_surf_str(fe, index0 + iv, s1);
+    if (fabs(fed[iv] - fed1) > DBL_EPSILON) ifail += 1;
+    if (fabs(mu[0][iv] - mu1[0]) > DBL_EPSILON) ifail += 1;
+    if (fabs(mu[1][iv] - mu1[1]) > DBL_EPSILON) ifail += 1;
+    for (int ia = 0; ia < 3; ia++) {
+      for (int ib = 0; ib < 3; ib++) {
+	if (fabs(s[ia][ib][iv] - s1[ia][ib]) > DBL_EPSILON) ifail += 1;
+      }
+    }
+  }
+
+  test_assert(ifail == 0);
+
+  fe_surf_free(fe);
+  field_grad_free(dphi);
+
+  return ifail;
+}
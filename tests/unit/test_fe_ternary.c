@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Phsyics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2019-2022 The University of Edinburgh
+ *  (c) 2019-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -31,6 +31,7 @@ __host__ int test_fe_ternary_create(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_ternary_fed(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_ternary_mu(pe_t * pe, cs_t * cs, field_t * phi);
 __host__ int test_fe_ternary_str(pe_t * pe, cs_t * cs, field_t * phi);
+__host__ int test_fe_ternary_vector(pe_t * pe, cs_t * cs, field_t * phi);
 
 /*****************************************************************************
  *
@@ -68,6 +69,7 @@ __host__ int test_fe_ternary_suite(void) {
     test_fe_ternary_fed(pe, cs, phi);
     test_fe_ternary_mu(pe, cs, phi);
     test_fe_ternary_str(pe, cs, phi);
+    test_fe_ternary_vector(pe, cs, phi);
 
     field_free(phi);
     cs_free(cs);
@@ -279,3 +281,72 @@ __host__ int test_fe_ternary_str(pe_t * pe, cs_t * cs, field_t * phi) {
   return 0;
 }
 
+
+/*****************************************************************************
+ *
+ *  test_fe_ternary_vector
+ *
+ *  The vectorised fed, mu, and stress must agree with the scalar
+ *  versions site by site.
+ *
+ *****************************************************************************/
+
+__host__ int test_fe_ternary_vector(pe_t * pe, cs_t * cs, field_t * phi) {
+
+  fe_ternary_t * fe = NULL;
+  field_grad_t * dphi = NULL;
+  fe_ternary_param_t pref = {0.5, 0.6, 0.7, 0.8};
+
+  int index0 = 2;
+  int ifail = 0;
+  double fed[NSIMDVL] = {0};
+  double mu[3][NSIMDVL] = {0};
+  double s[3][3][NSIMDVL] = {0};
+
+  assert(pe);
+  assert(cs);
+  assert(phi);
+
+  field_grad_create(pe, phi, 2, &dphi);
+  fe_ternary_create(pe, cs, phi, dphi, pref, &fe);
+
+  /* A different state at each site in the vector */
+
+  for (int iv = 0; iv < NSIMDVL; iv++) {
+    double phi0[2]  = {-0.3 + 0.1*iv, 0.7 - 0.05*iv};
+    double d2phi[2] = {0.1, 0.4 - 0.1*iv};
+    double grad[2][3] = {{0.1, -0.2, 0.3}, {-0.4, 0.5, -0.7 + 0.1*iv}};
+    field_scalar_array_set(phi, index0 + iv, phi0);
+    field_grad_pair_grad_set(dphi, index0 + iv, grad);
+    field_grad_pair_delsq_set(dphi, index0 + iv, d2phi);
+  }
+
+  fe_ternary_fed_v(fe, index0, fed);
+  fe_ternary_mu_v(fe, index0, mu);
+  fe_ternary_str_v(fe, index0, s);
+
+  for (int iv = 0; iv < NSIMDVL; iv++) {
+    double fed1 = 0.0;
+    double mu1[3] = {0};
+    double s1[3][3] = {0};
+    fe_ternary_fed(fe, index0 + iv, &fed1);
+    fe_ternary_mu(fe, index0 + iv, mu1);
+    fe_ternary_str(fe, index0 + iv, s1);
+    if (fabs(fed[iv] - fed1) > DBL_EPSILON) ifail += 1;
+    for (int n = 0; n < 3; n++) {
+      if (fabs(mu[n][iv] - mu1[n]) > DBL_EPSILON) ifail += 1;
+    }
+    for (int ia = 0; ia < 3; ia++) {
+      for (int ib = 0; ib < 3; ib++) {
+	if (fabs(s[ia][ib][iv] - s1[ia][ib]) > DBL_EPSILON) ifail += 1;
+      }
+    }
+  }
+
+  test_assert(ifail == 0);
+
+  fe_ternary_free(fe);
+  field_grad_free(dphi);
+
+  return ifail;
+}
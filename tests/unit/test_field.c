@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -45,9 +45,11 @@ int test_field_io_aggr_pack(pe_t * pe);
 int test_field_io_read_write(pe_t * pe);
 int test_field_io_write(pe_t * pe, cs_t * cs, const field_options_t * opts);
 int test_field_io_read(pe_t * pe, cs_t * cs, const field_options_t * opts);
+int test_field_io_read_serial_file(pe_t * pe, int nf);
 
 int util_field_data_check(field_t * field);
 int util_field_data_check_set(field_t * field);
+int64_t field_unique_value(field_t * f, int ic, int jc, int kc, int n);
 
 
 __global__ void do_test_field_kernel1(field_t * phi);
@@ -81,6 +83,8 @@ int test_field_suite(void) {
   test_field_write_buf_ascii(pe);
   test_field_io_aggr_pack(pe);
   test_field_io_read_write(pe);
+  test_field_io_read_serial_file(pe, 1);
+  test_field_io_read_serial_file(pe, 5);
 
   pe_info(pe, "PASS     ./unit/test_field\n");
   pe_free(pe);
@@ -772,6 +776,91 @@ int test_field_io_read(pe_t * pe, cs_t * cs, const field_options_t * opts) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  test_field_io_read_serial_file
+ *
+ *  A file "stub.001-001" of nf doubles per site in serial order is
+ *  written directly by rank 0 and read by all ranks (collectively).
+ *
+ *****************************************************************************/
+
+int test_field_io_read_serial_file(pe_t * pe, int nf) {
+
+  int ifail = 0;
+  int rank = -1;
+  int ntotal[3] = {16, 16, 8};
+  int grid[3] = {1, 1, 1};
+  const char * stub = "phi-test-serial";
+  char filename[BUFSIZ] = {0};
+  MPI_Comm comm = MPI_COMM_NULL;
+
+  cs_t * cs = NULL;
+  field_t * phi = NULL;
+  io_info_t * iohandler = NULL;
+  field_options_t opts = field_options_default();
+
+  assert(pe);
+
+  pe_mpi_comm(pe, &comm);
+  MPI_Comm_rank(comm, &rank);
+  sprintf(filename, "%s.%3.3d-%3.3d", stub, 1, 1);
+
+  opts.ndata = nf;
+
+  if (rank == 0) {
+    /* A field on a single rank has the global values */
+    pe_t * pself = NULL;
+    cs_t * cself = NULL;
+    field_t * fself = NULL;
+    FILE * fp = fopen(filename, "w");
+    assert(fp);
+
+    pe_create(MPI_COMM_SELF, PE_QUIET, &pself);
+    cs_create(pself, &cself);
+    cs_ntotal_set(cself, ntotal);
+    cs_init(cself);
+    field_create(pself, cself, NULL, "phi-test", &opts, &fself);
+
+    for (int ic = 1; ic <= ntotal[X]; ic++) {
+      for (int jc = 1; jc <= ntotal[Y]; jc++) {
+	for (int kc = 1; kc <= ntotal[Z]; kc++) {
+	  for (int n = 0; n < nf; n++) {
+	    double fval = 1.0*field_unique_value(fself, ic, jc, kc, n);
+	    fwrite(&fval, sizeof(double), 1, fp);
+	  }
+	}
+      }
+    }
+    fclose(fp);
+
+    field_free(fself);
+    cs_free(cself);
+    pe_free(pself);
+  }
+
+  MPI_Barrier(comm);
+
+  cs_create(pe, &cs);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  field_create(pe, cs, NULL, "phi-test", &opts, &phi);
+  field_init_io_info(phi, grid, IO_FORMAT_BINARY_SERIAL, IO_FORMAT_BINARY);
+  field_io_info(phi, &iohandler);
+
+  io_read_data(iohandler, stub, phi);
+  ifail = util_field_data_check(phi);
+  assert(ifail == 0);
+
+  MPI_Barrier(comm);
+  if (rank == 0) remove(filename);
+
+  field_free(phi);
+  cs_free(cs);
+
+  return ifail;
+}
+
 /*****************************************************************************
  *
  *  field_unique_value
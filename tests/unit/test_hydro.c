@@ -8,7 +8,7 @@
  *  Edinburgh Soft Matter and Statisitical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2014-2022 The University of Edinburgh
+ *  (c) 2014-2023 The University of Edinburgh
  *
  *  Contributing authors
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -36,6 +36,7 @@ static int do_test_halo1(pe_t * pe, int nhalo, int nhcomm,
 static int do_test_io1(pe_t * pe, int io_format);
 
 int test_hydro_rho(pe_t * pe);
+int test_hydro_u_accumulate(pe_t * pe);
 
 /*****************************************************************************
  *
@@ -63,6 +64,7 @@ int test_hydro_suite(void) {
   }
 
   test_hydro_rho(pe);
+  test_hydro_u_accumulate(pe);
 
   do_test_io1(pe, IO_FORMAT_DEFAULT);
   do_test_io1(pe, IO_FORMAT_ASCII);
@@ -265,3 +267,54 @@ int test_hydro_rho(pe_t * pe) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_hydro_u_accumulate
+ *
+ *****************************************************************************/
+
+int test_hydro_u_accumulate(pe_t * pe) {
+
+  cs_t * cs = NULL;
+
+  hydro_options_t opts = hydro_options_default();
+  hydro_t * hydro = NULL;
+  hydro_t * uavg = NULL;
+
+  assert(pe);
+
+  cs_create(pe, &cs);
+  cs_init(cs);
+
+  hydro_create(pe, cs, NULL, &opts, &hydro);
+  hydro_create(pe, cs, NULL, &opts, &uavg);
+
+  {
+    double u0[3] = {1.0, -2.0, 3.0};
+    double u1[3] = {0.5, 0.5, 0.5};
+    double u[3] = {0};
+    int index = hydro->nsite - 1;
+
+    hydro_u_zero(hydro, u0);
+    hydro_u_zero(uavg, u1);
+    hydro_u_accumulate(uavg, 0.25, hydro);
+    hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
+    hydro_memcpy(uavg, tdpMemcpyDeviceToHost);
+
+    hydro_u(uavg, index, u);
+    assert(fabs(u[X] - 0.75) < DBL_EPSILON);
+    assert(fabs(u[Y] - 0.00) < DBL_EPSILON);
+    assert(fabs(u[Z] - 1.25) < DBL_EPSILON);
+
+    /* Source unchanged */
+    hydro_u(hydro, index, u);
+    assert(fabs(u[X] - u0[X]) < DBL_EPSILON);
+  }
+
+  hydro_free(uavg);
+  hydro_free(hydro);
+  cs_free(cs);
+
+  return 0;
+}
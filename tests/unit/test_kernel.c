@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2016-2021 The University of Edinburgh
+ *  (c) 2016-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -39,6 +39,7 @@ __host__ int do_test_kernel(cs_t * cs, kernel_info_t limits, data_t * data);
 __host__ int do_host_kernel(cs_t * cs, kernel_info_t limits, int * mask, int * isum);
 __host__ int do_check(cs_t * cs, int * iref, int * itarget);
 __host__ int do_test_attributes(pe_t * pe);
+__host__ int do_test_kernel_cache(cs_t * cs);
 
 __global__ void do_target_kernel1(kernel_ctxt_t * ktx, data_t * data);
 __global__ void do_target_kernel2(kernel_ctxt_t * ktx, data_t * data);
@@ -88,6 +89,8 @@ __host__ int test_kernel_suite(void) {
 
   data_free(data);
 
+  do_test_kernel_cache(cs);
+
   cs_free(cs);
   pe_info(pe, "PASS     ./unit/test_kernel\n");
   pe_free(pe);
@@ -195,6 +198,83 @@ __host__ int do_test_kernel(cs_t * cs, kernel_info_t limits, data_t * data) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  do_test_kernel_cache
+ *
+ *  Repeated requests for the same context should be served by the
+ *  cache; different limits or vector length give a different context.
+ *
+ *****************************************************************************/
+
+__host__ int do_test_kernel_cache(cs_t * cs) {
+
+  int nlocal[3];
+  int nentry = -1;
+  int ninuse = -1;
+  kernel_info_t lim1 = {0};
+  kernel_info_t lim2 = {0};
+  kernel_info_t info = {0};
+  kernel_ctxt_t * ctxt1 = NULL;
+  kernel_ctxt_t * ctxt2 = NULL;
+  kernel_ctxt_t * ctxt3 = NULL;
+
+  assert(cs);
+
+  cs_nlocal(cs, nlocal);
+
+  lim1.imin = 1; lim1.imax = nlocal[X];
+  lim1.jmin = 1; lim1.jmax = nlocal[Y];
+  lim1.kmin = 1; lim1.kmax = nlocal[Z];
+
+  lim2 = lim1;
+  lim2.imin = 0;
+
+  kernel_ctxt_cache_clear();
+  kernel_ctxt_cache_info(&nentry, &ninuse);
+  test_assert(nentry == 0);
+  test_assert(ninuse == 0);
+
+  kernel_ctxt_create(cs, NSIMDVL, lim1, &ctxt1);
+  kernel_ctxt_create(cs, NSIMDVL, lim1, &ctxt2);
+  test_assert(ctxt1 == ctxt2);
+
+  kernel_ctxt_cache_info(&nentry, &ninuse);
+  test_assert(nentry == 1);
+  test_assert(ninuse == 1);
+
+  kernel_ctxt_create(cs, NSIMDVL, lim2, &ctxt3);
+  test_assert(ctxt3 != ctxt1);
+  kernel_ctxt_info(ctxt3, &info);
+  test_assert(info.imin == lim2.imin);
+  kernel_ctxt_free(ctxt3);
+
+  kernel_ctxt_free(ctxt2);
+  kernel_ctxt_free(ctxt1);
+
+  kernel_ctxt_cache_info(&nentry, &ninuse);
+  test_assert(nentry == 2);
+  test_assert(ninuse == 0);
+
+  /* A released context is retained for reuse */
+
+  kernel_ctxt_create(cs, NSIMDVL, lim1, &ctxt2);
+  test_assert(ctxt2 == ctxt1);
+  kernel_ctxt_free(ctxt2);
+
+  if (NSIMDVL > 1) {
+    kernel_ctxt_create(cs, 1, lim1, &ctxt3);
+    test_assert(ctxt3 != ctxt1);
+    kernel_ctxt_free(ctxt3);
+  }
+
+  kernel_ctxt_cache_clear();
+  kernel_ctxt_cache_info(&nentry, &ninuse);
+  test_assert(nentry == 0);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  do_host_kernel
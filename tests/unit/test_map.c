@@ -7,7 +7,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2012-2022 The University of Edinburgh
+ *  (c) 2012-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -23,6 +23,7 @@
 #include "coords.h"
 #include "coords_field.h"
 #include "map.h"
+#include "map_rt.h"
 
 #include "test_coords_field.h"
 #include "tests.h"
@@ -31,6 +32,8 @@ static int do_test1(pe_t * pe);
 static int do_test2(pe_t * pe);
 static int do_test_halo(pe_t * pe, int ndata);
 static int do_test_io(pe_t * pe, int ndata, int io_form_in, int io_form_out);
+static int do_test_io_rle(pe_t * pe, int ndata);
+static int do_test_io_serial_file(pe_t * pe, int ndata);
 
 /*****************************************************************************
  *
@@ -54,6 +57,12 @@ int test_map_suite(void) {
   do_test_io(pe, 2, IO_FORMAT_BINARY_SERIAL, IO_FORMAT_BINARY);
   do_test_io(pe, 2, IO_FORMAT_ASCII_SERIAL,  IO_FORMAT_ASCII);
 
+  do_test_io_rle(pe, 0);
+  do_test_io_rle(pe, 2);
+
+  do_test_io_serial_file(pe, 0);
+  do_test_io_serial_file(pe, 2);
+
   pe_info(pe, "PASS     ./unit/test_map\n");
   pe_free(pe);
 
@@ -292,3 +301,228 @@ static int do_test_io(pe_t * pe, int ndata, int io_form_in, int io_form_out) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_map_rle_ref
+ *
+ *  Reference geometry: walls at x = 1 and y = 1 with data varying in
+ *  x, a colloid line at z = 1, and fluid elsewhere.
+ *
+ *****************************************************************************/
+
+static void test_map_rle_ref(int ix, int iy, int iz, int ndata, int * status,
+			     double * data) {
+
+  *status = MAP_FLUID;
+  if (iz == 1) *status = MAP_COLLOID;
+  if (ix == 1 || iy == 1) *status = MAP_BOUNDARY;
+
+  for (int n = 0; n < ndata; n++) {
+    data[n] = (*status == MAP_FLUID) ? 0.0 : 1.0*(n + 1) + 0.5*ix;
+  }
+}
+
+/*****************************************************************************
+ *
+ *  do_test_io_rle
+ *
+ *  The file is written by rank 0 in serial, and read by all ranks.
+ *
+ *****************************************************************************/
+
+static int do_test_io_rle(pe_t * pe, int ndata) {
+
+  const char * filename = "map-io-test.rle";
+  int rank = -1;
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double data[2] = {0};
+  double dataref[2] = {0};
+  MPI_Comm comm = MPI_COMM_NULL;
+
+  cs_t * cs = NULL;
+  map_t * map = NULL;
+
+  assert(pe);
+  assert(ndata <= 2);
+
+  pe_mpi_comm(pe, &comm);
+  MPI_Comm_rank(comm, &rank);
+
+  if (rank == 0) {
+    pe_t * pself = NULL;
+    cs_t * cself = NULL;
+    int ntotal[3] = {0};
+
+    pe_create(MPI_COMM_SELF, PE_QUIET, &pself);
+    cs_create(pself, &cself);
+    cs_init(cself);
+    cs_ntotal(cself, ntotal);
+    map_create(pself, cself, ndata, &map);
+
+    for (int ic = 1; ic <= ntotal[X]; ic++) {
+      for (int jc = 1; jc <= ntotal[Y]; jc++) {
+	for (int kc = 1; kc <= ntotal[Z]; kc++) {
+	  int index = cs_index(cself, ic, jc, kc);
+	  int status = -1;
+	  test_map_rle_ref(ic, jc, kc, ndata, &status, dataref);
+	  map_status_set(map, index, status);
+	  map_data_set(map, index, dataref);
+	}
+      }
+    }
+
+    map_write_rle(map, filename);
+
+    map_free(map);
+    cs_free(cself);
+    pe_free(pself);
+    map = NULL;
+  }
+
+  MPI_Barrier(comm);
+
+  cs_create(pe, &cs);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  map_create(pe, cs, ndata, &map);
+
+  map_read_rle(map, filename);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	int status = -1;
+	int statusref = -1;
+	test_map_rle_ref(noffset[X] + ic, noffset[Y] + jc, noffset[Z] + kc,
+			 ndata, &statusref, dataref);
+	map_status(map, index, &status);
+	map_data(map, index, data);
+	assert(status == statusref);
+	for (int n = 0; n < ndata; n++) {
+	  assert(fabs(data[n] - dataref[n]) < DBL_EPSILON);
+	}
+      }
+    }
+  }
+
+  /* The encoded file should be much smaller than one byte per site */
+  if (rank == 0) {
+    FILE * fp = fopen(filename, "r");
+    long int nbytes = 0;
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    nbytes = ftell(fp);
+    assert(nbytes < map->nsite);
+    fclose(fp);
+  }
+
+  MPI_Barrier(comm);
+  if (rank == 0) remove(filename);
+
+  map_free(map);
+  cs_free(cs);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  do_test_io_serial_file
+ *
+ *  A porous media file "capillary.001-001" (one status byte and ndata
+ *  doubles per site in serial order) is written directly by rank 0,
+ *  and read by all ranks via map_init_porous_media_from_file().
+ *
+ *****************************************************************************/
+
+static int do_test_io_serial_file(pe_t * pe, int ndata) {
+
+  const char * filename = "capillary.001-001";
+  int rank = -1;
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double data[2] = {0};
+  double dataref[2] = {0};
+  MPI_Comm comm = MPI_COMM_NULL;
+
+  cs_t * cs = NULL;
+  rt_t * rt = NULL;
+  map_t * map = NULL;
+
+  assert(pe);
+  assert(ndata <= 2);
+
+  pe_mpi_comm(pe, &comm);
+  MPI_Comm_rank(comm, &rank);
+
+  cs_create(pe, &cs);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  if (rank == 0) {
+    int ntotal[3] = {0};
+    FILE * fp = fopen(filename, "w");
+    assert(fp);
+
+    cs_ntotal(cs, ntotal);
+
+    for (int ic = 1; ic <= ntotal[X]; ic++) {
+      for (int jc = 1; jc <= ntotal[Y]; jc++) {
+	for (int kc = 1; kc <= ntotal[Z]; kc++) {
+	  int status = -1;
+	  char cstatus = 0;
+	  test_map_rle_ref(ic, jc, kc, ndata, &status, dataref);
+	  cstatus = status;
+	  fwrite(&cstatus, sizeof(char), 1, fp);
+	  fwrite(dataref, sizeof(double), ndata, fp);
+	}
+      }
+    }
+    fclose(fp);
+  }
+
+  MPI_Barrier(comm);
+
+  {
+    char value[BUFSIZ] = {0};
+    sprintf(value, "%d", ndata);
+    rt_create(pe, &rt);
+    rt_add_key_value(rt, "porous_media_ndata", value);
+    rt_add_key_value(rt, "porous_media_format", "BINARY_SERIAL");
+  }
+
+  map_init_porous_media_from_file(pe, cs, rt, &map);
+  assert(map);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	int status = -1;
+	int statusref = -1;
+	test_map_rle_ref(noffset[X] + ic, noffset[Y] + jc, noffset[Z] + kc,
+			 ndata, &statusref, dataref);
+	map_status(map, index, &status);
+	map_data(map, index, data);
+	assert(status == statusref);
+	for (int n = 0; n < ndata; n++) {
+	  assert(fabs(data[n] - dataref[n]) < DBL_EPSILON);
+	}
+      }
+    }
+  }
+
+  MPI_Barrier(comm);
+  if (rank == 0) remove(filename);
+
+  map_free(map);
+  rt_free(rt);
+  cs_free(cs);
+
+  return 0;
+}
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 
 #include "pe.h"
+#include "util.h"
 #include "coords.h"
 #include "physics.h"
 #include "map.h"
@@ -29,6 +30,7 @@
 #include "nernst_planck.h"
 
 static int test_nernst_planck_driver(pe_t * pe);
+static int test_nernst_planck_driver_d3qx(pe_t * pe);
 
 /*****************************************************************************
  *
@@ -43,6 +45,7 @@ int test_nernst_planck_suite(void) {
   pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
 
   test_nernst_planck_driver(pe);
+  test_nernst_planck_driver_d3qx(pe);
 
   pe_info(pe, "PASS     ./unit/test_nernst_planck\n");
   pe_free(pe);
@@ -262,3 +265,133 @@ static int test_nernst_planck_driver(pe_t * pe) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_nernst_planck_driver_d3qx
+ *
+ *  A single step with walls at x = 1 and x = Lx and a non-uniform
+ *  charge distribution. The link fluxes are antisymmetric and there
+ *  is no flux through the walls, so the total charge of each species
+ *  in the fluid must be conserved, while the charge at the walls is
+ *  unchanged.
+ *
+ *****************************************************************************/
+
+static int test_nernst_planck_driver_d3qx(pe_t * pe) {
+
+  int nhalo = 1;
+  int ntotal[3] = {16, 8, 4};
+  int nlocal[3] = {0};
+  int noffst[3] = {0};
+  double rho_w = 1.0e-2;
+  double sum0[2] = {0};
+  double sum1[2] = {0};
+  double local[2] = {0};
+  double maxacc = 0.0;
+  PI_DOUBLE(pi);
+
+  cs_t * cs = NULL;
+  map_t * map = NULL;
+  psi_t * psi = NULL;
+  physics_t * phys = NULL;
+  fe_electro_t * fe = NULL;
+
+  psi_options_t opts = psi_options_default(nhalo);
+  MPI_Comm comm = MPI_COMM_NULL;
+
+  assert(pe);
+
+  physics_create(pe, &phys);
+
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffst);
+  cs_cart_comm(cs, &comm);
+
+  map_create(pe, cs, 0, &map);
+
+  opts.beta     = 3.0e4;
+  opts.epsilon1 = 3.3e3;
+  opts.epsilon2 = 3.3e3;
+  psi_create(pe, cs, &opts, &psi);
+  fe_electro_create(pe, psi, &fe);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	int ix = noffst[X] + ic;
+	double r = 2.0*pi*(noffst[Y] + jc)/ntotal[Y];
+	double rho0 = 1.0e-3*(1.0 + 0.5*sin(2.0*pi*ix/ntotal[X]));
+	double rho1 = 1.0e-3*(1.0 + 0.5*cos(r));
+
+	if (ix == 1 || ix == ntotal[X]) {
+	  map_status_set(map, index, MAP_BOUNDARY);
+	  rho0 = rho_w;
+	  rho1 = 0.0;
+	}
+	psi_psi_set(psi, index, 1.0e-5*sin(r));
+	psi_rho_set(psi, index, 0, rho0);
+	psi_rho_set(psi, index, 1, rho1);
+      }
+    }
+  }
+
+  map_halo(map);
+  psi_halo_psi(psi);
+  psi_halo_rho(psi);
+
+  for (int n = 0; n < 2; n++) {
+    local[n] = 0.0;
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  double rho = 0.0;
+	  psi_rho(psi, cs_index(cs, ic, jc, kc), n, &rho);
+	  local[n] += rho;
+	}
+      }
+    }
+  }
+  MPI_Allreduce(local, sum0, 2, MPI_DOUBLE, MPI_SUM, comm);
+
+  nernst_planck_driver_d3qx(psi, (fe_t *) fe, NULL, map, NULL);
+
+  for (int n = 0; n < 2; n++) {
+    local[n] = 0.0;
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(cs, ic, jc, kc);
+	  int status = MAP_FLUID;
+	  double rho = 0.0;
+	  psi_rho(psi, index, n, &rho);
+	  map_status(map, index, &status);
+	  if (status != MAP_FLUID) {
+	    assert(fabs(rho - ((n == 0) ? rho_w : 0.0)) < DBL_EPSILON);
+	  }
+	  local[n] += rho;
+	}
+      }
+    }
+  }
+  MPI_Allreduce(local, sum1, 2, MPI_DOUBLE, MPI_SUM, comm);
+
+  assert(fabs(sum1[0] - sum0[0]) < 1.0e-12*sum0[0]);
+  assert(fabs(sum1[1] - sum0[1]) < 1.0e-12*sum0[1]);
+
+  nernst_planck_maxacc(&maxacc);
+  assert(maxacc > 0.0);
+
+  map_free(map);
+  fe_electro_free(fe);
+  psi_free(&psi);
+  cs_free(cs);
+  physics_free(phys);
+
+  return 0;
+}
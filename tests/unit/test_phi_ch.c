@@ -9,7 +9,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2022 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -17,15 +17,27 @@
  *****************************************************************************/
 
 #include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "pe.h"
+#include "util.h"
 #include "coords.h"
 #include "fe_null.h"
+#include "symmetric.h"
+#include "gradient_3d_7pt_fluid.h"
 #include "physics.h"
 #include "phi_cahn_hilliard.h"
 
 int test_phi_ch_create(pe_t * pe);
 int test_phi_cahn_hilliard(pe_t * pe);
+int test_phi_ch_semi_implicit(pe_t * pe);
+int test_phi_ch_dt(pe_t * pe);
+static int test_phi_ch_laplacian(cs_t * cs, field_t * in, double * out);
+static int test_phi_ch_dt_steps(phi_ch_t * ch, fe_t * fe, field_t * phi,
+				field_grad_t * dphi, double dt, int nstep);
 
 
 /*****************************************************************************
@@ -44,6 +56,8 @@ int test_phi_ch_suite(void) {
 
   test_phi_ch_create(pe);
   test_phi_cahn_hilliard(pe);
+  test_phi_ch_semi_implicit(pe);
+  test_phi_ch_dt(pe);
 
   pe_info(pe, "PASS     ./unit/test_phi_ch\n");
 
@@ -162,3 +176,386 @@ int test_phi_cahn_hilliard(pe_t * pe) {
 
   return 0;
 }
+
+/*****************************************************************************
+ *
+ *  test_phi_ch_semi_implicit
+ *
+ *  The semi-implicit increment x must satisfy
+ *
+ *    x + M A \nabla^2 \nabla^2 x = b
+ *
+ *  where b is the explicit increment from the same initial state.
+ *  Order parameter is conserved, and the increment is damped.
+ *
+ *****************************************************************************/
+
+int test_phi_ch_semi_implicit(pe_t * pe) {
+
+  int nhalo = 2;
+  int ntotal[3] = {16, 16, 8};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double mobility = 0.5;
+  double * phi0 = NULL;
+  double * bexp = NULL;
+  double sum[3] = {0};
+  double sum_local[3] = {0};
+  double rmax = 0.0;
+  PI_DOUBLE(pi);
+
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  field_t * phi = NULL;
+  field_t * x = NULL;
+  field_t * lap = NULL;
+  field_grad_t * dphi = NULL;
+  fe_symm_t * fe = NULL;
+  fe_symm_param_t param = {-0.0625, 0.0625, 0.04, 0.0, 0.0};
+
+  physics_ref(&phys);
+  physics_mobility_set(phys, mobility);
+
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  {
+    lees_edw_options_t opts = {0};
+    lees_edw_create(pe, cs, &opts, &le);
+  }
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(1, nhalo);
+    field_create(pe, cs, le, "phi", &opts, &phi);
+    field_create(pe, cs, le, "x", &opts, &x);
+    field_create(pe, cs, le, "lap", &opts, &lap);
+    field_grad_create(pe, phi, 2, &dphi);
+    field_grad_set(dphi, grad_3d_7pt_fluid_d2, NULL);
+  }
+
+  fe_symm_create(pe, cs, phi, dphi, &fe);
+  fe_symm_param_set(fe, param);
+
+  /* Initial state */
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double rx = 2.0*pi*(noffset[X] + ic)/ntotal[X];
+	double ry = 2.0*pi*(noffset[Y] + jc)/ntotal[Y];
+	double rz = 2.0*pi*(noffset[Z] + kc)/ntotal[Z];
+	field_scalar_set(phi, index, 0.3*sin(rx) + 0.2*cos(2.0*ry) + 0.1*sin(rz));
+      }
+    }
+  }
+
+  field_halo(phi);
+  field_grad_compute(dphi);
+
+  phi0 = (double *) malloc(phi->nsites*sizeof(double));
+  bexp = (double *) malloc(phi->nsites*sizeof(double));
+  assert(phi0);
+  assert(bexp);
+  memcpy(phi0, phi->data, phi->nsites*sizeof(double));
+
+  {
+    /* Explicit increment */
+    phi_ch_info_t info = {.conserve = 0};
+    phi_ch_t * ch = NULL;
+
+    phi_ch_create(pe, cs, le, &info, &ch);
+    phi_cahn_hilliard(ch, (fe_t *) fe, phi, NULL, NULL, NULL);
+    phi_ch_free(ch);
+
+    for (int index = 0; index < phi->nsites; index++) {
+      bexp[index] = phi->data[index] - phi0[index];
+    }
+    memcpy(phi->data, phi0, phi->nsites*sizeof(double));
+  }
+
+  {
+    /* Semi-implicit increment */
+    phi_ch_info_t info = {.implicit = 1, .reltol = 1.0e-12};
+    phi_ch_t * ch = NULL;
+
+    info.stabiliser = param.kappa;
+    phi_ch_create(pe, cs, le, &info, &ch);
+    assert(ch->si);
+    phi_cahn_hilliard(ch, (fe_t *) fe, phi, NULL, NULL, NULL);
+    phi_ch_free(ch);
+
+    for (int index = 0; index < phi->nsites; index++) {
+      x->data[index] = phi->data[index] - phi0[index];
+    }
+  }
+
+  /* Residual x + M A \nabla^2 \nabla^2 x - b */
+
+  test_phi_ch_laplacian(cs, x, lap->data);
+  test_phi_ch_laplacian(cs, lap, phi->data);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double xi = x->data[index];
+	double r = xi + mobility*param.kappa*phi->data[index] - bexp[index];
+	rmax = fmax(rmax, fabs(r));
+	sum_local[0] += xi;
+	sum_local[1] += xi*xi;
+	sum_local[2] += bexp[index]*bexp[index];
+      }
+    }
+  }
+
+  {
+    MPI_Comm comm = MPI_COMM_NULL;
+    double rmax_local = rmax;
+    cs_cart_comm(cs, &comm);
+    MPI_Allreduce(sum_local, sum, 3, MPI_DOUBLE, MPI_SUM, comm);
+    MPI_Allreduce(&rmax_local, &rmax, 1, MPI_DOUBLE, MPI_MAX, comm);
+  }
+
+  assert(rmax < 1.0e-12);
+  assert(fabs(sum[0]) < 1.0e-12);
+  assert(sum[1] < sum[2]);
+
+  free(bexp);
+  free(phi0);
+  fe_symm_free(fe);
+  field_grad_free(dphi);
+  field_free(lap);
+  field_free(x);
+  field_free(phi);
+  lees_edw_free(le);
+  cs_free(cs);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_phi_ch_dt
+ *
+ *  With a = A, b = kappa = 0 the symmetric free energy gives pure
+ *  diffusion with D = M A. For phi = phi0 cos(k x) each forward Euler
+ *  step of size dt multiplies phi by 1 + dt D sigma, where
+ *  sigma = 2(cos k - 1) is the eigenvalue of the discrete Laplacian.
+ *
+ *  N sub-steps of dt = 1/N (fd_order_parameter_substeps) and one step
+ *  of dt = N (fd_order_parameter_interval) must reproduce this, and
+ *  agree with the same interval taken in unit steps to O(dt^2).
+ *
+ *****************************************************************************/
+
+int test_phi_ch_dt(pe_t * pe) {
+
+  int nhalo = 2;
+  int ntotal[3] = {16, 16, 8};
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  double mobility = 0.5;
+  double * phi1 = NULL;
+  double * phin = NULL;
+  PI_DOUBLE(pi);
+
+  cs_t * cs = NULL;
+  lees_edw_t * le = NULL;
+  physics_t * phys = NULL;
+  field_t * phi = NULL;
+  field_grad_t * dphi = NULL;
+  fe_symm_t * fe = NULL;
+  fe_symm_param_t param = {0.2, 0.0, 0.0, 0.0, 0.0};
+  phi_ch_info_t info = {.conserve = 0};
+  phi_ch_t * ch = NULL;
+
+  physics_ref(&phys);
+  physics_mobility_set(phys, mobility);
+
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+
+  {
+    lees_edw_options_t opts = {0};
+    lees_edw_create(pe, cs, &opts, &le);
+  }
+
+  {
+    field_options_t opts = field_options_ndata_nhalo(1, nhalo);
+    field_create(pe, cs, le, "phi", &opts, &phi);
+    field_grad_create(pe, phi, 2, &dphi);
+    field_grad_set(dphi, grad_3d_7pt_fluid_d2, NULL);
+  }
+
+  fe_symm_create(pe, cs, phi, dphi, &fe);
+  fe_symm_param_set(fe, param);
+  phi_ch_create(pe, cs, le, &info, &ch);
+
+  phi1 = (double *) malloc(phi->nsites*sizeof(double));
+  phin = (double *) malloc(phi->nsites*sizeof(double));
+  assert(phi1);
+  assert(phin);
+
+  {
+    int nstep = 4;
+    double k = 2.0*pi/ntotal[X];
+    double x = mobility*param.a*2.0*(cos(k) - 1.0);
+    double g1 = pow(1.0 + x, nstep);          /* nstep unit steps */
+    double gsub = pow(1.0 + x/nstep, nstep);  /* nstep sub-steps */
+    double gint = 1.0 + nstep*x;              /* one step dt = nstep */
+
+    /* One unit step is the reference for the sub-steps */
+
+    test_phi_ch_dt_steps(ch, (fe_t *) fe, phi, dphi, 1.0, 1);
+    memcpy(phi1, phi->data, phi->nsites*sizeof(double));
+
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(cs, ic, jc, kc);
+	  double phi0 = cos(k*(noffset[X] + ic));
+	  assert(fabs(phi1[index] - (1.0 + x)*phi0) < 1.0e-14);
+	}
+      }
+    }
+
+    /* nstep sub-steps of dt = 1/nstep in one LB step */
+
+    phi_ch_dt_set(ch, 1.0/nstep);
+    test_phi_ch_dt_steps(ch, (fe_t *) fe, phi, dphi, 1.0/nstep, nstep);
+
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(cs, ic, jc, kc);
+	  double phi0 = cos(k*(noffset[X] + ic));
+	  assert(fabs(phi->data[index] - gsub*phi0) < 1.0e-14);
+	  assert(fabs(phi->data[index] - phi1[index]) < 0.5*x*x);
+	}
+      }
+    }
+
+    /* One step of dt = nstep against nstep unit steps */
+
+    phi_ch_dt_set(ch, 1.0);
+    test_phi_ch_dt_steps(ch, (fe_t *) fe, phi, dphi, 1.0, nstep);
+    memcpy(phin, phi->data, phi->nsites*sizeof(double));
+
+    phi_ch_dt_set(ch, 1.0*nstep);
+    test_phi_ch_dt_steps(ch, (fe_t *) fe, phi, dphi, 1.0*nstep, 1);
+
+    for (int ic = 1; ic <= nlocal[X]; ic++) {
+      for (int jc = 1; jc <= nlocal[Y]; jc++) {
+	for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	  int index = cs_index(cs, ic, jc, kc);
+	  double phi0 = cos(k*(noffset[X] + ic));
+	  assert(fabs(phin[index] - g1*phi0) < 1.0e-14);
+	  assert(fabs(phi->data[index] - gint*phi0) < 1.0e-14);
+	  assert(fabs(phi->data[index] - phin[index]) < 0.5*nstep*nstep*x*x);
+	}
+      }
+    }
+  }
+
+  free(phin);
+  free(phi1);
+  phi_ch_free(ch);
+  fe_symm_free(fe);
+  field_grad_free(dphi);
+  field_free(phi);
+  lees_edw_free(le);
+  cs_free(cs);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_phi_ch_dt_steps
+ *
+ *  From phi = cos(k x) at local sites, take nstep updates each of
+ *  time step dt, with halo and gradients between steps as in the
+ *  sub-cycled time step loop. The time step must already be set.
+ *
+ *****************************************************************************/
+
+static int test_phi_ch_dt_steps(phi_ch_t * ch, fe_t * fe, field_t * phi,
+				field_grad_t * dphi, double dt, int nstep) {
+
+  int nlocal[3] = {0};
+  int noffset[3] = {0};
+  int ntotal[3] = {0};
+  PI_DOUBLE(pi);
+
+  assert(ch);
+  assert(fabs(ch->dt - dt) < DBL_EPSILON);
+
+  cs_ntotal(ch->cs, ntotal);
+  cs_nlocal(ch->cs, nlocal);
+  cs_nlocal_offset(ch->cs, noffset);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(ch->cs, ic, jc, kc);
+	double rx = 2.0*pi*(noffset[X] + ic)/ntotal[X];
+	field_scalar_set(phi, index, cos(rx));
+      }
+    }
+  }
+
+  for (int n = 0; n < nstep; n++) {
+    field_halo(phi);
+    field_grad_compute(dphi);
+    phi_cahn_hilliard(ch, fe, phi, NULL, NULL, NULL);
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_phi_ch_laplacian
+ *
+ *  Seven-point Laplacian of field "in" at local sites.
+ *
+ *****************************************************************************/
+
+static int test_phi_ch_laplacian(cs_t * cs, field_t * in, double * out) {
+
+  int nlocal[3] = {0};
+
+  assert(cs);
+  assert(in);
+  assert(out);
+
+  cs_nlocal(cs, nlocal);
+  field_halo(in);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+      for (int kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	out[index] = in->data[cs_index(cs, ic-1, jc, kc)]
+	  +          in->data[cs_index(cs, ic+1, jc, kc)]
+	  +          in->data[cs_index(cs, ic, jc-1, kc)]
+	  +          in->data[cs_index(cs, ic, jc+1, kc)]
+	  +          in->data[cs_index(cs, ic, jc, kc-1)]
+	  +          in->data[cs_index(cs, ic, jc, kc+1)]
+	  -      6.0*in->data[index];
+      }
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,323 @@
+/*****************************************************************************
+ *
+ *  test_phi_force.c
+ *
+ *  Force on the fluid from the divergence of the thermodynamic stress
+ *  computed via the momentum fluxes (Lees-Edwards planes present).
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "lb_data.h"
+#include "map.h"
+#include "wall.h"
+#include "gradient_3d_7pt_fluid.h"
+#include "symmetric.h"
+#include "phi_force.h"
+#include "util.h"
+#include "tests.h"
+
+int test_phi_force_flux(pe_t * pe, cs_t * cs);
+static int test_phi_force_flux_reference(lees_edw_t * le, fe_t * fe,
+					 double * fref);
+
+/*****************************************************************************
+ *
+ *  test_phi_force_suite
+ *
+ *****************************************************************************/
+
+int test_phi_force_suite(void) {
+
+  int nhalo = 2;
+  int ntotal[3] = {16, 8, 8};
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  physics_create(pe, &phys);
+
+  cs_create(pe, &cs);
+  cs_nhalo_set(cs, nhalo);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+
+  test_phi_force_flux(pe, cs);
+
+  pe_info(pe, "PASS     ./unit/test_phi_force\n");
+
+  cs_free(cs);
+  physics_free(phys);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_phi_force_flux
+ *
+ *  Two Lees-Edwards planes with a non-zero displacement, so that the
+ *  flux correction at the planes is required. The force must agree
+ *  with a serial evaluation of the stress at each face in turn.
+ *
+ *****************************************************************************/
+
+int test_phi_force_flux(pe_t * pe, cs_t * cs) {
+
+  int ifail = 0;
+  int nhalo = 0;
+  int nlocal[3];
+  int noffset[3];
+  int ic, jc, kc, index;
+  int nall;
+  double ltot[3];
+  double * fref = NULL;
+  PI_DOUBLE(pi);
+
+  lees_edw_options_t leopts = {.nplanes = 2, .type = LE_SHEAR_TYPE_STEADY,
+			       .nt0 = 0, .uy = 0.0173};
+  fe_symm_param_t param = {-0.0625, 0.0625, 0.04, 0.0, 0.0};
+  lb_data_options_t lbopts = lb_data_options_default();
+  hydro_options_t hopts = hydro_options_default();
+  field_options_t fopts = {0};
+
+  lees_edw_t * le = NULL;
+  field_t * phi = NULL;
+  field_grad_t * dphi = NULL;
+  fe_symm_t * fe = NULL;
+  pth_t * pth = NULL;
+  hydro_t * hydro = NULL;
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+  wall_t * wall = NULL;
+  physics_t * phys = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  /* Time 7 gives a displacement which is not a whole number of sites */
+
+  physics_ref(&phys);
+  physics_control_init_time(phys, 7, 1);
+
+  cs_nhalo(cs, &nhalo);
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  cs_ltot(cs, ltot);
+
+  lees_edw_create(pe, cs, &leopts, &le);
+
+  fopts = field_options_ndata_nhalo(1, nhalo);
+  field_create(pe, cs, le, "phi", &fopts, &phi);
+  field_grad_create(pe, phi, 2, &dphi);
+  field_grad_set(dphi, grad_3d_7pt_fluid_d2, NULL);
+
+  fe_symm_create(pe, cs, phi, dphi, &fe);
+  fe_symm_param_set(fe, param);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	double x = 2.0*pi*(noffset[X] + ic)/ltot[X];
+	double y = 2.0*pi*(noffset[Y] + jc)/ltot[Y];
+	double z = 2.0*pi*(noffset[Z] + kc)/ltot[Z];
+	double phi0 = 0.5*sin(x)*cos(y) + 0.1*cos(z);
+	index = cs_index(cs, ic, jc, kc);
+	field_scalar_set(phi, index, phi0);
+      }
+    }
+  }
+
+  field_memcpy(phi, tdpMemcpyHostToDevice);
+  field_halo(phi);
+  field_grad_compute(dphi);
+  field_memcpy(phi, tdpMemcpyDeviceToHost);
+  field_grad_memcpy(dphi, tdpMemcpyDeviceToHost);
+
+  hydro_create(pe, cs, le, &hopts, &hydro);
+  lb_data_create(pe, cs, &lbopts, &lb);
+  map_create(pe, cs, 0, &map);
+  wall_create(pe, cs, map, lb, &wall);
+  pth_create(pe, cs, FE_FORCE_METHOD_STRESS_DIVERGENCE, &pth);
+
+  /* Twice, to reuse the flux workspace */
+
+  phi_force_calculation(pe, cs, le, wall, pth, (fe_t *) fe, map, phi, hydro);
+  assert(pth->flux);
+  phi_force_calculation(pe, cs, le, wall, pth, (fe_t *) fe, map, phi, hydro);
+  hydro_memcpy(hydro, tdpMemcpyDeviceToHost);
+
+  lees_edw_nsites(le, &nall);
+  assert(pth->nflux == nall);
+
+  fref = (double *) calloc(3*nall, sizeof(double));
+  assert(fref);
+
+  test_phi_force_flux_reference(le, (fe_t *) fe, fref);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	double f[3] = {0};
+	index = lees_edw_index(le, ic, jc, kc);
+	hydro_f_local(hydro, index, f);
+	if (fabs(f[X] - 2.0*fref[3*index + X]) > DBL_EPSILON) ifail += 1;
+	if (fabs(f[Y] - 2.0*fref[3*index + Y]) > DBL_EPSILON) ifail += 1;
+	if (fabs(f[Z] - 2.0*fref[3*index + Z]) > DBL_EPSILON) ifail += 1;
+      }
+    }
+  }
+
+  assert(ifail == 0);
+
+  free(fref);
+  pth_free(pth);
+  wall_free(wall);
+  map_free(map);
+  lb_free(lb);
+  hydro_free(hydro);
+  fe_symm_free(fe);
+  field_grad_free(dphi);
+  field_free(phi);
+  lees_edw_free(le);
+
+  physics_control_init_time(phys, 0, 0);
+
+  return ifail;
+}
+
+/*****************************************************************************
+ *
+ *  test_phi_force_flux_reference
+ *
+ *  Host evaluation of the force with the stress evaluated afresh
+ *  at each face, followed by the plane correction, in the manner of
+ *  the original host code. One MPI task only is assumed for the
+ *  plane sums.
+ *
+ *****************************************************************************/
+
+static int test_phi_force_flux_reference(lees_edw_t * le, fe_t * fe,
+					 double * fref) {
+  int ic, jc, kc, ia, ip;
+  int nall;
+  int nlocal[3];
+  double ltot[3];
+  double * fluxe = NULL;
+  double * fluxw = NULL;
+  double * fluxy = NULL;
+  double * fluxz = NULL;
+
+  assert(le);
+  assert(fe);
+  assert(fref);
+
+  lees_edw_nsites(le, &nall);
+  lees_edw_nlocal(le, nlocal);
+  lees_edw_ltot(le, ltot);
+
+  fluxe = (double *) calloc(3*nall, sizeof(double));
+  fluxw = (double *) calloc(3*nall, sizeof(double));
+  fluxy = (double *) calloc(3*nall, sizeof(double));
+  fluxz = (double *) calloc(3*nall, sizeof(double));
+  assert(fluxe && fluxw && fluxy && fluxz);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    int icm1 = lees_edw_ic_to_buff(le, ic, -1);
+    int icp1 = lees_edw_ic_to_buff(le, ic, +1);
+    for (jc = 0; jc <= nlocal[Y]; jc++) {
+      for (kc = 0; kc <= nlocal[Z]; kc++) {
+	double pth0[3][3];
+	double pth1[3][3];
+	int index = lees_edw_index(le, ic, jc, kc);
+
+	fe->func->stress(fe, index, pth0);
+
+	fe->func->stress(fe, lees_edw_index(le, icm1, jc, kc), pth1);
+	for (ia = 0; ia < 3; ia++) {
+	  fluxw[3*index + ia] = 0.5*(pth1[ia][X] + pth0[ia][X]);
+	}
+	fe->func->stress(fe, lees_edw_index(le, icp1, jc, kc), pth1);
+	for (ia = 0; ia < 3; ia++) {
+	  fluxe[3*index + ia] = 0.5*(pth1[ia][X] + pth0[ia][X]);
+	}
+	fe->func->stress(fe, lees_edw_index(le, ic, jc + 1, kc), pth1);
+	for (ia = 0; ia < 3; ia++) {
+	  fluxy[3*index + ia] = 0.5*(pth1[ia][Y] + pth0[ia][Y]);
+	}
+	fe->func->stress(fe, lees_edw_index(le, ic, jc, kc + 1), pth1);
+	for (ia = 0; ia < 3; ia++) {
+	  fluxz[3*index + ia] = 0.5*(pth1[ia][Z] + pth0[ia][Z]);
+	}
+      }
+    }
+  }
+
+  /* Plane correction */
+
+  for (ip = 0; ip < lees_edw_nplane_local(le); ip++) {
+    double fbar[3] = {0.0, 0.0, 0.0};
+    double ra = 0.5/(ltot[Y]*ltot[Z]);
+    ic = lees_edw_plane_location(le, ip);
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	int index  = lees_edw_index(le, ic, jc, kc);
+	int index1 = lees_edw_index(le, ic + 1, jc, kc);
+	for (ia = 0; ia < 3; ia++) {
+	  fbar[ia] += - fluxe[3*index + ia] + fluxw[3*index1 + ia];
+	}
+      }
+    }
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	int index  = lees_edw_index(le, ic, jc, kc);
+	int index1 = lees_edw_index(le, ic + 1, jc, kc);
+	for (ia = 0; ia < 3; ia++) {
+	  fluxe[3*index  + ia] += ra*fbar[ia];
+	  fluxw[3*index1 + ia] -= ra*fbar[ia];
+	}
+      }
+    }
+  }
+
+  /* Divergence */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	int index  = lees_edw_index(le, ic, jc, kc);
+	int indexj = lees_edw_index(le, ic, jc - 1, kc);
+	int indexk = lees_edw_index(le, ic, jc, kc - 1);
+	for (ia = 0; ia < 3; ia++) {
+	  fref[3*index + ia] = -(+ fluxe[3*index + ia] - fluxw[3*index + ia]
+				 + fluxy[3*index + ia] - fluxy[3*indexj + ia]
+				 + fluxz[3*index + ia] - fluxz[3*indexk + ia]);
+	}
+      }
+    }
+  }
+
+  free(fluxz);
+  free(fluxy);
+  free(fluxw);
+  free(fluxe);
+
+  return 0;
+}
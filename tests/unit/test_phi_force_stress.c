@@ -0,0 +1,141 @@
+/*****************************************************************************
+ *
+ *  test_phi_force_stress.c
+ *
+ *  Storage of the thermodynamic stress, and its time step stamp.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "fe_null.h"
+#include "phi_force_stress.h"
+#include "tests.h"
+
+int test_pth_create(pe_t * pe, cs_t * cs);
+int test_pth_stress_current(pe_t * pe, cs_t * cs);
+
+/*****************************************************************************
+ *
+ *  test_phi_force_stress_suite
+ *
+ *****************************************************************************/
+
+int test_phi_force_stress_suite(void) {
+
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_init(cs);
+  physics_create(pe, &phys);
+
+  test_pth_create(pe, cs);
+  test_pth_stress_current(pe, cs);
+
+  pe_info(pe, "PASS     ./unit/test_phi_force_stress\n");
+
+  physics_free(phys);
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_pth_create
+ *
+ *****************************************************************************/
+
+int test_pth_create(pe_t * pe, cs_t * cs) {
+
+  int nsites = 0;
+  pth_t * pth = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  pth_create(pe, cs, FE_FORCE_METHOD_STRESS_DIVERGENCE, &pth);
+  assert(pth);
+
+  cs_nsites(cs, &nsites);
+  assert(pth->nsites == nsites);
+  assert(pth->stamp == -1);
+  assert(pth_stress_current(pth) == 0);
+
+  pth_free(pth);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_pth_stress_current
+ *
+ *  The full stress is current only for the step at which it was
+ *  computed; the antisymmetric part alone is never current.
+ *
+ *****************************************************************************/
+
+int test_pth_stress_current(pe_t * pe, cs_t * cs) {
+
+  int index;
+  double p[3][3] = {0};
+  fe_null_t * fe = NULL;
+  pth_t * pth = NULL;
+  physics_t * phys = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  physics_ref(&phys);
+  physics_control_init_time(phys, 10, 2);
+
+  fe_null_create(pe, &fe);
+  pth_create(pe, cs, FE_FORCE_METHOD_STRESS_DIVERGENCE, &pth);
+
+  pth_stress_compute(pth, (fe_t *) fe);
+  assert(pth->stamp == 10);
+  assert(pth_stress_current(pth));
+
+  /* The null free energy has zero stress */
+
+  pth_memcpy(pth, tdpMemcpyDeviceToHost);
+  index = cs_index(cs, 1, 1, 1);
+  pth_stress(pth, index, p);
+  assert(fabs(p[X][Y]) < DBL_EPSILON);
+
+  physics_control_next_step(phys);
+  assert(pth_stress_current(pth) == 0);
+
+  pth_stress_compute(pth, (fe_t *) fe);
+  assert(pth_stress_current(pth));
+
+  fe->super.use_stress_relaxation = 1;
+  pth_stress_compute(pth, (fe_t *) fe);
+  assert(pth->stamp == -1);
+  assert(pth_stress_current(pth) == 0);
+
+  pth_free(pth);
+  fe_null_free(fe);
+
+  physics_control_init_time(phys, 0, 0);
+
+  return 0;
+}
@@ -10,7 +10,7 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinbrugh
+ *  (c) 2010-2023 The University of Edinbrugh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
@@ -34,6 +34,8 @@ static int test_polar_active_aster(fe_polar_t * fe, cs_t * cs, field_t * fp,
 				   field_grad_t * fpgrad);
 static int test_polar_active_terms(fe_polar_t * fe, cs_t * cs, field_t * fp,
 				   field_grad_t * fpgrad);
+static int test_polar_active_vector(fe_polar_t * fe, cs_t * cs, field_t * fp,
+				    field_grad_t * fpgrad);
 static int test_polar_active_init_aster(cs_t * cs, field_t * fp);
 
 /*****************************************************************************
@@ -84,6 +86,7 @@ int test_polar_active_suite(void) {
 
   test_polar_active_aster(fe, cs, fp, fpgrad);
   test_polar_active_terms(fe, cs, fp, fpgrad);
+  test_polar_active_vector(fe, cs, fp, fpgrad);
 
   fe_polar_free(fe);
   field_grad_free(fpgrad);
@@ -285,6 +288,71 @@ int test_polar_active_terms(fe_polar_t * fe, cs_t * cs, field_t * fp,
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  test_polar_active_vector
+ *
+ *  The vectorised free energy density, molecular field, and stress
+ *  must agree with the scalar versions at each site.
+ *
+ *****************************************************************************/
+
+static int test_polar_active_vector(fe_polar_t * fe, cs_t * cs, field_t * fp,
+				    field_grad_t * fpgrad) {
+
+  int nlocal[3] = {0};
+  fe_polar_param_t param = {0};
+
+  cs_nlocal(cs, nlocal);
+
+  param.a = -0.1;
+  param.b = +0.1;
+  param.kappa1 = 0.01;
+  param.lambda = 2.1;
+  param.zeta   = 0.001;
+  fe_polar_param_set(fe, param);
+
+  test_polar_active_init_aster(cs, fp);
+  field_halo_swap(fp, FIELD_HALO_HOST);
+  field_grad_compute(fpgrad);
+
+  for (int ic = 1; ic <= nlocal[X]; ic++) {
+    for (int jc = 1; jc <= nlocal[Y]; jc++) {
+
+      int index = cs_index(cs, ic, jc, 1);
+      double fed[NSIMDVL] = {0};
+      double h[3][NSIMDVL] = {0};
+      double s[3][3][NSIMDVL] = {0};
+
+      fe_polar_fed_v(fe, index, fed);
+      fe_polar_mol_field_v(fe, index, h);
+      fe_polar_stress_v(fe, index, s);
+
+      for (int iv = 0; iv < NSIMDVL; iv++) {
+	double fed1 = 0.0;
+	double h1[3] = {0};
+	double s1[3][3] = {0};
+
+	if (index + iv >= fp->nsites) break;
+
+	fe_polar_fed(fe, index + iv, &fed1);
+	fe_polar_mol_field(fe, index + iv, h1);
+	fe_polar_stress(fe, index + iv, s1);
+
+	test_assert(fabs(fed[iv] - fed1) < DBL_EPSILON);
+	for (int ia = 0; ia < 3; ia++) {
+	  test_assert(fabs(h[ia][iv] - h1[ia]) < DBL_EPSILON);
+	  for (int ib = 0; ib < 3; ib++) {
+	    test_assert(fabs(s[ia][ib][iv] - s1[ia][ib]) < DBL_EPSILON);
+	  }
+	}
+      }
+    }
+  }
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  test_polar_active_init_aster
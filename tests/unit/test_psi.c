@@ -41,7 +41,7 @@ int test_psi_suite(void) {
   pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
 
   /* Changes in psi_t should be accompanied by changes in tests... */
-  assert(sizeof(psi_t) == 576);
+  assert(sizeof(psi_t) == 584);
 
   test_psi_initialise(pe);
   test_psi_create(pe);
@@ -121,6 +121,7 @@ int test_psi_initialise(pe_t * pe) {
     /* Nernst Planck */
     assert(psi.multisteps == opts.nsmallstep);
     assert(fabs(psi.diffacc - opts.diffacc) < DBL_EPSILON);
+    assert(psi.rhonew     != NULL);
 
     /* Other */
     assert(psi.method == opts.method);
@@ -0,0 +1,304 @@
+/*****************************************************************************
+ *
+ *  test_subgrid.c
+ *
+ *  Sub-grid particle interpolation and force spreading.
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Contributing authors:
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include "pe.h"
+#include "coords.h"
+#include "physics.h"
+#include "lb_data.h"
+#include "map.h"
+#include "colloids_halo.h"
+#include "subgrid.h"
+#include "tests.h"
+
+/* Number of particles in the spreading test */
+#define TEST_SUBGRID_NPART 66
+
+int test_subgrid_interpolation(pe_t * pe, cs_t * cs);
+int test_subgrid_spread(pe_t * pe, cs_t * cs, int nc);
+static double test_d_peskin(double r);
+
+/*****************************************************************************
+ *
+ *  test_subgrid_suite
+ *
+ *****************************************************************************/
+
+int test_subgrid_suite(void) {
+
+  int ntotal[3] = {32, 32, 32};
+  pe_t * pe = NULL;
+  cs_t * cs = NULL;
+  physics_t * phys = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+  cs_create(pe, &cs);
+  cs_ntotal_set(cs, ntotal);
+  cs_init(cs);
+  physics_create(pe, &phys);
+
+  test_subgrid_interpolation(pe, cs);
+
+  /* Wide cells (coloured spreading) and narrow cells (atomic) */
+  test_subgrid_spread(pe, cs, 2);
+  test_subgrid_spread(pe, cs, 16);
+
+  pe_info(pe, "PASS     ./unit/test_subgrid\n");
+
+  physics_free(phys);
+  cs_free(cs);
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_subgrid_interpolation
+ *
+ *  The Peskin delta function reproduces a linear velocity field exactly
+ *  (weights sum to unity and have zero first moment).
+ *
+ *****************************************************************************/
+
+int test_subgrid_interpolation(pe_t * pe, cs_t * cs) {
+
+  int index, nsites;
+  int ncell[3] = {2, 2, 2};
+  int noffset[3];
+  int ijk[3];
+  double r0[3] = {16.3, 15.7, 16.5};
+  double u0[3] = {0.01, -0.02, 0.005};
+  double du[3] = {0.001, 0.002, -0.003};
+
+  lees_edw_t * le = NULL;
+  hydro_options_t opts = hydro_options_default();
+  hydro_t * hydro = NULL;
+  colloid_t * pc = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  lees_edw_create(pe, cs, NULL, &le);
+  hydro_create(pe, cs, le, &opts, &hydro);
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+
+  /* u = u0 + du.x in global coordinates at all sites */
+
+  cs_nsites(cs, &nsites);
+  cs_nlocal_offset(cs, noffset);
+
+  for (index = 0; index < nsites; index++) {
+    double u[3];
+    cs_index_to_ijk(cs, index, ijk);
+    u[X] = u0[X] + du[X]*(noffset[X] + ijk[X]);
+    u[Y] = u0[Y] + du[Y]*(noffset[Y] + ijk[Y]);
+    u[Z] = u0[Z] + du[Z]*(noffset[Z] + ijk[Z]);
+    hydro_u_set(hydro, index, u);
+  }
+
+  colloids_info_add_local(cinfo, 1, r0, &pc);
+  if (pc) {
+    pc->s.type = COLLOID_TYPE_SUBGRID;
+    pc->s.a0 = 0.1;
+    pc->s.ah = 0.1;
+    pc->s.al = 0.1;
+  }
+  colloids_info_ntotal_set(cinfo);
+  cinfo->nsubgrid = 1;
+
+  colloids_halo_state(cinfo);
+
+  /* No external force and no noise: the particle velocity is the
+   * interpolated fluid velocity. */
+
+  subgrid_update(cinfo, hydro, 0);
+
+  if (pc) {
+    assert(fabs(pc->s.v[X] - (u0[X] + du[X]*r0[X])) < FLT_EPSILON);
+    assert(fabs(pc->s.v[Y] - (u0[Y] + du[Y]*r0[Y])) < FLT_EPSILON);
+    assert(fabs(pc->s.v[Z] - (u0[Z] + du[Z]*r0[Z])) < FLT_EPSILON);
+    assert(fabs(pc->s.dr[X] - pc->s.v[X]) < DBL_EPSILON);
+  }
+
+  colloids_info_free(cinfo);
+  hydro_free(hydro);
+  lees_edw_free(le);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_subgrid_spread
+ *
+ *  The force spread to each fluid site must agree with a serial
+ *  evaluation of the delta function over all particles (and their
+ *  periodic images). Many particles are placed in the same cell, and
+ *  close enough to share lattice sites, so that any conflicting
+ *  updates are exposed if run with OMP_NUM_THREADS > 1.
+ *
+ *****************************************************************************/
+
+int test_subgrid_spread(pe_t * pe, cs_t * cs, int nc) {
+
+  int ic, jc, kc, index;
+  int n;
+  int ncell[3] = {nc, nc, nc};
+  int nlocal[3];
+  int noffset[3];
+  int ntotal[3];
+  int ifail = 0;
+  double fex[3] = {0.1, -0.2, 0.3};
+  double flocal[3] = {0.0, 0.0, 0.0};
+  double fsum[3] = {0.0, 0.0, 0.0};
+  double r0[TEST_SUBGRID_NPART][3];
+  MPI_Comm comm;
+
+  lb_t * lb = NULL;
+  map_t * map = NULL;
+  wall_t * wall = NULL;
+  lees_edw_t * le = NULL;
+  lb_data_options_t lbopts = lb_data_options_default();
+  hydro_options_t opts = hydro_options_default();
+  hydro_t * hydro = NULL;
+  colloids_info_t * cinfo = NULL;
+
+  assert(pe);
+  assert(cs);
+
+  /* A cluster of particles near the centre (one cell if nc = 2),
+   * and two near the periodic boundaries. */
+
+  for (n = 0; n < TEST_SUBGRID_NPART - 2; n++) {
+    r0[n][X] = 15.5 + 0.05*(n % 4);
+    r0[n][Y] = 16.0 + 0.05*((n/4) % 4);
+    r0[n][Z] = 16.2 - 0.05*(n/16);
+  }
+  r0[n][X] =  1.2; r0[n][Y] =  8.3; r0[n][Z] = 31.7; n += 1;
+  r0[n][X] = 31.9; r0[n][Y] = 31.9; r0[n][Z] = 31.9;
+
+  lees_edw_create(pe, cs, NULL, &le);
+  hydro_create(pe, cs, le, &opts, &hydro);
+  lb_data_create(pe, cs, &lbopts, &lb);
+  map_create(pe, cs, 0, &map);
+  wall_create(pe, cs, map, lb, &wall);
+
+  colloids_info_create(pe, cs, ncell, &cinfo);
+  colloids_info_map_init(cinfo);
+
+  for (n = 0; n < TEST_SUBGRID_NPART; n++) {
+    colloid_t * pc = NULL;
+    colloids_info_add_local(cinfo, 1 + n, r0[n], &pc);
+    if (pc) {
+      pc->s.type = COLLOID_TYPE_SUBGRID;
+      pc->s.a0 = 0.1;
+      pc->s.ah = 0.1;
+      pc->s.al = 0.1;
+      pc->fex[X] = fex[X];
+      pc->fex[Y] = fex[Y];
+      pc->fex[Z] = fex[Z];
+    }
+  }
+  colloids_info_ntotal_set(cinfo);
+  cinfo->nsubgrid = TEST_SUBGRID_NPART;
+
+  colloids_halo_state(cinfo);
+  subgrid_force_from_particles(cinfo, hydro, wall);
+
+  cs_nlocal(cs, nlocal);
+  cs_nlocal_offset(cs, noffset);
+  cs_ntotal(cs, ntotal);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	double f[3] = {0};
+	double fref[3] = {0};
+	index = cs_index(cs, ic, jc, kc);
+	hydro_f_local(hydro, index, f);
+	flocal[X] += f[X];
+	flocal[Y] += f[Y];
+	flocal[Z] += f[Z];
+
+	/* Serial reference (nearest periodic image) */
+	for (n = 0; n < TEST_SUBGRID_NPART; n++) {
+	  double dr[3];
+	  double w;
+	  dr[X] = 1.0*(noffset[X] + ic) - r0[n][X];
+	  dr[Y] = 1.0*(noffset[Y] + jc) - r0[n][Y];
+	  dr[Z] = 1.0*(noffset[Z] + kc) - r0[n][Z];
+	  dr[X] -= ntotal[X]*round(dr[X]/ntotal[X]);
+	  dr[Y] -= ntotal[Y]*round(dr[Y]/ntotal[Y]);
+	  dr[Z] -= ntotal[Z]*round(dr[Z]/ntotal[Z]);
+	  w = test_d_peskin(dr[X])*test_d_peskin(dr[Y])*test_d_peskin(dr[Z]);
+	  fref[X] += w*fex[X];
+	  fref[Y] += w*fex[Y];
+	  fref[Z] += w*fex[Z];
+	}
+	if (fabs(f[X] - fref[X]) > FLT_EPSILON) ifail += 1;
+	if (fabs(f[Y] - fref[Y]) > FLT_EPSILON) ifail += 1;
+	if (fabs(f[Z] - fref[Z]) > FLT_EPSILON) ifail += 1;
+      }
+    }
+  }
+
+  assert(ifail == 0);
+
+  cs_cart_comm(cs, &comm);
+  MPI_Allreduce(flocal, fsum, 3, MPI_DOUBLE, MPI_SUM, comm);
+
+  assert(fabs(fsum[X] - TEST_SUBGRID_NPART*fex[X]) < FLT_EPSILON);
+  assert(fabs(fsum[Y] - TEST_SUBGRID_NPART*fex[Y]) < FLT_EPSILON);
+  assert(fabs(fsum[Z] - TEST_SUBGRID_NPART*fex[Z]) < FLT_EPSILON);
+
+  colloids_info_free(cinfo);
+  wall_free(wall);
+  map_free(map);
+  lb_free(lb);
+  hydro_free(hydro);
+  lees_edw_free(le);
+
+  return ifail;
+}
+
+/*****************************************************************************
+ *
+ *  test_d_peskin
+ *
+ *  Reference Peskin delta function (cf. subgrid.c).
+ *
+ *****************************************************************************/
+
+static double test_d_peskin(double r) {
+
+  double rmod = fabs(r);
+  double delta = 0.0;
+
+  if (rmod <= 1.0) {
+    delta = 0.125*(3.0 - 2.0*rmod + sqrt(1.0 + 4.0*rmod - 4.0*rmod*rmod));
+  }
+  else if (rmod <= 2.0) {
+    delta = 0.125*(5.0 - 2.0*rmod - sqrt(-7.0 + 12.0*rmod - 4.0*rmod*rmod));
+  }
+
+  return delta;
+}
@@ -7,13 +7,14 @@
  *  Edinburgh Soft Matter and Statistical Physics Group and
  *  Edinburgh Parallel Computing Centre
  *
- *  (c) 2010-2017 The University of Edinburgh
+ *  (c) 2010-2023 The University of Edinburgh
  *
  *  Contributing authors:
  *  Kevin Stratford (kevin@epcc.ed.ac.uk)
  *
  *****************************************************************************/
 
+#include <assert.h>
 #include <time.h>
 #include <limits.h>
 
@@ -37,6 +38,14 @@ int test_timer_suite(void) {
   TIMER_start(TIMER_TOTAL);
   TIMER_stop(TIMER_TOTAL);
 
+  /* A timer with a count of work items, which accumulates */
+  assert(timer_count(TIMER_REBUILD_LINKS) == 0);
+  TIMER_start(TIMER_REBUILD_LINKS);
+  TIMER_count(TIMER_REBUILD_LINKS, 1);
+  TIMER_count(TIMER_REBUILD_LINKS, 41);
+  TIMER_stop(TIMER_REBUILD_LINKS);
+  assert(timer_count(TIMER_REBUILD_LINKS) == 42);
+
   pe_info(pe, "PASS     ./unit/test_timer\n");
   pe_free(pe);
 
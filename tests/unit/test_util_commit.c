@@ -0,0 +1,171 @@
+/*****************************************************************************
+ *
+ *  test_util_commit.c
+ *
+ *
+ *  Edinburgh Soft Matter and Statistical Physics Group and
+ *  Edinburgh Parallel Computing Centre
+ *
+ *  (c) 2023 The University of Edinburgh
+ *
+ *  Kevin Stratford (kevin@epcc.ed.ac.uk)
+ *
+ *****************************************************************************/
+
+#include <assert.h>
+
+#include "pe.h"
+#include "util_commit.h"
+
+int test_util_commit_required(void);
+int test_util_commit_reset(void);
+int test_util_commit_owner(void);
+
+/*****************************************************************************
+ *
+ *  test_util_commit_suite
+ *
+ *****************************************************************************/
+
+int test_util_commit_suite(void) {
+
+  pe_t * pe = NULL;
+
+  pe_create(MPI_COMM_WORLD, PE_QUIET, &pe);
+
+  test_util_commit_required();
+  test_util_commit_reset();
+  test_util_commit_owner();
+
+  pe_info(pe, "%-9s %s\n", "PASS", __FILE__);
+
+  pe_free(pe);
+
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ *  test_util_commit_required
+ *
+ *****************************************************************************/
+
+int test_util_commit_required(void) {
+
+  int ifail = 0;
+  double param[3] = {1.0, 2.0, 3.0};
+  util_commit_t commit = {0};
+
+  /* First request always requires a commit */
+  ifail = util_commit_required(&commit, "test", param, sizeof(param));
+  assert(ifail == 1);
+
+  /* No change */
+  ifail = util_commit_required(&commit, "test", param, sizeof(param));
+  assert(ifail == 0);
+
+  /* A change */
+  param[2] = 4.0;
+  ifail = util_commit_required(&commit, "test", param, sizeof(param));
+  assert(ifail == 1);
+  ifail = util_commit_required(&commit, "test", param, sizeof(param));
+  assert(ifail == 0);
+
+  /* A different parameter block of the same size and values */
+  {
+    double other[3] = {1.0, 2.0, 4.0};
+    ifail = util_commit_required(&commit, "test", other, sizeof(other));
+    assert(ifail == 0);
+  }
+
+  /* A different size */
+  ifail = util_commit_required(&commit, "test", param, 2*sizeof(double));
+  assert(ifail == 1);
+
+  assert(commit.nrequest == 6);
+  assert(commit.ncommit  == 3);
+
+  util_commit_reset(&commit);
+
+  return ifail;
+}
+
+/*****************************************************************************
+ *
+ *  test_util_commit_reset
+ *
+ *****************************************************************************/
+
+int test_util_commit_reset(void) {
+
+  int ifail = 0;
+  int param = 1;
+  util_commit_t commit = {0};
+
+  ifail = util_commit_required(&commit, "test", &param, sizeof(int));
+  assert(ifail == 1);
+
+  util_commit_reset(&commit);
+  assert(commit.last == NULL);
+
+  ifail = util_commit_required(&commit, "test", &param, sizeof(int));
+  assert(ifail == 1);
+
+  util_commit_reset(&commit);
+
+  return ifail;
+}
+
+/*****************************************************************************
+ *
+ *  test_util_commit_owner
+ *
+ *  Two objects sharing the same target symbol.
+ *
+ *****************************************************************************/
+
+int test_util_commit_owner(void) {
+
+  int ifail = 0;
+  double param[2] = {1.0, 2.0};
+  util_commit_t commit1 = {0};
+  util_commit_t commit2 = {0};
+
+  ifail = util_commit_required(&commit1, "test_owner", param, sizeof(param));
+  assert(ifail == 1);
+  ifail = util_commit_required(&commit1, "test_owner", param, sizeof(param));
+  assert(ifail == 0);
+
+  /* Same values from a different object must commit ... */
+  ifail = util_commit_required(&commit2, "test_owner", param, sizeof(param));
+  assert(ifail == 1);
+  ifail = util_commit_required(&commit2, "test_owner", param, sizeof(param));
+  assert(ifail == 0);
+
+  /* ... and the first object must then commit again */
+  ifail = util_commit_required(&commit1, "test_owner", param, sizeof(param));
+  assert(ifail == 1);
+
+  /* A different symbol is independent */
+  {
+    util_commit_t commit3 = {0};
+    ifail = util_commit_required(&commit3, "test_other", param, sizeof(param));
+    assert(ifail == 1);
+    ifail = util_commit_required(&commit1, "test_owner", param, sizeof(param));
+    assert(ifail == 0);
+    util_commit_reset(&commit3);
+  }
+
+  /* Releasing the owner means the next request must commit */
+  util_commit_reset(&commit1);
+  ifail = util_commit_required(&commit2, "test_owner", param, sizeof(param));
+  assert(ifail == 1);
+
+  assert(commit1.ncommit == 2);
+  assert(commit2.ncommit == 2);
+
+  util_commit_reset(&commit1);
+  util_commit_reset(&commit2);
+
+  return ifail;
+}
@@ -29,6 +29,7 @@
 int test_visc_arrhenius_create(pe_t * pe, cs_t * cs, field_t * phi);
 int test_visc_arrhenius_update(pe_t * pe, cs_t * cs, field_t * phi);
 int test_visc_arrhenius_eta_uniform(cs_t * cs, hydro_t * hydro, double eta0);
+int test_visc_arrhenius_local(pe_t * pe, cs_t * cs, field_t * phi);
 
 
 /*****************************************************************************
@@ -64,6 +65,7 @@ __host__ int test_visc_arrhenius_suite(void) {
 
     test_visc_arrhenius_create(pe, cs, phi);
     test_visc_arrhenius_update(pe, cs, phi);
+    test_visc_arrhenius_local(pe, cs, phi);
 
     field_free(phi);
     cs_free(cs);
@@ -199,6 +201,81 @@ int test_visc_arrhenius_update(pe_t * pe, cs_t * cs, field_t * phi) {
   return 0;
 }
 
+/*****************************************************************************
+ *
+ *  test_visc_arrhenius_local
+ *
+ *  The site-local form should agree with the update() at each site.
+ *
+ *****************************************************************************/
+
+int test_visc_arrhenius_local(pe_t * pe, cs_t * cs, field_t * phi) {
+
+  const double eta_plus  = 0.625;
+  const double eta_minus = 0.00625;
+  const double phistar   = 0.8;
+
+  visc_arrhenius_param_t param = {eta_minus, eta_plus, phistar};
+  visc_arrhenius_t * visc = NULL;
+  visc_local_t local = {0};
+
+  hydro_options_t hopts = hydro_options_nhalo(0);
+  hydro_t * hydro = NULL;
+
+  int nlocal[3];
+  int ic, jc, kc;
+
+  assert(pe);
+  assert(cs);
+  assert(phi);
+
+  cs_nlocal(cs, nlocal);
+
+  visc_arrhenius_create(pe, cs, phi, param, &visc);
+  visc_arrhenius_local(visc, &local);
+
+  assert(local.model == VISC_LOCAL_ARRHENIUS);
+  assert(local.phi == phi->target);
+  assert(visc->super.func->local);
+
+  /* A non-uniform composition in the range [-phistar, +phistar] */
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	int index = cs_index(cs, ic, jc, kc);
+	double phi0 = phistar*cos(0.1*ic + 0.2*jc + 0.3*kc);
+	field_scalar_set(phi, index, phi0);
+      }
+    }
+  }
+
+  hydro_create(pe, cs, NULL, &hopts, &hydro);
+  visc_arrhenius_update(visc, hydro);
+
+  for (ic = 1; ic <= nlocal[X]; ic++) {
+    for (jc = 1; jc <= nlocal[Y]; jc++) {
+      for (kc = 1; kc <= nlocal[Z]; kc++) {
+	int iv = 0;
+	int index = cs_index(cs, ic, jc, kc);
+	double eta0 = hydro->eta->data[addr_rank0(hydro->nsite, index)];
+	double eta[NSIMDVL] = {0};
+
+	/* Use a vector starting at this site */
+	if (index + NSIMDVL > hydro->nsite) continue;
+	visc_local_eta_v(&local, index, eta);
+	/* Round-off in the exponent is amplified by the exp() */
+	assert(fabs(eta[iv] - eta0) < 16.0*DBL_EPSILON*eta0);
+      }
+    }
+  }
+
+  hydro_free(hydro);
+  visc_arrhenius_free(visc);
+
+  return 0;
+}
+
 /*****************************************************************************
  *
  *  test_visc_arrhenius_eta_uniform
@@ -52,18 +52,23 @@ __host__ int tests_create(int argc, char ** argv) {
   
   test_kernel_suite();
   test_gradient_d3q27_suite();
+  test_advection_suite();
   test_angle_cosine_suite();
   test_assumptions_suite();
   test_be_suite();
   test_bond_fene_suite();
+  test_bbl_suite();
+  test_brownian_suite();
   test_bonds_suite();
   test_bp_suite();
+  test_bp_init_suite();
   test_build_suite();
   test_ch_suite();
   test_colloid_suite();
   test_colloid_sums_suite();
   test_colloids_info_suite();
   test_colloids_halo_suite();
+  test_colloids_init_suite();
   test_ewald_suite();
   test_fe_null_suite();
   test_fe_electro_suite();
@@ -111,6 +116,8 @@ __host__ int tests_create(int argc, char ** argv) {
   test_phi_bc_outflow_opts_suite();
   test_phi_bc_outflow_free_suite();
   test_phi_ch_suite();
+  test_phi_force_suite();
+  test_phi_force_stress_suite();
   test_polar_active_suite();
 
   test_psi_solver_options_suite(argc, argv);
@@ -126,9 +133,11 @@ __host__ int tests_create(int argc, char ** argv) {
   test_stencil_d3q19_suite();
   test_stencil_d3q27_suite();
   test_stencils_suite();
+  test_subgrid_suite();
   test_timer_suite();
   test_util_suite();
   test_util_bits_suite();
+  test_util_commit_suite();
   test_util_fopen_suite();
   test_util_io_suite();
   test_util_json_suite();
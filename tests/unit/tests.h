@@ -26,11 +26,15 @@ __host__ __device__ void test_assert_info(const int lvalue, int line,
 
 /* List of test drivers (see relevant file.c) */
 
+int test_advection_suite(void);
 int test_angle_cosine_suite(void);
 int test_assumptions_suite(void);
 int test_be_suite(void);
 int test_bp_suite(void);
+int test_bp_init_suite(void);
 int test_bond_fene_suite(void);
+int test_bbl_suite(void);
+int test_brownian_suite(void);
 int test_bonds_suite(void);
 int test_build_suite(void);
 int test_ch_suite(void);
@@ -38,6 +42,7 @@ int test_colloid_sums_suite(void);
 int test_colloid_suite(void);
 int test_colloids_info_suite(void);
 int test_colloids_halo_suite(void);
+int test_colloids_init_suite(void);
 int test_coords_suite(void);
 int test_cs_limits_suite(void);
 int test_ewald_suite(void);
@@ -90,6 +95,8 @@ int test_pair_ss_cut_ij_suite(void);
 int test_pair_yukawa_suite(void);
 int test_pe_suite(void);
 int test_phi_ch_suite(void);
+int test_phi_force_suite(void);
+int test_phi_force_stress_suite(void);
 int test_polar_active_suite(void);
 int test_lb_prop_suite(void);
 int test_phi_bc_inflow_opts_suite(void);
@@ -107,9 +114,11 @@ int test_stencil_d3q7_suite(void);
 int test_stencil_d3q19_suite(void);
 int test_stencil_d3q27_suite(void);
 int test_stencils_suite(void);
+int test_subgrid_suite(void);
 int test_timer_suite(void);
 int test_util_suite(void);
 int test_util_bits_suite(void);
+int test_util_commit_suite(void);
 int test_util_fopen_suite(void);
 int test_util_io_suite(void);
 int test_util_json_suite(void);
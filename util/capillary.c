@@ -10,6 +10,7 @@
  *
  *  The output should be capillary.dat      [for human consumption]
  *                       capillary.001-001  [for initial input to run]
+ *                       capillary.rle      [porous_media_format RLE]
  *
  *  Edinburgh Soft Matter and Statistcal Physics Group and
  *  Edinburgh Parallel Computing Centre
@@ -279,6 +280,9 @@ int main(int argc, char ** argv) {
     io_write_data(map->info, "capillary", map);
   }
 
+  /* Compact (run-length encoded) equivalent */
+  map_write_rle(map, "capillary.rle");
+
   map_free(map);
   cs_free(cs);
   pe_free(pe);